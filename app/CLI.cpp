@@ -11,39 +11,108 @@
 
 #include <CortidQCT/CortidQCT.h>
 
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <vector>
 
 using namespace CortidQCT;
 
+namespace {
+
+/// Inserts `-suffix` in front of the extension of `filename`
+std::string withSuffix(std::string const &filename, std::string const &suffix) {
+  if (suffix.empty() || filename == "/dev/null") return filename;
+
+  auto const sep = filename.find_last_of("/\\");
+  auto const dot = filename.find_last_of('.');
+  if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+    return filename + "-" + suffix;
+  }
+  return filename.substr(0, dot) + "-" + suffix + filename.substr(dot);
+}
+
+} // anonymous namespace
+
 int main(int argc, char **argv) {
   using namespace std::string_literals;
 
-  if (argc != 4) {
+  std::vector<std::string> args;
+  // `--trace` takes precedence over the environment
+  std::string traceFile;
+  if (auto const *value = std::getenv("CORTIDQCT_TRACE"); value != nullptr) {
+    traceFile = value;
+  }
+  for (auto i = 1; i < argc; ++i) {
+    if (argv[i] == "--trace"s && i + 1 < argc) {
+      traceFile = argv[++i];
+    } else {
+      args.emplace_back(argv[i]);
+    }
+  }
+
+  if (args.size() != 3 && args.size() != 4) {
     std::cerr << "Usage: " << argv[0]
-              << " <configurationFile> <inputVolume> <outputMesh> [outputLabels]" << std::endl;
+              << " [--trace <traceFile>] <configurationFile> <inputVolume> "
+                 "<outputMesh> [outputLabels]"
+              << std::endl;
+    std::cerr << "For configurations with several instances, the instance "
+                 "name is appended to the output file names." << std::endl;
+    std::cerr << "With --trace or the environment variable CORTIDQCT_TRACE, "
+                 "a Chrome trace of the fit is written to <traceFile>."
+              << std::endl;
     return EXIT_FAILURE;
   }
 
   try {
-    auto const volume = VoxelVolume{argv[2]};
-    auto fitter = MeshFitter{argv[1]};
+    if (!traceFile.empty()) { startTracing(); }
 
-    auto const result = fitter.fit(volume);
+    auto const volume = VoxelVolume{args[1]};
+    auto config = MultiMeshFitter::Configuration::fromFile(args[0]);
 
-    if (result.success) {
-      auto const &mesh = result.deformedMesh;
-      auto outLabels = "/dev/null"s;
+    // Report the progress of each instance
+    for (auto &instance : config.instances) {
+      auto const prefix = instance.name.empty() ? ""s : instance.name + ": "s;
+      instance.configuration.iterationObserver =
+          [prefix](MeshFitter::IterationRecord const &record) {
+            std::ostringstream line;
+            line << prefix << "Iteration " << record.iteration
+                 << ": log likelihood " << record.logLikelihood
+                 << ", displacement " << record.displacementNorm
+                 << (record.converged ? " (converged)" : "") << '\n';
+            std::cout << line.str() << std::flush;
+          };
+    }
 
-      if (argc == 5) { outLabels = argv[4]; }
+    auto const fitter = MultiMeshFitter{std::move(config)};
 
-      mesh.writeToFile(argv[3], outLabels);
-    } else {
-      std::cerr << "Fitting failed with unknown error!" << std::endl;
-      return EXIT_FAILURE;
+    auto const results = fitter.fit(volume);
+
+    if (!traceFile.empty()) { stopTracing(traceFile); }
+
+    auto success = true;
+    for (auto i = 0u; i < results.size(); ++i) {
+      auto const &result = results[i];
+      auto const &name = fitter.configuration.instances[i].name;
+
+      if (!result.success) {
+        std::cerr << "Fitting " << (name.empty() ? "" : name + " "s)
+                  << "failed with unknown error!" << std::endl;
+        success = false;
+        continue;
+      }
+
+      auto outLabels = "/dev/null"s;
+      if (args.size() == 4) { outLabels = args[3]; }
+
+      result.deformedMesh.writeToFile(withSuffix(args[2], name),
+                                      withSuffix(outLabels, name));
     }
 
+    if (!success) { return EXIT_FAILURE; }
+
   } catch (std::invalid_argument const &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -473,6 +473,40 @@ CQCT_EXTERN size_t
 CQCT_meshRayIntersections(CQCT_Mesh mesh, CQCT_Ray *raysPtr, size_t nRays,
                           CQCT_RayMeshIntersection **intersectionsOutPtr);
 
+/**
+ * @brief Computes all intersections of a set of rays with the mesh.
+ *
+ * Every crossing of the line through a ray is reported, crossings behind the
+ * ray origin have a negative signed distance `t`. The result is stored in
+ * compressed row format: the intersections of the `i`-th ray are
+ * `(*intersectionsOutPtr)[(*offsetsOutPtr)[i]]` up to (excluding)
+ * `(*intersectionsOutPtr)[(*offsetsOutPtr)[i + 1]]`, sorted by `t`.
+ *
+ * @param[in] mesh Mesh object
+ * @param[in] raysPtr pointer to array of CQCT_Ray objects
+ * @param[in] nRays Number of rays
+ * @param[out] offsetsOutPtr Pointer that contains the memory address where
+ * the `nRays + 1` offsets should be stored. Alternatively, the address
+ * contained in `offsetsOutPtr` can be set to NULL. In this case the memory is
+ * allocated by the function.
+ * @param[out] intersectionsOutPtr Pointer that receives the address of the
+ * intersections. Since their number is not known in advance, the memory is
+ * always allocated by the function and the address previously contained in
+ * `intersectionsOutPtr` is ignored.
+ * @param[out] error pointer to an error object. If `NULL` errors are ignored.
+ * The caller is responsible for releasing the memory of both buffers.
+ * @return number of intersections, a negative value on error. On error,
+ * neither out-pointer is modified and no memory is left allocated.
+ * @pre `mesh != NULL || nRays == 0`
+ * @pre `raysPtr != NULL || nRays == 0`
+ * @pre `offsetsOutPtr != NULL`
+ * @pre `intersectionsOutPtr != NULL`
+ */
+CQCT_EXTERN ptrdiff_t CQCT_meshAllRayIntersections(
+    CQCT_Mesh mesh, CQCT_Ray const *raysPtr, size_t nRays,
+    size_t **offsetsOutPtr, CQCT_RayMeshIntersection **intersectionsOutPtr,
+    CQCT_Error *error);
+
 /**
  * @brief Upsamples the given mesh `nTimes` without touchting the original
  * vertices
@@ -579,7 +613,8 @@ CQCT_EXTERN size_t CQCT_meshFitterResultCopyVertexNormals(
     CQCT_MeshFitterResult result, float **buffer)
     __attribute__((deprecated("Use normals stored in deformedMesh instead.")));
 
-/// Returns the number of volume sampling positions
+/// Returns the number of volume sampling positions, zero unless the
+/// configuration stores them (`storeVolumeSamplingPositions`)
 CQCT_EXTERN size_t
 CQCT_meshFitterResultVolumeSamplingPositionsCount(CQCT_MeshFitterResult result);
 
@@ -587,7 +622,14 @@ CQCT_meshFitterResultVolumeSamplingPositionsCount(CQCT_MeshFitterResult result);
 CQCT_EXTERN size_t CQCT_meshFitterResultCopyVolumeSamplingPositions(
     CQCT_MeshFitterResult result, float **buffer);
 
-/// Copies the volume samples
+/// Returns the number of volume samples, i.e. the number of vertices times
+/// the number of samples per vertex. The samples are always stored, even if
+/// the sampling positions are not.
+CQCT_EXTERN size_t
+CQCT_meshFitterResultVolumeSamplesCount(CQCT_MeshFitterResult result);
+
+/// Copies the volume samples, `CQCT_meshFitterResultVolumeSamplesCount()`
+/// floats
 CQCT_EXTERN size_t CQCT_meshFitterResultCopyVolumeSamples(
     CQCT_MeshFitterResult result, float **buffer);
 
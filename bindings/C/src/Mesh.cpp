@@ -382,6 +382,62 @@ CQCT_meshRayIntersections(CQCT_Mesh mesh, CQCT_Ray *raysPtr, size_t nRays,
   return size;
 }
 
+CORTIDQCT_C_EXPORT CQCT_EXTERN ptrdiff_t CQCT_meshAllRayIntersections(
+    CQCT_Mesh mesh, CQCT_Ray const *raysPtr, size_t nRays,
+    size_t **offsetsOutPtr, CQCT_RayMeshIntersection **intersectionsOutPtr,
+    CQCT_Error *error) {
+
+  assert(mesh != nullptr || nRays == 0);
+  assert(raysPtr != nullptr || nRays == 0);
+  assert(offsetsOutPtr != nullptr);
+  assert(intersectionsOutPtr != nullptr);
+
+  try {
+    std::vector<size_t> offsets;
+    std::vector<RayMeshIntersection<float>> intersections;
+
+    if (nRays > 0) {
+      auto const raysBegin = reinterpret_cast<Ray<float> const *>(raysPtr);
+      mesh->impl.objPtr->allRayIntersections(raysBegin, raysBegin + nRays,
+                                             offsets, intersections);
+    } else {
+      offsets.push_back(0);
+    }
+
+    // Both buffers are allocated before either out-pointer is written, so
+    // that nothing leaks if one of the allocations fails
+    auto const offsetsSize = offsets.size() * sizeof(size_t);
+    auto const allocateOffsets = *offsetsOutPtr == nullptr;
+    auto *offsetsPtr = allocateOffsets
+                           ? static_cast<size_t *>(malloc(offsetsSize))
+                           : *offsetsOutPtr;
+    auto const size = intersections.size() * sizeof(CQCT_RayMeshIntersection);
+    auto *intersectionsPtr =
+        static_cast<CQCT_RayMeshIntersection *>(malloc(size));
+
+    if (offsetsPtr == nullptr || (size > 0 && intersectionsPtr == nullptr)) {
+      if (allocateOffsets) { free(offsetsPtr); }
+      free(intersectionsPtr);
+      throw std::bad_alloc{};
+    }
+
+    memcpy(offsetsPtr, offsets.data(), offsetsSize);
+    if (size > 0) { memcpy(intersectionsPtr, intersections.data(), size); }
+
+    *offsetsOutPtr = offsetsPtr;
+    *intersectionsOutPtr = intersectionsPtr;
+
+    return static_cast<ptrdiff_t>(intersections.size());
+  } catch (std::exception const &e) {
+    if (error != nullptr) {
+      *error = CQCT_createError(CQCT_ErrorId_Unknown, e.what());
+      CQCT_autorelease(*error);
+    }
+  }
+
+  return -1;
+}
+
 CORTIDQCT_C_EXPORT CQCT_EXTERN void CQCT_meshUpsample(CQCT_Mesh mesh,
                                                       size_t nTimes) {
   if (nTimes == 0) return;
@@ -187,6 +187,13 @@ CQCT_meshFitterResultCopyVolumeSamplingPositions(CQCT_MeshFitterResult result,
   return size;
 }
 
+CORTIDQCT_C_EXPORT CQCT_EXTERN size_t
+CQCT_meshFitterResultVolumeSamplesCount(CQCT_MeshFitterResult result) {
+  assert(result != nullptr);
+
+  return result->impl.objPtr->state.volumeSamples.size();
+}
+
 CORTIDQCT_C_EXPORT CQCT_EXTERN size_t CQCT_meshFitterResultCopyVolumeSamples(
     CQCT_MeshFitterResult result, float **buffer) {
   assert(result != nullptr);
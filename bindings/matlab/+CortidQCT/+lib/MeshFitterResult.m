@@ -120,10 +120,10 @@ classdef MeshFitterResult < CortidQCT.lib.ObjectBase
     function volumeSamples = get.volumeSamples(obj)
       import CortidQCT.lib.ObjectBase;
 
-      posCount = ObjectBase.call('meshFitterResultVolumeSamplingPositionsCount', obj.handle);
-      buffer = libpointer('singlePtr', zeros(posCount, 1, 'single'));
+      sampleCount = ObjectBase.call('meshFitterResultVolumeSamplesCount', obj.handle);
+      buffer = libpointer('singlePtr', zeros(sampleCount, 1, 'single'));
       result = ObjectBase.call('meshFitterResultCopyVolumeSamples', obj.handle, buffer);
-      assert(result == 4 * posCount, "Size mismatch");
+      assert(result == 4 * sampleCount, "Size mismatch");
       volumeSamples = buffer.Value;
     end
 
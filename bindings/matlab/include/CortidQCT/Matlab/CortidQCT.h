@@ -537,7 +537,8 @@ CQCT_EXTERN size_t CQCT_meshFitterResultCopyVertexNormals(
     CQCT_MeshFitterResult result, float **buffer)
     __attribute__((deprecated("Use normals stored in deformedMesh instead.")));
 
-/// Returns the number of volume sampling positions
+/// Returns the number of volume sampling positions, zero unless the
+/// configuration stores them (`storeVolumeSamplingPositions`)
 CQCT_EXTERN size_t
 CQCT_meshFitterResultVolumeSamplingPositionsCount(CQCT_MeshFitterResult result);
 
@@ -545,7 +546,14 @@ CQCT_meshFitterResultVolumeSamplingPositionsCount(CQCT_MeshFitterResult result);
 CQCT_EXTERN size_t CQCT_meshFitterResultCopyVolumeSamplingPositions(
     CQCT_MeshFitterResult result, float **buffer);
 
-/// Copies the volume samples
+/// Returns the number of volume samples, i.e. the number of vertices times
+/// the number of samples per vertex. The samples are always stored, even if
+/// the sampling positions are not.
+CQCT_EXTERN size_t
+CQCT_meshFitterResultVolumeSamplesCount(CQCT_MeshFitterResult result);
+
+/// Copies the volume samples, `CQCT_meshFitterResultVolumeSamplesCount()`
+/// floats
 CQCT_EXTERN size_t CQCT_meshFitterResultCopyVolumeSamples(
     CQCT_MeshFitterResult result, float **buffer);
 
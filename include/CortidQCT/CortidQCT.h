@@ -11,9 +11,14 @@
 
 #pragma once
 
+#include "src/CancellationToken.h"
+#include "src/DensityProfiles.h"
+#include "src/FitOptions.h"
 #include "src/MeasurementModel.h"
 #include "src/Mesh.h"
 #include "src/MeshFitter.h"
+#include "src/MultiMeshFitter.h"
+#include "src/Tracing.h"
 #include "src/VoxelVolume.h"
 #include "src/Version.h"
 
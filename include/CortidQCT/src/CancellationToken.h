@@ -0,0 +1,42 @@
+/**
+ * @file      CancellationToken.h
+ *
+ * @brief     This header contains the definition of the CancellationToken
+ * type.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace CortidQCT {
+
+/**
+ * @brief Thread-safe flag to request the cancellation of a running operation
+ *
+ * Copies share their state, so a copy handed to an operation observes a
+ * `cancel()` call on the original from any thread.
+ */
+class CancellationToken {
+public:
+  /// Constructs a token that was not cancelled
+  inline CancellationToken()
+      : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  /// Requests the cancellation of all operations observing this token
+  inline void cancel() noexcept { *cancelled_ = true; }
+
+  /// Returns true iff `cancel()` was called on this token or a copy of it
+  inline bool isCancelled() const noexcept { return *cancelled_; }
+
+private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+} // namespace CortidQCT
@@ -0,0 +1,100 @@
+/**
+ * @file      DensityProfiles.h
+ *
+ * @brief     This header contains functions for extracting density profiles
+ * along the normals of a mesh.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "DiscreteRange.h"
+#include "Mesh.h"
+#include "VoxelVolume.h"
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace CortidQCT {
+
+/// Linear calibration `density = slope * value + intercept` of voxel values
+struct DensityCalibration {
+  /// Slope
+  float slope = 1.0f;
+  /// Intercept
+  float intercept = 0.0f;
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/// Statistics of the density profiles of all vertices with the same label
+struct LabelDensityProfile {
+  /// The label
+  Mesh<float>::Label label = 0;
+  /// Number of vertices with this label
+  std::size_t vertexCount = 0;
+  /// Mean density at each sampling position, NaN samples are ignored
+  std::vector<float> mean;
+  /// Standard deviation of the density at each sampling position
+  std::vector<float> standardDeviation;
+  /// Number of valid (non-NaN) samples at each sampling position
+  std::vector<std::size_t> sampleCount;
+};
+#pragma clang diagnostic pop
+
+/**
+ * @brief Samples a volume along the vertex normals of a mesh
+ *
+ * The profile of vertex `v` with normal `n` is sampled at the positions
+ * `v - t * n` for all `t` in `range`, i.e. positive values of `t` point into
+ * the mesh. These are the same positions the `MeshFitter` samples the volume
+ * at, using the same (parallel) trilinear sampler.
+ *
+ * @param mesh the mesh, its normals must be up to date
+ * @param volume the volume to sample
+ * @param range distances along the normals to sample at
+ * @param calibration calibration applied to the sampled values
+ * @param profiles preallocated buffer for `mesh.vertexCount() *
+ * range.numElements()` values. The profile of vertex `i` is stored at
+ * `profiles[i * range.numElements()], ...`
+ * @param exteriorValue value of samples outside of the volume
+ * @throws std::invalid_argument if `profiles` is NULL and the mesh has
+ * vertices
+ */
+void sampleDensityProfiles(
+    Mesh<float> const &mesh, VoxelVolume const &volume,
+    DiscreteRangef const &range, DensityCalibration const &calibration,
+    float *profiles,
+    float exteriorValue = std::numeric_limits<float>::quiet_NaN());
+
+/**
+ * @brief Samples a volume along the vertex normals of a mesh
+ * @see sampleDensityProfiles(Mesh<float> const &, VoxelVolume const &,
+ * DiscreteRangef const &, DensityCalibration const &, float *, float)
+ * @return the profiles of all vertices, stored consecutively
+ */
+std::vector<float> sampleDensityProfiles(
+    Mesh<float> const &mesh, VoxelVolume const &volume,
+    DiscreteRangef const &range, DensityCalibration const &calibration,
+    float exteriorValue = std::numeric_limits<float>::quiet_NaN());
+
+/**
+ * @brief Aggregates the density profiles of the vertices per label
+ *
+ * @param mesh the mesh the profiles were sampled for
+ * @param profiles the profiles as returned by `sampleDensityProfiles()`
+ * @param samplesPerProfile number of samples per profile
+ * @return statistics for each label present in the mesh, sorted by label
+ * @throws std::invalid_argument if `profiles` is NULL and the mesh has
+ * vertices
+ */
+std::vector<LabelDensityProfile>
+aggregateDensityProfiles(Mesh<float> const &mesh, float const *profiles,
+                         std::size_t samplesPerProfile);
+
+} // namespace CortidQCT
@@ -0,0 +1,53 @@
+/**
+ * @file      FitOptions.h
+ *
+ * @brief     This header contains the definition of the FitOptions type.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "CancellationToken.h"
+#include "Optional.h"
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace CortidQCT {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Options of a single fit
+ *
+ * The deadline, the timeout and the cancellation token may stop the fit
+ * before it converged. The stop condition is checked between the stages of an
+ * iteration and between the local-global iterations of the deformation stage.
+ * A stopped fit returns the state of the completed iteration with the highest
+ * log likelihood.
+ */
+struct FitOptions {
+  using Clock = std::chrono::steady_clock;
+
+  /// The fit stops at this point in time, defaults to no deadline
+  Clock::time_point deadline = Clock::time_point::max();
+  /// The fit stops after this duration, measured from the start of the fit,
+  /// defaults to no timeout. Unlike `deadline`, it applies to each fit of a
+  /// batch separately.
+  Clock::duration timeout = Clock::duration::max();
+  /// The fit stops as soon as this token is cancelled, if set
+  std::optional<CancellationToken> cancellationToken;
+  /// If not empty, a checkpoint of the fit is written to this file every
+  /// `checkpointInterval` iterations, see `MeshFitter::saveCheckpoint()`
+  std::string checkpointFile;
+  /// Number of iterations between two checkpoints
+  std::size_t checkpointInterval = 10;
+};
+#pragma clang diagnostic pop
+
+} // namespace CortidQCT
@@ -15,6 +15,7 @@
 #include "Optional.h"
 
 #include <chrono>
+#include <memory>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -41,7 +42,8 @@ private:
     Label label;
     double scale;
     std::string name;
-    std::vector<float> data;
+    /// Immutable after loading, so copies of the model share it
+    std::shared_ptr<std::vector<float> const> data;
   };
   /// Type used to store data samples
   using DataStorage = std::unordered_map<Label, VOIData>;
@@ -175,7 +177,7 @@ public:
   template <class F>
   inline auto withUnsafeDataPointer(Label label, F &&f) const {
     if (auto const store = data_.find(label); store != data_.end()) {
-      return f(store->second.data.data());
+      return f(store->second.data->data());
     }
 
     throw std::invalid_argument("Label " + std::to_string(label) +
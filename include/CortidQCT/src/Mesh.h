@@ -14,10 +14,14 @@
 #include "BarycentricPoint.h"
 #include "ColorToLabelMap.h"
 #include "LabelToColorMap.h"
+#include "MeshTopology.h"
 #include "Ray.h"
 #include "RayMeshIntersection.h"
+#include "SliceContour.h"
+#include "VoxelVolume.h"
 
 #include <array>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -25,6 +29,20 @@
 
 namespace CortidQCT {
 
+namespace Internal {
+struct PrivateMeshAccessor;
+}
+
+/// Vertex orderings supported by `Mesh::reorderVertices()`
+enum class VertexOrdering {
+  /// Keep the current order
+  original,
+  /// Reverse Cuthill-McKee order, minimizes the bandwidth of the vertex graph
+  reverseCuthillMcKee,
+  /// Order along a 3D Hilbert curve through the vertex positions
+  hilbertCurve
+};
+
 /**
  * @brief A triangle mesh class
  *
@@ -50,6 +68,12 @@ public:
   /// Label type
   using Label = unsigned int;
 
+  /// Topology type
+  using Topology = MeshTopology<Index>;
+
+  /// Contour type, see `sliceContours()`
+  using Contour = SliceContour<T, Label>;
+
 private:
   /// Type of vertex data storage
   using VertexData = std::vector<Scalar>;
@@ -77,6 +101,21 @@ public:
       : vertexData_(3 * nVertices, T{0}), indexData_(3 * nTriangles, Index{0}),
         labelData_(nVertices, Label{0}), normalData_(3 * nVertices, T{0}) {}
 
+  /// Copies the mesh, the cached topology is shared with `other`
+  Mesh(Mesh const &other);
+
+  /// Moves the mesh
+  Mesh(Mesh &&other) noexcept = default;
+
+  /// Copy assigns the mesh, the cached topology is shared with `other`
+  Mesh &operator=(Mesh const &other);
+
+  /// Move assigns the mesh
+  Mesh &operator=(Mesh &&other) noexcept = default;
+
+  /// Destroys the mesh
+  ~Mesh() = default;
+
   // @}
 
   /// @name Accessors
@@ -94,6 +133,13 @@ public:
   inline bool isEmpty() const noexcept {
     return triangleCount() == 0 || vertexCount() == 0;
   }
+
+  /// @brief Connectivity information of the mesh
+  ///
+  /// The topology is computed lazily on first access and cached until the
+  /// index data changes. Access is thread safe. The returned reference stays
+  /// valid until the index data of the mesh is modified.
+  Topology const &topology() const;
   /// @}
 
   /// @name IO
@@ -101,7 +147,8 @@ public:
 
   /// @brief Load mesh and labels from ASCII file using format auto detection
   ///
-  /// Supported file formats are: obj, off, stl, wrl, ply, mesh, SIMesh.
+  /// Supported file formats are: obj, off, stl, wrl, ply, mesh, SIMesh and
+  /// binary SIMesh (simeshb).
   /// If a .off file with color data (COFF) is given and the labels should be
   /// extracted from the color data, use the overload
   /// `loadFromFile(std::string const &, ColorToLabelMap<Label, double> const
@@ -121,9 +168,10 @@ public:
   /// @brief Load mesh from ASCII file using format auto detection and extract
   /// labels from per-vertex colors
   ///
-  /// Supported file formats are: off (COFF), SIMesh.
+  /// Supported file formats are: off (COFF), ply, SIMesh, binary SIMesh.
   /// Per-vertex colors are converted to labels using the given colormap.
-  /// For SIMesh format, the labels are directly read from the file.
+  /// For SIMesh format and ply files with a per-vertex `label` property, the
+  /// labels are directly read from the file.
   /// For other formats use the overload
   /// `loadFromFile(std::string const &, std::string const &)`
   ///
@@ -141,7 +189,8 @@ public:
 
   /// @brief Writes mesh to ASCII file using format auto detection
   ///
-  /// Supported file formats are: obj, off, stl, wrl, ply, mesh, SIMesh.
+  /// Supported file formats are: obj, off, stl, wrl, ply, mesh, SIMesh and
+  /// binary SIMesh (simeshb).
   /// Labels are written rowwise to `labelFilename`.
   /// For encoding the labels in the color attribute use the overload
   /// `writeToFile(std::string const &, LabelToColorMap<double, Label> const
@@ -160,11 +209,12 @@ public:
   /// @brief Writes mesh to ASCII file using format auto detection and encode
   /// labels as colors.
   ///
-  /// Supported file formats are: off (coff), SIMesh.
+  /// Supported file formats are: off (coff), ply, SIMesh, binary SIMesh.
   /// The labels are encoded in per-vertex colors using the given label to
   /// color map.
   /// For the 'SIMesh' format the labels are written directly into the mesh
-  /// file, ignoring the color encoding.
+  /// file, ignoring the color encoding. Binary ply files contain both, the
+  /// colors and a per-vertex `label` property.
   /// For storing the labels in a separate file use the overload
   /// `writeToFile(std::string const &, std::string const &)`.
   ///
@@ -245,6 +295,9 @@ public:
    * The attributes must be in row major order, i.e. a full attribute vector is
    * stored in consecutively in the underlying container.
    *
+   * If both `PtIter` and `OutputIterator` are random access iterators, all
+   * points are validated up front and then interpolated in parallel.
+   *
    * @tparam PtIter InputIterator of BarycentricPoint type
    * @tparam AttrIter RandomAccessIterator of scalar type
    * @tparam OutputIterator output iterator acceptiong scalar of the same type
@@ -299,6 +352,99 @@ public:
    */
   RayMeshIntersection<T> rayIntersection(Ray<T> const &ray) const;
 
+  /**
+   * @brief Computes all intersections of a set of rays with the mesh
+   *
+   * In contrast to `rayIntersections()`, every crossing of the line through
+   * a ray is reported, e.g. both the periosteal and the endosteal surface
+   * for thickness measurements. Crossings behind the origin have a negative
+   * signed distance.
+   *
+   * The result is stored in compressed row format: the intersections of the
+   * `i`-th ray are `intersections[offsets[i]], ...,
+   * intersections[offsets[i + 1] - 1]`, sorted by signed distance. Crossings
+   * on an edge or a vertex are reported once. The barycentric coordinates
+   * use the same convention as `cartesianRepresentation()`.
+   *
+   * A bounding volume hierarchy of the triangles is built once per call and
+   * the rays are processed in parallel.
+   *
+   * @param raysBegin pointer to the first ray
+   * @param raysEnd pointer one past the last ray
+   * @param offsets output, resized to the number of rays plus one
+   * @param intersections output, resized to `offsets.back()`
+   */
+  void
+  allRayIntersections(Ray<T> const *raysBegin, Ray<T> const *raysEnd,
+                      std::vector<std::size_t> &offsets,
+                      std::vector<RayMeshIntersection<T>> &intersections) const;
+
+  /**
+   * @brief Rasterizes the interior of the mesh into a label mask
+   *
+   * The mesh must be closed. Each z-slice is rasterized in parallel by
+   * intersecting rays along the x-axis with the mesh and filling the voxels
+   * between pairs of crossings. An interior voxel gets the label of the
+   * nearest crossing on its ray, where the label of a crossing is the label
+   * of the nearest corner of the crossed triangle.
+   *
+   * The voxel `(i, j, k)` is centered at `(i * w, j * h, k * d)` in mesh
+   * coordinates, where `(w, h, d)` is the voxel size. This matches the
+   * sampling positions used for a `VoxelVolume` of the same size and voxel
+   * size.
+   *
+   * @param volumeSize size of the voxel grid
+   * @param voxelSize size of a voxel
+   * @param outsideLabel label of the voxels outside of the mesh
+   * @return label mask in the memory layout of `VoxelVolume`, i.e. `x` is
+   * the fastest varying index
+   * @throws std::invalid_argument if the voxel size is not positive
+   */
+  std::vector<Label> voxelize(VolumeSize const &volumeSize,
+                              VoxelSize const &voxelSize,
+                              Label outsideLabel) const;
+
+  /**
+   * @brief Rasterizes the interior of the mesh into a label mask aligned with
+   * the given volume
+   * @see voxelize(VolumeSize const &, VoxelSize const &, Label) const
+   */
+  inline std::vector<Label> voxelize(VoxelVolume const &volume,
+                                     Label outsideLabel) const {
+    return voxelize(volume.size(), volume.voxelSize(), outsideLabel);
+  }
+
+  /**
+   * @brief Intersects the mesh with the z-planes `z = k * spacing`, `k = 0,
+   * ..., sliceCount - 1`
+   *
+   * All planes are processed in one sweep: the triangles are bucketed by
+   * their z-extent once and the slices are contoured in parallel. The
+   * crossing segments of a slice are joined into polylines via the mesh
+   * edges they cross. Each contour point is labeled with the label of the
+   * nearer endpoint of the crossed edge.
+   *
+   * On closed meshes with outward facing normals all contours are closed and
+   * oriented counter-clockwise around the interior when viewed from `+z`.
+   *
+   * @param sliceCount number of planes
+   * @param spacing distance between two planes
+   * @return the contours of every slice
+   * @throws std::invalid_argument if the spacing is not positive
+   */
+  std::vector<std::vector<Contour>> sliceContours(std::size_t sliceCount,
+                                                  T spacing) const;
+
+  /**
+   * @brief Intersects the mesh with the axial slices of the given volume
+   * @see sliceContours(std::size_t, T) const
+   */
+  inline std::vector<std::vector<Contour>>
+  sliceContours(VoxelVolume const &volume) const {
+    return sliceContours(volume.size().depth,
+                         static_cast<T>(volume.voxelSize().depth));
+  }
+
   /**
    * @brief Re-computes per-vertex normals
    */
@@ -321,6 +467,66 @@ public:
    */
   Mesh<T> &upsample(std::size_t nTimes = 1);
 
+  /// Vertex correspondence between a mesh and its decimated version
+  struct VertexCorrespondence {
+    /// Index of the original vertex each vertex of the decimated mesh
+    /// originates from
+    std::vector<Index> coarseToFine;
+    /// Index of the vertex of the decimated mesh each original vertex was
+    /// collapsed into
+    std::vector<Index> fineToCoarse;
+  };
+
+  /**
+   * @brief Reduces the number of vertices using quadric error metrics
+   *
+   * Edges are collapsed in the order of increasing quadric error. Label
+   * boundaries and mesh borders are preserved: only vertices with equal labels
+   * are merged and vertices adjacent to other labels do not move off the
+   * boundary. Collapses that would result in non-manifold or flipped
+   * triangles are skipped, so the resulting mesh might have more than
+   * `targetVertexCount` vertices.
+   *
+   * @param targetVertexCount desired number of vertices
+   * @param correspondence optional output for the vertex correspondence
+   * between the decimated and the original mesh
+   * @return Reference to `*this`
+   */
+  Mesh<T> &decimate(std::size_t targetVertexCount,
+                    VertexCorrespondence *correspondence = nullptr);
+
+  /**
+   * @brief Reorders the vertices according to the given permutation
+   *
+   * Vertex positions, normals and labels are permuted and the triangle
+   * indices are updated accordingly. The order of the triangles is kept, so
+   * applying the inverse permutation restores the original mesh.
+   *
+   * @param newToOld index of the vertex that is moved to position `i`, for
+   * each `i`
+   * @return Reference to `*this`
+   * @throws std::invalid_argument if `newToOld` is not a permutation of the
+   * vertex indices
+   */
+  Mesh<T> &permuteVertices(std::vector<Index> const &newToOld);
+
+  /**
+   * @brief Reorders the vertices to improve memory locality
+   *
+   * Vertices that are close on the surface are placed close in memory. This
+   * reduces the bandwidth of matrices defined on the vertex graph (e.g. the
+   * Laplacian) and the distance between memory accesses of consecutive
+   * vertices in per-vertex loops.
+   *
+   * @param ordering the vertex ordering
+   * @param newToOld optional output for the applied permutation, can be used
+   * to restore the original order
+   * @return Reference to `*this`
+   * @see permuteVertices
+   */
+  Mesh<T> &reorderVertices(VertexOrdering ordering,
+                           std::vector<Index> *newToOld = nullptr);
+
   /// @}
 
   /**
@@ -374,9 +580,11 @@ public:
     return f(indexData_.data());
   }
 
+  /// @note Invalidates the cached topology
   template <class F>
   inline auto withUnsafeIndexPointer(F &&f) noexcept(
       noexcept(f(std::declval<IndexData>().data()))) {
+    invalidateTopology();
     return f(indexData_.data());
   }
 
@@ -430,9 +638,14 @@ public:
 
   /// @}
 private:
+  friend struct Internal::PrivateMeshAccessor;
+
   /// Ensures validility of the mesh
   void ensurePostconditions() const;
 
+  /// Drops the cached topology, must be called whenever `indexData_` changes
+  inline void invalidateTopology() noexcept { topology_.reset(); }
+
   /// Stores vertex coordinates in column major order
   VertexData vertexData_;
   /// Stores per triangle vertex indices in column major oder
@@ -441,6 +654,8 @@ private:
   LabelData labelData_;
   /// Stores per vertex normals
   NormalData normalData_;
+  /// Lazily computed topology, shared between copies of the mesh
+  mutable std::shared_ptr<Topology const> topology_;
 };
 
 /*************************************
@@ -458,6 +673,14 @@ extern template void Mesh<double>::barycentricInterpolation(
     BarycentricPoint<double, std::ptrdiff_t> const *,
     BarycentricPoint<double, std::ptrdiff_t> const *, double const *, double *,
     std::size_t) const;
+extern template void Mesh<float>::barycentricInterpolation(
+    BarycentricPoint<float, std::ptrdiff_t> const *,
+    BarycentricPoint<float, std::ptrdiff_t> const *, float const *,
+    std::back_insert_iterator<std::vector<float>>, std::size_t) const;
+extern template void Mesh<double>::barycentricInterpolation(
+    BarycentricPoint<double, std::ptrdiff_t> const *,
+    BarycentricPoint<double, std::ptrdiff_t> const *, double const *,
+    std::back_insert_iterator<std::vector<double>>, std::size_t) const;
 
 extern template void Mesh<float>::cartesianRepresentation(
     BarycentricPoint<float, std::ptrdiff_t> const *,
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "FitOptions.h"
 #include "MeasurementModel.h"
 #include "Mesh.h"
 #include "VoxelVolume.h"
@@ -8,13 +9,16 @@
 #include "propagate_const.h"
 
 #include <array>
+#include <functional>
 #include <memory>
 #include <variant>
+#include <vector>
 
 namespace CortidQCT {
 
 namespace Internal {
 struct PrivateStateAccessor;
+struct ReferenceMeshCache;
 }
 
 struct Coordinate3D {
@@ -24,6 +28,14 @@ struct Coordinate3D {
   Type type{Type::absolute};
 };
 
+/// Rigid transformation `x -> rotation * x + translation`
+struct RigidTransform {
+  /// Rotation matrix in row major order
+  std::array<float, 9> rotation{{1, 0, 0, 0, 1, 0, 0, 0, 1}};
+  /// Translation vector
+  std::array<float, 3> translation{{0, 0, 0}};
+};
+
 /**
  * @nosubgrouping .
  */
@@ -33,6 +45,69 @@ class MeshFitter {
 public:
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
+  /**
+   * @brief Wall clock time in seconds spent in each stage of an iteration
+   *
+   * All times are zero if the library was built without
+   * `CORTIDQCT_WITH_STAGE_TIMERS`.
+   */
+  struct StageTimings {
+    /// Sampling the volume along the vertex normals
+    double volumeSampling = 0.0;
+    /// Finding the optimal displacements and weights
+    double displacements = 0.0;
+    /// Fitting the ARAP deformation, including the four parts below
+    double deformation = 0.0;
+    /// Part of `deformation`: setting up the linear system
+    double deformationSetup = 0.0;
+    /// Part of `deformation`: solving for the vertex positions
+    double deformationSolve = 0.0;
+    /// Part of `deformation`: finding the per-vertex rotations
+    double deformationRotations = 0.0;
+    /// Part of `deformation`: computing the rigidity energy
+    double deformationEnergy = 0.0;
+    /// Detecting self-intersections
+    double selfIntersections = 0.0;
+    /// Computing the log likelihood
+    double logLikelihood = 0.0;
+
+    /// Adds the times of `rhs` to this object
+    inline StageTimings &operator+=(StageTimings const &rhs) noexcept {
+      volumeSampling += rhs.volumeSampling;
+      displacements += rhs.displacements;
+      deformation += rhs.deformation;
+      deformationSetup += rhs.deformationSetup;
+      deformationSolve += rhs.deformationSolve;
+      deformationRotations += rhs.deformationRotations;
+      deformationEnergy += rhs.deformationEnergy;
+      selfIntersections += rhs.selfIntersections;
+      logLikelihood += rhs.logLikelihood;
+      return *this;
+    }
+  };
+
+  /// Compact summary of a single iteration
+  struct IterationRecord {
+    /// `Result::iteration` after the iteration, i.e. the number of completed
+    /// iterations plus one
+    std::size_t iteration = 0;
+    /// Log likelihood of the deformed mesh
+    float logLikelihood = 0.f;
+    /// Norm of the displacement vector divided by the number of vertices
+    float displacementNorm = 0.f;
+    /// Effective sigmaS
+    float effectiveSigmaS = 0.f;
+    /// Number of non-decreasing iterations
+    std::size_t nonDecreasing = 0;
+    /// Converged?
+    bool converged = false;
+    /// Time spent in each stage of the iteration
+    StageTimings timings;
+  };
+
+  /// Receives the record of each iteration
+  using IterationObserver = std::function<void(IterationRecord const &)>;
+
   /**
    * @brief Configuration type for MeshFitter
    */
@@ -43,6 +118,44 @@ public:
 
     using RotationVector = std::array<float, 3>;
 
+    /**
+     * @brief A coarse level of the multi-resolution fitting
+     *
+     * The reference mesh is decimated and the volume is downsampled, then
+     * the decimated mesh is fitted to the downsampled volume.
+     */
+    struct Level {
+      /// Fraction of the reference mesh vertices kept by the decimation
+      float vertexFraction = 0.25f;
+      /// Integer factor the volume is downsampled by
+      std::size_t volumeDownsampling = 1;
+      /// Maximum number of iterations
+      std::size_t maxIterations = 20;
+      /// Scale parameter for ARAP energy term, defaults to `sigmaE`
+      std::optional<double> sigmaE;
+      /// Scale parameter for the latent variable s, defaults to `sigmaS`
+      std::optional<double> sigmaS;
+    };
+
+    /// Transformations estimated by the pre-alignment
+    enum class AlignmentType { none, rigid, similarity };
+
+    /**
+     * @brief Pre-alignment of the reference mesh
+     *
+     * Refines the initial placement of the reference mesh by a few
+     * iterations of weighted point-to-plane ICP. Each iteration estimates
+     * the optimal displacements of the vertices, like the deformable fit,
+     * and moves the mesh by the rigid or similarity transformation that
+     * realizes them best.
+     */
+    struct PreAlignment {
+      /// Transformation to estimate, `none` disables the pre-alignment
+      AlignmentType type = AlignmentType::none;
+      /// Number of ICP iterations
+      std::size_t iterations = 5;
+    };
+
     /// The measurement model
     MeasurementModel model;
     /// The reference mesh
@@ -63,6 +176,13 @@ public:
     float calibrationIntercept = 0.0f;
     /// Ignore samples outisde the volumes?
     bool ignoreExteriorSamples = false;
+    /// Check the deformed mesh for self-intersections in each iteration?
+    bool detectSelfIntersections = false;
+    /// Stop fitting as soon as a self-intersection is detected?
+    bool stopOnSelfIntersection = false;
+    /// Store the volume sampling positions in `Result`? They are only
+    /// required for diagnostics and are not computed otherwise.
+    bool storeVolumeSamplingPositions = false;
 
     /**
      * @brief Reference mesh origin
@@ -87,6 +207,54 @@ public:
      */
     RotationVector referenceMeshRotation = {{0.f, 0.f, 0.f}};
 
+    /**
+     * @brief Vertex ordering used during fitting
+     *
+     * If not `VertexOrdering::original`, the vertices of the reference mesh
+     * are reordered for better memory locality before fitting. The `State`
+     * returned by `init()` uses the reordered vertices, the `Result` returned
+     * by `fit()` is mapped back to the original vertex order.
+     */
+    VertexOrdering referenceMeshVertexOrdering = VertexOrdering::original;
+
+    /**
+     * @brief Coarse levels of the multi-resolution fitting, ordered from
+     * coarse to fine
+     *
+     * If not empty, `MeshFitter::fit()` fits the levels one after another.
+     * Each level starts with the deformation of the previous one, its result
+     * is prolongated to the full resolution reference mesh. The full
+     * resolution mesh is then fitted to the full resolution volume as usual.
+     */
+    std::vector<Level> levels;
+
+    /**
+     * @brief Pre-alignment applied by `MeshFitter::fit()` before the coarse
+     * levels and the deformable fit
+     *
+     * The aligned reference mesh is the rest shape of the deformation and is
+     * reported as `Result::referenceMesh`.
+     */
+    PreAlignment preAlignment;
+
+    /**
+     * @brief Called by `MeshFitter::fit()` after each iteration, e.g. to
+     * report progress
+     *
+     * The record is only computed if an observer is set. The observer may be
+     * called concurrently by the fits of `MeshFitter::fitBatch()`.
+     */
+    IterationObserver iterationObserver;
+
+    /**
+     * @brief Precomputed data of the reference mesh
+     *
+     * Only set if the reference mesh was loaded from a reference mesh bundle
+     * (`.refmesh`). It is ignored if the reference mesh is modified
+     * afterwards.
+     */
+    std::shared_ptr<Internal::ReferenceMeshCache const> referenceMeshCache;
+
     /**
      * @brief Load the configuration from a file
      * @param filename Path to the configuration file
@@ -132,7 +300,8 @@ public:
     std::vector<float> weights;
     /// per-vertex normals
     std::vector<std::array<float, 3>> vertexNormals;
-    /// Volume sampling positions
+    /// Volume sampling positions, stored per vertex. Empty unless
+    /// `Configuration::storeVolumeSamplingPositions` is set.
     std::vector<std::array<float, 3>> volumeSamplingPositions;
     /// Volume samples
     std::vector<float> volumeSamples;
@@ -149,14 +318,25 @@ public:
 #pragma clang diagnostic pop
     /// Effective sigmaS
     float effectiveSigmaS = .0f;
+    /// Number of intersecting triangle pairs in `deformedMesh`, only computed
+    /// if `Configuration::detectSelfIntersections` is set
+    std::size_t selfIntersectionCount = 0;
     /// Iteration count
     std::size_t iteration = 1;
     /// Converged?
     bool converged = false;
+    /// True iff the fit was stopped by the deadline, the timeout or the
+    /// cancellation token of its `FitOptions`
+    bool interrupted = false;
     /// Successfull?
     bool success = false;
     /// Number of non-decreasing iterations
     std::size_t nonDecreasing = 0;
+    /// Time spent in each stage, summed over the whole fit including the
+    /// coarse levels and the initial volume sampling
+    StageTimings totalTimings;
+    /// Time spent in each stage of each iteration of the finest level
+    std::vector<StageTimings> iterationTimings;
   };
 
   /// Internal State type
@@ -182,6 +362,12 @@ public:
 
 #pragma clang diagnostic pop
 
+  /// Loads a volume on demand, e.g. from a file
+  using VolumeLoader = std::function<VoxelVolume()>;
+
+  /// Receives the result of the batch item with the given index
+  using BatchCallback = std::function<void(std::size_t, Result &&)>;
+
   /**
    * @name Public Properties
    * @{
@@ -222,6 +408,64 @@ public:
    */
   Result fit(VoxelVolume const &volume) const;
 
+  /**
+   * @brief Fits the reference mesh to the given voxel volume, stopping early
+   * or writing checkpoints if requested by `options`
+   *
+   * @param volume VoxelVolume object representing the target scan
+   * @param options Deadline, timeout, cancellation token and checkpoints of
+   * the fit
+   * @return A `Result` struct containing the deformed mesh. If the fit was
+   * stopped early, it contains the completed iteration with the highest log
+   * likelihood, or the initial state if no iteration was completed, and
+   * `interrupted` is set.
+   */
+  Result fit(VoxelVolume const &volume, FitOptions const &options) const;
+
+  /**
+   * @brief Fits the reference mesh to each of the given volumes
+   *
+   * The fits run concurrently and share the configuration and all data
+   * derived from the reference mesh, e.g. its Laplacian. If there are at
+   * least as many volumes as cores, each fit runs single threaded. Otherwise
+   * the cores are split evenly between the fits.
+   *
+   * @param volumes VoxelVolume objects representing the target scans
+   * @param callback called with the index of the volume and its result as
+   * soon as the fit finished. Calls are serialized but may come from any
+   * thread and in any order.
+   * @param maxConcurrentFits upper bound of concurrent fits, 0 for the number
+   * of cores
+   * @param options Stop conditions applied to each fit
+   * @throws std::invalid_argument if `options` requests checkpoints
+   * @throws the first exception thrown by a fit or by `callback`. No further
+   * fits are started then.
+   */
+  void fitBatch(std::vector<VoxelVolume> const &volumes,
+                BatchCallback const &callback,
+                std::size_t maxConcurrentFits = 0,
+                FitOptions const &options = {}) const;
+
+  /**
+   * @brief Fits the reference mesh to each of the volumes returned by the
+   * given loaders
+   *
+   * Each volume is loaded right before its fit and released afterwards, so
+   * at most `maxConcurrentFits` volumes are in memory at once.
+   *
+   * @param loaders functions returning the target scans
+   * @param callback called with the index of the loader and its result
+   * @param maxConcurrentFits upper bound of concurrent fits, 0 for the number
+   * of cores
+   * @param options Stop conditions applied to each fit
+   * @see fitBatch(std::vector<VoxelVolume> const &, BatchCallback const &,
+   * std::size_t, FitOptions const &) const
+   */
+  void fitBatch(std::vector<VolumeLoader> const &loaders,
+                BatchCallback const &callback,
+                std::size_t maxConcurrentFits = 0,
+                FitOptions const &options = {}) const;
+
   /**
    * @brief Initializes the fitting algorithm
    *
@@ -234,16 +478,86 @@ public:
    */
   State init(VoxelVolume const &volume) const;
 
+  /**
+   * @brief Initializes the fitting algorithm with the result of a previous
+   * fit, e.g. of a baseline scan of the same subject
+   *
+   * The deformed mesh starts at the deformed mesh of `prior`, mapped to
+   * `volume` by `transform`, and the decayed sigmaS of `prior` is used for
+   * the first iteration. The reference mesh is placed as configured and
+   * remains the rest shape of the deformation, so a warm started fit
+   * regularizes against the same reference as a fit started by `init()`.
+   * Pass the returned state to `resume()` to fit it until it converged.
+   *
+   * @param volume VoxelVolume object representing the target scan
+   * @param prior Result of a fit with the configured reference mesh
+   * @param transform Maps the coordinates of the scan `prior` was fitted to
+   * to the coordinates of `volume`
+   * @return State object that must be passed to subsequent calls
+   * @throw std::invalid_argument iff the deformed mesh of `prior` does not
+   * match the reference mesh
+   */
+  State init(VoxelVolume const &volume, Result const &prior,
+             RigidTransform const &transform = {}) const;
+
+  /**
+   * @brief Continues fitting the given state until it converged
+   *
+   * Coarse levels are not fitted, the state is expected to be initialized by
+   * `init()` or loaded by `loadCheckpoint()`.
+   *
+   * @param state State object returned by `init()` or `loadCheckpoint()`
+   * @param options Stop conditions and checkpoints of the fit
+   * @return A `Result` struct containing the deformed mesh, as returned by
+   * `fit()`
+   * @throw std::invalid_argument iff state was not initialized properly
+   */
+  Result resume(State const &state, FitOptions const &options = {}) const;
+
+  /**
+   * @brief Writes a compact binary checkpoint of the given state to a file
+   *
+   * The checkpoint contains everything required to continue the fit with the
+   * exact same iterations, e.g. the decayed sigmaS and the iteration
+   * counters. The volume is not stored but referenced by a hash of its
+   * content. The file is replaced atomically, i.e. an existing checkpoint is
+   * never left half written.
+   *
+   * @param state State object returned by `init()` or `loadCheckpoint()`
+   * @param filename Path to the checkpoint file
+   * @throw std::invalid_argument iff state was not initialized properly or
+   * the file could not be written
+   * @see FitOptions::checkpointFile
+   */
+  void saveCheckpoint(State const &state, std::string const &filename) const;
+
+  /**
+   * @brief Loads a state from a checkpoint written by `saveCheckpoint()`
+   *
+   * The fitter must have the configuration of the fitter that wrote the
+   * checkpoint. Calling `fitOneIteration()` or `resume()` on the returned
+   * state gives the same iterations as continuing the original state.
+   *
+   * @param filename Path to the checkpoint file
+   * @param volume The volume the checkpointed state was fitted to
+   * @return State object that must be passed to subsequent calls
+   * @throw std::invalid_argument if the file could not be read or if it was
+   * written for another volume or reference mesh
+   */
+  State loadCheckpoint(std::string const &filename,
+                       VoxelVolume const &volume) const;
+
   /**
    * @brief Runs the fitting algorithm for a single iteration
    *
    * Performed the following steps:
    *  1. optimalDisplacementStep()
    *  2. optimalDeformationStep()
-   *  3. logLikelihoodStep()
-   *  4. convergenceTestStep()
-   *  5. increase interation count
-   *  6. volumeSamplingStep()
+   *  3. selfIntersectionStep(), if enabled in the configuration
+   *  4. logLikelihoodStep()
+   *  5. convergenceTestStep()
+   *  6. increase interation count
+   *  7. volumeSamplingStep()
    *
    * @param[in,out] state State object returned by `init`.
    * @throw std::invalid_argument iff state was not initialized properly
@@ -285,6 +599,21 @@ public:
    */
   void optimalDeformationStep(State &state) const;
 
+  /**
+   * @brief Counts the pairs of intersecting triangles of the current deformed
+   * mesh.
+   *
+   * A bounding volume hierarchy of the deformed mesh is kept in the state and
+   * refitted to the current vertex positions, i.e. it is only built once.
+   * Triangles sharing a vertex are not tested against each other.
+   *
+   * @param[in,out] state Optimization state
+   * @pre `state` has been initialized by calling `init()`.
+   * @throw std::invalid_argument iff state was not initialized properly
+   * @see fitOneIteration
+   */
+  void selfIntersectionStep(State &state) const;
+
   /**
    * @brief Computes the log likelihood of the current deformed mesh given the
    * input volume.
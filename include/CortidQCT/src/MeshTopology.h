@@ -0,0 +1,181 @@
+/**
+ * @file      MeshTopology.h
+ *
+ * @brief     This header contains the definition of the MeshTopology type
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace CortidQCT {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Connectivity information of a triangle mesh
+ *
+ * Stores the unique undirected edges, the one-ring neighbourhood of each
+ * vertex and the vertex-face incidence relation. Per-vertex relations are
+ * stored in compressed sparse row (CSR) format: the entries of vertex `i` are
+ * `indices[offsets[i]], ..., indices[offsets[i + 1] - 1]`.
+ *
+ * One-rings of manifold vertices are ordered consistently with the
+ * orientation of the incident triangles. Edges `(i, j)` are stored with
+ * `i < j` and are sorted by `j`, then by `i`.
+ *
+ * @tparam Index Signed integral index type
+ * @nosubgrouping .
+ */
+template <class Index> class MeshTopology {
+
+  static_assert(std::is_integral<Index>::value && std::is_signed<Index>::value,
+                "Index must be a signed integral type");
+
+public:
+  /// Size type
+  using Size = std::size_t;
+  /// Undirected edge type, first index is always the smaller one
+  using Edge = std::array<Index, 2>;
+
+  /// @name Construction
+  /// @{
+
+  /// Constructs an empty topology
+  inline MeshTopology() noexcept {}
+
+  /**
+   * @brief Computes the topology of the given triangulation
+   *
+   * @param indices pointer to `3 * nTriangles` vertex indices, stored
+   * contiguously per triangle: [i_00, i_01, i_02, i_10, ...]
+   * @param nTriangles number of triangles
+   * @param nVertices number of vertices
+   * @return The topology of the triangulation
+   * @throws std::out_of_range if any index is not in `[0, nVertices)`
+   */
+  static MeshTopology fromTriangles(Index const *indices, Size nTriangles,
+                                    Size nVertices);
+
+  /**
+   * @brief Constructs a topology from precomputed adjacency information
+   *
+   * The arguments must be in the same format as returned by the accessors
+   * of a topology that was created by `fromTriangles()`.
+   *
+   * @return The topology made up of the given relations
+   * @throws std::invalid_argument if the relations are inconsistent
+   */
+  static MeshTopology fromAdjacency(std::vector<Edge> edges,
+                                    std::vector<Index> neighbourOffsets,
+                                    std::vector<Index> neighbourIndices,
+                                    std::vector<Index> faceOffsets,
+                                    std::vector<Index> faceIndices);
+
+  /// @}
+
+  /// @name Accessors
+  /// @{
+
+  /// Number of vertices
+  inline Size vertexCount() const noexcept {
+    return neighbourOffsets_.empty() ? 0 : neighbourOffsets_.size() - 1;
+  }
+
+  /// Number of unique undirected edges
+  inline Size edgeCount() const noexcept { return edges_.size(); }
+
+  /// Unique undirected edges
+  inline std::vector<Edge> const &edges() const noexcept { return edges_; }
+
+  /// CSR offsets into `neighbourIndices()`, size is `vertexCount() + 1`
+  inline std::vector<Index> const &neighbourOffsets() const noexcept {
+    return neighbourOffsets_;
+  }
+
+  /// Concatenated one-ring neighbourhoods of all vertices
+  inline std::vector<Index> const &neighbourIndices() const noexcept {
+    return neighbourIndices_;
+  }
+
+  /// CSR offsets into `faceIndices()`, size is `vertexCount() + 1`
+  inline std::vector<Index> const &faceOffsets() const noexcept {
+    return faceOffsets_;
+  }
+
+  /// Concatenated indices of the triangles incident to each vertex
+  inline std::vector<Index> const &faceIndices() const noexcept {
+    return faceIndices_;
+  }
+
+  /// Number of vertices in the one-ring of vertex `i`
+  inline Size degree(Index i) const noexcept {
+    return static_cast<Size>(neighbourOffsets_[static_cast<Size>(i) + 1] -
+                             neighbourOffsets_[static_cast<Size>(i)]);
+  }
+
+  /// Pointer to the first one-ring neighbour of vertex `i`
+  inline Index const *neighboursBegin(Index i) const noexcept {
+    return neighbourIndices_.data() + neighbourOffsets_[static_cast<Size>(i)];
+  }
+
+  /// Pointer one past the last one-ring neighbour of vertex `i`
+  inline Index const *neighboursEnd(Index i) const noexcept {
+    return neighbourIndices_.data() +
+           neighbourOffsets_[static_cast<Size>(i) + 1];
+  }
+
+  /// Pointer to the first triangle incident to vertex `i`
+  inline Index const *facesBegin(Index i) const noexcept {
+    return faceIndices_.data() + faceOffsets_[static_cast<Size>(i)];
+  }
+
+  /// Pointer one past the last triangle incident to vertex `i`
+  inline Index const *facesEnd(Index i) const noexcept {
+    return faceIndices_.data() + faceOffsets_[static_cast<Size>(i) + 1];
+  }
+
+  /**
+   * @brief Returns the index of the edge connecting the vertices `i` and `j`
+   *
+   * Runs in `O(log(degree))`.
+   *
+   * @param i index of the first vertex
+   * @param j index of the second vertex
+   * @return index into `edges()` or -1 if there is no such edge
+   */
+  Index edgeIndex(Index i, Index j) const noexcept;
+
+  /// @}
+
+private:
+  /// Unique edges, grouped by their larger vertex index
+  std::vector<Edge> edges_;
+  /// Offsets of the edge groups in `edges_`, size is `vertexCount() + 1`
+  std::vector<Index> edgeOffsets_;
+  /// CSR offsets of the one-rings
+  std::vector<Index> neighbourOffsets_;
+  /// CSR indices of the one-rings
+  std::vector<Index> neighbourIndices_;
+  /// CSR offsets of the vertex-face incidence relation
+  std::vector<Index> faceOffsets_;
+  /// CSR indices of the vertex-face incidence relation
+  std::vector<Index> faceIndices_;
+};
+#pragma clang diagnostic pop
+
+/*************************************
+ * Explicit template instanciations
+ */
+
+extern template class MeshTopology<std::ptrdiff_t>;
+
+} // namespace CortidQCT
@@ -0,0 +1,121 @@
+/**
+ * @file      MultiMeshFitter.h
+ *
+ * @brief     This header contains the definition of the MultiMeshFitter type.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "FitOptions.h"
+#include "MeshFitter.h"
+#include "VoxelVolume.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace CortidQCT {
+
+/**
+ * @brief Fits several reference meshes to the same volume, e.g. the lumbar
+ * vertebrae L1 to L5 of one scan
+ *
+ * The instances are fitted concurrently. All of them sample the same volume,
+ * which is neither copied nor reloaded, and instances using the same
+ * measurement model share its density data.
+ *
+ * @nosubgrouping .
+ */
+class MultiMeshFitter {
+public:
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+  /// A reference mesh instance, e.g. one vertebra
+  struct Instance {
+    /// Name of the instance, e.g. "L1"
+    std::string name;
+    /// Configuration of the instance
+    MeshFitter::Configuration configuration;
+  };
+
+  /**
+   * @brief Configuration type for MultiMeshFitter
+   */
+  struct Configuration {
+    /// The instances
+    std::vector<Instance> instances;
+    /// Upper bound of concurrently fitted instances, 0 for the number of
+    /// cores
+    std::size_t maxConcurrentFits = 0;
+
+    /**
+     * @brief Load the configuration from a file
+     *
+     * The file has the same format as a `MeshFitter` configuration file plus
+     * an `instances` sequence. Each instance has a `name` and may override
+     * every other key, typically `referenceMesh` and `measurementModel`. A
+     * file without `instances` describes a single unnamed instance.
+     *
+     * @param filename Path to the configuration file
+     * @return reference to the loaded configuration object
+     * @throws std::invalid_argument if the file could not be read
+     */
+    Configuration &loadFromFile(std::string const &filename);
+
+    /**
+     * @brief Convenience initializer to load a configuration from file
+     * @see loadFromFile
+     * @return Configuration object
+     */
+    inline static Configuration fromFile(std::string const &filename) {
+      return Configuration{}.loadFromFile(filename);
+    }
+  };
+#pragma clang diagnostic pop
+
+  /**
+   * @name Public Properties
+   * @{
+   */
+
+  /// The configuration
+  Configuration configuration;
+
+  /// @}
+
+  /**
+   * @brief Constructs a MultiMeshFitter object with given configuration
+   * @param config Configuration object
+   */
+  inline explicit MultiMeshFitter(Configuration config)
+      : configuration(std::move(config)) {}
+
+  /**
+   * @brief Convenience constructor that reads the configuration from the given
+   * configuration file
+   * @param configFilename path to the configuration file
+   */
+  inline explicit MultiMeshFitter(std::string const &configFilename)
+      : MultiMeshFitter(Configuration::fromFile(configFilename)) {}
+
+  /**
+   * @brief Fits all instances to the given voxel volume
+   *
+   * @param volume VoxelVolume object representing the target scan
+   * @param options Stop conditions applied to each instance
+   * @return one `MeshFitter::Result` per instance, in the order of the
+   * instances
+   * @throws std::invalid_argument if `options` requests checkpoints
+   * @throws the first exception thrown by a fit. No further fits are started
+   * then.
+   */
+  std::vector<MeshFitter::Result>
+  fit(VoxelVolume const &volume, FitOptions const &options = {}) const;
+};
+
+} // namespace CortidQCT
@@ -0,0 +1,42 @@
+/**
+ * @file      SliceContour.h
+ *
+ * @brief     Definition of the SliceContour data structure
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace CortidQCT {
+
+/**
+ * @brief Polyline of the intersection of a mesh with a z-plane
+ *
+ * @tparam T Scalar type of the points
+ * @tparam Label Label type
+ */
+template <class T, class Label> struct SliceContour {
+
+  static_assert(std::is_floating_point<T>::value,
+                "Scalar must be a floating point type");
+
+  /// Points (x, y, z) of the polyline, stored consecutively
+  std::vector<T> points;
+  /// Label of each point
+  std::vector<Label> labels;
+  /// True iff the last point is connected to the first one
+  bool isClosed = false;
+
+  /// Number of points
+  inline std::size_t pointCount() const noexcept { return labels.size(); }
+};
+
+} // namespace CortidQCT
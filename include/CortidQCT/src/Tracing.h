@@ -0,0 +1,47 @@
+/**
+ * @file      Tracing.h
+ *
+ * @brief     This header contains functions to record a trace of the fitting
+ * stages.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <string>
+
+namespace CortidQCT {
+
+/**
+ * @brief Starts recording trace events
+ *
+ * While recording, every fitting stage and every chunk of work a thread
+ * processes inside the parallel regions of the fitting loop is recorded
+ * together with the thread that ran it. Events of a previous recording are
+ * discarded.
+ *
+ * @pre No fit is running
+ * @see stopTracing()
+ */
+void startTracing();
+
+/**
+ * @brief Stops recording trace events and writes them to the given file
+ *
+ * The file is written in the Chrome trace event format and can be opened in
+ * `chrome://tracing` or the Perfetto UI.
+ *
+ * @param filename Path to the output file
+ * @pre No fit is running
+ * @throws std::invalid_argument if the file could not be written
+ */
+void stopTracing(std::string const &filename);
+
+/// Returns true iff trace events are being recorded
+bool isTracing() noexcept;
+
+} // namespace CortidQCT
@@ -98,6 +98,34 @@ public:
 
   /// @}
 
+  /// @name Resampling
+  /// @{
+
+  /// @brief Reduces the resolution of the volume by an integer factor
+  ///
+  /// Voxel `i` of the downsampled volume is located at voxel `factor * i` of
+  /// the original volume, i.e. world coordinates are preserved. Its value is
+  /// the mean of the original voxels within a box of `factor + 1` (odd
+  /// factors: `factor`) voxels per dimension centered at that position.
+  ///
+  /// @param factor Downsampling factor, 1 leaves the volume untouched
+  /// @return Reference to `*this`.
+  /// @throw std::invalid_argument if `factor` is zero
+  VoxelVolume &downsample(std::size_t factor);
+
+  /// @brief Returns a copy of the volume with the resolution reduced by an
+  /// integer factor
+  ///
+  /// Same as `downsample()`, but reads the voxels of this volume directly
+  /// instead of copying them first.
+  ///
+  /// @param factor Downsampling factor, 1 returns a copy
+  /// @return The downsampled volume
+  /// @throw std::invalid_argument if `factor` is zero
+  VoxelVolume downsampled(std::size_t factor) const;
+
+  /// @}
+
   /**
    * @name Raw Data Access
    * The methods in this section all call a functional with a pointer to raw
@@ -0,0 +1,170 @@
+/**
+ * @file      BinaryIO.h
+ *
+ * @brief     This header contains helpers for reading and writing little
+ * endian binary data.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+/// True iff the host byte order is little endian
+inline bool hostIsLittleEndian() noexcept {
+  std::uint16_t const probe = 1;
+  unsigned char firstByte;
+  std::memcpy(&firstByte, &probe, 1);
+  return firstByte == 1;
+}
+
+/**
+ * @brief Computes the 64 bit FNV-1a hash of the given bytes
+ *
+ * Pass the result of a previous call as `hash` to hash non-contiguous data.
+ */
+inline std::uint64_t fnv1a64(void const *data, std::size_t size,
+                             std::uint64_t hash = 0xcbf29ce484222325ull) {
+  auto const *bytes = static_cast<unsigned char const *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/// Loads a value of type `Stored` in little endian byte order from `src`
+template <class Stored> inline Stored loadLittleEndian(void const *src) {
+  static_assert(std::is_trivially_copyable<Stored>::value,
+                "Stored must be trivially copyable");
+
+  unsigned char bytes[sizeof(Stored)];
+  std::memcpy(bytes, src, sizeof(Stored));
+  if (!hostIsLittleEndian()) std::reverse(bytes, bytes + sizeof(Stored));
+
+  Stored value;
+  std::memcpy(&value, bytes, sizeof(Stored));
+  return value;
+}
+
+/// Stores `value` as `Stored` in little endian byte order at `dst`
+template <class Stored, class V>
+inline void storeLittleEndian(void *dst, V value) {
+  static_assert(std::is_trivially_copyable<Stored>::value,
+                "Stored must be trivially copyable");
+
+  auto const stored = static_cast<Stored>(value);
+  auto *bytes = static_cast<unsigned char *>(dst);
+  std::memcpy(bytes, &stored, sizeof(Stored));
+  if (!hostIsLittleEndian()) std::reverse(bytes, bytes + sizeof(Stored));
+}
+
+/// Writes `n` values of type `Stored` in little endian byte order
+template <class Stored, class V>
+void writeLittleEndian(std::ostream &out, V const *values, std::size_t n) {
+  std::vector<unsigned char> bytes(n * sizeof(Stored));
+  for (std::size_t i = 0; i < n; ++i) {
+    storeLittleEndian<Stored>(bytes.data() + i * sizeof(Stored), values[i]);
+  }
+
+  out.write(reinterpret_cast<char const *>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+}
+
+/// Writes a single value of type `Stored` in little endian byte order
+template <class Stored, class V>
+void writeLittleEndian(std::ostream &out, V value) {
+  writeLittleEndian<Stored>(out, &value, 1);
+}
+
+/// Reads `n` values of type `Stored` in little endian byte order
+/// @throws std::invalid_argument if the stream ends prematurely
+template <class Stored, class V>
+void readLittleEndian(std::istream &in, V *values, std::size_t n) {
+  std::vector<unsigned char> bytes(n * sizeof(Stored));
+  if (!in.read(reinterpret_cast<char *>(bytes.data()),
+               static_cast<std::streamsize>(bytes.size()))) {
+    throw std::invalid_argument("Unexpected end of binary file");
+  }
+
+  for (std::size_t i = 0; i < n; ++i) {
+    values[i] = static_cast<V>(
+        loadLittleEndian<Stored>(bytes.data() + i * sizeof(Stored)));
+  }
+}
+
+/// Reads a single value of type `Stored` in little endian byte order
+template <class Stored> Stored readLittleEndian(std::istream &in) {
+  Stored value;
+  readLittleEndian<Stored>(in, &value, 1);
+  return value;
+}
+
+/// Appends little endian values to a byte buffer
+class ByteWriter {
+public:
+  inline explicit ByteWriter(std::size_t capacity) { bytes_.reserve(capacity); }
+
+  template <class Stored, class V> void append(V const *values, std::size_t n) {
+    auto const offset = bytes_.size();
+    bytes_.resize(offset + n * sizeof(Stored));
+    for (std::size_t i = 0; i < n; ++i) {
+      storeLittleEndian<Stored>(bytes_.data() + offset + i * sizeof(Stored),
+                                values[i]);
+    }
+  }
+
+  std::vector<unsigned char> const &bytes() const noexcept { return bytes_; }
+
+private:
+  std::vector<unsigned char> bytes_;
+};
+
+/// Reads little endian values from a byte buffer with bounds checking
+class ByteReader {
+public:
+  inline ByteReader(char const *begin, char const *end) noexcept
+      : pos_(begin), end_(end) {}
+
+  template <class Stored, class V> void read(V *values, std::size_t n) {
+    if (n > static_cast<std::size_t>(end_ - pos_) / sizeof(Stored)) {
+      throw std::invalid_argument("Unexpected end of file");
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      values[i] = static_cast<V>(loadLittleEndian<Stored>(pos_));
+      pos_ += sizeof(Stored);
+    }
+  }
+
+  template <class Stored> Stored read() {
+    Stored value;
+    read<Stored>(&value, 1);
+    return value;
+  }
+
+  template <class Stored, class V> std::vector<V> readVector(std::size_t n) {
+    std::vector<V> values(n);
+    read<Stored>(values.data(), n);
+    return values;
+  }
+
+private:
+  char const *pos_;
+  char const *end_;
+};
+
+} // namespace Internal
+} // namespace CortidQCT
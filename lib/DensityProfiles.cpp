@@ -0,0 +1,140 @@
+/**
+ * @file      DensityProfiles.cpp
+ *
+ * @brief     Implementation of the density profile extraction
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "DensityProfiles.h"
+#include "MeshAdaptors.h"
+#include "Sampler.h"
+
+#include <Eigen/Core>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+namespace CortidQCT {
+
+using namespace Internal;
+
+void sampleDensityProfiles(Mesh<float> const &mesh, VoxelVolume const &volume,
+                           DiscreteRangef const &range,
+                           DensityCalibration const &calibration,
+                           float *profiles, float exteriorValue) {
+  using Eigen::Map;
+  using Eigen::MatrixXf;
+  if (mesh.vertexCount() == 0) return;
+  if (profiles == nullptr) {
+    throw std::invalid_argument("Profile buffer must not be NULL");
+  }
+
+  auto const V = Adaptor::vertexMap(mesh);
+  auto const N = Adaptor::vertexNormalMap(mesh);
+
+  // The profile of each vertex is stored consecutively, i.e. as the
+  // transpose of the column major N x M matrix the sampler expects
+  Map<MatrixXf> values{profiles,
+                       gsl::narrow<Eigen::Index>(range.numElements()),
+                       V.cols()};
+
+  VolumeSampler const volumeSampler{volume, exteriorValue};
+  volumeSampler.sampleNormalLines(V, N, range, values.transpose(),
+                                  calibration.slope, calibration.intercept);
+}
+
+std::vector<float> sampleDensityProfiles(Mesh<float> const &mesh,
+                                         VoxelVolume const &volume,
+                                         DiscreteRangef const &range,
+                                         DensityCalibration const &calibration,
+                                         float exteriorValue) {
+  std::vector<float> profiles(mesh.vertexCount() * range.numElements());
+
+  sampleDensityProfiles(mesh, volume, range, calibration, profiles.data(),
+                        exteriorValue);
+
+  return profiles;
+}
+
+std::vector<LabelDensityProfile>
+aggregateDensityProfiles(Mesh<float> const &mesh, float const *profiles,
+                         std::size_t samplesPerProfile) {
+  using Label = Mesh<float>::Label;
+
+  /// Running sums of one label
+  struct Accumulator {
+    std::size_t vertexCount = 0;
+    std::vector<double> sum;
+    std::vector<double> sumOfSquares;
+    std::vector<std::size_t> count;
+  };
+
+  auto const nV = mesh.vertexCount();
+  if (nV > 0 && profiles == nullptr) {
+    throw std::invalid_argument("Profiles must not be NULL");
+  }
+
+  std::map<Label, Accumulator> accumulators;
+
+  mesh.withUnsafeLabelPointer([&](Label const *labels) {
+    for (std::size_t i = 0; i < nV; ++i) {
+      auto &acc = accumulators[labels[i]];
+      if (acc.vertexCount++ == 0) {
+        acc.sum.assign(samplesPerProfile, 0.0);
+        acc.sumOfSquares.assign(samplesPerProfile, 0.0);
+        acc.count.assign(samplesPerProfile, 0);
+      }
+
+      auto const *profile = profiles + i * samplesPerProfile;
+      for (auto k = 0u; k < samplesPerProfile; ++k) {
+        auto const value = static_cast<double>(profile[k]);
+        if (std::isnan(value)) continue;
+        acc.sum[k] += value;
+        acc.sumOfSquares[k] += value * value;
+        ++acc.count[k];
+      }
+    }
+  });
+
+  std::vector<LabelDensityProfile> result;
+  result.reserve(accumulators.size());
+
+  for (auto const &entry : accumulators) {
+    auto const &acc = entry.second;
+    LabelDensityProfile profile;
+    profile.label = entry.first;
+    profile.vertexCount = acc.vertexCount;
+    profile.sampleCount = acc.count;
+    profile.mean.resize(samplesPerProfile);
+    profile.standardDeviation.resize(samplesPerProfile);
+
+    for (auto k = 0u; k < samplesPerProfile; ++k) {
+      if (acc.count[k] == 0) {
+        profile.mean[k] = std::numeric_limits<float>::quiet_NaN();
+        profile.standardDeviation[k] = std::numeric_limits<float>::quiet_NaN();
+        continue;
+      }
+
+      auto const n = static_cast<double>(acc.count[k]);
+      auto const mean = acc.sum[k] / n;
+      auto const variance =
+          std::max(acc.sumOfSquares[k] / n - mean * mean, 0.0);
+      profile.mean[k] = static_cast<float>(mean);
+      profile.standardDeviation[k] = static_cast<float>(std::sqrt(variance));
+    }
+
+    result.push_back(std::move(profile));
+  }
+
+  return result;
+}
+
+} // namespace CortidQCT
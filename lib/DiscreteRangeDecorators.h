@@ -10,6 +10,8 @@
  * AFL 3.0 license; see LICENSE for full license details.
  */
 
+#pragma once
+
 #include "DiscreteRange.h"
 
 #include <Eigen/Core>
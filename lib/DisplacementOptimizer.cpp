@@ -12,6 +12,7 @@
 #include "DisplacementOptimizer.h"
 #include "CommonMath.h"
 #include "DiscreteRangeDecorators.h"
+#include "TraceRecorder.h"
 
 namespace CortidQCT {
 namespace Internal {
@@ -21,11 +22,11 @@ namespace {
 /// @brief Convert per vertex normals to angles with z-axis in degrees
 template <class DerivedN>
 Eigen::VectorXf normalsToAngles(Eigen::MatrixBase<DerivedN> const &N) {
-  Expects(N.rows() > 0);
-  Expects(N.cols() == 3);
+  Expects(N.cols() > 0);
+  Expects(N.rows() == 3);
   Eigen::VectorXf const angles =
-      N.col(2).array().abs().acos().template cast<float>() * 180.f /
-      static_cast<float>(M_PI);
+      N.row(2).transpose().array().abs().acos().template cast<float>() *
+      180.f / static_cast<float>(M_PI);
 
   return angles;
 }
@@ -37,7 +38,7 @@ Eigen::VectorXf normalsToAngles(Eigen::MatrixBase<DerivedN> const &N) {
  * densities.
  *
  * @param model MeasurementModel instance
- * @param N per-vertex normal matrix
+ * @param N per-vertex normal matrix (3xN)
  * @param densities densities sampled from input volume along lines through
  * vertices along normals from `N`
  * @param positionsOut position matrix to update
@@ -50,9 +51,9 @@ void updateModelSamplingPositions(MeasurementModel const &model,
                                   Eigen::MatrixBase<DerivedOut> &positionsOut) {
   using Eigen::VectorXf;
 
-  Expects(N.cols() == 3);
-  Expects(N.rows() > 0);
-  Expects(densities.rows() % N.rows() == 0);
+  Expects(N.rows() == 3);
+  Expects(N.cols() > 0);
+  Expects(densities.rows() % N.cols() == 0);
 
   if (positionsOut.rows() != densities.rows()) {
     positionsOut.derived().resize(densities.rows(), 4);
@@ -61,13 +62,13 @@ void updateModelSamplingPositions(MeasurementModel const &model,
   Ensures(positionsOut.rows() == densities.rows());
   Ensures(positionsOut.cols() >= 3);
 
-  auto const numVertices = N.rows();
-  auto const numSamples = densities.rows() / N.rows();
+  auto const numVertices = N.cols();
+  auto const numSamples = densities.rows() / N.cols();
 
   VectorXf const t = discreteRangeElementVector(model.samplingRange);
 
   auto const angles = normalsToAngles(N);
-  Ensures(angles.rows() == N.rows());
+  Ensures(angles.rows() == N.cols());
 
   positionsOut.col(1) = densities.template cast<float>();
   positionsOut.col(2) = angles.template cast<float>().replicate(numSamples, 1);
@@ -109,21 +110,25 @@ operator()(Eigen::MatrixBase<DerivedN> const &N,
                                modelSamplingPositions_);
 
   // Pre-allocate matrix for observation likelihood given displacement
-  MatrixXf Lzs(N.rows(), displacements.rows());
+  MatrixXf Lzs(N.cols(), displacements.rows());
 
-  MatrixXf tmp(N.rows() * numSamples, displacements.rows());
+  VectorXf modelSamples(N.cols() * numSamples);
+#pragma omp parallel firstprivate(modelSamples)
+  {
+    ScopedTraceEvent const trace{"observationLikelihood chunk"};
 
-  VectorXf modelSamples(N.rows() * numSamples);
-#pragma omp parallel for firstprivate(modelSamples)
-  for (Index i = 0; i < displacements.size(); ++i) {
+#pragma omp for nowait
+    for (Index i = 0; i < displacements.size(); ++i) {
 
-    modelSampler_(modelSamplingPositions_, displacements(i), modelSamples);
+      modelSampler_(modelSamplingPositions_, displacements(i), modelSamples);
 
-    // interpret modelSamples as 2K+1 x N matrix, then the observation
-    // log likelihood is the colwise sum of that matrix
-    Lzs.col(i) = Map<MatrixXf const>{modelSamples.data(), N.rows(), numSamples}
-                     .rowwise()
-                     .sum();
+      // interpret modelSamples as 2K+1 x N matrix, then the observation
+      // log likelihood is the colwise sum of that matrix
+      Lzs.col(i) =
+          Map<MatrixXf const>{modelSamples.data(), N.cols(), numSamples}
+              .rowwise()
+              .sum();
+    }
   }
 
   // To compute the posterior, the displacement prior log likelihood and the
@@ -165,13 +170,18 @@ operator()(Eigen::MatrixBase<DerivedN> const &N,
   posteriorLL.colwise() -= posteriorDenominator;
 
   // Find the displacements that maximize the posterior log likelihood
-  VectorXf bestDisplacements(N.rows());
-#pragma omp parallel for
-  for (Index i = 0; i < N.rows(); ++i) {
-    Index idx;
-    posteriorLL.row(i).maxCoeff(&idx);
-    bestDisplacements(i) =
-        displacementRange.nThElement(gsl::narrow_cast<std::size_t>(idx) + 1);
+  VectorXf bestDisplacements(N.cols());
+#pragma omp parallel
+  {
+    ScopedTraceEvent const trace{"bestDisplacements chunk"};
+
+#pragma omp for nowait
+    for (Index i = 0; i < N.cols(); ++i) {
+      Index idx;
+      posteriorLL.row(i).maxCoeff(&idx);
+      bestDisplacements(i) = displacementRange.nThElement(
+          gsl::narrow_cast<std::size_t>(idx) + 1);
+    }
   }
 
   // Compute weight vector gamma
@@ -201,7 +211,7 @@ DisplacementOptimizer::logLikelihoodVector(
   updateModelSamplingPositions(model_, N, labels, measurements,
                                modelSamplingPositions_);
 
-  Matrix modelSamples(N.rows(), modelSamplingPositions_.rows() / N.rows());
+  Matrix modelSamples(N.cols(), modelSamplingPositions_.rows() / N.cols());
   modelSampler_(
       modelSamplingPositions_, .0f,
       Map<Vector>{modelSamples.data(), modelSamplingPositions_.rows(), 1});
@@ -228,51 +238,37 @@ float DisplacementOptimizer::logLikelihood(
 }
 
 template DisplacementOptimizer::DisplacementsWeightsPair DisplacementOptimizer::
-operator()<NormalMatrix<float>, LabelVector, Eigen::VectorXf>(
-    Eigen::MatrixBase<NormalMatrix<float>> const &,
+operator()<PointMatrix<float>, LabelVector, Eigen::VectorXf>(
+    Eigen::MatrixBase<PointMatrix<float>> const &,
     Eigen::MatrixBase<LabelVector> const &,
     Eigen::MatrixBase<Eigen::VectorXf> const &, std::size_t, float &);
 
 template DisplacementOptimizer::DisplacementsWeightsPair DisplacementOptimizer::
-operator()<NormalMatrix<double>, LabelVector, Eigen::VectorXd>(
-    Eigen::MatrixBase<NormalMatrix<double>> const &,
+operator()<PointMatrix<double>, LabelVector, Eigen::VectorXd>(
+    Eigen::MatrixBase<PointMatrix<double>> const &,
     Eigen::MatrixBase<LabelVector> const &,
     Eigen::MatrixBase<Eigen::VectorXd> const &, std::size_t, float &);
 
 template DisplacementOptimizer::DisplacementsWeightsPair DisplacementOptimizer::
-operator()<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
-    Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
-    Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &, std::size_t,
-    float &);
-
-template DisplacementOptimizer::DisplacementsWeightsPair DisplacementOptimizer::
-operator()<
-    Eigen::Transpose<Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+operator()<Eigen::Map<PointMatrix<float>>, Eigen::Map<LabelVector>,
+           Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &, std::size_t,
     float &);
 
 template float DisplacementOptimizer::logLikelihood<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+    Eigen::Map<PointMatrix<float>>, Eigen::Map<LabelVector>,
+    Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &);
 
 template Eigen::Matrix<float, Eigen::Dynamic, 1>
-DisplacementOptimizer::logLikelihoodVector<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+DisplacementOptimizer::logLikelihoodVector<Eigen::Map<PointMatrix<float>>,
+                                           Eigen::Map<LabelVector>,
+                                           Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &);
 
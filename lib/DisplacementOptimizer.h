@@ -40,6 +40,11 @@ public:
 
   /**
    * @brief Compute the optimal displacement and the corresponding weights
+   *
+   * @param N per-vertex normals (3xN), e.g. a map of the mesh normals
+   * @param labels per-vertex labels
+   * @param measurements volume samples, the samples at sampling position `k`
+   * of all vertices are stored consecutively
    */
   template <class DerivedN, class DerivedL, class DerivedM>
   DisplacementsWeightsPair
@@ -72,6 +77,12 @@ public:
     return modelSamplingPositions_;
   }
 
+  /// Returns the current, possibly decayed, squared sigmaS
+  inline float currentSigma() const noexcept { return currentSigma_; }
+
+  /// Overrides the current squared sigmaS, e.g. to resume a fit
+  inline void setCurrentSigma(float sigma) noexcept { currentSigma_ = sigma; }
+
 private:
   using ModelSamplingPositionMatrix = Eigen::Matrix<float, Eigen::Dynamic, 4>;
 
@@ -85,52 +96,39 @@ private:
 
 extern template DisplacementOptimizer::DisplacementsWeightsPair
 DisplacementOptimizer::
-operator()<NormalMatrix<float>, LabelVector, Eigen::VectorXf>(
-    Eigen::MatrixBase<NormalMatrix<float>> const &,
+operator()<PointMatrix<float>, LabelVector, Eigen::VectorXf>(
+    Eigen::MatrixBase<PointMatrix<float>> const &,
     Eigen::MatrixBase<LabelVector> const &,
     Eigen::MatrixBase<Eigen::VectorXf> const &, std::size_t, float &);
 
 extern template DisplacementOptimizer::DisplacementsWeightsPair
 DisplacementOptimizer::
-operator()<NormalMatrix<double>, LabelVector, Eigen::VectorXd>(
-    Eigen::MatrixBase<NormalMatrix<double>> const &,
+operator()<PointMatrix<double>, LabelVector, Eigen::VectorXd>(
+    Eigen::MatrixBase<PointMatrix<double>> const &,
     Eigen::MatrixBase<LabelVector> const &,
     Eigen::MatrixBase<Eigen::VectorXd> const &, std::size_t, float &);
 
 extern template DisplacementOptimizer::DisplacementsWeightsPair
-DisplacementOptimizer::operator()<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
-    Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
-    Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &, std::size_t,
-    float &);
-
-extern template DisplacementOptimizer::DisplacementsWeightsPair
-DisplacementOptimizer::operator()<
-    Eigen::Transpose<Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+DisplacementOptimizer::operator()<Eigen::Map<PointMatrix<float>>,
+                                  Eigen::Map<LabelVector>,
+                                  Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &, std::size_t,
     float &);
 
 extern template float DisplacementOptimizer::logLikelihood<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+    Eigen::Map<PointMatrix<float>>, Eigen::Map<LabelVector>,
+    Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &);
 
 extern template Eigen::Matrix<float, Eigen::Dynamic, 1>
-DisplacementOptimizer::logLikelihoodVector<
-    Eigen::Transpose<const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>,
-    Eigen::Map<LabelVector>, Eigen::Map<Eigen::VectorXf>>(
-    Eigen::MatrixBase<Eigen::Transpose<
-        const Eigen::Map<Eigen::Matrix<float, 3, Eigen::Dynamic>>>> const &,
+DisplacementOptimizer::logLikelihoodVector<Eigen::Map<PointMatrix<float>>,
+                                           Eigen::Map<LabelVector>,
+                                           Eigen::Map<Eigen::VectorXf>>(
+    Eigen::MatrixBase<Eigen::Map<PointMatrix<float>>> const &,
     Eigen::MatrixBase<Eigen::Map<LabelVector>> const &,
     Eigen::MatrixBase<Eigen::Map<Eigen::VectorXf>> const &);
 
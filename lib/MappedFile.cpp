@@ -0,0 +1,102 @@
+/**
+ * @file      MappedFile.cpp
+ *
+ * @brief     Implementation file for MappedFile
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MappedFile.h"
+#include "ParseHelpers.h"
+
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define CORTIDQCT_HAS_MMAP
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace CortidQCT {
+namespace Internal {
+
+MappedFile::MappedFile(std::string const &filename) {
+#ifdef CORTIDQCT_HAS_MMAP
+  auto const fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::invalid_argument("Failed to open file '" + filename + "'");
+  }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::invalid_argument("Failed to stat file '" + filename + "'");
+  }
+
+  size_ = static_cast<std::size_t>(info.st_size);
+
+  // Empty files cannot be mapped
+  if (size_ == 0) {
+    ::close(fd);
+    data_ = contents_.data();
+    return;
+  }
+
+  auto *ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (ptr != MAP_FAILED) {
+    ::madvise(ptr, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<char const *>(ptr);
+    mapped_ = true;
+    return;
+  }
+#endif
+
+  // Fallback: read into memory
+  contents_ = readFileContents(filename);
+  data_ = contents_.data();
+  size_ = contents_.size();
+}
+
+MappedFile::~MappedFile() { release(); }
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, false)),
+      contents_(std::move(other.contents_)) {
+  if (!mapped_) data_ = contents_.data();
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    release();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0);
+    mapped_ = std::exchange(other.mapped_, false);
+    contents_ = std::move(other.contents_);
+    if (!mapped_) data_ = contents_.data();
+  }
+  return *this;
+}
+
+void MappedFile::release() noexcept {
+#ifdef CORTIDQCT_HAS_MMAP
+  if (mapped_) {
+    ::munmap(const_cast<char *>(data_), size_);
+    mapped_ = false;
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,69 @@
+/**
+ * @file      MappedFile.h
+ *
+ * @brief     This header contains the definition of a read-only memory mapped
+ * file.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace CortidQCT {
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Read-only view of the contents of a file
+ *
+ * On POSIX systems the file is memory mapped. On other systems the contents
+ * are read into memory.
+ */
+class MappedFile {
+public:
+  /**
+   * @brief Maps the given file into memory
+   * @param filename path to the file
+   * @throws std::invalid_argument if the file could not be opened or mapped
+   */
+  explicit MappedFile(std::string const &filename);
+
+  ~MappedFile();
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  /// Pointer to the first byte of the file
+  inline char const *data() const noexcept { return data_; }
+
+  /// Size of the file in bytes
+  inline std::size_t size() const noexcept { return size_; }
+
+  /// Contents of the file
+  inline std::string_view view() const noexcept { return {data_, size_}; }
+
+private:
+  void release() noexcept;
+
+  char const *data_ = nullptr;
+  std::size_t size_ = 0;
+  /// True iff `data_` points to a memory mapping
+  bool mapped_ = false;
+  /// Fallback storage if the file could not be mapped
+  std::string contents_;
+};
+#pragma clang diagnostic pop
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -146,7 +146,8 @@ MeasurementModel &MeasurementModel::loadFromFile(std::string const &filename) {
       VOIData voiData;
       voiData.label = label;
       voiData.scale = scale;
-      voiData.data = std::move(storage);
+      voiData.data =
+          std::make_shared<std::vector<float> const>(std::move(storage));
 
       if (auto const &voiNameNode = datNode["name"]) {
         voiData.name = voiNameNode.as<std::string>();
@@ -233,6 +234,8 @@ void MeasurementModel::reorderData() {
     auto const &value = keyVal.second;
 
     auto destValue = value;
+    auto const &src = *value.data;
+    std::vector<float> reordered(src.size());
 
     // The original data layout is distance - density - angle.
     // Since distance is not going to be interpolated, it should be moved to
@@ -244,10 +247,12 @@ void MeasurementModel::reorderData() {
           auto const destIndex =
               i * (nDensities * nAngles) + j * nDensities + k;
 
-          destValue.data[destIndex] = value.data[srcIndex];
+          reordered[destIndex] = src[srcIndex];
         }
       }
     }
+    destValue.data =
+        std::make_shared<std::vector<float> const>(std::move(reordered));
 
     dest.emplace(key, destValue);
   }
@@ -11,19 +11,23 @@
 
 #include "Mesh.h"
 #include "CheckExtension.h"
-#include "MatrixIO.h"
 #include "MeshAdaptors.h"
+#include "MeshDecimation.h"
 #include "MeshHelpers.h"
+#include "MeshIO.h"
+#include "MeshReordering.h"
+#include "MeshSlicing.h"
+#include "MeshSubdivision.h"
+#include "MeshVoxelization.h"
 #include "SIMesh.h"
+#include "TraceRecorder.h"
+#include "TriangleBVH.h"
 
-#include <Eigen/Sparse>
 #include <gsl/gsl>
 #include <igl/orient_outward.h>
 #include <igl/orientable_patches.h>
 #include <igl/ray_mesh_intersect.h>
-#include <igl/readOFF.h>
 #include <igl/read_triangle_mesh.h>
-#include <igl/upsample.h>
 #include <igl/writeOFF.h>
 #include <igl/write_triangle_mesh.h>
 
@@ -33,6 +37,9 @@
 #include <functional>
 #include <iterator>
 #include <limits>
+#include <memory>
+#include <numeric>
+#include <utility>
 
 namespace CortidQCT {
 
@@ -53,6 +60,27 @@ void orientOutwards(Eigen::MatrixBase<DerivedV> const &V,
   igl::orient_outward(V.derived(), F.derived(), C, F.derived(), I);
 }
 
+/// Orients the triangles of a mesh given in `Mesh` storage layout outwards
+template <class T, class Index>
+void orientOutwards(std::vector<T> const &vertexData,
+                    std::vector<Index> &indexData) {
+  using Eigen::Dynamic;
+  using Eigen::Map;
+  using Eigen::Matrix;
+  using gsl::narrow;
+
+  Map<Matrix<T, 3, Dynamic> const> const vertices{
+      vertexData.data(), 3, narrow<Eigen::Index>(vertexData.size() / 3)};
+  Map<Matrix<Index, 3, Dynamic>> indices{
+      indexData.data(), 3, narrow<Eigen::Index>(indexData.size() / 3)};
+
+  Matrix<T, Dynamic, 3> const V = vertices.transpose();
+  Matrix<Index, Dynamic, 3> F = indices.transpose();
+  orientOutwards(V, F);
+
+  indices = F.transpose();
+}
+
 struct SequencialTransform {
   template <class I, class O, class F>
   void operator()(I b, I e, O o, F &&f) const {
@@ -81,6 +109,24 @@ struct ParallelTransform {
 
 } // anonymous namespace
 
+template <class T>
+Mesh<T>::Mesh(Mesh const &other)
+    : vertexData_(other.vertexData_), indexData_(other.indexData_),
+      labelData_(other.labelData_), normalData_(other.normalData_),
+      // `topology()` publishes the cache of `other` concurrently
+      topology_(std::atomic_load(&other.topology_)) {}
+
+template <class T> Mesh<T> &Mesh<T>::operator=(Mesh const &other) {
+  vertexData_ = other.vertexData_;
+  indexData_ = other.indexData_;
+  labelData_ = other.labelData_;
+  normalData_ = other.normalData_;
+  // `topology()` publishes the cache of `other` concurrently
+  topology_ = std::atomic_load(&other.topology_);
+
+  return *this;
+}
+
 template <class T> void Mesh<T>::ensurePostconditions() const {
   using Eigen::Dynamic;
   using Eigen::Map;
@@ -107,42 +153,26 @@ Mesh<T> &Mesh<T>::loadFromFile(std::string const &meshFilename,
   using gsl::narrow;
 
   // Check file format since igl does only print an error
-  std::string const supportedFormats[] = {"obj", "off",  "stl",   "wrl",
-                                          "ply", "mesh", "simesh"};
+  std::string const supportedFormats[] = {"obj", "off",  "stl",    "wrl",
+                                          "ply", "mesh", "simesh", "simeshb"};
 
   if (!IO::checkExtensions(meshFilename, supportedFormats)) {
     throw std::invalid_argument("Unsupported file format '" +
                                 IO::extension(meshFilename) + "'");
   }
 
-  Size lVertexCount{0};
+  auto const extension = IO::extension(meshFilename, true);
 
-  bool meshLoaded = false;
-  if (IO::extension(meshFilename, true) == "simesh") {
+  if (isSIMeshExtension(extension)) {
     *this = readFromSIMesh<T>(meshFilename, false);
-    meshLoaded = true;
-
-    Map<Matrix<T, 3, Dynamic>> vertices{vertexData_.data(), 3,
-                                        narrow<Eigen::Index>(vertexCount())};
-    Map<Matrix<Index, 3, Dynamic>> indices{
-        indexData_.data(), 3, narrow<Eigen::Index>(triangleCount())};
-
-    VertexMatrix<T> V = vertices.transpose();
-    FacetMatrix F = indices.transpose();
-    orientOutwards(V, F);
-
-    vertices = V.transpose();
-    indices = F.transpose();
-
-    lVertexCount = vertexCount();
-  }
-
-  MatrixXd vertices;
-  MatrixXi indices;
-
-  constexpr auto magicLabel = std::numeric_limits<Label>::max();
+  } else if (hasNativeMeshReader(extension)) {
+    auto data = readMeshFile<T>(meshFilename);
+    vertexData_ = std::move(data.vertices);
+    indexData_ = std::move(data.indices);
+  } else {
+    MatrixXd vertices;
+    MatrixXi indices;
 
-  if (!meshLoaded) {
     // Ensure the file exists and is readable, otherwise
     // igl::read_triangle_mesh() might SEGFAULT.
     if (!std::ifstream{meshFilename} ||
@@ -150,59 +180,22 @@ Mesh<T> &Mesh<T>::loadFromFile(std::string const &meshFilename,
       throw std::invalid_argument("Failed to read mesh from file '" +
                                   meshFilename + "'");
     }
-  }
-
-  // load labels. Fill labels vector with prefined value to be able to check if
-  // all labels are correctly initialized.
-  Matrix<Label, Dynamic, 1> labels =
-      magicLabel * Matrix<Label, Dynamic, 1>::Ones(vertices.rows());
-
-  std::ifstream labelStream{labelFilename};
-  if (!labelStream) {
-    throw std::invalid_argument("Failed to read labels form file '" +
-                                labelFilename + "'");
-  }
-  labelStream >> io(labels);
-
-  // Check if labels were correctly initialized
-  if ((labels.array() == magicLabel).any()) {
-    throw std::invalid_argument(
-        "Failed to read labels from file '" + labelFilename +
-        "', maybe the files does not contain the right number of labels (" +
-        std::to_string(vertices.rows()) + ")");
-  }
-
-  VertexData vertexData;
-  IndexData indexData;
-  if (!meshLoaded) {
-    lVertexCount = narrow<Size>(vertices.rows());
-    auto const lTriangleCount = narrow<Size>(indices.rows());
-
-    orientOutwards(vertices, indices);
-
-    // Reserve storage for vertex and index data
-    vertexData = VertexData(3 * lVertexCount);
-    indexData = IndexData(3 * lTriangleCount);
 
     // Copy data from eigen matrix into vectors
-    Map<Matrix<Scalar, 3, Dynamic>>{vertexData.data(), 3, vertices.rows()} =
+    vertexData_ = VertexData(narrow<Size>(3 * vertices.rows()));
+    indexData_ = IndexData(narrow<Size>(3 * indices.rows()));
+    Map<Matrix<Scalar, 3, Dynamic>>{vertexData_.data(), 3, vertices.rows()} =
         vertices.cast<Scalar>().transpose();
-    Map<Matrix<Index, 3, Dynamic>>{indexData.data(), 3, indices.rows()} =
+    Map<Matrix<Index, 3, Dynamic>>{indexData_.data(), 3, indices.rows()} =
         indices.cast<Index>().transpose();
-
-    Ensures(vertexData.size() == 3 * lVertexCount);
-    Ensures(indexData.size() == 3 * lTriangleCount);
   }
 
-  auto labelData = LabelData(lVertexCount);
-  Map<Matrix<Label, Dynamic, 1>>{labelData.data(), vertices.rows(), 1} = labels;
-  Ensures(labelData.size() == lVertexCount);
-  labelData_ = std::move(labelData);
+  orientOutwards(vertexData_, indexData_);
+  invalidateTopology();
 
-  if (!meshLoaded) {
-    vertexData_ = std::move(vertexData);
-    indexData_ = std::move(indexData);
-  }
+  // Superfluous labels are ignored, missing labels are an error
+  labelData_ = readLabelFile(labelFilename, vertexCount());
+  Ensures(labelData_.size() == vertexCount());
 
   updatePerVertexNormals();
 
@@ -214,80 +207,48 @@ Mesh<T> &Mesh<T>::loadFromFile(std::string const &meshFilename,
 template <class T>
 Mesh<T> &Mesh<T>::loadFromFile(std::string const &meshFilename,
                                ColorToLabelMap<Label, double> const &colorMap) {
-  using Eigen::Dynamic;
-  using Eigen::Map;
-  using Eigen::Matrix;
-  using Eigen::MatrixXd;
-  using Eigen::MatrixXi;
-  using gsl::narrow;
-
   // Check file format since igl does only print an error
-  std::string const supportedFormats[] = {"off", "coff", "simesh"};
+  std::string const supportedFormats[] = {"off", "coff", "ply", "simesh",
+                                          "simeshb"};
 
   if (!IO::checkExtensions(meshFilename, supportedFormats)) {
     throw std::invalid_argument("Unsupported file format '" +
                                 IO::extension(meshFilename) + "'");
   }
 
-  if (IO::extension(meshFilename, true) == "simesh") {
+  if (isSIMeshExtension(IO::extension(meshFilename, true))) {
     *this = readFromSIMesh<T>(meshFilename, true);
-    Map<Matrix<T, 3, Dynamic>> vertices{vertexData_.data(), 3,
-                                        narrow<Eigen::Index>(vertexCount())};
-    Map<Matrix<Index, 3, Dynamic>> indices{
-        indexData_.data(), 3, narrow<Eigen::Index>(triangleCount())};
-
-    VertexMatrix<T> V = vertices.transpose();
-    FacetMatrix F = indices.transpose();
-    orientOutwards(V, F);
-
-    vertices = V.transpose();
-    indices = F.transpose();
+    orientOutwards(vertexData_, indexData_);
+    invalidateTopology();
 
     ensurePostconditions();
     return *this;
   }
 
-  MatrixXd vertices, colors;
-  MatrixXi indices;
-
-  // Ensure the file exists and is readable, otherwise
-  // igl::readOFF() might SEGFAULT.
-  if (!std::ifstream{meshFilename} ||
-      !igl::readOFF(meshFilename, vertices, indices, colors)) {
-    throw std::invalid_argument("Failed to read mesh from file '" +
-                                meshFilename + "'");
-  }
-
-  auto const lVertexCount = narrow<Size>(vertices.rows());
-  auto const lTriangleCount = narrow<Size>(indices.rows());
-
-  orientOutwards(vertices, indices);
-
-  // Reserve storage for vertex and index data
-  auto vertexData = VertexData(3 * lVertexCount);
-  auto indexData = IndexData(3 * lTriangleCount);
-  auto labelData = LabelData(lVertexCount);
-
-  // Copy data from eigen matrix into vectors
-  Map<Matrix<Scalar, 3, Dynamic>>{vertexData.data(), 3, vertices.rows()} =
-      vertices.cast<Scalar>().transpose();
-  Map<Matrix<Index, 3, Dynamic>>{indexData.data(), 3, indices.rows()} =
-      indices.cast<Index>().transpose();
-
-  // Convert colors to labels
-  for (auto i = 0; i < colors.rows(); ++i) {
-    labelData[gsl::narrow_cast<std::size_t>(i)] =
-        colorMap(colors(i, 0), colors(i, 1), colors(i, 2));
+  auto data = readMeshFile<T>(meshFilename);
+  auto const lVertexCount = data.vertexCount();
+
+  auto labelData = LabelData(lVertexCount, 0);
+  if (!data.labels.empty()) {
+    // Labels stored in the file take precedence over colors
+    labelData = std::move(data.labels);
+  } else if (!data.colors.empty()) {
+    // Convert colors to labels
+    for (auto i = 0u; i < lVertexCount; ++i) {
+      labelData[i] = colorMap(data.colors[3 * i], data.colors[3 * i + 1],
+                              data.colors[3 * i + 2]);
+    }
   }
 
-  Ensures(vertexData.size() == 3 * lVertexCount);
-  Ensures(indexData.size() == 3 * lTriangleCount);
   Ensures(labelData.size() == lVertexCount);
 
-  vertexData_ = std::move(vertexData);
-  indexData_ = std::move(indexData);
+  vertexData_ = std::move(data.vertices);
+  indexData_ = std::move(data.indices);
   labelData_ = std::move(labelData);
 
+  orientOutwards(vertexData_, indexData_);
+  invalidateTopology();
+
   updatePerVertexNormals();
 
   ensurePostconditions();
@@ -307,8 +268,8 @@ void Mesh<T>::writeToFile(std::string const &meshFilename,
   if (isEmpty()) { return; }
 
   // Check file format since igl does only print an error
-  std::string const supportedFormats[] = {"obj", "off",  "stl",   "wrl",
-                                          "ply", "mesh", "simesh"};
+  std::string const supportedFormats[] = {"obj", "off",  "stl",    "wrl",
+                                          "ply", "mesh", "simesh", "simeshb"};
 
   if (!IO::checkExtensions(meshFilename, supportedFormats)) {
     throw std::invalid_argument("Unsupported file format '" +
@@ -316,10 +277,12 @@ void Mesh<T>::writeToFile(std::string const &meshFilename,
   }
 
   // check for SIMEsh format
-  if (IO::extension(meshFilename, true) == "simesh") {
+  if (isSIMeshExtension(IO::extension(meshFilename, true))) {
     constexpr auto magicLabel = std::numeric_limits<Label>::max();
     auto const includeLabels = labelVector(*this)[0] != magicLabel;
     writeToSIMesh(*this, meshFilename, includeLabels);
+  } else if (IO::extension(meshFilename, true) == "ply") {
+    writeToPLY(*this, meshFilename);
   } else {
 
     // Convert vertex and index data to a format igl understads
@@ -365,7 +328,8 @@ void Mesh<T>::writeToFile(
   if (isEmpty()) { return; };
 
   // Check file format since igl does only print an error
-  std::string const supportedFormats[] = {"off", "coff", "simesh"};
+  std::string const supportedFormats[] = {"off", "coff", "ply", "simesh",
+                                          "simeshb"};
 
   if (!IO::checkExtensions(meshFilename, supportedFormats)) {
     throw std::invalid_argument("Unsupported file format '" +
@@ -373,8 +337,10 @@ void Mesh<T>::writeToFile(
   }
 
   // check for SIMEsh format
-  if (IO::extension(meshFilename, true) == "simesh") {
+  if (isSIMeshExtension(IO::extension(meshFilename, true))) {
     writeToSIMesh(*this, meshFilename, true);
+  } else if (IO::extension(meshFilename, true) == "ply") {
+    writeToPLY(*this, meshFilename, &labelMap);
   } else {
     // Convert vertex and index data to a format igl understads
     Map<Matrix<Scalar, 3, Dynamic> const> const Vmap{
@@ -423,7 +389,7 @@ std::array<T, 3> Mesh<T>::cartesianRepresentation(
   using Internal::Adaptor::vertexMap;
 
   if ((point.triangleIndex < 0) ||
-      (narrow_cast<std::size_t>(point.triangleIndex) > triangleCount())) {
+      (narrow_cast<std::size_t>(point.triangleIndex) >= triangleCount())) {
     throw std::range_error("Triangle index out of range");
   }
 
@@ -456,7 +422,7 @@ template <> struct BarycentricPointValidatorHelper_<true> {
     auto const idxUB = mesh.triangleCount();
     if (std::any_of(begin, end, [idxUB](auto const &p) {
           return (p.triangleIndex < 0) ||
-                 (gsl::narrow_cast<std::size_t>(p.triangleIndex) > idxUB);
+                 (gsl::narrow_cast<std::size_t>(p.triangleIndex) >= idxUB);
         })) {
       throw std::out_of_range("At least one triangle index is out of range");
     }
@@ -469,7 +435,7 @@ template <> struct BarycentricPointValidatorHelper_<false> {
   static void validate(BarycentricPoint<T, typename Mesh<T>::Index> const &pt,
                        Mesh<T> const &mesh) {
     if ((pt.triangleIndex < 0) ||
-        (gsl::narrow_cast<std::size_t>(pt.triangleIndex) >
+        (gsl::narrow_cast<std::size_t>(pt.triangleIndex) >=
          mesh.triangleCount())) {
       throw std::out_of_range("triangle index is out of range");
     }
@@ -485,6 +451,51 @@ using BarycentricPointValidator_ =
         std::forward_iterator_tag,
         typename std::iterator_traits<Iter>::iterator_category>::value>;
 
+/// Minimum number of points to interpolate in parallel
+constexpr std::ptrdiff_t minParallelInterpolationSize = 1024;
+
+/// Number of rays that share an output buffer in `allRayIntersections()`
+constexpr std::size_t rayBlockSize = 64;
+
+/**
+ * @brief Blends the attributes of the triangle corners of each point
+ *
+ * Random access fast path of `Mesh::barycentricInterpolation()`. Points must
+ * be validated before. The points are split between the OpenMP threads, each
+ * point is blended on its own. If `Dim` is positive, it is used as the number
+ * of attribute dimensions at compile time so that the blend is fully
+ * unrolled, otherwise `dims` is used.
+ *
+ * Only the loop over the attribute dimensions of a single point is an `omp
+ * simd` loop, i.e. it is vectorized for long attribute vectors. The corner
+ * attributes are not gathered across points.
+ */
+template <int Dim, class Index, class PtIter, class AttrIter, class OutIter>
+void barycentricBlend_(PtIter points, Index nPoints, Index const *indices,
+                       AttrIter attributes, OutIter out, Index dims) {
+  auto const N = Dim > 0 ? Index{Dim} : dims;
+
+#pragma omp parallel for if (nPoints >= minParallelInterpolationSize)
+  for (Index p = 0; p < nPoints; ++p) {
+    auto const &point = points[p];
+    auto const *triangle = indices + 3 * point.triangleIndex;
+    auto const w0 = point.uv[0];
+    auto const w1 = point.uv[1];
+    auto const w2 = 1 - w0 - w1;
+
+    auto const a0 = attributes + N * triangle[0];
+    auto const a1 = attributes + N * triangle[1];
+    auto const a2 = attributes + N * triangle[2];
+    auto const o = out + N * p;
+
+    // Contiguous attribute dimensions of one point, no gather across points
+#pragma omp simd
+    for (Index i = 0; i < N; ++i) {
+      o[i] = w0 * a0[i] + w1 * a1[i] + w2 * a2[i];
+    }
+  }
+}
+
 } // namespace Internal
 
 template <class T>
@@ -508,7 +519,7 @@ void Mesh<T>::barycentricInterpolation(PtIter pointsBegin, PtIter pointsEnd,
   using std::iterator_traits;
   using PtTraits = iterator_traits<PtIter>;
   using AttrTraits = iterator_traits<AttrIter>;
-  // using OutTraits = iterator_traits<OutputIterator>;
+  using OutTraits = iterator_traits<OutputIterator>;
   static_assert(is_base_of<std::input_iterator_tag,
                            typename PtTraits::iterator_category>::value,
                 "PtIter must be an input iterator");
@@ -524,24 +535,49 @@ void Mesh<T>::barycentricInterpolation(PtIter pointsBegin, PtIter pointsEnd,
   // ForwardIterator
   Validator::validate(pointsBegin, pointsEnd, *this);
 
-  auto const iMap = indexMap(*this);
-
   auto const N = gsl::narrow<Index>(attributeDimensions);
 
-  for (auto ptI = pointsBegin; ptI != pointsEnd; ++ptI) {
-    for (auto i = 0; i < N; ++i) {
-      // Validate input. Will only result in code if PtIter does not conform to
-      // ForwardIterator
+  // Points and outputs with random access can be processed in parallel
+  constexpr auto isRandomAccess =
+      is_base_of<std::random_access_iterator_tag,
+                 typename PtTraits::iterator_category>::value &&
+      is_base_of<std::random_access_iterator_tag,
+                 typename OutTraits::iterator_category>::value;
+
+  if constexpr (isRandomAccess) {
+    using Internal::barycentricBlend_;
+
+    auto const nPoints = std::distance(pointsBegin, pointsEnd);
+    auto const *indices = indexData_.data();
+
+    switch (N) {
+      case 1:
+        barycentricBlend_<1>(pointsBegin, nPoints, indices, attrBegin, out, N);
+        break;
+      case 3:
+        barycentricBlend_<3>(pointsBegin, nPoints, indices, attrBegin, out, N);
+        break;
+      default:
+        barycentricBlend_<0>(pointsBegin, nPoints, indices, attrBegin, out, N);
+    }
+  } else {
+    auto const iMap = indexMap(*this);
+
+    for (auto ptI = pointsBegin; ptI != pointsEnd; ++ptI) {
+      // Validate input. Will only result in code if PtIter does not conform
+      // to ForwardIterator
       Validator::validate(*ptI, *this);
 
-      std::array<Index, 3> const attrIdx{{N * iMap(0, ptI->triangleIndex) + i,
-                                          N * iMap(1, ptI->triangleIndex) + i,
-                                          N * iMap(2, ptI->triangleIndex) + i}};
+      std::array<Index, 3> const attrIdx{{N * iMap(0, ptI->triangleIndex),
+                                          N * iMap(1, ptI->triangleIndex),
+                                          N * iMap(2, ptI->triangleIndex)}};
 
-      // Interpolate values
-      *out++ = ptI->uv[0] * attrBegin[attrIdx[0]] +
-               ptI->uv[1] * attrBegin[attrIdx[1]] +
-               (1 - ptI->uv[0] - ptI->uv[1]) * attrBegin[attrIdx[2]];
+      for (auto i = 0; i < N; ++i) {
+        // Interpolate values
+        *out++ = ptI->uv[0] * attrBegin[attrIdx[0] + i] +
+                 ptI->uv[1] * attrBegin[attrIdx[1] + i] +
+                 (1 - ptI->uv[0] - ptI->uv[1]) * attrBegin[attrIdx[2] + i];
+      }
     }
   }
 }
@@ -624,85 +660,222 @@ void Mesh<T>::rayIntersections(InputIterator raysBegin, InputIterator raysEnd,
       });
 }
 
+template <class T>
+void Mesh<T>::allRayIntersections(
+    Ray<T> const *raysBegin, Ray<T> const *raysEnd,
+    std::vector<std::size_t> &offsets,
+    std::vector<RayMeshIntersection<T>> &intersections) const {
+  using Internal::rayBlockSize;
+  using Vector3 = Eigen::Matrix<T, 3, 1>;
+  using gsl::narrow_cast;
+
+  auto const nRays = narrow_cast<std::size_t>(raysEnd - raysBegin);
+  offsets.assign(nRays + 1, 0);
+  intersections.clear();
+  if (nRays == 0 || isEmpty()) return;
+
+  Internal::TriangleBVH<T> const bvh{vertexData_.data(), indexData_.data(),
+                                     triangleCount()};
+
+  // Each block of rays collects its intersections in a separate buffer, the
+  // buffers are concatenated afterwards
+  auto const nBlocks = (nRays + rayBlockSize - 1) / rayBlockSize;
+  std::vector<std::vector<RayMeshIntersection<T>>> blocks(nBlocks);
+
+#pragma omp parallel
+  {
+    std::vector<typename Internal::TriangleBVH<T>::LineHit> hits;
+
+#pragma omp for schedule(dynamic)
+    for (Index b = 0; b < narrow_cast<Index>(nBlocks); ++b) {
+      Internal::ScopedTraceEvent const trace{"rayIntersections block"};
+
+      auto &block = blocks[narrow_cast<std::size_t>(b)];
+      auto const first = narrow_cast<std::size_t>(b) * rayBlockSize;
+      auto const last = std::min(first + rayBlockSize, nRays);
+
+      for (auto r = first; r < last; ++r) {
+        auto const &ray = raysBegin[r];
+        bvh.lineIntersections(vertexData_.data(),
+                              Eigen::Map<Vector3 const>{ray.origin.data()},
+                              Eigen::Map<Vector3 const>{ray.direction.data()},
+                              hits);
+
+        offsets[r + 1] = hits.size();
+        for (auto const &hit : hits) {
+          RayMeshIntersection<T> intersection;
+          intersection.position.triangleIndex = hit.triangle;
+          intersection.position.uv = hit.uv;
+          intersection.signedDistance = hit.t;
+          block.push_back(intersection);
+        }
+      }
+    }
+  }
+
+  std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+  intersections.resize(offsets.back());
+
+#pragma omp parallel for
+  for (Index b = 0; b < narrow_cast<Index>(nBlocks); ++b) {
+    auto const &block = blocks[narrow_cast<std::size_t>(b)];
+    std::copy(block.cbegin(), block.cend(),
+              intersections.begin() +
+                  narrow_cast<std::ptrdiff_t>(
+                      offsets[narrow_cast<std::size_t>(b) * rayBlockSize]));
+  }
+}
+
+template <class T> auto Mesh<T>::topology() const -> Topology const & {
+  auto cached = std::atomic_load(&topology_);
+
+  if (!cached) {
+    auto computed = std::make_shared<Topology const>(Topology::fromTriangles(
+        indexData_.data(), triangleCount(), vertexCount()));
+    // Another thread might have been faster, in that case use its result
+    if (std::atomic_compare_exchange_strong(&topology_, &cached, computed)) {
+      cached = std::move(computed);
+    }
+  }
+
+  Ensures(cached != nullptr);
+  return *cached;
+}
+
 template <class T> Mesh<T> &Mesh<T>::upsample(std::size_t nTimes) {
 
+  if (nTimes == 0) return *this;
+
+  Internal::SubdividedMesh<T> level;
+  // The topology of the original mesh is cached, it is used for the first
+  // level
+  Internal::midpointSubdivision(topology(), vertexData_.data(),
+                                normalData_.data(), indexData_.data(),
+                                labelData_.data(), level);
+
+  Internal::SubdividedMesh<T> next;
+  for (auto i = 1u; i < nTimes; ++i) {
+    auto const levelTopology = Topology::fromTriangles(
+        level.indices.data(), level.indices.size() / 3, level.labels.size());
+    Internal::midpointSubdivision(levelTopology, level.vertices.data(),
+                                  level.normals.data(), level.indices.data(),
+                                  level.labels.data(), next);
+    std::swap(level, next);
+  }
+
+  vertexData_ = std::move(level.vertices);
+  normalData_ = std::move(level.normals);
+  indexData_ = std::move(level.indices);
+  labelData_ = std::move(level.labels);
+  invalidateTopology();
+
+  return *this;
+}
+
+template <class T>
+Mesh<T> &Mesh<T>::decimate(std::size_t targetVertexCount,
+                           VertexCorrespondence *correspondence) {
+  auto decimated = quadricDecimation(*this, targetVertexCount);
+
+  vertexData_ = std::move(decimated.vertices);
+  indexData_ = std::move(decimated.indices);
+  labelData_ = std::move(decimated.labels);
+  invalidateTopology();
+
+  updatePerVertexNormals();
+
+  if (correspondence != nullptr) {
+    correspondence->coarseToFine = std::move(decimated.coarseToFine);
+    correspondence->fineToCoarse = std::move(decimated.fineToCoarse);
+  }
+
+  ensurePostconditions();
+
+  return *this;
+}
+
+template <class T>
+Mesh<T> &Mesh<T>::permuteVertices(std::vector<Index> const &newToOld) {
   using gsl::narrow_cast;
-  using VMat = Eigen::Matrix<T, Eigen::Dynamic, 3>;
-  using FMat = Eigen::Matrix<int, Eigen::Dynamic, 3>;
-  using LMat = Eigen::Matrix<Label, Eigen::Dynamic, 1>;
 
-  if (nTimes == 0) return *this;
+  auto const nV = vertexCount();
 
-  // Copy vertces and indices into matrices so that igl can handle them
-  VMat const V = Adaptor::vertexMap(*this).transpose();
-  FMat const F = Adaptor::indexMap(*this).transpose().template cast<int>();
-  VMat const N = Adaptor::vertexNormalMap(*this).transpose();
-  LMat const L = Adaptor::labelMap(*this);
-
-  VMat Vnew = V;
-  FMat Fnew = F;
-  VMat Nnew = N;
-  LMat Lnew = L;
-
-  for (auto i = 0u; i < nTimes; ++i) {
-    FMat tmpF = Fnew;
-    Eigen::SparseMatrix<T> S;
-
-    igl::upsample(narrow_cast<int>(Vnew.rows()), tmpF, S, Fnew);
-
-    // find best matching labels
-    LMat tmpL = LMat(S.rows(), 1);
-
-    Eigen::Matrix<Label, Eigen::Dynamic, 3> LL =
-        Eigen::Matrix<Label, Eigen::Dynamic, 3>::Zero(S.rows(), 3);
-    Eigen::Matrix<Eigen::Index, Eigen::Dynamic, 3> Lcnt =
-        Eigen::Matrix<Eigen::Index, Eigen::Dynamic, 3>::Zero(S.rows(), 3);
-
-    for (auto j = 0; j < S.outerSize(); ++j) {
-      for (typename Eigen::SparseMatrix<T>::InnerIterator it(S, j); it; ++it) {
-        auto const lj = Lnew(it.col());
-        auto const row = it.row();
-
-        for (auto k = 0; k < 3; ++k) {
-          if (lj == LL(row, k)) {
-            ++Lcnt(row, k);
-            break;
-          } else if (LL(row, k) == 0) {
-            LL(row, k) = lj;
-            Lcnt(row, k) = 1;
-            break;
-          }
-        }
-      }
+  if (newToOld.size() != nV) {
+    throw std::invalid_argument("Permutation size does not match vertex count");
+  }
+
+  std::vector<bool> seen(nV, false);
+  for (auto const i : newToOld) {
+    if (i < 0 || narrow_cast<std::size_t>(i) >= nV ||
+        seen[narrow_cast<std::size_t>(i)]) {
+      throw std::invalid_argument("Invalid vertex permutation");
     }
-    // Select label with most votes
-    for (auto j = 0; j < Lcnt.rows(); ++j) {
-      Eigen::Matrix<Index, 3, 1> const row = Lcnt.row(j).transpose();
-      auto const maxEl = std::max_element(row.data(), row.data() + row.size());
-      tmpL(j) = LL(j, std::distance(row.data(), maxEl));
+    seen[narrow_cast<std::size_t>(i)] = true;
+  }
+
+  auto const oldToNew = inversePermutation(newToOld);
+
+  VertexData vertices(vertexData_.size());
+  NormalData normals(normalData_.size());
+  LabelData labels(labelData_.size());
+
+  auto const nVI = narrow_cast<Index>(nV);
+  auto const hasNormals = normalData_.size() == vertexData_.size();
+
+#pragma omp parallel for
+  for (Index i = 0; i < nVI; ++i) {
+    auto const dst = narrow_cast<std::size_t>(i);
+    auto const src = narrow_cast<std::size_t>(newToOld[dst]);
+    for (auto k = 0u; k < 3; ++k) {
+      vertices[3 * dst + k] = vertexData_[3 * src + k];
+      if (hasNormals) normals[3 * dst + k] = normalData_[3 * src + k];
     }
+    labels[dst] = labelData_[src];
+  }
 
-    Lnew = tmpL;
-    Vnew = (S * Vnew).eval();
-    Nnew = (S * Nnew).eval();
-    // normalize
-    Nnew.array().colwise() /= Nnew.array().square().rowwise().sum().sqrt();
+  auto const nI = narrow_cast<Index>(indexData_.size());
+#pragma omp parallel for
+  for (Index i = 0; i < nI; ++i) {
+    auto &index = indexData_[narrow_cast<std::size_t>(i)];
+    index = oldToNew[narrow_cast<std::size_t>(index)];
   }
 
-  vertexData_.resize(3 * narrow_cast<std::size_t>(Vnew.rows()));
-  normalData_.resize(3 * narrow_cast<std::size_t>(Vnew.rows()));
-  indexData_.resize(3 * narrow_cast<std::size_t>(Fnew.rows()));
-  labelData_.resize(narrow_cast<std::size_t>(Vnew.rows()), Label{0});
+  vertexData_ = std::move(vertices);
+  normalData_ = std::move(normals);
+  labelData_ = std::move(labels);
+  invalidateTopology();
 
-  // Assign copy new vertices and indices
-  Adaptor::vertexMap(*this) = Vnew.transpose();
-  Adaptor::indexMap(*this) = Fnew.transpose().template cast<Index>();
-  Adaptor::vertexNormalMap(*this) = Nnew.transpose();
-  Adaptor::labelMap(*this) = Lnew;
+  return *this;
+}
+
+template <class T>
+Mesh<T> &Mesh<T>::reorderVertices(VertexOrdering ordering,
+                                  std::vector<Index> *newToOld) {
+  auto order = vertexOrder(*this, ordering);
+
+  if (ordering != VertexOrdering::original) permuteVertices(order);
+
+  if (newToOld != nullptr) *newToOld = std::move(order);
 
   return *this;
 }
 
+template <class T>
+auto Mesh<T>::voxelize(VolumeSize const &volumeSize,
+                       VoxelSize const &voxelSize, Label outsideLabel) const
+    -> std::vector<Label> {
+  return voxelizeMesh(vertexData_.data(), indexData_.data(),
+                      labelData_.data(), triangleCount(), volumeSize,
+                      voxelSize, outsideLabel);
+}
+
+template <class T>
+auto Mesh<T>::sliceContours(std::size_t sliceCount, T spacing) const
+    -> std::vector<std::vector<Contour>> {
+  return sliceMesh(vertexData_.data(), indexData_.data(), labelData_.data(),
+                   triangleCount(), sliceCount, static_cast<double>(spacing));
+}
+
 template <class T> void Mesh<T>::updatePerVertexNormals() {
   if (normalData_.size() != vertexData_.size()) {
     normalData_.resize(vertexData_.size());
@@ -727,6 +900,14 @@ template void Mesh<double>::barycentricInterpolation(
     BarycentricPoint<double, std::ptrdiff_t> const *,
     BarycentricPoint<double, std::ptrdiff_t> const *, double const *, double *,
     std::size_t) const;
+template void Mesh<float>::barycentricInterpolation(
+    BarycentricPoint<float, std::ptrdiff_t> const *,
+    BarycentricPoint<float, std::ptrdiff_t> const *, float const *,
+    std::back_insert_iterator<std::vector<float>>, std::size_t) const;
+template void Mesh<double>::barycentricInterpolation(
+    BarycentricPoint<double, std::ptrdiff_t> const *,
+    BarycentricPoint<double, std::ptrdiff_t> const *, double const *,
+    std::back_insert_iterator<std::vector<double>>, std::size_t) const;
 
 template void Mesh<float>::cartesianRepresentation(
     BarycentricPoint<float, std::ptrdiff_t> const *,
@@ -0,0 +1,502 @@
+/**
+ * @file      MeshDecimation.cpp
+ *
+ * @brief     Implementation of the quadric error metric based decimation
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshDecimation.h"
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <queue>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+using Vector3 = Eigen::Vector3d;
+using Vector4 = Eigen::Vector4d;
+using Quadric = Eigen::Matrix4d;
+
+/// Weight of the constraint planes along label boundaries and borders
+constexpr double constraintWeight = 1e3;
+/// Minimum cosine between a triangle normal before and after a collapse
+constexpr double minNormalCosine = 0.2;
+/// Minimum compactness of a triangle created by a collapse, unless it does
+/// not get worse
+constexpr double minCompactness = 0.1;
+
+/// Quadric of the plane through `p` with unit normal `n`
+inline Quadric planeQuadric(Vector3 const &n, Vector3 const &p,
+                            double weight) {
+  Vector4 const plane{n.x(), n.y(), n.z(), -n.dot(p)};
+  return weight * plane * plane.transpose();
+}
+
+/// Error of the quadric at position `p`
+inline double quadricError(Quadric const &Q, Vector3 const &p) {
+  Vector4 const h{p.x(), p.y(), p.z(), 1.0};
+  return std::max(0.0, h.dot(Q * h));
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct Collapse {
+  double cost;
+  std::ptrdiff_t keep;
+  std::ptrdiff_t remove;
+  std::uint32_t keepVersion;
+  std::uint32_t removeVersion;
+  Vector3 position;
+
+  /// Lowest cost first
+  bool operator<(Collapse const &rhs) const noexcept {
+    return cost > rhs.cost;
+  }
+};
+#pragma clang diagnostic pop
+
+template <class T> class Decimator {
+public:
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+  using Face = std::array<Index, 3>;
+
+  explicit Decimator(Mesh<T> const &mesh);
+
+  DecimatedMesh<T> run(std::size_t targetVertexCount);
+
+private:
+  /// Computes the optimal collapse of the edge (a, b)
+  Collapse collapseFor(Index a, Index b) const;
+
+  /// Pushes the collapses of all edges incident to `v`
+  void pushEdgesOf(Index v);
+
+  /// True iff the collapse keeps the mesh manifold and does not flip faces
+  bool isValid(Collapse const &collapse) const;
+
+  /// Performs the collapse
+  void apply(Collapse const &collapse);
+
+  /// Alive neighbours of `v`
+  std::vector<Index> neighbours(Index v) const;
+
+  /**
+   * @brief Classifies the edge (a, b)
+   *
+   * @return true iff the edge has only one incident face or the opposite
+   * vertex of an incident face has a different label
+   */
+  bool isConstrainedEdge(Index a, Index b) const;
+
+  Vector3 faceNormal(Face const &face, Index moved, Vector3 const &p) const;
+
+  /// Ratio of the area to the squared edge lengths, 1 for equilateral
+  /// triangles and 0 for degenerated ones
+  double faceCompactness(Face const &face, Index moved,
+                         Vector3 const &p) const;
+
+  std::vector<Vector3> positions_;
+  std::vector<Label> labels_;
+  std::vector<Face> faces_;
+  std::vector<char> faceAlive_;
+  std::vector<std::vector<Index>> vertexFaces_;
+  std::vector<Quadric> quadrics_;
+  /// Vertices on a label boundary or on a mesh border
+  std::vector<char> constrained_;
+  std::vector<char> vertexAlive_;
+  std::vector<std::uint32_t> version_;
+  /// Vertex each removed vertex was collapsed into
+  std::vector<Index> collapsedInto_;
+  std::priority_queue<Collapse> queue_;
+  std::size_t aliveCount_;
+};
+
+template <class T> Decimator<T>::Decimator(Mesh<T> const &mesh) {
+  using gsl::narrow_cast;
+
+  auto const nV = mesh.vertexCount();
+  auto const nF = mesh.triangleCount();
+  auto const &topology = mesh.topology();
+
+  positions_.resize(nV);
+  mesh.withUnsafeVertexPointer([this, nV](T const *ptr) {
+    for (auto i = 0u; i < nV; ++i) {
+      positions_[i] = Vector3{double(ptr[3 * i]), double(ptr[3 * i + 1]),
+                              double(ptr[3 * i + 2])};
+    }
+  });
+  mesh.withUnsafeLabelPointer(
+      [this, nV](Label const *ptr) { labels_.assign(ptr, ptr + nV); });
+  faces_.resize(nF);
+  mesh.withUnsafeIndexPointer([this, nF](Index const *ptr) {
+    for (auto f = 0u; f < nF; ++f) {
+      faces_[f] = Face{{ptr[3 * f], ptr[3 * f + 1], ptr[3 * f + 2]}};
+    }
+  });
+
+  faceAlive_.assign(nF, 1);
+  vertexAlive_.assign(nV, 1);
+  version_.assign(nV, 0);
+  collapsedInto_.resize(nV);
+  std::iota(collapsedInto_.begin(), collapsedInto_.end(), Index{0});
+  aliveCount_ = nV;
+
+  vertexFaces_.resize(nV);
+  for (auto i = 0u; i < nV; ++i) {
+    vertexFaces_[i].assign(topology.facesBegin(narrow_cast<Index>(i)),
+                           topology.facesEnd(narrow_cast<Index>(i)));
+  }
+
+  // Face quadrics, weighted by area
+  quadrics_.assign(nV, Quadric::Zero());
+  for (auto const &face : faces_) {
+    auto const &p0 = positions_[narrow_cast<std::size_t>(face[0])];
+    Vector3 const n = (positions_[narrow_cast<std::size_t>(face[1])] - p0)
+                          .cross(positions_[narrow_cast<std::size_t>(face[2])] -
+                                 p0);
+    auto const doubleArea = n.norm();
+    if (doubleArea == 0) continue;
+    Quadric const K = planeQuadric(n / doubleArea, p0, doubleArea / 2);
+    for (auto v : face) quadrics_[narrow_cast<std::size_t>(v)] += K;
+  }
+
+  // Constraint planes along borders and label boundaries
+  constrained_.assign(nV, 0);
+  for (auto const &edge : topology.edges()) {
+    auto const a = narrow_cast<std::size_t>(edge[0]);
+    auto const b = narrow_cast<std::size_t>(edge[1]);
+
+    if (labels_[a] != labels_[b]) {
+      constrained_[a] = constrained_[b] = 1;
+      continue;
+    }
+    if (!isConstrainedEdge(edge[0], edge[1])) continue;
+
+    constrained_[a] = constrained_[b] = 1;
+    Vector3 const e = positions_[b] - positions_[a];
+    for (auto f : vertexFaces_[a]) {
+      auto const &face = faces_[narrow_cast<std::size_t>(f)];
+      if (std::find(face.cbegin(), face.cend(), edge[1]) == face.cend()) {
+        continue;
+      }
+      Vector3 const n = faceNormal(face, -1, Vector3::Zero());
+      Vector3 c = e.cross(n);
+      if (c.norm() == 0) continue;
+      c.normalize();
+      Quadric const K =
+          planeQuadric(c, positions_[a], constraintWeight * e.squaredNorm());
+      quadrics_[a] += K;
+      quadrics_[b] += K;
+    }
+  }
+
+  for (auto i = 0u; i < nV; ++i) {
+    // Each edge is pushed once, from its larger vertex
+    for (auto const *it = topology.neighboursBegin(narrow_cast<Index>(i));
+         it != topology.neighboursEnd(narrow_cast<Index>(i)); ++it) {
+      if (*it < narrow_cast<Index>(i) &&
+          labels_[i] == labels_[narrow_cast<std::size_t>(*it)]) {
+        queue_.push(collapseFor(narrow_cast<Index>(i), *it));
+      }
+    }
+  }
+}
+
+template <class T>
+Vector3 Decimator<T>::faceNormal(Face const &face, Index moved,
+                                 Vector3 const &p) const {
+  auto const pos = [&](Index v) -> Vector3 const & {
+    return v == moved ? p : positions_[gsl::narrow_cast<std::size_t>(v)];
+  };
+  Vector3 const n =
+      (pos(face[1]) - pos(face[0])).cross(pos(face[2]) - pos(face[0]));
+  auto const norm = n.norm();
+  return norm > 0 ? Vector3{n / norm} : Vector3::Zero();
+}
+
+template <class T>
+double Decimator<T>::faceCompactness(Face const &face, Index moved,
+                                     Vector3 const &p) const {
+  auto const pos = [&](Index v) -> Vector3 const & {
+    return v == moved ? p : positions_[gsl::narrow_cast<std::size_t>(v)];
+  };
+  Vector3 const a = pos(face[1]) - pos(face[0]);
+  Vector3 const b = pos(face[2]) - pos(face[0]);
+  auto const sumSq = a.squaredNorm() + b.squaredNorm() + (b - a).squaredNorm();
+  // 4 * sqrt(3) * area / sumSq with area = |a x b| / 2
+  return sumSq > 0 ? 2.0 * std::sqrt(3.0) * a.cross(b).norm() / sumSq : 0.0;
+}
+
+template <class T>
+bool Decimator<T>::isConstrainedEdge(Index a, Index b) const {
+  auto nFaces = 0;
+  for (auto f : vertexFaces_[gsl::narrow_cast<std::size_t>(a)]) {
+    auto const &face = faces_[gsl::narrow_cast<std::size_t>(f)];
+    if (std::find(face.cbegin(), face.cend(), b) == face.cend()) continue;
+    ++nFaces;
+    for (auto v : face) {
+      if (labels_[gsl::narrow_cast<std::size_t>(v)] !=
+          labels_[gsl::narrow_cast<std::size_t>(a)]) {
+        return true;
+      }
+    }
+  }
+  return nFaces < 2;
+}
+
+template <class T>
+std::vector<typename Decimator<T>::Index>
+Decimator<T>::neighbours(Index v) const {
+  std::vector<Index> result;
+  for (auto f : vertexFaces_[gsl::narrow_cast<std::size_t>(v)]) {
+    for (auto u : faces_[gsl::narrow_cast<std::size_t>(f)]) {
+      if (u != v) result.push_back(u);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  result.erase(std::unique(result.begin(), result.end()), result.end());
+  return result;
+}
+
+template <class T>
+Collapse Decimator<T>::collapseFor(Index a, Index b) const {
+  using gsl::narrow_cast;
+
+  auto const as = narrow_cast<std::size_t>(a);
+  auto const bs = narrow_cast<std::size_t>(b);
+  Quadric const Q = quadrics_[as] + quadrics_[bs];
+
+  Collapse collapse;
+  collapse.keep = a;
+  collapse.remove = b;
+
+  if (constrained_[as] != constrained_[bs]) {
+    // The constrained vertex must not move
+    if (constrained_[bs]) std::swap(collapse.keep, collapse.remove);
+    collapse.position = positions_[narrow_cast<std::size_t>(collapse.keep)];
+  } else {
+    // Optimal position, fall back to the best of both end points and the
+    // midpoint if the system is ill conditioned
+    std::array<Vector3, 3> const candidates = {{
+        positions_[as], positions_[bs], (positions_[as] + positions_[bs]) / 2}};
+    collapse.position = candidates[2];
+    auto bestError = quadricError(Q, candidates[2]);
+    for (auto k = 0u; k < 2; ++k) {
+      auto const error = quadricError(Q, candidates[k]);
+      if (error < bestError) {
+        bestError = error;
+        collapse.position = candidates[k];
+      }
+    }
+
+    Eigen::Matrix3d const A = Q.template topLeftCorner<3, 3>();
+    Eigen::FullPivLU<Eigen::Matrix3d> const lu{A};
+    if (lu.isInvertible() && lu.rcond() > 1e-9) {
+      Vector3 const p = lu.solve(-Q.template topRightCorner<3, 1>());
+      // Guard against far away solutions of nearly planar neighbourhoods
+      auto const edgeLength = (positions_[as] - positions_[bs]).norm();
+      if ((p - candidates[2]).norm() <= 2 * edgeLength &&
+          quadricError(Q, p) <= bestError) {
+        collapse.position = p;
+      }
+    }
+  }
+
+  collapse.cost = quadricError(Q, collapse.position);
+  collapse.keepVersion = version_[narrow_cast<std::size_t>(collapse.keep)];
+  collapse.removeVersion = version_[narrow_cast<std::size_t>(collapse.remove)];
+
+  return collapse;
+}
+
+template <class T> void Decimator<T>::pushEdgesOf(Index v) {
+  auto const vs = gsl::narrow_cast<std::size_t>(v);
+  for (auto u : neighbours(v)) {
+    if (labels_[gsl::narrow_cast<std::size_t>(u)] == labels_[vs]) {
+      queue_.push(collapseFor(v, u));
+    }
+  }
+}
+
+template <class T> bool Decimator<T>::isValid(Collapse const &c) const {
+  using gsl::narrow_cast;
+
+  auto const keep = c.keep;
+  auto const remove = c.remove;
+  auto const ks = narrow_cast<std::size_t>(keep);
+  auto const rs = narrow_cast<std::size_t>(remove);
+
+  // Two constrained vertices may only be merged along their boundary
+  if (constrained_[ks] && constrained_[rs] &&
+      !isConstrainedEdge(keep, remove)) {
+    return false;
+  }
+
+  // Link condition: the common neighbours must be the opposite vertices of
+  // the faces incident to the edge
+  auto const nKeep = neighbours(keep);
+  auto const nRemove = neighbours(remove);
+  std::vector<Index> common;
+  std::set_intersection(nKeep.cbegin(), nKeep.cend(), nRemove.cbegin(),
+                        nRemove.cend(), std::back_inserter(common));
+
+  std::size_t sharedFaces = 0;
+  for (auto f : vertexFaces_[rs]) {
+    auto const &face = faces_[narrow_cast<std::size_t>(f)];
+    if (std::find(face.cbegin(), face.cend(), keep) != face.cend()) {
+      ++sharedFaces;
+    }
+  }
+  if (sharedFaces == 0 || common.size() != sharedFaces) return false;
+
+  // Avoid collapsing a tetrahedron into a degenerated configuration
+  if (nKeep.size() <= 3 && nRemove.size() <= 3) return false;
+
+  // Check for flipped, degenerated and needle-like triangles
+  auto const checkFaces = [&](Index moved) {
+    for (auto f : vertexFaces_[narrow_cast<std::size_t>(moved)]) {
+      auto const &face = faces_[narrow_cast<std::size_t>(f)];
+      if (std::find(face.cbegin(), face.cend(),
+                    moved == keep ? remove : keep) != face.cend()) {
+        continue; // removed by the collapse
+      }
+      auto const before = faceNormal(face, -1, Vector3::Zero());
+      auto const after = faceNormal(face, moved, c.position);
+      if (after.isZero() || before.dot(after) < minNormalCosine) return false;
+      auto const compactness = faceCompactness(face, moved, c.position);
+      if (compactness < minCompactness &&
+          compactness < faceCompactness(face, -1, Vector3::Zero())) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  return checkFaces(keep) && checkFaces(remove);
+}
+
+template <class T> void Decimator<T>::apply(Collapse const &c) {
+  using gsl::narrow_cast;
+
+  auto const ks = narrow_cast<std::size_t>(c.keep);
+  auto const rs = narrow_cast<std::size_t>(c.remove);
+
+  for (auto f : vertexFaces_[rs]) {
+    auto const fs = narrow_cast<std::size_t>(f);
+    auto &face = faces_[fs];
+    if (std::find(face.cbegin(), face.cend(), c.keep) != face.cend()) {
+      // Degenerated face, remove it from the other vertices
+      faceAlive_[fs] = 0;
+      for (auto v : face) {
+        if (v == c.remove) continue;
+        auto &list = vertexFaces_[narrow_cast<std::size_t>(v)];
+        list.erase(std::remove(list.begin(), list.end(), f), list.end());
+      }
+    } else {
+      std::replace(face.begin(), face.end(), c.remove, c.keep);
+      vertexFaces_[ks].push_back(f);
+    }
+  }
+  vertexFaces_[rs].clear();
+
+  positions_[ks] = c.position;
+  quadrics_[ks] += quadrics_[rs];
+  constrained_[ks] = constrained_[ks] || constrained_[rs];
+  vertexAlive_[rs] = 0;
+  collapsedInto_[rs] = c.keep;
+  ++version_[ks];
+  ++version_[rs];
+  --aliveCount_;
+
+  pushEdgesOf(c.keep);
+}
+
+template <class T>
+DecimatedMesh<T> Decimator<T>::run(std::size_t targetVertexCount) {
+  using gsl::narrow_cast;
+
+  while (aliveCount_ > targetVertexCount && !queue_.empty()) {
+    auto const collapse = queue_.top();
+    queue_.pop();
+
+    auto const ks = narrow_cast<std::size_t>(collapse.keep);
+    auto const rs = narrow_cast<std::size_t>(collapse.remove);
+
+    // Skip outdated entries
+    if (!vertexAlive_[ks] || !vertexAlive_[rs] ||
+        version_[ks] != collapse.keepVersion ||
+        version_[rs] != collapse.removeVersion) {
+      continue;
+    }
+
+    if (isValid(collapse)) apply(collapse);
+  }
+
+  // Compact vertices, keeping their relative order
+  DecimatedMesh<T> result;
+  std::vector<Index> newIndex(positions_.size(), -1);
+  for (auto i = 0u; i < positions_.size(); ++i) {
+    if (!vertexAlive_[i]) continue;
+    newIndex[i] = narrow_cast<Index>(result.coarseToFine.size());
+    result.coarseToFine.push_back(narrow_cast<Index>(i));
+    for (auto k = 0; k < 3; ++k) {
+      result.vertices.push_back(static_cast<T>(positions_[i][k]));
+    }
+    result.labels.push_back(labels_[i]);
+  }
+
+  for (auto f = 0u; f < faces_.size(); ++f) {
+    if (!faceAlive_[f]) continue;
+    for (auto v : faces_[f]) {
+      result.indices.push_back(newIndex[narrow_cast<std::size_t>(v)]);
+    }
+  }
+
+  // Follow the collapse chains of removed vertices
+  result.fineToCoarse.resize(positions_.size());
+  for (auto i = 0u; i < positions_.size(); ++i) {
+    auto root = narrow_cast<Index>(i);
+    while (collapsedInto_[narrow_cast<std::size_t>(root)] != root) {
+      root = collapsedInto_[narrow_cast<std::size_t>(root)];
+    }
+    collapsedInto_[i] = root;
+    result.fineToCoarse[i] = newIndex[narrow_cast<std::size_t>(root)];
+  }
+
+  return result;
+}
+
+} // anonymous namespace
+
+template <class T>
+DecimatedMesh<T> quadricDecimation(Mesh<T> const &mesh,
+                                   std::size_t targetVertexCount) {
+  return Decimator<T>{mesh}.run(targetVertexCount);
+}
+
+/*************************************
+ * Explicit template instanciations
+ */
+
+template DecimatedMesh<float> quadricDecimation(Mesh<float> const &,
+                                                std::size_t);
+template DecimatedMesh<double> quadricDecimation(Mesh<double> const &,
+                                                 std::size_t);
+
+} // namespace Internal
+} // namespace CortidQCT
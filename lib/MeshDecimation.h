@@ -0,0 +1,72 @@
+/**
+ * @file      MeshDecimation.h
+ *
+ * @brief     This file contains the definition of the quadric error metric
+ * based mesh decimation.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/// Result of `quadricDecimation()`
+template <class T> struct DecimatedMesh {
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  /// Vertex positions in `Mesh` storage layout
+  std::vector<T> vertices;
+  /// Triangle indices in `Mesh` storage layout
+  std::vector<Index> indices;
+  /// Per-vertex labels
+  std::vector<Label> labels;
+  /// Index of the original vertex each decimated vertex originates from
+  std::vector<Index> coarseToFine;
+  /// Index of the decimated vertex each original vertex was collapsed into
+  std::vector<Index> fineToCoarse;
+};
+#pragma clang diagnostic pop
+
+/**
+ * @brief Decimates a labeled triangle mesh by iterative edge collapses
+ *
+ * Edges are collapsed in the order of their quadric error (Garland and
+ * Heckbert). Label boundaries are preserved:
+ *
+ *   - only edges between vertices with equal labels are collapsed,
+ *   - a vertex adjacent to a differently labeled vertex (or a mesh border)
+ *     never moves when collapsed with an unconstrained vertex,
+ *   - two such vertices are only collapsed along the label boundary (or
+ *     border), which is additionally protected by constraint quadrics.
+ *
+ * Collapses that would make the mesh non-manifold or flip triangles are
+ * rejected, so the decimation may stop before `targetVertexCount` is
+ * reached.
+ *
+ * @param mesh the mesh to decimate
+ * @param targetVertexCount desired number of vertices
+ * @return the decimated mesh including the vertex correspondences
+ */
+template <class T>
+DecimatedMesh<T> quadricDecimation(Mesh<T> const &mesh,
+                                   std::size_t targetVertexCount);
+
+extern template DecimatedMesh<float> quadricDecimation(Mesh<float> const &,
+                                                       std::size_t);
+extern template DecimatedMesh<double> quadricDecimation(Mesh<double> const &,
+                                                        std::size_t);
+
+} // namespace Internal
+} // namespace CortidQCT
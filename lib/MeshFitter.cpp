@@ -56,13 +56,65 @@ void MeshFitter::swap(MeshFitter &rhs) noexcept {
 }
 
 MeshFitter::Result MeshFitter::fit(VoxelVolume const &volume) const {
-  return pImpl_->fit(volume);
+  return pImpl_->fit(volume, FitOptions{});
+}
+
+MeshFitter::Result MeshFitter::fit(VoxelVolume const &volume,
+                                   FitOptions const &options) const {
+  return pImpl_->fit(volume, options);
+}
+
+void MeshFitter::fitBatch(std::vector<VoxelVolume> const &volumes,
+                          BatchCallback const &callback,
+                          std::size_t maxConcurrentFits,
+                          FitOptions const &options) const {
+  pImpl_->fitBatch(
+      volumes.size(),
+      [&volumes](std::size_t i) {
+        // Not owned, the volumes outlive the batch
+        return std::shared_ptr<VoxelVolume const>{std::shared_ptr<void>{},
+                                                  &volumes[i]};
+      },
+      callback, maxConcurrentFits, options);
+}
+
+void MeshFitter::fitBatch(std::vector<VolumeLoader> const &loaders,
+                          BatchCallback const &callback,
+                          std::size_t maxConcurrentFits,
+                          FitOptions const &options) const {
+  pImpl_->fitBatch(
+      loaders.size(),
+      [&loaders](std::size_t i) {
+        return std::make_shared<VoxelVolume const>(loaders[i]());
+      },
+      callback, maxConcurrentFits, options);
 }
 
 MeshFitter::State MeshFitter::init(VoxelVolume const &volume) const {
   return pImpl_->init(volume);
 }
 
+MeshFitter::State MeshFitter::init(VoxelVolume const &volume,
+                                   Result const &prior,
+                                   RigidTransform const &transform) const {
+  return pImpl_->init(volume, prior, transform);
+}
+
+MeshFitter::Result MeshFitter::resume(State const &state,
+                                      FitOptions const &options) const {
+  return pImpl_->resume(state, options);
+}
+
+void MeshFitter::saveCheckpoint(State const &state,
+                                std::string const &filename) const {
+  pImpl_->saveCheckpoint(state, filename);
+}
+
+MeshFitter::State MeshFitter::loadCheckpoint(std::string const &filename,
+                                             VoxelVolume const &volume) const {
+  return pImpl_->loadCheckpoint(filename, volume);
+}
+
 void MeshFitter::fitOneIteration(MeshFitter::State &state) const {
   return pImpl_->fitOneIteration(state);
 }
@@ -79,6 +131,10 @@ void MeshFitter::optimalDeformationStep(MeshFitter::State &state) const {
   return pImpl_->findOptimalDeformation(state);
 }
 
+void MeshFitter::selfIntersectionStep(MeshFitter::State &state) const {
+  return pImpl_->detectSelfIntersections(state);
+}
+
 void MeshFitter::logLikelihoodStep(MeshFitter::State &state) const {
   return pImpl_->computeLogLikelihood(state);
 }
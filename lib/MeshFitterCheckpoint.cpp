@@ -0,0 +1,347 @@
+/**
+ * @file      MeshFitterCheckpoint.cpp
+ *
+ * @brief     Implementation of the MeshFitter checkpoint reader and writer
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterImpl.h"
+
+#include "BinaryIO.h"
+#include "EigenAdaptors.h"
+#include "MappedFile.h"
+#include "MeshAdaptors.h"
+#include "MeshFitterHiddenState.h"
+#include "ReferenceMeshBundle.h"
+
+#include <Eigen/Geometry>
+#include <gsl/gsl>
+
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+
+namespace CortidQCT {
+
+using namespace Internal;
+
+namespace {
+
+using StageTimings = MeshFitter::StageTimings;
+
+constexpr std::array<char, 8> checkpointMagic = {
+    {'C', 'Q', 'T', 'C', 'H', 'K', 'P', 'T'}};
+constexpr std::uint32_t checkpointVersion = 2;
+constexpr std::size_t headerSize = 64;
+
+/// Number of stages in `StageTimings`
+constexpr std::size_t stageCount = 9;
+
+constexpr std::uint32_t convergedFlag = 1;
+constexpr std::uint32_t successFlag = 2;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct CheckpointHeader {
+  std::uint64_t vertexCount = 0;
+  /// Number of entries of the per-vertex log likelihood, zero before the
+  /// first iteration
+  std::uint64_t logLikelihoodCount = 0;
+  /// Number of iterations with timings
+  std::uint64_t iterationCount = 0;
+  std::uint64_t volumeChecksum = 0;
+  std::uint64_t referenceMeshChecksum = 0;
+  std::uint64_t checksum = 0;
+
+  /// Size of the payload in bytes
+  std::uint64_t payloadSize() const noexcept {
+    return 4 * 12 + 8 * 3 + 4 * 4 + 4 +
+           4 * (8 * vertexCount + logLikelihoodCount) +
+           8 * stageCount * (iterationCount + 1);
+  }
+};
+#pragma clang diagnostic pop
+
+std::array<double, stageCount> stageArray(StageTimings const &timings) {
+  return {{timings.volumeSampling, timings.displacements, timings.deformation,
+           timings.deformationSetup, timings.deformationSolve,
+           timings.deformationRotations, timings.deformationEnergy,
+           timings.selfIntersections, timings.logLikelihood}};
+}
+
+StageTimings stageTimings(std::array<double, stageCount> const &values) {
+  StageTimings timings;
+  timings.volumeSampling = values[0];
+  timings.displacements = values[1];
+  timings.deformation = values[2];
+  timings.deformationSetup = values[3];
+  timings.deformationSolve = values[4];
+  timings.deformationRotations = values[5];
+  timings.deformationEnergy = values[6];
+  timings.selfIntersections = values[7];
+  timings.logLikelihood = values[8];
+  return timings;
+}
+
+/// Hashes the size, the voxel size and the voxel data of the volume
+std::uint64_t volumeChecksum(VoxelVolume const &volume) {
+  auto const &size = volume.size();
+  auto const &voxelSize = volume.voxelSize();
+
+  ByteWriter geometry{3 * 8 + 3 * 4};
+  std::array<std::size_t, 3> const dims = {
+      {size.width, size.height, size.depth}};
+  std::array<float, 3> const spacing = {
+      {voxelSize.width, voxelSize.height, voxelSize.depth}};
+  geometry.append<std::uint64_t>(dims.data(), dims.size());
+  geometry.append<float>(spacing.data(), spacing.size());
+
+  auto const hash = fnv1a64(geometry.bytes().data(), geometry.bytes().size());
+  return volume.withUnsafeDataPointer([&](auto const *ptr) {
+    return fnv1a64(ptr,
+                   size.width * size.height * size.depth *
+                       sizeof(VoxelVolume::ValueType),
+                   hash);
+  });
+}
+
+} // anonymous namespace
+
+void MeshFitter::Impl::saveCheckpoint(MeshFitter::State const &state,
+                                      std::string const &filename) const {
+  using gsl::narrow;
+
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  auto &hiddenState = *state.hiddenState_;
+  auto const &mesh = state.deformedMesh;
+  auto const nV = mesh.vertexCount();
+
+  Expects(state.displacementVector.size() == nV && state.weights.size() == nV);
+  Expects(state.perVertexLogLikelihood.empty() ||
+          state.perVertexLogLikelihood.size() == nV);
+
+  // The volume never changes during a fit, so it is only hashed once
+  if (!hiddenState.volumeChecksum) {
+    hiddenState.volumeChecksum = volumeChecksum(*hiddenState.volume);
+  }
+
+  CheckpointHeader header;
+  header.vertexCount = nV;
+  header.logLikelihoodCount = state.perVertexLogLikelihood.size();
+  header.iterationCount = state.iterationTimings.size();
+  header.volumeChecksum = *hiddenState.volumeChecksum;
+  header.referenceMeshChecksum = meshChecksum(state.referenceMesh);
+
+  ByteWriter payload{narrow<std::size_t>(header.payloadSize())};
+
+  // The pre-alignment is applied to the reference mesh before it is compared
+  // on load, so it comes first
+  Eigen::Matrix<float, 3, 4> const alignment =
+      hiddenState.alignment.matrix().topRows<3>();
+  payload.append<float>(alignment.data(), 12);
+
+  std::array<std::uint64_t, 3> const counters = {
+      {state.iteration, state.nonDecreasing, state.selfIntersectionCount}};
+  payload.append<std::uint64_t>(counters.data(), counters.size());
+
+  std::array<float, 4> const scalars = {
+      {state.minDisNorm, state.logLikelihood, state.effectiveSigmaS,
+       hiddenState.displacementOptimizer.currentSigma()}};
+  payload.append<float>(scalars.data(), scalars.size());
+
+  std::uint32_t const flags = (state.converged ? convergedFlag : 0u) |
+                              (state.success ? successFlag : 0u);
+  payload.append<std::uint32_t>(&flags, 1);
+
+  // The volume samples are not stored, they are a function of the deformed
+  // mesh and the volume
+  mesh.withUnsafeVertexPointer(
+      [&](float const *ptr) { payload.append<float>(ptr, 3 * nV); });
+  mesh.withUnsafeVertexNormalPointer(
+      [&](float const *ptr) { payload.append<float>(ptr, 3 * nV); });
+  payload.append<float>(state.displacementVector.data(), nV);
+  payload.append<float>(state.weights.data(), nV);
+  payload.append<float>(state.perVertexLogLikelihood.data(),
+                        state.perVertexLogLikelihood.size());
+
+  auto const total = stageArray(state.totalTimings);
+  payload.append<double>(total.data(), total.size());
+  for (auto const &timings : state.iterationTimings) {
+    auto const values = stageArray(timings);
+    payload.append<double>(values.data(), values.size());
+  }
+
+  Ensures(payload.bytes().size() == header.payloadSize());
+
+  header.checksum = fnv1a64(payload.bytes().data(), payload.bytes().size());
+
+  // Write to a temporary file first, so that a crash while writing never
+  // destroys the previous checkpoint
+  auto const tmpFilename = filename + ".tmp";
+  {
+    std::ofstream out{tmpFilename, std::ios::binary};
+    if (!out) {
+      throw std::invalid_argument("Failed to write checkpoint '" +
+                                  tmpFilename + "'");
+    }
+
+    out.write(checkpointMagic.data(), checkpointMagic.size());
+    writeLittleEndian<std::uint32_t>(out, checkpointVersion);
+    writeLittleEndian<std::uint32_t>(out, std::uint32_t{0});
+    writeLittleEndian<std::uint64_t>(out, header.vertexCount);
+    writeLittleEndian<std::uint64_t>(out, header.logLikelihoodCount);
+    writeLittleEndian<std::uint64_t>(out, header.iterationCount);
+    writeLittleEndian<std::uint64_t>(out, header.volumeChecksum);
+    writeLittleEndian<std::uint64_t>(out, header.referenceMeshChecksum);
+    writeLittleEndian<std::uint64_t>(out, header.checksum);
+    out.write(reinterpret_cast<char const *>(payload.bytes().data()),
+              static_cast<std::streamsize>(payload.bytes().size()));
+    out.close();
+
+    if (!out) {
+      throw std::invalid_argument("Failed to write checkpoint '" +
+                                  tmpFilename + "'");
+    }
+  }
+
+  if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+    // Renaming does not replace an existing file on all platforms
+    std::remove(filename.c_str());
+    if (std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+      throw std::invalid_argument("Failed to write checkpoint '" + filename +
+                                  "'");
+    }
+  }
+}
+
+MeshFitter::State
+MeshFitter::Impl::loadCheckpoint(std::string const &filename,
+                                 VoxelVolume const &volume) const {
+  using gsl::narrow;
+
+  try {
+    MappedFile const file{filename};
+    ByteReader reader{file.data(), file.data() + file.size()};
+
+    // Header
+    std::array<char, 8> magic;
+    reader.read<char>(magic.data(), magic.size());
+    if (magic != checkpointMagic) {
+      throw std::invalid_argument("Not a checkpoint");
+    }
+
+    auto const version = reader.read<std::uint32_t>();
+    if (version != checkpointVersion) {
+      throw std::invalid_argument("Unsupported checkpoint version " +
+                                  std::to_string(version));
+    }
+    reader.read<std::uint32_t>();
+
+    CheckpointHeader header;
+    header.vertexCount = reader.read<std::uint64_t>();
+    header.logLikelihoodCount = reader.read<std::uint64_t>();
+    header.iterationCount = reader.read<std::uint64_t>();
+    header.volumeChecksum = reader.read<std::uint64_t>();
+    header.referenceMeshChecksum = reader.read<std::uint64_t>();
+    header.checksum = reader.read<std::uint64_t>();
+
+    // Guard against overflows in payloadSize() caused by corrupted counts
+    constexpr auto maxCount = std::uint64_t{1} << 40;
+    if (header.vertexCount > maxCount ||
+        header.logLikelihoodCount > maxCount ||
+        header.iterationCount > maxCount ||
+        header.payloadSize() != file.size() - headerSize) {
+      throw std::invalid_argument("File size does not match header");
+    }
+
+    if (fnv1a64(file.data() + headerSize, file.size() - headerSize) !=
+        header.checksum) {
+      throw std::invalid_argument("Checksum mismatch");
+    }
+
+    auto const nV = narrow<std::size_t>(header.vertexCount);
+    auto const nL = narrow<std::size_t>(header.logLikelihoodCount);
+    if (nL != 0 && nL != nV) {
+      throw std::invalid_argument("Invalid per-vertex log likelihood");
+    }
+
+    if (volumeChecksum(volume) != header.volumeChecksum) {
+      throw std::invalid_argument("Checkpoint was written for another volume");
+    }
+
+    // The state may outlive the volume, so it keeps its own copy
+    auto state =
+        initWithoutSampling(std::make_shared<VoxelVolume const>(volume));
+    auto &hiddenState = *state.hiddenState_;
+    hiddenState.volumeChecksum = header.volumeChecksum;
+
+    Eigen::Matrix<float, 3, 4> alignmentMatrix;
+    reader.read<float>(alignmentMatrix.data(), 12);
+    Eigen::Affine3f alignment = Eigen::Affine3f::Identity();
+    alignment.matrix().topRows<3>() = alignmentMatrix;
+    applyAlignment(state, alignment);
+
+    if (state.referenceMesh.vertexCount() != nV ||
+        meshChecksum(state.referenceMesh) != header.referenceMeshChecksum) {
+      throw std::invalid_argument(
+          "Checkpoint was written for another reference mesh");
+    }
+
+    std::array<std::uint64_t, 3> counters;
+    reader.read<std::uint64_t>(counters.data(), counters.size());
+    state.iteration = narrow<std::size_t>(counters[0]);
+    state.nonDecreasing = narrow<std::size_t>(counters[1]);
+    state.selfIntersectionCount = narrow<std::size_t>(counters[2]);
+
+    std::array<float, 4> scalars;
+    reader.read<float>(scalars.data(), scalars.size());
+    state.minDisNorm = scalars[0];
+    state.logLikelihood = scalars[1];
+    state.effectiveSigmaS = scalars[2];
+    hiddenState.displacementOptimizer.setCurrentSigma(scalars[3]);
+
+    auto const flags = reader.read<std::uint32_t>();
+    state.converged = (flags & convergedFlag) != 0;
+    state.success = (flags & successFlag) != 0;
+
+    // The normals are restored as stored instead of being recomputed, so the
+    // next iteration starts with bitwise identical inputs
+    auto &mesh = state.deformedMesh;
+    mesh.withUnsafeVertexPointer(
+        [&](float *ptr) { reader.read<float>(ptr, 3 * nV); });
+    mesh.withUnsafeVertexNormalPointer(
+        [&](float *ptr) { reader.read<float>(ptr, 3 * nV); });
+    // This will be removed in v2.0:
+    Adaptor::map(state.vertexNormals) = Adaptor::vertexNormalMap(mesh);
+
+    reader.read<float>(state.displacementVector.data(), nV);
+    reader.read<float>(state.weights.data(), nV);
+    state.perVertexLogLikelihood = reader.readVector<float, float>(nL);
+
+    std::array<double, stageCount> values;
+    reader.read<double>(values.data(), values.size());
+    state.totalTimings = stageTimings(values);
+    state.iterationTimings.reserve(narrow<std::size_t>(header.iterationCount));
+    for (auto i = 0u; i < header.iterationCount; ++i) {
+      reader.read<double>(values.data(), values.size());
+      state.iterationTimings.push_back(stageTimings(values));
+    }
+
+    sampleVolume(state);
+
+    return state;
+  } catch (std::invalid_argument const &e) {
+    throw std::invalid_argument("Failed to read checkpoint '" + filename +
+                                "': " + e.what());
+  }
+}
+
+} // namespace CortidQCT
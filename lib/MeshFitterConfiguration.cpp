@@ -9,15 +9,20 @@
  *            the AFL 3.0 license; see LICENSE for full license details.
  */
 #include "MeshFitter.h"
+#include "MeshFitterConfigurationIO.h"
 
+#include "CheckExtension.h"
 #include "ColorToLabelMapIO.h"
 #include "EigenAdaptors.h"
 #include "MeshHelpers.h"
+#include "ReferenceMeshBundle.h"
 
 #include <Eigen/Core>
 #include <gsl/gsl>
 #include <yaml-cpp/yaml.h>
 
+#include <memory>
+
 namespace CortidQCT {
 
 using namespace Internal;
@@ -48,200 +53,319 @@ inline std::string composePath(std::string const &origPath,
 
 } // anonymous namespace
 
-MeshFitter::Configuration &
-MeshFitter::Configuration::loadFromFile(std::string const &filename) {
-
-  try {
+namespace Internal {
 
-    auto const node = YAML::LoadFile(filename);
+void loadConfiguration(MeshFitter::Configuration &config,
+                       YAML::Node const &node, std::string const &filename,
+                       MeasurementModelCache &models) {
+  using Configuration = MeshFitter::Configuration;
 
-    if (auto const &baseFileNode = node["inherit"]) {
-      auto const baseFilePath =
-          composePath(filename, baseFileNode.as<std::string>());
+  if (auto const &baseFileNode = node["inherit"]) {
+    auto const baseFilePath =
+        composePath(filename, baseFileNode.as<std::string>());
 
-      loadFromFile(baseFilePath);
-    }
+    loadConfiguration(config, YAML::LoadFile(baseFilePath), baseFilePath,
+                      models);
+  }
 
-    auto const &referenceMeshNode = node["referenceMesh"];
-    auto const &measurementModelNode = node["measurementModel"];
+  auto const &referenceMeshNode = node["referenceMesh"];
+  auto const &measurementModelNode = node["measurementModel"];
 
-    if (!referenceMeshNode) {
-      throw std::invalid_argument("Missing 'referenceMesh' in " + filename);
-    }
+  if (!referenceMeshNode) {
+    throw std::invalid_argument("Missing 'referenceMesh' in " + filename);
+  }
 
-    if (!measurementModelNode) {
-      throw std::invalid_argument("Missing 'measurementModel' in " + filename);
-    }
+  if (!measurementModelNode) {
+    throw std::invalid_argument("Missing 'measurementModel' in " + filename);
+  }
 
-    if (!referenceMeshNode["mesh"]) {
-      throw std::invalid_argument("Missing 'referenceMesh.mesh' in " +
-                                  filename);
-    }
+  if (!referenceMeshNode["mesh"]) {
+    throw std::invalid_argument("Missing 'referenceMesh.mesh' in " +
+                                filename);
+  }
 
-    auto const meshFilename =
-        composePath(filename, referenceMeshNode["mesh"].as<std::string>());
-    auto const modelFilename =
-        composePath(filename, measurementModelNode.as<std::string>());
+  auto const meshFilename =
+      composePath(filename, referenceMeshNode["mesh"].as<std::string>());
+  auto const modelFilename =
+      composePath(filename, measurementModelNode.as<std::string>());
 
-    auto refMesh = Mesh<float>{};
+  auto refMesh = Mesh<float>{};
 
-    auto meshOrigin = referenceMeshOrigin;
+  auto meshOrigin = config.referenceMeshOrigin;
 
-    if (auto const &originNode = referenceMeshNode["origin"]) {
-      if (originNode.IsScalar()) {
-        if (originNode.as<std::string>() == "untouched") {
-          meshOrigin = OriginType::untouched;
-        } else if (originNode.as<std::string>() == "centered") {
-          meshOrigin = OriginType::centered;
-        } else {
-          throw std::invalid_argument("Invalid origin type '" +
-                                      originNode.as<std::string>() + "' in " +
-                                      filename);
-        }
+  if (auto const &originNode = referenceMeshNode["origin"]) {
+    if (originNode.IsScalar()) {
+      if (originNode.as<std::string>() == "untouched") {
+        meshOrigin = Configuration::OriginType::untouched;
+      } else if (originNode.as<std::string>() == "centered") {
+        meshOrigin = Configuration::OriginType::centered;
       } else {
-        auto const &typeNode = originNode["type"];
-        if (!typeNode || !typeNode.IsScalar()) {
-          throw std::invalid_argument("Missing or invalid origin.type in " +
+        throw std::invalid_argument("Invalid origin type '" +
+                                    originNode.as<std::string>() + "' in " +
+                                    filename);
+      }
+    } else {
+      auto const &typeNode = originNode["type"];
+      if (!typeNode || !typeNode.IsScalar()) {
+        throw std::invalid_argument("Missing or invalid origin.type in " +
+                                    filename);
+      }
+
+      if (typeNode.as<std::string>() == "untouched") {
+        meshOrigin = Configuration::OriginType::untouched;
+      } else if (typeNode.as<std::string>() == "centered") {
+        meshOrigin = Configuration::OriginType::centered;
+      } else if (typeNode.as<std::string>() == "absolute" ||
+                 typeNode.as<std::string>() == "relative") {
+        auto const &xyzNode = originNode["xyz"];
+        if (!xyzNode || !xyzNode.IsSequence() || xyzNode.size() != 3) {
+          throw std::invalid_argument("Missing or invalid origin.xyz in " +
                                       filename);
         }
 
-        if (typeNode.as<std::string>() == "untouched") {
-          meshOrigin = OriginType::untouched;
-        } else if (typeNode.as<std::string>() == "centered") {
-          meshOrigin = OriginType::centered;
-        } else if (typeNode.as<std::string>() == "absolute" ||
-                   typeNode.as<std::string>() == "relative") {
-          auto const &xyzNode = originNode["xyz"];
-          if (!xyzNode || !xyzNode.IsSequence() || xyzNode.size() != 3) {
-            throw std::invalid_argument("Missing or invalid origin.xyz in " +
-                                        filename);
-          }
-
-          Coordinate3D originXYZ;
-
-          originXYZ.xyz[0] = xyzNode.begin()->as<float>();
-          originXYZ.xyz[1] = (++xyzNode.begin())->as<float>();
-          originXYZ.xyz[2] = (++++xyzNode.begin())->as<float>();
-
-          if (typeNode.as<std::string>() == "relative") {
-            originXYZ.type = Coordinate3D::Type::relative;
-          }
-
-          meshOrigin = originXYZ;
+        Coordinate3D originXYZ;
+
+        originXYZ.xyz[0] = xyzNode.begin()->as<float>();
+        originXYZ.xyz[1] = (++xyzNode.begin())->as<float>();
+        originXYZ.xyz[2] = (++++xyzNode.begin())->as<float>();
+
+        if (typeNode.as<std::string>() == "relative") {
+          originXYZ.type = Coordinate3D::Type::relative;
         }
-      }
-    }
 
-    if (auto const &scaleNode = referenceMeshNode["scale"]) {
-      if (scaleNode.IsScalar()) {
-        // apply uniform scaling
-        auto const scale = scaleNode.as<float>();
-        referenceMeshScale = {{scale, scale, scale}};
-      } else if (scaleNode.IsSequence() && scaleNode.size() == 3) {
-        auto const scaleX = scaleNode[0].as<float>();
-        auto const scaleY = scaleNode[1].as<float>();
-        auto const scaleZ = scaleNode[2].as<float>();
-
-        referenceMeshScale = {{scaleX, scaleY, scaleZ}};
-      } else {
-        throw std::invalid_argument(
-            "refereceMesh.scale must either be a scalar or a 3 element vector" +
-            filename);
+        meshOrigin = originXYZ;
       }
     }
+  }
 
-    if (auto const &rotationNode = referenceMeshNode["rotation"]) {
-      if (!rotationNode.IsSequence() || rotationNode.size() != 3) {
-        throw std::invalid_argument(
-            "referenceMesh.rotation must be a 3 element vector in " + filename);
-      }
+  if (auto const &scaleNode = referenceMeshNode["scale"]) {
+    if (scaleNode.IsScalar()) {
+      // apply uniform scaling
+      auto const scale = scaleNode.as<float>();
+      config.referenceMeshScale = {{scale, scale, scale}};
+    } else if (scaleNode.IsSequence() && scaleNode.size() == 3) {
+      auto const scaleX = scaleNode[0].as<float>();
+      auto const scaleY = scaleNode[1].as<float>();
+      auto const scaleZ = scaleNode[2].as<float>();
+
+      config.referenceMeshScale = {{scaleX, scaleY, scaleZ}};
+    } else {
+      throw std::invalid_argument(
+          "refereceMesh.scale must either be a scalar or a 3 element vector" +
+          filename);
+    }
+  }
 
-      referenceMeshRotation = {{rotationNode[0].as<float>(),
-                                rotationNode[1].as<float>(),
-                                rotationNode[2].as<float>()}};
+  if (auto const &rotationNode = referenceMeshNode["rotation"]) {
+    if (!rotationNode.IsSequence() || rotationNode.size() != 3) {
+      throw std::invalid_argument(
+          "referenceMesh.rotation must be a 3 element vector in " + filename);
     }
 
-    referenceMeshOrigin = meshOrigin;
+    config.referenceMeshRotation = {{rotationNode[0].as<float>(),
+                              rotationNode[1].as<float>(),
+                              rotationNode[2].as<float>()}};
+  }
+
+  if (auto const &orderingNode = referenceMeshNode["vertexOrdering"]) {
+    auto const ordering = orderingNode.as<std::string>();
+    if (ordering == "original") {
+      config.referenceMeshVertexOrdering = VertexOrdering::original;
+    } else if (ordering == "reverseCuthillMcKee") {
+      config.referenceMeshVertexOrdering =
+          VertexOrdering::reverseCuthillMcKee;
+    } else if (ordering == "hilbertCurve") {
+      config.referenceMeshVertexOrdering = VertexOrdering::hilbertCurve;
+    } else {
+      throw std::invalid_argument("Invalid vertex ordering '" + ordering +
+                                  "' in " + filename);
+    }
+  }
 
-    if (auto const &labelNode = referenceMeshNode["labels"]) {
-      auto const labelFilename =
-          composePath(filename, labelNode.as<std::string>());
-      refMesh.loadFromFile(meshFilename, labelFilename);
-    } else if (auto const &colorMapNode =
-                   referenceMeshNode["colorToLabelMap"]) {
+  config.referenceMeshOrigin = meshOrigin;
 
-      if (auto const &typeNode = colorMapNode["type"]) {
-        auto const type = typeNode.as<std::string>();
+  std::shared_ptr<ReferenceMeshCache const> refMeshCache;
 
-        if (type == "default") {
+  if (isReferenceMeshBundleExtension(IO::extension(meshFilename, true))) {
+    // Bundles contain the labels and precomputed data for the fitter
+    auto bundle = readReferenceMeshBundle(meshFilename);
+    refMesh = std::move(bundle.mesh);
+    refMeshCache =
+        std::make_shared<ReferenceMeshCache const>(std::move(bundle.cache));
+  } else if (auto const &labelNode = referenceMeshNode["labels"]) {
+    auto const labelFilename =
+        composePath(filename, labelNode.as<std::string>());
+    refMesh.loadFromFile(meshFilename, labelFilename);
+  } else if (auto const &colorMapNode =
+                 referenceMeshNode["colorToLabelMap"]) {
 
-          refMesh.loadFromFile(meshFilename);
-        } else if (type == "custom") {
+    if (auto const &typeNode = colorMapNode["type"]) {
+      auto const type = typeNode.as<std::string>();
 
-          ColorToLabelMap<Mesh<float>::Label, double> const colorToLabelMap =
-              ColorToLabelMaps::IO::loadCustomMapFromYAMLNode(colorMapNode);
+      if (type == "default") {
 
-          refMesh.loadFromFile(meshFilename, colorToLabelMap);
+        refMesh.loadFromFile(meshFilename);
+      } else if (type == "custom") {
 
-        } else {
-          throw std::invalid_argument("Invalid color to label map type: '" +
-                                      type + "' in " + filename);
-        }
-      } else {
-        // custom type
         ColorToLabelMap<Mesh<float>::Label, double> const colorToLabelMap =
             ColorToLabelMaps::IO::loadCustomMapFromYAMLNode(colorMapNode);
 
         refMesh.loadFromFile(meshFilename, colorToLabelMap);
+
+      } else {
+        throw std::invalid_argument("Invalid color to label map type: '" +
+                                    type + "' in " + filename);
       }
     } else {
-      throw std::invalid_argument("Missing 'referenceMesh.labels' or "
-                                  "'referenceMesh.colorToLabelMap' in " +
-                                  filename);
+      // custom type
+      ColorToLabelMap<Mesh<float>::Label, double> const colorToLabelMap =
+          ColorToLabelMaps::IO::loadCustomMapFromYAMLNode(colorMapNode);
+
+      refMesh.loadFromFile(meshFilename, colorToLabelMap);
     }
+  } else {
+    throw std::invalid_argument("Missing 'referenceMesh.labels' or "
+                                "'referenceMesh.colorToLabelMap' in " +
+                                filename);
+  }
+
+  Ensures(!refMesh.isEmpty());
 
-    Ensures(!refMesh.isEmpty());
+  auto modelIt = models.find(modelFilename);
+  if (modelIt == models.end()) {
+    modelIt = models
+                  .emplace(modelFilename,
+                           MeasurementModel{}.loadFromFile(modelFilename))
+                  .first;
+  }
+  // Copies share the density data
+  auto model_ = modelIt->second;
 
-    auto model_ = MeasurementModel{}.loadFromFile(modelFilename);
+  if (auto sigmaENode = node["sigmaE"]) {
+    config.sigmaE = sigmaENode.as<double>(config.sigmaE);
+  }
 
-    if (auto sigmaENode = node["sigmaE"]) {
-      sigmaE = sigmaENode.as<double>(sigmaE);
-    }
+  if (auto sigmaSNode = node["sigmaS"]) {
+    config.sigmaS = sigmaSNode.as<double>(config.sigmaS);
+  }
 
-    if (auto sigmaSNode = node["sigmaS"]) {
-      sigmaS = sigmaSNode.as<double>(sigmaS);
-    }
+  if (auto maxIterNode = node["maxIterations"]) {
+    config.maxIterations = maxIterNode.as<std::size_t>();
+  }
 
-    if (auto maxIterNode = node["maxIterations"]) {
-      maxIterations = maxIterNode.as<std::size_t>();
-    }
+  if (auto minNonDecreasingNode = node["minNonDecreasing"]) {
+    config.minNonDecreasing = minNonDecreasingNode.as<std::size_t>();
+  }
 
-    if (auto minNonDecreasingNode = node["minNonDecreasing"]) {
-      minNonDecreasing = minNonDecreasingNode.as<std::size_t>();
-    }
+  if (auto decayNode = node["decay"]) {
+    config.decay = decayNode.as<float>();
+  }
+
+  if (auto ignoreExteriorSamplesNode = node["ignoreExteriorSamples"]) {
+    config.ignoreExteriorSamples = ignoreExteriorSamplesNode.as<bool>();
+  }
 
-    if (auto decayNode = node["decay"]) { decay = decayNode.as<float>(); }
+  if (auto detectNode = node["detectSelfIntersections"]) {
+    config.detectSelfIntersections = detectNode.as<bool>();
+  }
+
+  if (auto stopNode = node["stopOnSelfIntersection"]) {
+    config.stopOnSelfIntersection = stopNode.as<bool>();
+  }
 
-    if (auto ignoreExteriorSamplesNode = node["ignoreExteriorSamples"]) {
-      ignoreExteriorSamples = ignoreExteriorSamplesNode.as<bool>();
+  if (auto storeNode = node["storeVolumeSamplingPositions"]) {
+    config.storeVolumeSamplingPositions = storeNode.as<bool>();
+  }
+
+  if (auto levelsNode = node["levels"]) {
+    if (!levelsNode.IsSequence()) {
+      throw std::invalid_argument("levels must be a sequence in " +
+                                  filename);
     }
 
-    if (auto calibrationNode = node["calibration"]) {
-      if (!calibrationNode.IsMap()) {
-        throw std::invalid_argument("calibration node must be a map type in " +
-                                    filename);
+    std::vector<Configuration::Level> levels_;
+    for (auto const &levelNode : levelsNode) {
+      Configuration::Level level;
+      if (auto fractionNode = levelNode["vertexFraction"]) {
+        level.vertexFraction = fractionNode.as<float>();
+      }
+      if (auto downsamplingNode = levelNode["volumeDownsampling"]) {
+        level.volumeDownsampling = downsamplingNode.as<std::size_t>();
+      }
+      if (auto maxIterNode = levelNode["maxIterations"]) {
+        level.maxIterations = maxIterNode.as<std::size_t>();
+      }
+      if (auto sigmaENode = levelNode["sigmaE"]) {
+        level.sigmaE = sigmaENode.as<double>();
+      }
+      if (auto sigmaSNode = levelNode["sigmaS"]) {
+        level.sigmaS = sigmaSNode.as<double>();
+      }
+
+      if (!(level.vertexFraction > 0.f && level.vertexFraction <= 1.f)) {
+        throw std::invalid_argument(
+            "levels.vertexFraction must be in (0, 1] in " + filename);
       }
-      if (auto slopeNode = calibrationNode["slope"]) {
-        calibrationSlope = slopeNode.as<float>();
+      if (level.volumeDownsampling == 0) {
+        throw std::invalid_argument(
+            "levels.volumeDownsampling must be positive in " + filename);
       }
-      if (auto interceptNode = calibrationNode["intercept"]) {
-        calibrationIntercept = interceptNode.as<float>();
+
+      levels_.push_back(level);
+    }
+    config.levels = std::move(levels_);
+  }
+
+  if (auto alignmentNode = node["preAlignment"]) {
+    if (!alignmentNode.IsMap()) {
+      throw std::invalid_argument("preAlignment node must be a map type in " +
+                                  filename);
+    }
+    if (auto typeNode = alignmentNode["type"]) {
+      using AlignmentType = Configuration::AlignmentType;
+      auto const type = typeNode.as<std::string>();
+      if (type == "none") {
+        config.preAlignment.type = AlignmentType::none;
+      } else if (type == "rigid") {
+        config.preAlignment.type = AlignmentType::rigid;
+      } else if (type == "similarity") {
+        config.preAlignment.type = AlignmentType::similarity;
+      } else {
+        throw std::invalid_argument("Invalid pre-alignment type '" + type +
+                                    "' in " + filename);
       }
     }
+    if (auto iterationsNode = alignmentNode["iterations"]) {
+      config.preAlignment.iterations = iterationsNode.as<std::size_t>();
+    }
+  }
+
+  if (auto calibrationNode = node["calibration"]) {
+    if (!calibrationNode.IsMap()) {
+      throw std::invalid_argument("calibration node must be a map type in " +
+                                  filename);
+    }
+    if (auto slopeNode = calibrationNode["slope"]) {
+      config.calibrationSlope = slopeNode.as<float>();
+    }
+    if (auto interceptNode = calibrationNode["intercept"]) {
+      config.calibrationIntercept = interceptNode.as<float>();
+    }
+  }
 
-    model = std::move(model_);
-    referenceMesh = std::move(refMesh);
+  config.model = std::move(model_);
+  config.referenceMesh = std::move(refMesh);
+  config.referenceMeshCache = std::move(refMeshCache);
+}
+
+} // namespace Internal
+
+MeshFitter::Configuration &
+MeshFitter::Configuration::loadFromFile(std::string const &filename) {
+  MeasurementModelCache models;
 
+  try {
+    loadConfiguration(*this, YAML::LoadFile(filename), filename, models);
   } catch (YAML::Exception const &e) {
     throw std::invalid_argument("Failed to load configuration file '" +
                                 filename + "': " + e.what());
@@ -0,0 +1,46 @@
+/**
+ * @file      MeshFitterConfigurationIO.h
+ *
+ * @brief     This private header contains the YAML parser of the mesh fitter
+ * configuration.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "MeshFitter.h"
+
+#include <yaml-cpp/yaml.h>
+
+#include <map>
+#include <string>
+
+namespace CortidQCT {
+namespace Internal {
+
+/// Loaded measurement models by file path, so that each model file is only
+/// loaded once. Copies of a model share its density data.
+using MeasurementModelCache = std::map<std::string, MeasurementModel>;
+
+/**
+ * @brief Loads a mesh fitter configuration from a parsed YAML node
+ *
+ * @param config the configuration to load into, parameters that are not
+ * given in `node` keep their value
+ * @param node the configuration node
+ * @param filename path of the file `node` was read from, relative paths are
+ * interpreted as relative to it
+ * @param models cache of loaded measurement models
+ * @throws std::invalid_argument if the configuration is invalid
+ * @throws YAML::Exception if `node` is malformed
+ */
+void loadConfiguration(MeshFitter::Configuration &config,
+                       YAML::Node const &node, std::string const &filename,
+                       MeasurementModelCache &models);
+
+} // namespace Internal
+} // namespace CortidQCT
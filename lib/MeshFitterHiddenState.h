@@ -14,21 +14,45 @@
 #include "DisplacementOptimizer.h"
 #include "MeshFitter.h"
 #include "MeshHelpers.h"
+#include "StopCondition.h"
+#include "TriangleBVH.h"
 #include "WeightedARAPFitter.h"
 
+#include <Eigen/Geometry>
+
+#include <cstdint>
+
 namespace CortidQCT {
 
 struct MeshFitter::State::HiddenState {
-  VoxelVolume volume;
+  /// The target volume, shared by concurrent fits of the same volume
+  std::shared_ptr<VoxelVolume const> volume;
   Internal::DisplacementOptimizer displacementOptimizer;
   Internal::WeightedARAPFitter<float> meshFitter;
   Internal::FacetMatrix F;
-  Eigen::MatrixXf volumeSamplesMatrix;
+  /// Applied vertex permutation (new to old), empty if not reordered
+  std::vector<Mesh<float>::Index> vertexOrder;
+  /// Hierarchy over the deformed mesh, built by the first self-intersection
+  /// test and refitted afterwards
+  Internal::TriangleBVH<float> deformedMeshBVH;
+  /// Time spent in the stages of the current iteration
+  MeshFitter::StageTimings iterationTimings;
+  /// Stops the fit early, never met unless set by `MeshFitter::fit()`
+  Internal::StopCondition stopCondition;
+  /// True iff the last iteration was stopped by `stopCondition`
+  bool interrupted = false;
+  /// Pre-alignment applied to the configured placement of the reference
+  /// mesh
+  Eigen::Affine3f alignment = Eigen::Affine3f::Identity();
+  /// Hash of `volume`, computed by the first checkpoint of the state
+  std::optional<std::uint64_t> volumeChecksum;
 
-  HiddenState(VoxelVolume const &v, Internal::DisplacementOptimizer const &opt,
+  HiddenState(std::shared_ptr<VoxelVolume const> v,
+              Internal::DisplacementOptimizer const &opt,
               Internal::WeightedARAPFitter<float> const &fitter,
               Internal::FacetMatrix const &f)
-      : volume{v}, displacementOptimizer{opt}, meshFitter{fitter}, F{f} {}
+      : volume{std::move(v)}, displacementOptimizer{opt}, meshFitter{fitter},
+        F{f} {}
 };
 
 namespace Internal {
@@ -11,20 +11,33 @@
 
 #include "MeshFitterImpl.h"
 
+#include "BinaryIO.h"
 #include "CommonMath.h"
-#include "DiscreteRangeDecorators.h"
 #include "DisplacementOptimizer.h"
 #include "EigenAdaptors.h"
 #include "MeshAdaptors.h"
 #include "MeshFitterHiddenState.h"
 #include "MeshHelpers.h"
+#include "MeshReordering.h"
+#include "PointToPlaneAlignment.h"
+#include "ReferenceMeshBundle.h"
 #include "Sampler.h"
+#include "StageTimer.h"
+#include "StopCondition.h"
+#include "TaskScheduler.h"
+#include "TraceRecorder.h"
 #include "WeightedARAPFitter.h"
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <map>
+#include <mutex>
+
 namespace CortidQCT {
 
 using namespace Internal;
@@ -37,40 +50,279 @@ using namespace Internal;
 // MARK: Helper Function
 
 /**
- * @brief Returns a matrix containing positions to sample a voxel volume at
+ * @brief Applies `out[i] = in[oldToNew[i]]` to consecutive blocks of
+ * `blockSize` elements
+ */
+template <class T, class Index>
+void restoreOrder(std::vector<T> &values, std::vector<Index> const &oldToNew,
+                  std::size_t blockSize = 1) {
+  auto const nV = oldToNew.size();
+  if (values.size() != nV * blockSize) return;
+
+  std::vector<T> restored(values.size());
+  for (auto i = 0u; i < nV; ++i) {
+    auto const src = gsl::narrow_cast<std::size_t>(oldToNew[i]) * blockSize;
+    std::copy_n(values.data() + src, blockSize,
+                restored.data() + i * blockSize);
+  }
+  values = std::move(restored);
+}
+
+/**
+ * @brief Returns the configuration used to fit a coarse level
  *
- * Let \f$N := |V|\f$ and let \f$M := |R|\f$, where \f$R\f$ represent
- * `model.samplingRange`, then the returned NMx3 matrix contains N*M positions,
- * where each M consecutive postitions represent a line through a vertex in `V`
- * sampled along the surface normal in `N`.
+ * The coarse mesh is already placed in the volume, so no initial
+ * transformation, reordering or precomputed data is applied.
+ */
+MeshFitter::Configuration
+levelConfiguration(MeshFitter::Configuration const &conf,
+                   MeshFitter::Configuration::Level const &level,
+                   Mesh<float> coarseMesh) {
+  using Configuration = MeshFitter::Configuration;
+
+  auto levelConf = conf;
+  levelConf.referenceMesh = std::move(coarseMesh);
+  levelConf.referenceMeshCache = nullptr;
+  levelConf.referenceMeshOrigin = Configuration::OriginType::untouched;
+  levelConf.referenceMeshScale = {{1.f, 1.f, 1.f}};
+  levelConf.referenceMeshRotation = {{0.f, 0.f, 0.f}};
+  levelConf.referenceMeshVertexOrdering = VertexOrdering::original;
+  levelConf.maxIterations = level.maxIterations;
+  levelConf.sigmaE = level.sigmaE.value_or(conf.sigmaE);
+  levelConf.sigmaS = level.sigmaS.value_or(conf.sigmaS);
+  levelConf.detectSelfIntersections = false;
+  levelConf.stopOnSelfIntersection = false;
+  levelConf.storeVolumeSamplingPositions = false;
+  levelConf.levels.clear();
+  levelConf.preAlignment = {};
+  levelConf.iterationObserver = nullptr;
+
+  return levelConf;
+}
+
+/**
+ * @brief Prolongates the displacements of a coarse mesh to the mesh it was
+ * decimated from
  *
- * @param V Nx3 matrix with vertex positions
- * @param N Nx3 matrix of per-vertex surface normals
- * @param model MeasurementModel instance
- * @return NMx3 matrix containing sampling positions
+ * Each vertex takes the displacement of the coarse vertex it was collapsed
+ * into. The result is smoothed over the one-rings to avoid steps between
+ * neighbouring clusters.
+ *
+ * @param coarseDisplacements 3xM displacements of the coarse vertices
+ * @param fineToCoarse coarse vertex of each fine vertex
+ * @param topology topology of the fine mesh
+ * @return 3xN displacements of the fine vertices
  */
-template <class DerivedV, class DerivedN>
-Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 3>
-samplingPoints(Eigen::MatrixBase<DerivedV> const &V,
-               Eigen::MatrixBase<DerivedN> const &N,
-               MeasurementModel const &model) {
-  using Scalar = typename DerivedV::Scalar;
-  using Eigen::Dynamic;
-  using Eigen::Index;
-  using Eigen::Matrix;
+PointMatrix<float>
+prolongateDisplacements(PointMatrix<float> const &coarseDisplacements,
+                        std::vector<Mesh<float>::Index> const &fineToCoarse,
+                        MeshTopology<Mesh<float>::Index> const &topology) {
+  using Index = Mesh<float>::Index;
   using gsl::narrow_cast;
 
-  auto const t = Internal::discreteRangeElementVector(model.samplingRange);
-  Matrix<Scalar, Dynamic, 3> samples(V.rows() * t.rows(), 3);
+  constexpr auto smoothingPasses = 2;
+
+  auto const n = narrow_cast<Index>(fineToCoarse.size());
+  PointMatrix<float> U(3, n);
+  for (Index i = 0; i < n; ++i) {
+    U.col(i) = coarseDisplacements.col(fineToCoarse[narrow_cast<size_t>(i)]);
+  }
+
+  PointMatrix<float> smoothed(3, n);
+  for (auto pass = 0; pass < smoothingPasses; ++pass) {
+#pragma omp parallel for
+    for (Index i = 0; i < n; ++i) {
+      Eigen::Vector3f sum = U.col(i);
+      for (auto it = topology.neighboursBegin(i);
+           it != topology.neighboursEnd(i); ++it) {
+        sum += U.col(*it);
+      }
+      smoothed.col(i) = sum / static_cast<float>(topology.degree(i) + 1);
+    }
+    U.swap(smoothed);
+  }
+
+  return U;
+}
+
+/**
+ * @brief Returns the initial placement of the reference mesh in the volume
+ *
+ * The mesh is scaled, rotated in the order z, y, x and then translated.
+ */
+Eigen::Affine3f initialPlacement(MeshFitter::Configuration const &conf,
+                                 VoxelVolume const &volume) {
+  using Eigen::Vector3f;
+
+  auto const translation = Adaptor::vec(conf.meshTranslation(volume));
+  Vector3f const rotInRad = Adaptor::vec(conf.referenceMeshRotation) *
+                            static_cast<float>(M_PI) / 180.f;
+
+  return Eigen::Translation<float, 3>{translation} *
+         Eigen::AngleAxisf(rotInRad[0], Vector3f::UnitX()) *
+         Eigen::AngleAxisf(rotInRad[1], Vector3f::UnitY()) *
+         Eigen::AngleAxisf(rotInRad[2], Vector3f::UnitZ()) *
+         Eigen::Scaling(Adaptor::vec(conf.referenceMeshScale));
+}
+
+/// True iff the scaling of the initial placement is uniform, i.e. the
+/// cotangent Laplacian of the reference mesh is not affected by it
+bool isUniformScale(MeshFitter::Configuration const &conf) {
+  auto const &scale = conf.referenceMeshScale;
+  return scale[0] == scale[1] && scale[1] == scale[2];
+}
+
+/// Moves the deformed mesh of `state` to `V` and updates its normals
+template <class Derived>
+void setDeformedVertices(MeshFitter::State &state,
+                         Eigen::MatrixBase<Derived> const &V) {
+  Adaptor::vertexMap(state.deformedMesh) = V;
+  state.deformedMesh.updatePerVertexNormals();
+  // This will be removed in v2.0:
+  Adaptor::map(state.vertexNormals) =
+      Adaptor::vertexNormalMap(state.deformedMesh);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief The parts of a state that change between iterations
+ *
+ * Kept for the best iteration of a fit that may be stopped early. The meshes
+ * keep their topology and labels and the timings cover the whole fit, so
+ * they are not part of the snapshot. Storing into the same snapshot re-uses
+ * its memory.
+ */
+struct IterationSnapshot {
+  PointMatrix<float> vertices;
+  PointMatrix<float> normals;
+  std::vector<float> displacementVector;
+  std::vector<float> weights;
+  std::vector<std::array<float, 3>> volumeSamplingPositions;
+  std::vector<float> volumeSamples;
+  std::vector<float> perVertexLogLikelihood;
+  float minDisNorm = std::numeric_limits<float>::max();
+  float logLikelihood = -std::numeric_limits<float>::max();
+  float effectiveSigmaS = 0.f;
+  std::size_t selfIntersectionCount = 0;
+  std::size_t iteration = 1;
+  std::size_t nonDecreasing = 0;
+
+  void store(MeshFitter::State const &state) {
+    vertices = Adaptor::vertexMap(state.deformedMesh);
+    normals = Adaptor::vertexNormalMap(state.deformedMesh);
+    displacementVector = state.displacementVector;
+    weights = state.weights;
+    volumeSamplingPositions = state.volumeSamplingPositions;
+    volumeSamples = state.volumeSamples;
+    perVertexLogLikelihood = state.perVertexLogLikelihood;
+    minDisNorm = state.minDisNorm;
+    logLikelihood = state.logLikelihood;
+    effectiveSigmaS = state.effectiveSigmaS;
+    selfIntersectionCount = state.selfIntersectionCount;
+    iteration = state.iteration;
+    nonDecreasing = state.nonDecreasing;
+  }
+
+  void restore(MeshFitter::State &state) {
+    Adaptor::vertexMap(state.deformedMesh) = vertices;
+    Adaptor::vertexNormalMap(state.deformedMesh) = normals;
+    // This will be removed in v2.0:
+    Adaptor::map(state.vertexNormals) = normals;
+    state.displacementVector = std::move(displacementVector);
+    state.weights = std::move(weights);
+    state.volumeSamplingPositions = std::move(volumeSamplingPositions);
+    state.volumeSamples = std::move(volumeSamples);
+    state.perVertexLogLikelihood = std::move(perVertexLogLikelihood);
+    state.minDisNorm = minDisNorm;
+    state.logLikelihood = logLikelihood;
+    state.effectiveSigmaS = effectiveSigmaS;
+    state.selfIntersectionCount = selfIntersectionCount;
+    state.iteration = iteration;
+    state.nonDecreasing = nonDecreasing;
+  }
+};
+#pragma clang diagnostic pop
+
+/// Summarizes the last iteration of `state`
+MeshFitter::IterationRecord iterationRecord(MeshFitter::State const &state) {
+  MeshFitter::IterationRecord record;
+  record.iteration = state.iteration;
+  record.logLikelihood = state.logLikelihood;
+  record.displacementNorm =
+      Adaptor::map(state.displacementVector).norm() /
+      static_cast<float>(state.displacementVector.size());
+  record.effectiveSigmaS = state.effectiveSigmaS;
+  record.nonDecreasing = state.nonDecreasing;
+  record.converged = state.converged;
+  record.timings = PrivateStateAccessor::hiddenState(state).iterationTimings;
+  return record;
+}
+
+/// @throws std::invalid_argument if checkpoints are requested without a
+/// positive interval
+void validateCheckpointOptions(FitOptions const &options) {
+  if (!options.checkpointFile.empty() && options.checkpointInterval == 0) {
+    throw std::invalid_argument("The checkpoint interval must be positive");
+  }
+}
 
-  for (auto i = 0; i < V.rows(); ++i) {
-    auto const iStart = i * t.rows();
-    samples.block(iStart, 0, t.rows(), 3).colwise() = -t;
-    samples.block(iStart, 0, t.rows(), 3).array().rowwise() *= N.row(i).array();
-    samples.block(iStart, 0, t.rows(), 3).rowwise() += V.row(i);
+/**
+ * @brief Returns the configuration shared by all fits of a batch
+ *
+ * The Laplacian of the reference mesh is computed once for the whole batch,
+ * unless it is already cached or cannot be re-used due to non-uniform
+ * scaling.
+ */
+MeshFitter::Configuration
+batchConfiguration(MeshFitter::Configuration const &conf) {
+  auto batchConf = conf;
+
+  auto const &cache = conf.referenceMeshCache;
+  if (isUniformScale(conf) &&
+      (cache == nullptr || !cache->isValidFor(conf.referenceMesh))) {
+    batchConf.referenceMeshCache = std::make_shared<ReferenceMeshCache const>(
+        referenceMeshCache(conf.referenceMesh));
   }
 
-  return samples;
+  return batchConf;
+}
+
+/**
+ * @brief Maps all per-vertex quantities of the result back to the original
+ * vertex order
+ *
+ * @param result the result in reordered vertex order
+ * @param newToOld the permutation applied to the reference mesh
+ */
+void restoreVertexOrder(MeshFitter::Result &result,
+                        std::vector<Mesh<float>::Index> const &newToOld) {
+  auto const oldToNew = inversePermutation(newToOld);
+  auto const nV = oldToNew.size();
+
+  result.referenceMesh.permuteVertices(oldToNew);
+  result.deformedMesh.permuteVertices(oldToNew);
+
+  restoreOrder(result.displacementVector, oldToNew);
+  restoreOrder(result.weights, oldToNew);
+  restoreOrder(result.vertexNormals, oldToNew);
+  restoreOrder(result.perVertexLogLikelihood, oldToNew);
+
+  // Sampling positions are stored per vertex
+  restoreOrder(result.volumeSamplingPositions, oldToNew,
+               result.volumeSamplingPositions.size() / nV);
+
+  // Samples are stored per sampling position index, i.e. as a column major
+  // nV x M matrix
+  auto &samples = result.volumeSamples;
+  if (nV == 0 || samples.size() % nV != 0) return;
+  std::vector<float> column(nV);
+  for (auto offset = 0u; offset < samples.size(); offset += nV) {
+    for (auto i = 0u; i < nV; ++i) {
+      column[i] = samples[offset + gsl::narrow_cast<std::size_t>(oldToNew[i])];
+    }
+    std::copy(column.cbegin(), column.cend(), samples.data() + offset);
+  }
 }
 
 /***********************************
@@ -80,36 +332,197 @@ samplingPoints(Eigen::MatrixBase<DerivedV> const &V,
 // MARK: -
 // MARK: MeshFitter::Impl Implementation
 
-MeshFitter::Result MeshFitter::Impl::fit(VoxelVolume const &volume) const {
+MeshFitter::Result MeshFitter::Impl::fit(VoxelVolume const &volume,
+                                         FitOptions const &options) const {
+  // The state does not outlive this call, so the volume is not copied
+  return fit(
+      std::shared_ptr<VoxelVolume const>{std::shared_ptr<void>{}, &volume},
+      options);
+}
+
+MeshFitter::Result
+MeshFitter::Impl::fit(std::shared_ptr<VoxelVolume const> volume,
+                      FitOptions const &options) const {
+  ScopedTraceEvent const trace{"fit"};
+
+  validateCheckpointOptions(options);
 
-  auto state = init(volume);
+  auto state = initWithoutSampling(std::move(volume));
+  state.hiddenState_->stopCondition = StopCondition{options};
 
-  VertexMatrix<float> Vlast =
-      Adaptor::vertexMap(state.deformedMesh).transpose();
+  preAlign(state);
+
+  if (!fitter_.configuration.levels.empty()) { fitCoarseLevels(state); }
+
+  sampleInitialVolume(state);
+
+  return iterate(std::move(state), options);
+}
+
+MeshFitter::Result
+MeshFitter::Impl::resume(MeshFitter::State const &state,
+                         FitOptions const &options) const {
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  ScopedTraceEvent const trace{"resume"};
+
+  validateCheckpointOptions(options);
+
+  auto resumed = state;
+  resumed.hiddenState_->stopCondition = StopCondition{options};
+
+  return iterate(std::move(resumed), options);
+}
+
+MeshFitter::Result MeshFitter::Impl::iterate(MeshFitter::State state,
+                                             FitOptions const &options) const {
+  auto &hiddenState = *state.hiddenState_;
+  hiddenState.interrupted = false;
+
+  auto const &observer = fitter_.configuration.iterationObserver;
+
+  // The completed iteration with the highest log likelihood, only kept if the
+  // fit may be stopped early
+  std::optional<IterationSnapshot> best;
+  if (hiddenState.stopCondition.isActive()) {
+    best.emplace();
+    best->store(state);
+  }
 
   while (!state.converged) {
 
     fitOneIteration(state);
 
-    auto V = Adaptor::vertexMap(state.deformedMesh);
+    if (hiddenState.interrupted) break;
 
-    auto const diff = (V.transpose() - Vlast).norm() / V.norm();
-    Vlast = V.transpose();
+    if (observer) { observer(iterationRecord(state)); }
 
-    auto disNorm = Adaptor::map(state.displacementVector).norm() /
-                   static_cast<float>(state.displacementVector.size());
+    if (best && state.logLikelihood > best->logLikelihood) {
+      best->store(state);
+    }
 
-    std::cout << "Converged after iteration " << state.iteration << ": "
-              << std::boolalpha << state.converged << " (" << diff << " | "
-              << disNorm << " | " << state.nonDecreasing << ")" << std::endl;
+    // `iteration` counts from one, i.e. one ahead of the completed iterations
+    if (!options.checkpointFile.empty() && !state.converged &&
+        (state.iteration - 1) % options.checkpointInterval == 0) {
+      saveCheckpoint(state, options.checkpointFile);
+    }
   }
 
-  state.success = true;
+  if (hiddenState.interrupted) {
+    // The interrupted iteration left the state inconsistent, e.g. deformed
+    // but not sampled. The timings still cover the whole fit.
+    best->restore(state);
+    state.converged = false;
+    state.interrupted = true;
+  }
+
+  if (!hiddenState.vertexOrder.empty()) {
+    restoreVertexOrder(state, hiddenState.vertexOrder);
+  }
+
+  // A fit that was stopped because of a self-intersection did not succeed
+  state.success = !(fitter_.configuration.stopOnSelfIntersection &&
+                    state.selfIntersectionCount > 0);
 
   return std::move(state);
 }
 
+void MeshFitter::Impl::fitBatch(
+    std::size_t count,
+    std::function<std::shared_ptr<VoxelVolume const>(std::size_t)> const
+        &volume,
+    BatchCallback const &callback, std::size_t maxConcurrentFits,
+    FitOptions const &options) const {
+  if (!options.checkpointFile.empty()) {
+    throw std::invalid_argument(
+        "Checkpoints are not supported by batch fits, they would all write "
+        "the same file");
+  }
+
+  if (count == 0) return;
+
+  MeshFitter const batchFitter{batchConfiguration(fitter_.configuration)};
+  if (!fitter_.configuration.levels.empty()) {
+    batchFitter.pImpl_->coarseLevelCache_ = coarseLevelCache();
+  }
+  // Computed once, all copies of the reference mesh share it
+  batchFitter.configuration.referenceMesh.topology();
+
+  std::mutex callbackMutex;
+
+  runTasks(count, maxConcurrentFits, [&](std::size_t i) {
+    auto result = batchFitter.pImpl_->fit(volume(i), options);
+
+    std::lock_guard<std::mutex> lock{callbackMutex};
+    if (callback) { callback(i, std::move(result)); }
+  });
+}
+
 MeshFitter::State MeshFitter::Impl::init(VoxelVolume const &volume) const {
+  // The state may outlive the volume, so it keeps its own copy
+  auto state =
+      initWithoutSampling(std::make_shared<VoxelVolume const>(volume));
+
+  sampleInitialVolume(state);
+
+  return state;
+}
+
+MeshFitter::State
+MeshFitter::Impl::init(VoxelVolume const &volume,
+                       MeshFitter::Result const &prior,
+                       RigidTransform const &transform) const {
+  using Eigen::Index;
+  using gsl::narrow_cast;
+
+  auto const &reference = fitter_.configuration.referenceMesh;
+  if (prior.deformedMesh.vertexCount() != reference.vertexCount() ||
+      prior.deformedMesh.triangleCount() != reference.triangleCount()) {
+    throw std::invalid_argument(
+        "The prior result does not match the reference mesh");
+  }
+
+  auto state =
+      initWithoutSampling(std::make_shared<VoxelVolume const>(volume));
+  auto &hiddenState = *state.hiddenState_;
+
+  // Map the prior deformation into the volume. The reference mesh, i.e. the
+  // rest shape of the ARAP deformation, stays where the configuration
+  // places it.
+  Eigen::Map<Eigen::Matrix<float, 3, 3, Eigen::RowMajor> const> const R{
+      transform.rotation.data()};
+  PointMatrix<float> const P =
+      (R * Adaptor::vertexMap(prior.deformedMesh)).colwise() +
+      Adaptor::vec(transform.translation);
+
+  // The prior is stored in the original vertex order
+  auto const &newToOld = hiddenState.vertexOrder;
+  PointMatrix<float> V = P;
+  if (!newToOld.empty()) {
+    for (Index i = 0; i < V.cols(); ++i) {
+      V.col(i) = P.col(
+          narrow_cast<Index>(newToOld[narrow_cast<std::size_t>(i)]));
+    }
+  }
+  setDeformedVertices(state, V);
+
+  // Continue with the decayed sigmaS of the prior, if it finished an iteration
+  if (prior.effectiveSigmaS > 0) {
+    hiddenState.displacementOptimizer.setCurrentSigma(prior.effectiveSigmaS);
+    state.effectiveSigmaS = prior.effectiveSigmaS;
+  }
+
+  sampleInitialVolume(state);
+
+  return state;
+}
+
+MeshFitter::State
+MeshFitter::Impl::initWithoutSampling(
+    std::shared_ptr<VoxelVolume const> volume,
+    LaplacianMatrix<float> const *laplacian) const {
   using Eigen::Dynamic;
   using Eigen::Index;
   using Eigen::Map;
@@ -127,20 +540,18 @@ MeshFitter::State MeshFitter::Impl::init(VoxelVolume const &volume) const {
   // Init result state
   state.referenceMesh = conf.referenceMesh;
 
+  std::vector<Mesh<float>::Index> vertexOrder;
+  if (conf.referenceMeshVertexOrdering != VertexOrdering::original) {
+    state.referenceMesh.reorderVertices(conf.referenceMeshVertexOrdering,
+                                        &vertexOrder);
+  }
+
   auto const nVertices = narrow_cast<Index>(conf.referenceMesh.vertexCount());
 
   // Apply initial transofrmation on the vertices of the reference mesh
-  auto const translation = Adaptor::vec(conf.meshTranslation(volume));
-  Vector3f const rotInRad = Adaptor::vec(conf.referenceMeshRotation) *
-                            static_cast<float>(M_PI) / 180.f;
   auto V0 = Adaptor::vertexMap(state.referenceMesh);
-
-  // Apply transformation to vertices of reference mesh
-  V0 = ((Eigen::Translation<float, 3>{translation} *
-         Eigen::AngleAxisf(rotInRad[0], Vector3f::UnitX()) *
-         Eigen::AngleAxisf(rotInRad[1], Vector3f::UnitY()) *
-         Eigen::AngleAxisf(rotInRad[2], Vector3f::UnitZ())) *
-        Adaptor::vec(conf.referenceMeshScale).asDiagonal() * V0);
+  PointMatrix<float> const placed = initialPlacement(conf, *volume) * V0;
+  V0 = placed;
 
   // Init vertex normals
   state.referenceMesh.updatePerVertexNormals();
@@ -163,25 +574,276 @@ MeshFitter::State MeshFitter::Impl::init(VoxelVolume const &volume) const {
   // Init vertex normals
   state.vertexNormals.resize(narrow_cast<std::size_t>(nVertices));
 
+  // The cotangent weights are invariant under rigid transformations and
+  // uniform scaling, so a precomputed Laplacian can be re-used in that case
+  auto const *cache = conf.referenceMeshCache.get();
+  if (laplacian == nullptr && cache != nullptr &&
+      cache->isValidFor(conf.referenceMesh)) {
+    laplacian = &cache->laplacian;
+  }
+  if (!isUniformScale(conf)) { laplacian = nullptr; }
+  auto const F = facetMatrix(state.referenceMesh);
+  auto const sigmaE = narrow_cast<float>(conf.sigmaE);
+
+  auto meshFitter = [&]() {
+    if (laplacian == nullptr) {
+      return WeightedARAPFitter<float>{V0, F, state.referenceMesh.topology(),
+                                       sigmaE};
+    }
+    if (vertexOrder.empty()) {
+      return WeightedARAPFitter<float>{V0, F, *laplacian, sigmaE};
+    }
+    // Permute the precomputed Laplacian: L'(i, j) = L(p(i), p(j))
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic,
+                             LaplacianMatrix<float>::StorageIndex>
+        P(nVertices);
+    auto const oldToNew = inversePermutation(vertexOrder);
+    std::transform(oldToNew.cbegin(), oldToNew.cend(), P.indices().data(),
+                   [](auto i) {
+                     return narrow_cast<LaplacianMatrix<float>::StorageIndex>(
+                         i);
+                   });
+    LaplacianMatrix<float> L = P * *laplacian * P.transpose();
+    return WeightedARAPFitter<float>{V0, F, std::move(L), sigmaE};
+  }();
+
   // Init hidden state
   state.hiddenState_ = std::make_unique<State::HiddenState>(
-      volume, DisplacementOptimizer{conf},
-      WeightedARAPFitter<float>{V0.transpose(), facetMatrix(conf.referenceMesh),
-                                narrow_cast<float>(conf.sigmaE)},
-      facetMatrix(conf.referenceMesh));
+      std::move(volume), DisplacementOptimizer{conf}, std::move(meshFitter),
+      F);
+  state.hiddenState_->vertexOrder = std::move(vertexOrder);
 
-  // Init volume sampling positions
+  // Init volume sampling positions, only stored on request
   auto const nSamples = conf.model.samplingRange.numElements() *
                         narrow_cast<std::size_t>(nVertices);
-  state.volumeSamplingPositions.resize(nSamples);
+  if (conf.storeVolumeSamplingPositions) {
+    state.volumeSamplingPositions.resize(nSamples);
+  }
 
   // Init volume samples
   state.volumeSamples.resize(nSamples);
 
+  return state;
+}
+
+void MeshFitter::Impl::preAlign(MeshFitter::State &state) const {
+  using AlignmentType = Configuration::AlignmentType;
+
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  auto const &preAlignment = fitter_.configuration.preAlignment;
+  if (preAlignment.type == AlignmentType::none) return;
+
+  ScopedTraceEvent const trace{"preAlign"};
+
+  auto &hiddenState = *state.hiddenState_;
+  auto &optimizer = hiddenState.displacementOptimizer;
+  hiddenState.iterationTimings = {};
+
+  // The displacement estimates of the pre-alignment must not affect the
+  // deformable fit, e.g. by decaying sigmaS
+  auto const sigma = optimizer.currentSigma();
+  auto const displacements = state.displacementVector;
+  auto const weights = state.weights;
+
+  auto const estimateScale = preAlignment.type == AlignmentType::similarity;
+  auto const V0 = Adaptor::vertexMap(state.referenceMesh);
+  Eigen::Affine3f alignment = Eigen::Affine3f::Identity();
+
+  for (auto i = 0u; i < preAlignment.iterations; ++i) {
+    if (hiddenState.stopCondition.isMet()) break;
+
+    sampleVolume(state);
+    findOptimalDisplacements(state);
+
+    alignment = pointToPlaneAlignment<float>(
+                    Adaptor::vertexMap(state.deformedMesh),
+                    Adaptor::vertexNormalMap(state.deformedMesh),
+                    Adaptor::map(state.displacementVector),
+                    Adaptor::map(state.weights), estimateScale) *
+                alignment;
+    setDeformedVertices(state, alignment * V0);
+  }
+
+  optimizer.setCurrentSigma(sigma);
+  state.effectiveSigmaS = .0f;
+  state.displacementVector = displacements;
+  state.weights = weights;
+
+  applyAlignment(state, alignment);
+
+  state.totalTimings += hiddenState.iterationTimings;
+}
+
+void MeshFitter::Impl::applyAlignment(MeshFitter::State &state,
+                                      Eigen::Affine3f const &transform) const {
+  auto &hiddenState = *state.hiddenState_;
+
+  auto V0 = Adaptor::vertexMap(state.referenceMesh);
+  PointMatrix<float> const V = transform * V0;
+  V0 = V;
+  state.referenceMesh.updatePerVertexNormals();
+
+  hiddenState.meshFitter.transformReference(transform);
+  hiddenState.alignment = transform * hiddenState.alignment;
+
+  setDeformedVertices(state, V);
+}
+
+std::shared_ptr<CoarseLevelCache const>
+MeshFitter::Impl::coarseLevelCache() const {
+  using gsl::narrow_cast;
+
+  auto const &conf = fitter_.configuration;
+  auto const &reference = conf.referenceMesh;
+  auto const nVertices = reference.vertexCount();
+
+  std::vector<std::size_t> targetVertexCounts;
+  for (auto const &level : conf.levels) {
+    targetVertexCounts.push_back(std::max<std::size_t>(
+        narrow_cast<std::size_t>(level.vertexFraction *
+                                 static_cast<float>(nVertices)),
+        4));
+  }
+
+  // The decimation preserves label boundaries, so the labels are hashed, too
+  auto const checksum = reference.withUnsafeLabelPointer([&](auto const *ptr) {
+    return fnv1a64(ptr, nVertices * sizeof(*ptr), meshChecksum(reference));
+  });
+
+  // Concurrent fits wait for the first one to compute the levels
+  std::lock_guard<std::mutex> lock{coarseLevelMutex_};
+  if (coarseLevelCache_ != nullptr &&
+      coarseLevelCache_->meshChecksum == checksum &&
+      coarseLevelCache_->targetVertexCounts == targetVertexCounts) {
+    return coarseLevelCache_;
+  }
+
+  ScopedTraceEvent const trace{"decimateReferenceMesh"};
+
+  auto cache = std::make_shared<CoarseLevelCache>();
+  for (auto const targetVertexCount : targetVertexCounts) {
+    CoarseLevelCache::Level level;
+    level.mesh = reference;
+    level.mesh.decimate(targetVertexCount, &level.correspondence);
+    level.laplacian = referenceMeshCache(level.mesh).laplacian;
+    cache->levels.push_back(std::move(level));
+  }
+  cache->meshChecksum = checksum;
+  cache->targetVertexCounts = std::move(targetVertexCounts);
+
+  coarseLevelCache_ = std::move(cache);
+  return coarseLevelCache_;
+}
+
+void MeshFitter::Impl::fitCoarseLevels(MeshFitter::State &state) const {
+  using gsl::narrow_cast;
+  using Index = Mesh<float>::Index;
+
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  auto const &conf = fitter_.configuration;
+  auto const &hiddenState = *state.hiddenState_;
+  auto const &reference = state.referenceMesh;
+  auto const V0 = Adaptor::vertexMap(reference);
+  auto const nVertices = reference.vertexCount();
+
+  auto const levelCache = coarseLevelCache();
+
+  // The levels were decimated before the placement and the reordering of
+  // the reference mesh
+  Eigen::Affine3f const placement =
+      hiddenState.alignment * initialPlacement(conf, *hiddenState.volume);
+  auto const &newToOld = hiddenState.vertexOrder;
+  auto const oldToNew = inversePermutation(newToOld);
+  auto const reordered = [&oldToNew](Index i) {
+    return oldToNew.empty() ? i : oldToNew[narrow_cast<std::size_t>(i)];
+  };
+
+  // Displacements of the full resolution reference vertices
+  PointMatrix<float> U = PointMatrix<float>::Zero(3, V0.cols());
+
+  auto const &stopCondition = hiddenState.stopCondition;
+
+  // Levels with the same downsampling factor share their volume
+  std::map<std::size_t, std::shared_ptr<VoxelVolume const>> levelVolumes;
+  levelVolumes[1] = hiddenState.volume;
+
+  for (auto k = 0u; k < conf.levels.size(); ++k) {
+    if (stopCondition.isMet()) break;
+
+    ScopedTraceEvent const trace{"fitCoarseLevel"};
+
+    auto const &level = conf.levels[k];
+    auto const &cached = levelCache->levels[k];
+    auto const &correspondence = cached.correspondence;
+
+    auto coarseMesh = cached.mesh;
+    auto coarseVertices = Adaptor::vertexMap(coarseMesh);
+    PointMatrix<float> const placed = placement * coarseVertices;
+    coarseVertices = placed;
+
+    std::vector<Index> fineToCoarse(nVertices);
+    for (auto i = 0u; i < nVertices; ++i) {
+      auto const j =
+          newToOld.empty() ? i : narrow_cast<std::size_t>(newToOld[i]);
+      fineToCoarse[i] = correspondence.fineToCoarse[j];
+    }
+
+    auto &levelVolume = levelVolumes[level.volumeDownsampling];
+    if (levelVolume == nullptr) {
+      levelVolume = std::make_shared<VoxelVolume const>(
+          hiddenState.volume->downsampled(level.volumeDownsampling));
+    }
+
+    MeshFitter const levelFitter{
+        levelConfiguration(conf, level, std::move(coarseMesh))};
+    auto const &levelImpl = *levelFitter.pImpl_;
+    // The cotangent weights are only invariant under uniform scaling
+    auto levelState = levelImpl.initWithoutSampling(
+        levelVolume, isUniformScale(conf) ? &cached.laplacian : nullptr);
+    levelState.hiddenState_->stopCondition = stopCondition;
+
+    // Start with the deformation of the previous level
+    auto const C = Adaptor::vertexMap(levelState.referenceMesh);
+    PointMatrix<float> D = C;
+    for (Eigen::Index i = 0; i < D.cols(); ++i) {
+      D.col(i) += U.col(reordered(
+          correspondence.coarseToFine[narrow_cast<std::size_t>(i)]));
+    }
+    setDeformedVertices(levelState, D);
+    levelImpl.sampleInitialVolume(levelState);
+
+    // An interrupted level still has valid vertex positions
+    while (!levelState.converged && !levelState.hiddenState_->interrupted) {
+      levelImpl.fitOneIteration(levelState);
+    }
+    state.totalTimings += levelState.totalTimings;
+
+    U = prolongateDisplacements(Adaptor::vertexMap(levelState.deformedMesh) -
+                                    C,
+                                fineToCoarse, reference.topology());
+  }
+
+  setDeformedVertices(state, V0 + U);
+}
+
+void MeshFitter::Impl::sampleInitialVolume(MeshFitter::State &state) const {
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  auto &timings = state.hiddenState_->iterationTimings;
+  timings = {};
+
   sampleVolume(state);
 
-  return state;
-} // namespace CortidQCT
+  state.totalTimings += timings;
+}
 
 void MeshFitter::Impl::fitOneIteration(MeshFitter::State &state) const {
 
@@ -189,12 +851,38 @@ void MeshFitter::Impl::fitOneIteration(MeshFitter::State &state) const {
     throw std::invalid_argument("Invalid state argument, call init() first!");
   }
 
+  ScopedTraceEvent const trace{"fitOneIteration"};
+
+  auto &hiddenState = *state.hiddenState_;
+  hiddenState.iterationTimings = {};
+
+  // Checked between the stages. The iteration is abandoned if the stop
+  // condition is met, leaving the state inconsistent.
+  auto const interrupted = [&state, &hiddenState] {
+    hiddenState.interrupted = hiddenState.stopCondition.isMet();
+    if (hiddenState.interrupted) {
+      state.totalTimings += hiddenState.iterationTimings;
+    }
+    return hiddenState.interrupted;
+  };
+
+  if (interrupted()) return;
   findOptimalDisplacements(state);
+  if (interrupted()) return;
   findOptimalDeformation(state);
+  if (fitter_.configuration.detectSelfIntersections) {
+    if (interrupted()) return;
+    detectSelfIntersections(state);
+  }
+  if (interrupted()) return;
   sampleVolume(state);
   computeLogLikelihood(state);
   checkConvergence(state);
 
+  auto const &timings = state.hiddenState_->iterationTimings;
+  state.iterationTimings.push_back(timings);
+  state.totalTimings += timings;
+
   ++state.iteration;
 }
 
@@ -204,6 +892,10 @@ void MeshFitter::Impl::findOptimalDisplacements(
     throw std::invalid_argument("Invalid state argument, call init() first!");
   }
 
+  ScopedTraceEvent const trace{"findOptimalDisplacements"};
+  ScopedStageTimer const timer{
+      state.hiddenState_->iterationTimings.displacements};
+
   // Get maps to state variables
   auto const labels = Adaptor::labelMap(state.referenceMesh);
   auto const N = Adaptor::vertexNormalMap(state.deformedMesh);
@@ -213,9 +905,9 @@ void MeshFitter::Impl::findOptimalDisplacements(
 
   // Find optimal displacements
   std::tie(optimalDisplacements, gamma) =
-      state.hiddenState_->displacementOptimizer(
-          N.transpose(), labels, volumeSamples, state.nonDecreasing,
-          state.effectiveSigmaS);
+      state.hiddenState_->displacementOptimizer(N, labels, volumeSamples,
+                                                state.nonDecreasing,
+                                                state.effectiveSigmaS);
 }
 
 void MeshFitter::Impl::findOptimalDeformation(MeshFitter::State &state) const {
@@ -223,18 +915,29 @@ void MeshFitter::Impl::findOptimalDeformation(MeshFitter::State &state) const {
     throw std::invalid_argument("Invalid state argument, call init() first!");
   }
 
+  ScopedTraceEvent const trace{"findOptimalDeformation"};
+  ScopedStageTimer const timer{
+      state.hiddenState_->iterationTimings.deformation};
+
   auto const N = Adaptor::vertexNormalMap(state.deformedMesh);
   auto const optimalDisplacements = Adaptor::map(state.displacementVector);
   auto const gamma = Adaptor::map(state.weights);
   auto V = Adaptor::vertexMap(state.deformedMesh);
 
-  VertexMatrix<> const Y =
-      (V - (N.array().rowwise() * optimalDisplacements.array().transpose())
-               .matrix())
-          .transpose();
+  PointMatrix<> const Y =
+      V - (N.array().rowwise() * optimalDisplacements.array().transpose())
+              .matrix();
 
-  // Fit mesh
-  V = state.hiddenState_->meshFitter.fit(Y, N.transpose(), gamma).transpose();
+  // Fit mesh, the result is written to the vertices of the deformed mesh
+  auto &meshFitter = state.hiddenState_->meshFitter;
+  meshFitter.fit(Y, N, gamma, V, state.hiddenState_->stopCondition);
+
+  auto const &arapTimings = meshFitter.timings();
+  auto &timings = state.hiddenState_->iterationTimings;
+  timings.deformationSetup += arapTimings.setup;
+  timings.deformationSolve += arapTimings.solve;
+  timings.deformationRotations += arapTimings.rotations;
+  timings.deformationEnergy += arapTimings.energy;
   // Update normals
   state.deformedMesh.updatePerVertexNormals();
   // This will be removed in v2.0:
@@ -246,40 +949,68 @@ void MeshFitter::Impl::sampleVolume(MeshFitter::State &state) const {
 
   using Eigen::Map;
   using Eigen::MatrixXf;
-  using Eigen::VectorXf;
 
   if (state.hiddenState_ == nullptr) {
     throw std::invalid_argument("Invalid state argument, call init() first!");
   }
 
+  ScopedTraceEvent const trace{"sampleVolume"};
+  ScopedStageTimer const timer{
+      state.hiddenState_->iterationTimings.volumeSampling};
+
   auto const &conf = fitter_.configuration;
+  auto const &range = conf.model.samplingRange;
   auto const V = Adaptor::vertexMap(state.deformedMesh);
-  auto const nVertices = V.cols();
-  auto N = Adaptor::vertexNormalMap(state.deformedMesh);
-  auto volumeSamplingPositions = Adaptor::map(state.volumeSamplingPositions);
-  auto volumeSamples = Adaptor::map(state.volumeSamples);
-
-  // Copmute new sampling positions
-  volumeSamplingPositions =
-      samplingPoints(V.transpose(), N.transpose(), conf.model).transpose();
-
-  // Sample the volume
-  auto const volumeSampler = VolumeSampler{
-      state.hiddenState_->volume, conf.ignoreExteriorSamples
-                                      ? std::numeric_limits<float>::quiet_NaN()
-                                      : 0.f};
-  volumeSampler(volumeSamplingPositions.transpose(), volumeSamples,
-                fitter_.configuration.calibrationSlope,
-                fitter_.configuration.calibrationIntercept);
-
-  // Reorder samples
-  state.hiddenState_->volumeSamplesMatrix =
-      Map<MatrixXf const>{volumeSamples.data(),
-                          volumeSamples.rows() / nVertices, nVertices}
-          .transpose();
-
-  volumeSamples = Map<VectorXf const>{
-      state.hiddenState_->volumeSamplesMatrix.data(), volumeSamples.rows()};
+  auto const N = Adaptor::vertexNormalMap(state.deformedMesh);
+
+  // Sampling positions are only materialized for diagnostics
+  if (conf.storeVolumeSamplingPositions) {
+    state.volumeSamplingPositions.resize(range.numElements() *
+                                         state.deformedMesh.vertexCount());
+    Adaptor::map(state.volumeSamplingPositions) = samplingPoints(V, N, range);
+  }
+
+  // Sample the volume along the normals. The samples are stored per sampling
+  // position index, i.e. as the column major nV x M matrix the displacement
+  // optimizer consumes.
+  auto const volumeSampler =
+      VolumeSampler{*state.hiddenState_->volume,
+                    conf.ignoreExteriorSamples
+                        ? std::numeric_limits<float>::quiet_NaN()
+                        : 0.f};
+  volumeSampler.sampleNormalLines(
+      V, N, range,
+      Map<MatrixXf>{state.volumeSamples.data(), V.cols(),
+                    gsl::narrow<Eigen::Index>(range.numElements())},
+      conf.calibrationSlope, conf.calibrationIntercept);
+}
+
+void MeshFitter::Impl::detectSelfIntersections(
+    MeshFitter::State &state) const {
+  if (state.hiddenState_ == nullptr) {
+    throw std::invalid_argument("Invalid state argument, call init() first!");
+  }
+
+  ScopedTraceEvent const trace{"detectSelfIntersections"};
+  ScopedStageTimer const timer{
+      state.hiddenState_->iterationTimings.selfIntersections};
+
+  auto &bvh = state.hiddenState_->deformedMeshBVH;
+  auto const &mesh = state.deformedMesh;
+
+  // The connectivity never changes, so the hierarchy only needs to be built
+  // once
+  state.selfIntersectionCount =
+      mesh.withUnsafeVertexPointer([&bvh, &mesh](float const *vertices) {
+        if (bvh.isEmpty()) {
+          mesh.withUnsafeIndexPointer([&](auto const *indices) {
+            bvh = TriangleBVH<float>{vertices, indices, mesh.triangleCount()};
+          });
+        } else {
+          bvh.refit(vertices);
+        }
+        return bvh.selfIntersections(vertices).size();
+      });
 }
 
 void MeshFitter::Impl::computeLogLikelihood(MeshFitter::State &state) const {
@@ -291,13 +1022,17 @@ void MeshFitter::Impl::computeLogLikelihood(MeshFitter::State &state) const {
     throw std::invalid_argument("Invalid state argument, call init() first!");
   }
 
+  ScopedTraceEvent const trace{"computeLogLikelihood"};
+  ScopedStageTimer const timer{
+      state.hiddenState_->iterationTimings.logLikelihood};
+
   auto const labels = Adaptor::labelMap(state.referenceMesh);
   auto const N = Adaptor::vertexNormalMap(state.deformedMesh);
   auto const volumeSamples = Adaptor::map(state.volumeSamples);
 
   auto const llVec =
       state.hiddenState_->displacementOptimizer.logLikelihoodVector(
-          N.transpose(), labels, volumeSamples);
+          N, labels, volumeSamples);
   auto const LL = llVec.sum();
 
   state.logLikelihood = LL;
@@ -315,7 +1050,9 @@ void MeshFitter::Impl::checkConvergence(MeshFitter::State &state) const {
   auto const &conf = fitter_.configuration;
 
   state.converged = state.iteration >= conf.maxIterations ||
-                    (optimalDisplacements.norm() < 1e-3f);
+                    (optimalDisplacements.norm() < 1e-3f) ||
+                    (conf.stopOnSelfIntersection &&
+                     state.selfIntersectionCount > 0);
 
   auto disNorm = optimalDisplacements.norm() / optimalDisplacements.rows();
   if (disNorm < state.minDisNorm) {
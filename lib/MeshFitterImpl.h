@@ -16,8 +16,48 @@
 #include "MeshHelpers.h"
 #include "WeightedARAPFitter.h"
 
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
 namespace CortidQCT {
 
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Decimated copies of the reference mesh used by the coarse levels
+ *
+ * The meshes are decimated in the frame and vertex order of the configured
+ * reference mesh, i.e. before the initial placement.
+ */
+struct CoarseLevelCache {
+  struct Level {
+    /// The decimated reference mesh
+    Mesh<float> mesh;
+    /// Correspondence between `mesh` and the reference mesh
+    Mesh<float>::VertexCorrespondence correspondence;
+    /// Cotangent Laplacian matrix of `mesh`
+    LaplacianMatrix<float> laplacian;
+  };
+
+  /// One entry per configured level
+  std::vector<Level> levels;
+  /// Checksum of the reference mesh the levels were computed for
+  std::uint64_t meshChecksum = 0;
+  /// Target vertex counts of the decimations
+  std::vector<std::size_t> targetVertexCounts;
+};
+#pragma clang diagnostic pop
+
+} // namespace Internal
+
 class MeshFitter::Impl {
 
   friend class MeshFitter;
@@ -39,18 +79,91 @@ public:
       : fitter_(rhsFitter) {}
 
 protected:
-  MeshFitter::Result fit(VoxelVolume const &volume) const;
+  MeshFitter::Result fit(VoxelVolume const &volume,
+                         FitOptions const &options) const;
   MeshFitter::State init(VoxelVolume const &volume) const;
+  MeshFitter::State init(VoxelVolume const &volume,
+                         MeshFitter::Result const &prior,
+                         RigidTransform const &transform) const;
   void fitOneIteration(MeshFitter::State &state) const;
 
+  /// Fits the reference mesh to a volume that is shared with the caller
+  MeshFitter::Result fit(std::shared_ptr<VoxelVolume const> volume,
+                         FitOptions const &options) const;
+
+  /**
+   * @brief Fits `count` volumes concurrently
+   *
+   * @param count number of volumes
+   * @param volume returns the `i`-th volume, called right before its fit
+   * @param callback receives the results
+   * @param maxConcurrentFits upper bound of concurrent fits, 0 for no bound
+   * @param options stop conditions applied to each fit
+   */
+  void fitBatch(
+      std::size_t count,
+      std::function<std::shared_ptr<VoxelVolume const>(std::size_t)> const
+          &volume,
+      BatchCallback const &callback, std::size_t maxConcurrentFits,
+      FitOptions const &options) const;
+
+  /// Continues fitting `state` until it converged
+  MeshFitter::Result resume(MeshFitter::State const &state,
+                            FitOptions const &options) const;
+
+  void saveCheckpoint(MeshFitter::State const &state,
+                      std::string const &filename) const;
+  MeshFitter::State loadCheckpoint(std::string const &filename,
+                                   VoxelVolume const &volume) const;
+
+  /**
+   * @brief Same as `init()` but without sampling the volume
+   *
+   * @param laplacian optional Laplacian of the configured reference mesh, used
+   * instead of the cached or computed one if the scaling is uniform
+   */
+  MeshFitter::State initWithoutSampling(
+      std::shared_ptr<VoxelVolume const> volume,
+      Internal::LaplacianMatrix<float> const *laplacian = nullptr) const;
+  /// Returns the coarse levels of the configuration, computed on first use
+  /// and whenever the reference mesh or the levels changed
+  std::shared_ptr<Internal::CoarseLevelCache const> coarseLevelCache() const;
+  /// Refines the placement of the reference mesh as configured by
+  /// `Configuration::preAlignment`, must be called before any deformation
+  void preAlign(MeshFitter::State &state) const;
+  /// Moves the reference mesh, the ARAP rest shape and the deformed mesh of
+  /// an undeformed `state` by `transform`
+  void applyAlignment(MeshFitter::State &state,
+                      Eigen::Affine3f const &transform) const;
+  /// Fits the coarse levels of the configuration and applies the prolongated
+  /// deformation to the deformed mesh of `state`
+  void fitCoarseLevels(MeshFitter::State &state) const;
+  /**
+   * @brief Runs iterations until `state` converged or its stop condition is
+   * met
+   *
+   * Writes the checkpoints requested by `options` and maps the result back
+   * to the original vertex order.
+   */
+  MeshFitter::Result iterate(MeshFitter::State state,
+                             FitOptions const &options) const;
+  /// Samples the volume before the first iteration and adds the time spent to
+  /// the total timings of `state`
+  void sampleInitialVolume(MeshFitter::State &state) const;
+
   void findOptimalDisplacements(MeshFitter::State &state) const;
   void findOptimalDeformation(MeshFitter::State &state) const;
   void sampleVolume(MeshFitter::State &state) const;
+  void detectSelfIntersections(MeshFitter::State &state) const;
   void computeLogLikelihood(MeshFitter::State &state) const;
   void checkConvergence(MeshFitter::State &state) const;
 
   MeshFitter &fitter_;
 
+  /// Guards `coarseLevelCache_`, concurrent fits of a batch share the cache
+  mutable std::mutex coarseLevelMutex_;
+  mutable std::shared_ptr<Internal::CoarseLevelCache const> coarseLevelCache_;
+
   std::optional<Result> result_;
 };
 
@@ -14,9 +14,13 @@
 #include "Mesh.h"
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/Sparse>
 #include <gsl/gsl>
-#include <igl/cotmatrix.h>
-#include <igl/per_vertex_normals.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
 namespace CortidQCT {
 
@@ -25,12 +29,55 @@ namespace Internal {
 template <class T = float>
 using VertexMatrix = Eigen::Matrix<T, Eigen::Dynamic, 3>;
 template <class T = float> using NormalMatrix = VertexMatrix<T>;
+/// 3xN matrix with one point per column, the layout of the mesh storage
+template <class T = float>
+using PointMatrix = Eigen::Matrix<T, 3, Eigen::Dynamic>;
 using FacetMatrix =
     Eigen::Matrix<typename Mesh<float>::Index, Eigen::Dynamic, 3>;
 using LabelVector =
     Eigen::Matrix<typename Mesh<float>::Label, Eigen::Dynamic, 1>;
 template <class T = float> using LaplacianMatrix = Eigen::SparseMatrix<T>;
 
+/**
+ * @brief Grants access to the storage of a mesh
+ *
+ * Used to fill meshes from precomputed data without redundant copies or
+ * recomputations. Callers must keep the mesh in a valid state.
+ */
+struct PrivateMeshAccessor {
+
+  template <class T>
+  static typename Mesh<T>::VertexData &vertexData(Mesh<T> &mesh) noexcept {
+    return mesh.vertexData_;
+  }
+
+  template <class T>
+  static typename Mesh<T>::IndexData &indexData(Mesh<T> &mesh) noexcept {
+    mesh.invalidateTopology();
+    return mesh.indexData_;
+  }
+
+  template <class T>
+  static typename Mesh<T>::LabelData &labelData(Mesh<T> &mesh) noexcept {
+    return mesh.labelData_;
+  }
+
+  template <class T>
+  static typename Mesh<T>::NormalData &normalData(Mesh<T> &mesh) noexcept {
+    return mesh.normalData_;
+  }
+
+  /// Replaces the cached topology of the mesh, must match the indices
+  template <class T>
+  static void
+  setTopology(Mesh<T> &mesh,
+              std::shared_ptr<typename Mesh<T>::Topology const> topology) {
+    Expects(topology == nullptr ||
+            topology->vertexCount() == mesh.vertexCount());
+    mesh.topology_ = std::move(topology);
+  }
+};
+
 /// Returns the Nx3 vertex matrix of the mesh
 template <class T> inline VertexMatrix<T> vertexMatrix(Mesh<T> const &mesh) {
   return mesh
@@ -61,44 +108,207 @@ template <class T> inline LabelVector labelVector(Mesh<T> const &mesh) {
   });
 }
 
-/// Returns a Nx3 matrix with per-vertex normals
-template <class DerivedV, class DerivedF>
+/// Computes the topology of the given Mx3 facet matrix
+template <class DerivedF>
+inline MeshTopology<typename FacetMatrix::Scalar>
+meshTopology(Eigen::MatrixBase<DerivedF> const &F, Eigen::Index nVertices) {
+  using Index = typename FacetMatrix::Scalar;
+  using gsl::narrow;
+
+  Eigen::Matrix<Index, 3, Eigen::Dynamic> const indices =
+      F.transpose().template cast<Index>();
+
+  return MeshTopology<Index>::fromTriangles(
+      indices.data(), narrow<std::size_t>(indices.cols()),
+      narrow<std::size_t>(nVertices));
+}
+
+/**
+ * @brief Returns a Nx3 matrix with angle weighted per-vertex normals
+ *
+ * @param V Nx3 vertex matrix
+ * @param F Mx3 facet matrix
+ * @param topology The topology of `F`
+ */
+template <class DerivedV, class DerivedF, class Index>
 inline NormalMatrix<typename DerivedV::Scalar>
 perVertexNormalMatrix(Eigen::MatrixBase<DerivedV> const &V,
-                      Eigen::MatrixBase<DerivedF> const &F) {
-  // output matrix
-  NormalMatrix<typename DerivedV::Scalar> normals;
+                      Eigen::MatrixBase<DerivedF> const &F,
+                      MeshTopology<Index> const &topology) {
+  using Scalar = typename DerivedV::Scalar;
+  using Vector = Eigen::Matrix<Scalar, 1, 3>;
+  using gsl::narrow_cast;
+
+  Expects(V.cols() == 3 && F.cols() == 3);
+  Expects(topology.vertexCount() == narrow_cast<std::size_t>(V.rows()));
+
+  auto const nF = F.rows();
+  auto const nV = V.rows();
+
+  // Per-face unit normals and interior angles at each corner
+  NormalMatrix<Scalar> faceNormals(nF, 3);
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 3> angles(nF, 3);
 
-  igl::per_vertex_normals(V, F, igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_ANGLE,
-                          normals);
+#pragma omp parallel for
+  for (Eigen::Index f = 0; f < nF; ++f) {
+    Vector const p[3] = {V.row(F(f, 0)), V.row(F(f, 1)), V.row(F(f, 2))};
+
+    Vector const n = (p[1] - p[0]).cross(p[2] - p[0]);
+    auto const norm = n.norm();
+    faceNormals.row(f) = norm > 0 ? Vector{n / norm} : Vector::Zero();
+
+    for (auto k = 0; k < 3; ++k) {
+      Vector const a = p[(k + 1) % 3] - p[k];
+      Vector const b = p[(k + 2) % 3] - p[k];
+      angles(f, k) = std::atan2(a.cross(b).norm(), a.dot(b));
+    }
+  }
+
+  // Accumulate per vertex, each vertex gathers from its incident faces
+  NormalMatrix<Scalar> normals(nV, 3);
+
+#pragma omp parallel for
+  for (Eigen::Index v = 0; v < nV; ++v) {
+    Vector n = Vector::Zero();
+    auto const vi = narrow_cast<Index>(v);
+
+    for (auto it = topology.facesBegin(vi); it != topology.facesEnd(vi);
+         ++it) {
+      // Faces are sorted, degenerate faces might be listed several times
+      if (it != topology.facesBegin(vi) && *(it - 1) == *it) continue;
+      for (auto k = 0; k < 3; ++k) {
+        if (F(*it, k) == v) n += angles(*it, k) * faceNormals.row(*it);
+      }
+    }
+
+    auto const norm = n.norm();
+    normals.row(v) = norm > 0 ? Vector{n / norm} : Vector::Zero();
+  }
 
   return normals;
 }
 
+/// Returns a Nx3 matrix with per-vertex normals
+template <class DerivedV, class DerivedF>
+inline NormalMatrix<typename DerivedV::Scalar>
+perVertexNormalMatrix(Eigen::MatrixBase<DerivedV> const &V,
+                      Eigen::MatrixBase<DerivedF> const &F) {
+  return perVertexNormalMatrix(V, F, meshTopology(F, V.rows()));
+}
+
 /// Returns a Nx3 matrix with per-vertex normals
 template <class T>
 inline NormalMatrix<T> perVertexNormalMatrix(Mesh<T> const &mesh) {
-  return perVertexNormalMatrix(vertexMatrix(mesh), facetMatrix(mesh));
+  return perVertexNormalMatrix(vertexMatrix(mesh), facetMatrix(mesh),
+                               mesh.topology());
 }
 
-/// Returns the NxN sparse laplacian matrix (using cotangent weights)
-template <class DerivedV, class DerivedF>
+/**
+ * @brief Returns the NxN sparse laplacian matrix (using cotangent weights)
+ *
+ * The sparsity pattern is taken directly from the one-rings of `topology`,
+ * the result is in compressed mode.
+ *
+ * @param V Nx3 vertex matrix
+ * @param F Mx3 facet matrix
+ * @param topology The topology of `F`
+ */
+template <class DerivedV, class DerivedF, class Index>
 inline LaplacianMatrix<typename DerivedV::Scalar>
 laplacianMatrix(Eigen::MatrixBase<DerivedV> const &V,
-                Eigen::MatrixBase<DerivedF> const &F) {
-  // output matrix
-  Eigen::SparseMatrix<typename DerivedV::Scalar> laplacian;
+                Eigen::MatrixBase<DerivedF> const &F,
+                MeshTopology<Index> const &topology) {
+  using Scalar = typename DerivedV::Scalar;
+  using Vector = Eigen::Matrix<Scalar, 1, 3>;
+  using StorageIndex = typename LaplacianMatrix<Scalar>::StorageIndex;
+  using gsl::narrow;
+  using gsl::narrow_cast;
+
   Expects(V.rows() > 0 && V.cols() == 3);
   Expects(F.rows() > 0 && F.cols() == 3);
-  igl::cotmatrix(V, F, laplacian);
+  Expects(topology.vertexCount() == narrow_cast<std::size_t>(V.rows()));
+
+  auto const nF = F.rows();
+  auto const nV = V.rows();
+
+  // Half cotangent of the angle at each corner
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 3> halfCot(nF, 3);
+
+#pragma omp parallel for
+  for (Eigen::Index f = 0; f < nF; ++f) {
+    for (auto k = 0; k < 3; ++k) {
+      Vector const a = V.row(F(f, (k + 1) % 3)) - V.row(F(f, k));
+      Vector const b = V.row(F(f, (k + 2) % 3)) - V.row(F(f, k));
+      halfCot(f, k) = Scalar{0.5} * a.dot(b) / a.cross(b).norm();
+    }
+  }
 
-  return laplacian;
+  // Column c contains the one-ring of c and the diagonal element
+  auto const &ringOffsets = topology.neighbourOffsets();
+  LaplacianMatrix<Scalar> L(nV, nV);
+  L.resizeNonZeros(narrow<Eigen::Index>(topology.neighbourIndices().size()) +
+                   nV);
+
+  auto *outer = L.outerIndexPtr();
+  auto *inner = L.innerIndexPtr();
+  auto *values = L.valuePtr();
+
+  for (Eigen::Index c = 0; c <= nV; ++c) {
+    outer[c] = narrow<StorageIndex>(
+        ringOffsets[narrow_cast<std::size_t>(c)] + narrow_cast<Index>(c));
+  }
+
+#pragma omp parallel for
+  for (Eigen::Index c = 0; c < nV; ++c) {
+    auto const ci = narrow_cast<Index>(c);
+    auto *rowsBegin = inner + outer[c];
+    auto *rowsEnd = inner + outer[c + 1];
+
+    *std::transform(topology.neighboursBegin(ci), topology.neighboursEnd(ci),
+                    rowsBegin, [](Index i) {
+                      return narrow_cast<StorageIndex>(i);
+                    }) = narrow_cast<StorageIndex>(c);
+    std::sort(rowsBegin, rowsEnd);
+    std::fill(values + outer[c], values + outer[c + 1], Scalar{0});
+
+    auto const coeff = [=](auto row) -> Scalar & {
+      auto const it = std::lower_bound(rowsBegin, rowsEnd,
+                                       narrow_cast<StorageIndex>(row));
+      return values[std::distance(inner, it)];
+    };
+
+    for (auto it = topology.facesBegin(ci); it != topology.facesEnd(ci);
+         ++it) {
+      auto const f = *it;
+      auto const k = F(f, 0) == c ? 0 : (F(f, 1) == c ? 1 : 2);
+      auto const next = F(f, (k + 1) % 3);
+      auto const prev = F(f, (k + 2) % 3);
+      // Edge (c, next) is opposite to the previous corner and vice versa
+      auto const wNext = halfCot(f, (k + 2) % 3);
+      auto const wPrev = halfCot(f, (k + 1) % 3);
+
+      coeff(next) += wNext;
+      coeff(prev) += wPrev;
+      coeff(c) -= wNext + wPrev;
+    }
+  }
+
+  return L;
+}
+
+/// Returns the NxN sparse laplacian matrix (using cotangent weights)
+template <class DerivedV, class DerivedF>
+inline LaplacianMatrix<typename DerivedV::Scalar>
+laplacianMatrix(Eigen::MatrixBase<DerivedV> const &V,
+                Eigen::MatrixBase<DerivedF> const &F) {
+  return laplacianMatrix(V, F, meshTopology(F, V.rows()));
 }
 
 /// Returns the NxN sparse laplacian matrix (using cotangent weights)
 template <class T>
 inline LaplacianMatrix<T> laplacianMatrix(Mesh<T> const &mesh) {
-  return laplacianMatrix(vertexMatrix(mesh), facetMatrix(mesh));
+  return laplacianMatrix(vertexMatrix(mesh), facetMatrix(mesh),
+                         mesh.topology());
 }
 
 } // namespace Internal
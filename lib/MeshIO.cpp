@@ -0,0 +1,893 @@
+/**
+ * @file      MeshIO.cpp
+ *
+ * @brief     Implementation of the native mesh file readers and writers
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshIO.h"
+#include "BinaryIO.h"
+#include "CheckExtension.h"
+#include "MappedFile.h"
+#include "ParseHelpers.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string_view>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+using Index = typename Mesh<float>::Index;
+using Label = typename Mesh<float>::Label;
+
+/// Appends a fan triangulation of the given polygon to `triangles`
+/// @throws std::invalid_argument if the polygon has less than 3 vertices
+inline void triangulate(std::vector<Index> const &polygon,
+                        std::vector<Index> &triangles) {
+  if (polygon.size() < 3) {
+    throw std::invalid_argument("Face with less than 3 vertices");
+  }
+  for (auto k = 1u; k + 1 < polygon.size(); ++k) {
+    triangles.push_back(polygon[0]);
+    triangles.push_back(polygon[k]);
+    triangles.push_back(polygon[k + 1]);
+  }
+}
+
+/// Concatenates the per-chunk triangle lists into `indices`
+void gatherTriangles(std::vector<std::vector<Index>> const &chunkTriangles,
+                     std::vector<Index> &indices) {
+  std::vector<std::size_t> offsets(chunkTriangles.size() + 1, 0);
+  for (auto c = 0u; c < chunkTriangles.size(); ++c) {
+    offsets[c + 1] = offsets[c] + chunkTriangles[c].size();
+  }
+
+  indices.resize(offsets.back());
+  parallelForEachChunk(chunkTriangles.size(), [&](std::size_t c) {
+    std::copy(chunkTriangles[c].cbegin(), chunkTriangles[c].cend(),
+              indices.begin() + gsl::narrow_cast<std::ptrdiff_t>(offsets[c]));
+  });
+}
+
+/// Divides colors by 255 if they are given as integers in [0, 255]
+void normalizeColors(std::vector<double> &colors) {
+  if (!colors.empty() &&
+      *std::max_element(colors.cbegin(), colors.cend()) > 1.0) {
+    for (auto &c : colors) c /= 255.0;
+  }
+}
+
+/**
+ * @brief Parses a line based body in parallel chunks
+ *
+ * Content lines `[vertexBegin, vertexBegin + nVertices)` are passed to
+ * `parseVertex(i, line)`, content lines `[faceBegin, faceBegin + nFaces)` to
+ * `parseFace(line, polygon)`. All other lines are ignored.
+ *
+ * @return triangulated faces
+ */
+template <class VertexParser, class FaceParser>
+std::vector<Index> parseLineBlocks(std::string_view body,
+                                   std::size_t vertexBegin,
+                                   std::size_t nVertices, std::size_t faceBegin,
+                                   std::size_t nFaces,
+                                   VertexParser &&parseVertex,
+                                   FaceParser &&parseFace) {
+  auto const chunks = splitAtLines(body, parallelChunkCount(body.size()));
+  auto const nChunks = chunks.size();
+
+  // Pass 1: find the global index of the first line of each chunk
+  std::vector<std::size_t> firstLine(nChunks + 1, 0);
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    firstLine[c + 1] = countContentLines(chunks[c]);
+  });
+  std::partial_sum(firstLine.cbegin(), firstLine.cend(), firstLine.begin());
+
+  if (firstLine.back() <
+      std::max(vertexBegin + nVertices, faceBegin + nFaces)) {
+    throw std::invalid_argument("Unexpected end of file");
+  }
+
+  // Pass 2: parse vertices and faces
+  std::vector<std::vector<Index>> chunkTriangles(nChunks);
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    auto line = firstLine[c];
+    std::vector<Index> polygon;
+    forEachContentLine(chunks[c], [&](std::string_view text) {
+      if (line >= vertexBegin && line < vertexBegin + nVertices) {
+        parseVertex(line - vertexBegin, text);
+      } else if (line >= faceBegin && line < faceBegin + nFaces) {
+        polygon.clear();
+        parseFace(text, polygon);
+        triangulate(polygon, chunkTriangles[c]);
+      }
+      ++line;
+    });
+  });
+
+  std::vector<Index> indices;
+  gatherTriangles(chunkTriangles, indices);
+  return indices;
+}
+
+// MARK: - OFF
+
+template <class T> MeshFileData<T> readOFF(std::string_view text) {
+  TextCursor cursor{text};
+
+  auto const nextContentLine = [&cursor]() {
+    while (!cursor.atEnd()) {
+      auto line = cursor.nextLine();
+      auto const first = line.find_first_not_of(" \t\r");
+      if (first != std::string_view::npos && line[first] != '#') {
+        return line.substr(first);
+      }
+    }
+    throw std::invalid_argument("Unexpected end of file");
+  };
+
+  // Header keyword, e.g. OFF, COFF, NOFF, CNOFF
+  auto const headerLine = nextContentLine();
+  auto const keyword = headerLine.substr(0, headerLine.find_first_of(" \t"));
+  if (keyword.size() < 3 || keyword.substr(keyword.size() - 3) != "OFF") {
+    throw std::invalid_argument("Missing OFF header");
+  }
+  auto const prefix = keyword.substr(0, keyword.size() - 3);
+  auto const hasColors = prefix.find('C') != std::string_view::npos;
+  auto const hasNormals = prefix.find('N') != std::string_view::npos;
+
+  // Element counts might follow the keyword in the same line
+  TextCursor countCursor{headerLine.substr(keyword.size())};
+  if (!countCursor.hasToken()) countCursor = TextCursor{nextContentLine()};
+
+  auto const nVertices = countCursor.parse<std::size_t>();
+  auto const nFaces = countCursor.parse<std::size_t>();
+
+  MeshFileData<T> data;
+  data.vertices.resize(3 * nVertices);
+  if (hasColors) data.colors.resize(3 * nVertices);
+
+  auto const body =
+      text.substr(static_cast<std::size_t>(cursor.position() - text.data()));
+
+  data.indices = parseLineBlocks(
+      body, 0, nVertices, nVertices, nFaces,
+      [&data, hasColors, hasNormals](std::size_t i, std::string_view line) {
+        TextCursor values{line};
+        values.parse(data.vertices[3 * i]);
+        values.parse(data.vertices[3 * i + 1]);
+        values.parse(data.vertices[3 * i + 2]);
+        if (hasNormals) {
+          for (auto k = 0; k < 3; ++k) values.skipToken();
+        }
+        if (hasColors) {
+          values.parse(data.colors[3 * i]);
+          values.parse(data.colors[3 * i + 1]);
+          values.parse(data.colors[3 * i + 2]);
+        }
+      },
+      [](std::string_view line, std::vector<Index> &polygon) {
+        TextCursor values{line};
+        polygon.resize(values.parse<std::size_t>());
+        for (auto &index : polygon) values.parse(index);
+      });
+
+  normalizeColors(data.colors);
+
+  return data;
+}
+
+// MARK: - OBJ
+
+template <class T> MeshFileData<T> readOBJ(std::string_view text) {
+  auto const chunks = splitAtLines(text, parallelChunkCount(text.size()));
+  auto const nChunks = chunks.size();
+
+  auto const isVertex = [](std::string_view line) {
+    return line.size() > 1 && line[0] == 'v' &&
+           (line[1] == ' ' || line[1] == '\t');
+  };
+  auto const isFace = [](std::string_view line) {
+    return line.size() > 1 && line[0] == 'f' &&
+           (line[1] == ' ' || line[1] == '\t');
+  };
+
+  // Pass 1: count vertices and triangles in each chunk
+  std::vector<std::size_t> vertexOffsets(nChunks + 1, 0);
+  std::vector<std::size_t> indexOffsets(nChunks + 1, 0);
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    forEachContentLine(chunks[c], [&](std::string_view line) {
+      if (isVertex(line)) {
+        ++vertexOffsets[c + 1];
+      } else if (isFace(line)) {
+        TextCursor tokens{line.substr(1)};
+        std::size_t n = 0;
+        while (tokens.hasToken()) {
+          tokens.skipToken();
+          ++n;
+        }
+        if (n < 3) {
+          throw std::invalid_argument("Face with less than 3 vertices");
+        }
+        indexOffsets[c + 1] += 3 * (n - 2);
+      }
+    });
+  });
+  std::partial_sum(vertexOffsets.cbegin(), vertexOffsets.cend(),
+                   vertexOffsets.begin());
+  std::partial_sum(indexOffsets.cbegin(), indexOffsets.cend(),
+                   indexOffsets.begin());
+
+  MeshFileData<T> data;
+  data.vertices.resize(3 * vertexOffsets.back());
+  data.indices.resize(indexOffsets.back());
+
+  // Pass 2: parse in place
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    auto vertex = vertexOffsets[c];
+    auto *out = data.indices.data() + indexOffsets[c];
+    std::vector<Index> polygon;
+
+    forEachContentLine(chunks[c], [&](std::string_view line) {
+      if (isVertex(line)) {
+        TextCursor values{line.substr(1)};
+        values.parse(data.vertices[3 * vertex]);
+        values.parse(data.vertices[3 * vertex + 1]);
+        values.parse(data.vertices[3 * vertex + 2]);
+        ++vertex;
+      } else if (isFace(line)) {
+        TextCursor values{line.substr(1)};
+        polygon.clear();
+        while (values.hasToken()) {
+          // Only the vertex index of v/vt/vn triplets is used
+          auto const *tokenBegin = values.position();
+          values.skipToken();
+          auto const index =
+              TextCursor{tokenBegin, values.position()}.parse<Index>();
+          // Negative indices are relative to the current vertex count
+          polygon.push_back(index < 0 ? static_cast<Index>(vertex) + index
+                                      : index - 1);
+        }
+        for (auto k = 1u; k + 1 < polygon.size(); ++k) {
+          *out++ = polygon[0];
+          *out++ = polygon[k];
+          *out++ = polygon[k + 1];
+        }
+      }
+    });
+  });
+
+  return data;
+}
+
+// MARK: - PLY
+
+enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+enum class PlyType {
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct PlyProperty {
+  std::string name;
+  PlyType type;
+  bool isList = false;
+  PlyType countType = PlyType::UInt8;
+};
+
+struct PlyElement {
+  std::string name;
+  std::size_t count = 0;
+  std::vector<PlyProperty> properties;
+
+  /// Size of a record in bytes, 0 if the element has list properties
+  std::size_t recordSize() const;
+};
+#pragma clang diagnostic pop
+
+PlyType parsePlyType(std::string_view name) {
+  if (name == "char" || name == "int8") return PlyType::Int8;
+  if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+  if (name == "short" || name == "int16") return PlyType::Int16;
+  if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+  if (name == "int" || name == "int32") return PlyType::Int32;
+  if (name == "uint" || name == "uint32") return PlyType::UInt32;
+  if (name == "float" || name == "float32") return PlyType::Float32;
+  if (name == "double" || name == "float64") return PlyType::Float64;
+  throw std::invalid_argument("Unknown PLY type '" + std::string{name} + "'");
+}
+
+std::size_t plyTypeSize(PlyType type) {
+  switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8: return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16: return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32: return 4;
+    case PlyType::Float64: return 8;
+  }
+  return 0;
+}
+
+bool isFloatingPoint(PlyType type) {
+  return type == PlyType::Float32 || type == PlyType::Float64;
+}
+
+std::size_t PlyElement::recordSize() const {
+  std::size_t size = 0;
+  for (auto const &property : properties) {
+    if (property.isList) return 0;
+    size += plyTypeSize(property.type);
+  }
+  return size;
+}
+
+template <class Stored>
+inline Stored loadBinary(char const *ptr, bool bigEndian) {
+  if (!bigEndian) return loadLittleEndian<Stored>(ptr);
+
+  unsigned char bytes[sizeof(Stored)];
+  std::memcpy(bytes, ptr, sizeof(Stored));
+  std::reverse(bytes, bytes + sizeof(Stored));
+  return loadLittleEndian<Stored>(bytes);
+}
+
+/// Reads a binary PLY scalar and converts it to double
+double loadPlyScalar(char const *ptr, PlyType type, bool bigEndian) {
+  switch (type) {
+    case PlyType::Int8: return loadBinary<std::int8_t>(ptr, bigEndian);
+    case PlyType::UInt8: return loadBinary<std::uint8_t>(ptr, bigEndian);
+    case PlyType::Int16: return loadBinary<std::int16_t>(ptr, bigEndian);
+    case PlyType::UInt16: return loadBinary<std::uint16_t>(ptr, bigEndian);
+    case PlyType::Int32: return loadBinary<std::int32_t>(ptr, bigEndian);
+    case PlyType::UInt32: return loadBinary<std::uint32_t>(ptr, bigEndian);
+    case PlyType::Float32: return double(loadBinary<float>(ptr, bigEndian));
+    case PlyType::Float64: return loadBinary<double>(ptr, bigEndian);
+  }
+  return 0;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/// Roles of the vertex and face properties that are used
+struct PlyLayout {
+  static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+  std::size_t vertexElement = none;
+  std::size_t faceElement = none;
+  std::array<std::size_t, 3> position = {{none, none, none}};
+  std::array<std::size_t, 3> color = {{none, none, none}};
+  std::size_t label = none;
+  std::size_t faceIndices = none;
+
+  bool hasColors() const noexcept { return color[0] != none; }
+};
+#pragma clang diagnostic pop
+
+PlyLayout plyLayout(std::vector<PlyElement> const &elements) {
+  PlyLayout layout;
+
+  for (auto e = 0u; e < elements.size(); ++e) {
+    auto const &element = elements[e];
+    auto const &props = element.properties;
+
+    if (element.name == "vertex") {
+      layout.vertexElement = e;
+      for (auto p = 0u; p < props.size(); ++p) {
+        auto const &name = props[p].name;
+        if (name == "x") layout.position[0] = p;
+        if (name == "y") layout.position[1] = p;
+        if (name == "z") layout.position[2] = p;
+        if (name == "red" || name == "diffuse_red") layout.color[0] = p;
+        if (name == "green" || name == "diffuse_green") layout.color[1] = p;
+        if (name == "blue" || name == "diffuse_blue") layout.color[2] = p;
+        if (name == "label") layout.label = p;
+      }
+    } else if (element.name == "face") {
+      layout.faceElement = e;
+      for (auto p = 0u; p < props.size(); ++p) {
+        if (props[p].isList && (props[p].name == "vertex_indices" ||
+                                props[p].name == "vertex_index")) {
+          layout.faceIndices = p;
+        }
+      }
+    }
+  }
+
+  if (layout.vertexElement == PlyLayout::none ||
+      std::find(layout.position.cbegin(), layout.position.cend(),
+                PlyLayout::none) != layout.position.cend()) {
+    throw std::invalid_argument("PLY file has no vertex positions");
+  }
+  if (layout.faceElement == PlyLayout::none ||
+      layout.faceIndices == PlyLayout::none) {
+    throw std::invalid_argument("PLY file has no faces");
+  }
+  if (std::find(layout.color.cbegin(), layout.color.cend(), PlyLayout::none) !=
+      layout.color.cend()) {
+    layout.color = {{PlyLayout::none, PlyLayout::none, PlyLayout::none}};
+  }
+
+  return layout;
+}
+
+/// Stores the value of vertex property `p` of vertex `i`
+template <class T>
+inline void storeVertexProperty(MeshFileData<T> &data, PlyLayout const &layout,
+                                std::size_t i, std::size_t p, double value,
+                                PlyType type) {
+  for (auto k = 0u; k < 3; ++k) {
+    if (p == layout.position[k]) {
+      data.vertices[3 * i + k] = static_cast<T>(value);
+    } else if (p == layout.color[k]) {
+      data.colors[3 * i + k] = isFloatingPoint(type) ? value : value / 255.0;
+    }
+  }
+  if (p == layout.label) data.labels[i] = static_cast<Label>(value);
+}
+
+/**
+ * @brief Reads a binary record of the given element
+ *
+ * @return pointer past the end of the record
+ */
+template <class ScalarF, class ListF>
+char const *readPlyRecord(char const *ptr, char const *end,
+                          PlyElement const &element, bool bigEndian,
+                          ScalarF &&onScalar, ListF &&onList) {
+  auto const require = [ptr, end](std::size_t offset) {
+    if (offset > static_cast<std::size_t>(end - ptr)) {
+      throw std::invalid_argument("Unexpected end of file");
+    }
+  };
+
+  std::size_t offset = 0;
+  for (auto p = 0u; p < element.properties.size(); ++p) {
+    auto const &property = element.properties[p];
+    if (property.isList) {
+      require(offset + plyTypeSize(property.countType));
+      auto const count = static_cast<std::size_t>(
+          loadPlyScalar(ptr + offset, property.countType, bigEndian));
+      offset += plyTypeSize(property.countType);
+      require(offset + count * plyTypeSize(property.type));
+      onList(p, count, ptr + offset);
+      offset += count * plyTypeSize(property.type);
+    } else {
+      require(offset + plyTypeSize(property.type));
+      onScalar(p, loadPlyScalar(ptr + offset, property.type, bigEndian));
+      offset += plyTypeSize(property.type);
+    }
+  }
+  return ptr + offset;
+}
+
+template <class T>
+void readPlyBinary(std::string_view body,
+                   std::vector<PlyElement> const &elements,
+                   PlyLayout const &layout, bool bigEndian,
+                   MeshFileData<T> &data) {
+  auto const *ptr = body.data();
+  auto const *end = body.data() + body.size();
+
+  for (auto e = 0u; e < elements.size(); ++e) {
+    auto const &element = elements[e];
+    auto const recordSize = element.recordSize();
+    auto const ignoreScalar = [](std::size_t, double) {};
+    auto const ignoreList = [](std::size_t, std::size_t, char const *) {};
+
+    if (e == layout.vertexElement && recordSize > 0) {
+      // Fixed size records are parsed in parallel
+      if (element.count * recordSize > static_cast<std::size_t>(end - ptr)) {
+        throw std::invalid_argument("Unexpected end of file");
+      }
+      auto const nChunks = parallelChunkCount(element.count * recordSize);
+      auto const chunkSize = (element.count + nChunks - 1) / nChunks;
+      parallelForEachChunk(nChunks, [&](std::size_t c) {
+        auto const first = c * chunkSize;
+        auto const last = std::min(element.count, first + chunkSize);
+        for (auto i = first; i < last; ++i) {
+          auto const &props = element.properties;
+          readPlyRecord(
+              ptr + i * recordSize, end, element, bigEndian,
+              [&](std::size_t p, double value) {
+                storeVertexProperty(data, layout, i, p, value, props[p].type);
+              },
+              ignoreList);
+        }
+      });
+      ptr += element.count * recordSize;
+    } else if (e == layout.vertexElement) {
+      for (auto i = 0u; i < element.count; ++i) {
+        ptr = readPlyRecord(
+            ptr, end, element, bigEndian,
+            [&](std::size_t p, double value) {
+              storeVertexProperty(data, layout, i, p, value,
+                                  element.properties[p].type);
+            },
+            ignoreList);
+      }
+    } else if (e == layout.faceElement) {
+      std::vector<Index> polygon;
+      auto const indexType = element.properties[layout.faceIndices].type;
+      auto const indexSize = plyTypeSize(indexType);
+      data.indices.reserve(3 * element.count);
+      for (auto i = 0u; i < element.count; ++i) {
+        ptr = readPlyRecord(
+            ptr, end, element, bigEndian, ignoreScalar,
+            [&](std::size_t p, std::size_t count, char const *items) {
+              if (p != layout.faceIndices) return;
+              polygon.resize(count);
+              for (auto k = 0u; k < count; ++k) {
+                polygon[k] = static_cast<Index>(
+                    loadPlyScalar(items + k * indexSize, indexType, bigEndian));
+              }
+              triangulate(polygon, data.indices);
+            });
+      }
+    } else if (recordSize > 0) {
+      if (element.count * recordSize > static_cast<std::size_t>(end - ptr)) {
+        throw std::invalid_argument("Unexpected end of file");
+      }
+      ptr += element.count * recordSize;
+    } else {
+      for (auto i = 0u; i < element.count; ++i) {
+        ptr = readPlyRecord(ptr, end, element, bigEndian, ignoreScalar,
+                            ignoreList);
+      }
+    }
+  }
+}
+
+template <class T>
+void readPlyAscii(std::string_view body,
+                  std::vector<PlyElement> const &elements,
+                  PlyLayout const &layout, MeshFileData<T> &data) {
+  // Each element record is one line
+  std::vector<std::size_t> firstLine(elements.size() + 1, 0);
+  for (auto e = 0u; e < elements.size(); ++e) {
+    firstLine[e + 1] = firstLine[e] + elements[e].count;
+  }
+
+  auto const &vertexElement = elements[layout.vertexElement];
+  auto const &faceElement = elements[layout.faceElement];
+
+  data.indices = parseLineBlocks(
+      body, firstLine[layout.vertexElement], vertexElement.count,
+      firstLine[layout.faceElement], faceElement.count,
+      [&data, &layout, &vertexElement](std::size_t i, std::string_view line) {
+        TextCursor values{line};
+        auto const &props = vertexElement.properties;
+        for (auto p = 0u; p < props.size(); ++p) {
+          if (props[p].isList) {
+            auto const count = values.parse<std::size_t>();
+            for (auto k = 0u; k < count; ++k) values.skipToken();
+          } else {
+            storeVertexProperty(data, layout, i, p, values.parse<double>(),
+                                props[p].type);
+          }
+        }
+      },
+      [&layout, &faceElement](std::string_view line,
+                              std::vector<Index> &polygon) {
+        TextCursor values{line};
+        auto const &props = faceElement.properties;
+        for (auto p = 0u; p < props.size(); ++p) {
+          if (!props[p].isList) {
+            values.skipToken();
+            continue;
+          }
+          auto const count = values.parse<std::size_t>();
+          if (p == layout.faceIndices) {
+            polygon.resize(count);
+            for (auto &index : polygon) index = values.parse<Index>();
+          } else {
+            for (auto k = 0u; k < count; ++k) values.skipToken();
+          }
+        }
+      });
+}
+
+template <class T> MeshFileData<T> readPLY(std::string_view text) {
+  TextCursor header{text};
+
+  if (header.nextLine() != "ply") {
+    throw std::invalid_argument("Missing PLY header");
+  }
+
+  auto format = PlyFormat::Ascii;
+  std::vector<PlyElement> elements;
+
+  auto const token = [](TextCursor &cursor) {
+    cursor.skipBlanks();
+    auto const *begin = cursor.position();
+    cursor.skipToken();
+    return std::string_view{
+        begin, static_cast<std::size_t>(cursor.position() - begin)};
+  };
+
+  while (true) {
+    if (header.atEnd()) throw std::invalid_argument("Missing end_header");
+
+    TextCursor line{header.nextLine()};
+    auto const keyword = token(line);
+
+    if (keyword == "end_header") break;
+
+    if (keyword == "format") {
+      auto const name = token(line);
+      if (name == "ascii") {
+        format = PlyFormat::Ascii;
+      } else if (name == "binary_little_endian") {
+        format = PlyFormat::BinaryLittleEndian;
+      } else if (name == "binary_big_endian") {
+        format = PlyFormat::BinaryBigEndian;
+      } else {
+        throw std::invalid_argument("Unknown PLY format '" +
+                                    std::string{name} + "'");
+      }
+    } else if (keyword == "element") {
+      PlyElement element;
+      element.name = std::string{token(line)};
+      line.parse(element.count);
+      elements.push_back(std::move(element));
+    } else if (keyword == "property") {
+      if (elements.empty()) {
+        throw std::invalid_argument("PLY property without element");
+      }
+      PlyProperty property;
+      auto const type = token(line);
+      if (type == "list") {
+        property.isList = true;
+        property.countType = parsePlyType(token(line));
+        property.type = parsePlyType(token(line));
+      } else {
+        property.type = parsePlyType(type);
+      }
+      property.name = std::string{token(line)};
+      elements.back().properties.push_back(std::move(property));
+    }
+    // comments and obj_info lines are ignored
+  }
+
+  auto const layout = plyLayout(elements);
+  auto const nVertices = elements[layout.vertexElement].count;
+
+  MeshFileData<T> data;
+  data.vertices.resize(3 * nVertices);
+  if (layout.hasColors()) data.colors.resize(3 * nVertices);
+  if (layout.label != PlyLayout::none) data.labels.resize(nVertices);
+
+  auto const body =
+      text.substr(static_cast<std::size_t>(header.position() - text.data()));
+
+  if (format == PlyFormat::Ascii) {
+    readPlyAscii(body, elements, layout, data);
+  } else {
+    readPlyBinary(body, elements, layout,
+                  format == PlyFormat::BinaryBigEndian, data);
+  }
+
+  return data;
+}
+
+// MARK: - Labels
+
+std::vector<Label> readLabels(std::string_view text, std::size_t nLabels) {
+  auto const chunks = splitAtLines(text, parallelChunkCount(text.size()));
+  auto const nChunks = chunks.size();
+
+  auto const forEachToken = [](std::string_view chunk, auto &&f) {
+    TextCursor cursor{chunk};
+    cursor.skipWhitespace();
+    while (!cursor.atEnd()) {
+      f(cursor);
+      cursor.skipWhitespace();
+    }
+  };
+
+  // Pass 1: count labels per chunk
+  std::vector<std::size_t> offsets(nChunks + 1, 0);
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    forEachToken(chunks[c], [&](TextCursor &cursor) {
+      cursor.skipToken();
+      ++offsets[c + 1];
+    });
+  });
+  std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+
+  if (offsets.back() < nLabels) {
+    throw std::invalid_argument("File contains only " +
+                                std::to_string(offsets.back()) + " labels");
+  }
+
+  // Pass 2: parse in place, superfluous labels are ignored
+  std::vector<Label> labels(nLabels);
+  parallelForEachChunk(nChunks, [&](std::size_t c) {
+    auto i = offsets[c];
+    forEachToken(chunks[c], [&](TextCursor &cursor) {
+      if (i < nLabels) {
+        cursor.parse(labels[i++]);
+      } else {
+        cursor.skipToken();
+      }
+    });
+  });
+
+  return labels;
+}
+
+} // anonymous namespace
+
+template <class T> MeshFileData<T> readMeshFile(std::string const &filename) {
+  auto const extension = IO::extension(filename, true);
+
+  try {
+    MappedFile const file{filename};
+
+    auto data = [&]() {
+      if (extension == "off" || extension == "coff") {
+        return readOFF<T>(file.view());
+      }
+      if (extension == "obj") { return readOBJ<T>(file.view()); }
+      if (extension == "ply") { return readPLY<T>(file.view()); }
+      throw std::invalid_argument("Unsupported file format '" + extension +
+                                  "'");
+    }();
+
+    auto const nVertices = gsl::narrow<Index>(data.vertexCount());
+    if (std::any_of(data.indices.cbegin(), data.indices.cend(),
+                    [nVertices](Index i) { return i < 0 || i >= nVertices; })) {
+      throw std::invalid_argument("Vertex index out of range");
+    }
+
+    return data;
+  } catch (std::invalid_argument const &e) {
+    throw std::invalid_argument("Failed to read mesh from file '" + filename +
+                                "': " + e.what());
+  }
+}
+
+std::vector<typename Mesh<float>::Label>
+readLabelFile(std::string const &filename, std::size_t nVertices) {
+  std::optional<MappedFile> file;
+  try {
+    file.emplace(filename);
+  } catch (std::invalid_argument const &) {
+    throw std::invalid_argument("Failed to read labels form file '" +
+                                filename + "'");
+  }
+
+  try {
+    return readLabels(file->view(), nVertices);
+  } catch (std::invalid_argument const &e) {
+    throw std::invalid_argument(
+        "Failed to read labels from file '" + filename +
+        "', maybe the files does not contain the right number of labels (" +
+        std::to_string(nVertices) + "): " + e.what());
+  }
+}
+
+template <class T>
+void writeToPLY(Mesh<T> const &mesh, std::string const &filename,
+                LabelToColorMap<double, typename Mesh<T>::Label> const
+                    *labelMap) {
+  using gsl::narrow_cast;
+
+  std::ofstream out{filename, std::ios::binary};
+  if (!out) {
+    throw std::invalid_argument("Failed to write mesh to file '" + filename +
+                                "'");
+  }
+
+  auto const nVertices = mesh.vertexCount();
+  auto const nTriangles = mesh.triangleCount();
+  char const *scalarType = std::is_same<T, float>::value ? "float" : "double";
+
+  out << "ply\n"
+      << "format binary_little_endian 1.0\n"
+      << "element vertex " << nVertices << '\n'
+      << "property " << scalarType << " x\n"
+      << "property " << scalarType << " y\n"
+      << "property " << scalarType << " z\n";
+  if (labelMap) {
+    out << "property uchar red\n"
+        << "property uchar green\n"
+        << "property uchar blue\n";
+  }
+  out << "property uint label\n"
+      << "element face " << nTriangles << '\n'
+      << "property list uchar int vertex_indices\n"
+      << "end_header\n";
+
+  // Vertex records
+  auto const recordSize =
+      3 * sizeof(T) + (labelMap ? 3 : 0) + sizeof(std::uint32_t);
+  std::vector<unsigned char> buffer(nVertices * recordSize);
+
+  mesh.withUnsafeVertexPointer([&](T const *vertices) {
+    mesh.withUnsafeLabelPointer([&](auto const *labels) {
+      for (auto i = 0u; i < nVertices; ++i) {
+        auto *record = buffer.data() + i * recordSize;
+        for (auto k = 0u; k < 3; ++k) {
+          storeLittleEndian<T>(record + k * sizeof(T), vertices[3 * i + k]);
+        }
+        record += 3 * sizeof(T);
+
+        if (labelMap) {
+          auto const color = (*labelMap)(labels[i]);
+          for (auto k = 0u; k < 3; ++k) {
+            *record++ = narrow_cast<unsigned char>(
+                std::clamp(color[k], 0.0, 1.0) * 255.0 + 0.5);
+          }
+        }
+        storeLittleEndian<std::uint32_t>(record, labels[i]);
+      }
+    });
+  });
+  out.write(reinterpret_cast<char const *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size()));
+
+  // Face records
+  constexpr auto faceSize = 1 + 3 * sizeof(std::int32_t);
+  buffer.resize(nTriangles * faceSize);
+  mesh.withUnsafeIndexPointer([&](auto const *indices) {
+    for (auto f = 0u; f < nTriangles; ++f) {
+      auto *record = buffer.data() + f * faceSize;
+      *record++ = 3;
+      for (auto k = 0u; k < 3; ++k) {
+        storeLittleEndian<std::int32_t>(
+            record + k * sizeof(std::int32_t),
+            gsl::narrow<std::int32_t>(indices[3 * f + k]));
+      }
+    }
+  });
+  out.write(reinterpret_cast<char const *>(buffer.data()),
+            static_cast<std::streamsize>(buffer.size()));
+
+  if (!out) {
+    throw std::invalid_argument("Failed to write mesh to file '" + filename +
+                                "'");
+  }
+}
+
+/*************************************
+ * Explicit template instanciations
+ */
+
+template MeshFileData<float> readMeshFile(std::string const &);
+template MeshFileData<double> readMeshFile(std::string const &);
+
+template void
+writeToPLY(Mesh<float> const &, std::string const &,
+           LabelToColorMap<double, typename Mesh<float>::Label> const *);
+template void
+writeToPLY(Mesh<double> const &, std::string const &,
+           LabelToColorMap<double, typename Mesh<double>::Label> const *);
+
+} // namespace Internal
+} // namespace CortidQCT
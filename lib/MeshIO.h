@@ -0,0 +1,105 @@
+/**
+ * @file      MeshIO.h
+ *
+ * @brief     This file contains the definition of the native mesh file
+ * readers and writers.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "LabelToColorMap.h"
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Raw mesh data as read from a mesh file
+ *
+ * The storage layout is the same as in Mesh, so that the vectors can be moved
+ * into a Mesh object without copying.
+ */
+template <class T> struct MeshFileData {
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  /// Vertex positions [x0, y0, z0, x1, ...]
+  std::vector<T> vertices;
+  /// Triangle indices [i00, i01, i02, i10, ...], polygons are triangulated
+  std::vector<Index> indices;
+  /// Per-vertex RGB colors in [0, 1], empty if the file has no colors
+  std::vector<double> colors;
+  /// Per-vertex labels, empty if the file has no labels
+  std::vector<Label> labels;
+
+  inline std::size_t vertexCount() const noexcept {
+    return vertices.size() / 3;
+  }
+  inline std::size_t triangleCount() const noexcept {
+    return indices.size() / 3;
+  }
+};
+#pragma clang diagnostic pop
+
+/// True iff there is a native reader for the given (lower case) extension
+inline bool hasNativeMeshReader(std::string const &extension) {
+  return extension == "off" || extension == "coff" || extension == "obj" ||
+         extension == "ply";
+}
+
+/**
+ * @brief Reads a mesh from an OFF, COFF, OBJ or PLY file
+ *
+ * The file is memory mapped and large files are parsed in parallel chunks.
+ * PLY files may be ASCII or binary (little and big endian). A per-vertex
+ * `label` property in PLY files is read into `MeshFileData::labels`.
+ *
+ * @param filename path to the mesh file
+ * @throws std::invalid_argument if the file could not be read or parsed
+ */
+template <class T> MeshFileData<T> readMeshFile(std::string const &filename);
+
+/**
+ * @brief Reads `nVertices` whitespace separated labels from the given file
+ *
+ * @throws std::invalid_argument if the file could not be read or contains
+ * less than `nVertices` labels
+ */
+std::vector<typename Mesh<float>::Label>
+readLabelFile(std::string const &filename, std::size_t nVertices);
+
+/**
+ * @brief Writes the mesh to a binary little endian PLY file
+ *
+ * Per-vertex labels are stored in the `label` vertex property. If `labelMap`
+ * is not null, per-vertex colors are written as well.
+ *
+ * @throws std::invalid_argument if the file could not be written
+ */
+template <class T>
+void writeToPLY(Mesh<T> const &mesh, std::string const &filename,
+                LabelToColorMap<double, typename Mesh<T>::Label> const
+                    *labelMap = nullptr);
+
+extern template MeshFileData<float> readMeshFile(std::string const &);
+extern template MeshFileData<double> readMeshFile(std::string const &);
+
+extern template void
+writeToPLY(Mesh<float> const &, std::string const &,
+           LabelToColorMap<double, typename Mesh<float>::Label> const *);
+extern template void
+writeToPLY(Mesh<double> const &, std::string const &,
+           LabelToColorMap<double, typename Mesh<double>::Label> const *);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,254 @@
+/**
+ * @file      MeshReordering.cpp
+ *
+ * @brief     Implementation of the vertex orderings
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshReordering.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+/// Number of bits per axis of the Hilbert curve
+constexpr unsigned hilbertBits = 16;
+
+/**
+ * @brief Index of the given grid point along a 3D Hilbert curve
+ *
+ * Uses the transpose representation by J. Skilling, "Programming the Hilbert
+ * curve", AIP Conference Proceedings 707, 2004.
+ */
+inline std::uint64_t hilbertIndex(std::array<std::uint32_t, 3> X) {
+  auto const M = std::uint32_t{1} << (hilbertBits - 1);
+
+  // Inverse undo
+  for (auto Q = M; Q > 1; Q >>= 1) {
+    auto const P = Q - 1;
+    for (auto &x : X) {
+      if ((x & Q) != 0) {
+        X[0] ^= P;
+      } else {
+        auto const t = (X[0] ^ x) & P;
+        X[0] ^= t;
+        x ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+  X[1] ^= X[0];
+  X[2] ^= X[1];
+  std::uint32_t t = 0;
+  for (auto Q = M; Q > 1; Q >>= 1) {
+    if ((X[2] & Q) != 0) t ^= Q - 1;
+  }
+  for (auto &x : X) { x ^= t; }
+
+  // Interleave the transposed bits
+  std::uint64_t index = 0;
+  for (auto bit = static_cast<int>(hilbertBits) - 1; bit >= 0; --bit) {
+    for (auto const x : X) { index = (index << 1) | ((x >> bit) & 1u); }
+  }
+  return index;
+}
+
+template <class T, class Index>
+std::vector<Index> hilbertCurveOrder(Mesh<T> const &mesh) {
+  using gsl::narrow_cast;
+
+  auto const nV = narrow_cast<Index>(mesh.vertexCount());
+
+  std::vector<std::uint64_t> keys(mesh.vertexCount());
+
+  mesh.withUnsafeVertexPointer([nV, &keys](T const *vertices) {
+    std::array<T, 3> lower, upper;
+    lower.fill(std::numeric_limits<T>::max());
+    upper.fill(std::numeric_limits<T>::lowest());
+    for (Index v = 0; v < nV; ++v) {
+      for (auto k = 0; k < 3; ++k) {
+        lower[k] = std::min(lower[k], vertices[3 * v + k]);
+        upper[k] = std::max(upper[k], vertices[3 * v + k]);
+      }
+    }
+
+    // Uniform scale to keep the curve isotropic
+    auto const extent = std::max(
+        {upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2]});
+    auto const maxCoord = static_cast<T>((1u << hilbertBits) - 1);
+    auto const scale = extent > T{0} ? maxCoord / extent : T{0};
+
+#pragma omp parallel for
+    for (Index v = 0; v < nV; ++v) {
+      std::array<std::uint32_t, 3> X;
+      for (auto k = 0; k < 3; ++k) {
+        auto const q = (vertices[3 * v + k] - lower[k]) * scale;
+        X[k] = static_cast<std::uint32_t>(std::clamp(q, T{0}, maxCoord));
+      }
+      keys[static_cast<std::size_t>(v)] = hilbertIndex(X);
+    }
+  });
+
+  std::vector<Index> order(mesh.vertexCount());
+  std::iota(order.begin(), order.end(), Index{0});
+  std::stable_sort(order.begin(), order.end(), [&keys](Index a, Index b) {
+    return keys[static_cast<std::size_t>(a)] <
+           keys[static_cast<std::size_t>(b)];
+  });
+
+  return order;
+}
+
+template <class Index> class CuthillMcKee {
+public:
+  using Topology = MeshTopology<Index>;
+
+  explicit CuthillMcKee(Topology const &topology)
+      : topology_(topology), visited_(topology.vertexCount(), false),
+        levelStamp_(topology.vertexCount(), 0) {}
+
+  /// Reverse Cuthill-McKee order of all vertices
+  std::vector<Index> order() {
+    auto const nV = static_cast<Index>(topology_.vertexCount());
+
+    std::vector<Index> result;
+    result.reserve(topology_.vertexCount());
+
+    for (Index v = 0; v < nV; ++v) {
+      if (visited_[static_cast<std::size_t>(v)]) continue;
+      visitComponent(pseudoPeripheralVertex(v), result);
+    }
+
+    std::reverse(result.begin(), result.end());
+    return result;
+  }
+
+private:
+  /// Appends the Cuthill-McKee order of the component of `start`
+  void visitComponent(Index start, std::vector<Index> &result) {
+    std::vector<Index> neighbours;
+
+    visited_[static_cast<std::size_t>(start)] = true;
+    auto head = result.size();
+    result.push_back(start);
+
+    while (head < result.size()) {
+      auto const v = result[head++];
+
+      neighbours.clear();
+      for (auto it = topology_.neighboursBegin(v);
+           it != topology_.neighboursEnd(v); ++it) {
+        if (!visited_[static_cast<std::size_t>(*it)]) {
+          visited_[static_cast<std::size_t>(*it)] = true;
+          neighbours.push_back(*it);
+        }
+      }
+
+      std::stable_sort(neighbours.begin(), neighbours.end(),
+                       [this](Index a, Index b) {
+                         return topology_.degree(a) < topology_.degree(b);
+                       });
+      result.insert(result.end(), neighbours.cbegin(), neighbours.cend());
+    }
+  }
+
+  /**
+   * @brief Finds a vertex of (nearly) maximal eccentricity in the component
+   * of `v` (George and Liu)
+   */
+  Index pseudoPeripheralVertex(Index v) {
+    auto current = v;
+    auto eccentricity = bfsDepth(current);
+
+    for (;;) {
+      // Minimum degree vertex of the last level
+      auto candidate = lastLevel_.front();
+      for (auto const u : lastLevel_) {
+        if (topology_.degree(u) < topology_.degree(candidate)) candidate = u;
+      }
+
+      auto const candidateEccentricity = bfsDepth(candidate);
+      if (candidateEccentricity <= eccentricity) return current;
+
+      current = candidate;
+      eccentricity = candidateEccentricity;
+    }
+  }
+
+  /// Depth of the BFS level structure rooted at `root`, stores the last level
+  std::size_t bfsDepth(Index root) {
+    ++stamp_;
+    std::vector<Index> level{root}, next;
+    levelStamp_[static_cast<std::size_t>(root)] = stamp_;
+
+    std::size_t depth = 0;
+    for (;;) {
+      next.clear();
+      for (auto const u : level) {
+        for (auto it = topology_.neighboursBegin(u);
+             it != topology_.neighboursEnd(u); ++it) {
+          auto &mark = levelStamp_[static_cast<std::size_t>(*it)];
+          if (mark != stamp_) {
+            mark = stamp_;
+            next.push_back(*it);
+          }
+        }
+      }
+      if (next.empty()) break;
+      level.swap(next);
+      ++depth;
+    }
+
+    lastLevel_ = std::move(level);
+    return depth;
+  }
+
+  Topology const &topology_;
+  std::vector<bool> visited_;
+  std::vector<std::size_t> levelStamp_;
+  std::vector<Index> lastLevel_;
+  std::size_t stamp_ = 0;
+};
+
+} // anonymous namespace
+
+template <class T>
+std::vector<typename Mesh<T>::Index> vertexOrder(Mesh<T> const &mesh,
+                                                 VertexOrdering ordering) {
+  using Index = typename Mesh<T>::Index;
+
+  switch (ordering) {
+    case VertexOrdering::reverseCuthillMcKee:
+      return CuthillMcKee<Index>{mesh.topology()}.order();
+    case VertexOrdering::hilbertCurve:
+      return hilbertCurveOrder<T, Index>(mesh);
+    case VertexOrdering::original:
+      break;
+  }
+
+  std::vector<Index> identity(mesh.vertexCount());
+  std::iota(identity.begin(), identity.end(), Index{0});
+  return identity;
+}
+
+template std::vector<Mesh<float>::Index> vertexOrder(Mesh<float> const &,
+                                                     VertexOrdering);
+template std::vector<Mesh<double>::Index> vertexOrder(Mesh<double> const &,
+                                                      VertexOrdering);
+
+} // namespace Internal
+} // namespace CortidQCT
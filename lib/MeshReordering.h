@@ -0,0 +1,60 @@
+/**
+ * @file      MeshReordering.h
+ *
+ * @brief     This file contains the computation of cache-friendly vertex
+ * orderings.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+/**
+ * @brief Computes a vertex permutation of the given mesh
+ *
+ * Element `i` of the returned vector is the index of the vertex that is moved
+ * to position `i`.
+ *
+ *   - `VertexOrdering::reverseCuthillMcKee` runs a breadth first search on
+ *     the vertex graph of each connected component, starting at a
+ *     pseudo-peripheral vertex and visiting neighbours by increasing degree.
+ *     The reversed visiting order minimizes the bandwidth of the Laplacian.
+ *   - `VertexOrdering::hilbertCurve` sorts the vertices by the index of their
+ *     quantized position along a 3D Hilbert curve through the bounding box.
+ *   - `VertexOrdering::original` yields the identity.
+ *
+ * @param mesh the mesh
+ * @param ordering the ordering to compute
+ * @return permutation mapping new to old vertex indices
+ */
+template <class T>
+std::vector<typename Mesh<T>::Index> vertexOrder(Mesh<T> const &mesh,
+                                                 VertexOrdering ordering);
+
+extern template std::vector<Mesh<float>::Index>
+vertexOrder(Mesh<float> const &, VertexOrdering);
+extern template std::vector<Mesh<double>::Index>
+vertexOrder(Mesh<double> const &, VertexOrdering);
+
+/// Returns the inverse of the given permutation
+template <class Index>
+std::vector<Index> inversePermutation(std::vector<Index> const &permutation) {
+  std::vector<Index> inverse(permutation.size());
+  for (auto i = 0u; i < permutation.size(); ++i) {
+    inverse[static_cast<std::size_t>(permutation[i])] = static_cast<Index>(i);
+  }
+  return inverse;
+}
+
+} // namespace Internal
+} // namespace CortidQCT
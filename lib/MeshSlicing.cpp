@@ -0,0 +1,288 @@
+/**
+ * @file      MeshSlicing.cpp
+ *
+ * @brief     Implementation of the z-slice bucketing and contour extraction
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshSlicing.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace CortidQCT {
+namespace Internal {
+
+// MARK: - TriangleSlices
+
+template <class T>
+TriangleSlices<T>::TriangleSlices(T const *vertices, Index const *indices,
+                                  std::size_t triangleCount,
+                                  std::size_t sliceCount, double spacing)
+    : spacing_(spacing), offsets_(sliceCount + 1, 0) {
+  using gsl::narrow_cast;
+
+  Expects(spacing > 0.0);
+
+  auto const nF = narrow_cast<Index>(triangleCount);
+  auto const n = static_cast<double>(sliceCount);
+  std::vector<std::array<Index, 2>> ranges(triangleCount);
+
+  for (Index f = 0; f < nF; ++f) {
+    auto zMin = std::numeric_limits<double>::max();
+    auto zMax = std::numeric_limits<double>::lowest();
+    for (auto c = 0; c < 3; ++c) {
+      auto const z = static_cast<double>(vertices[3 * indices[3 * f + c] + 2]);
+      zMin = std::min(zMin, z);
+      zMax = std::max(zMax, z);
+    }
+
+    auto const first = std::clamp(std::ceil(zMin / spacing), 0.0, n);
+    auto const last = std::clamp(std::floor(zMax / spacing), -1.0, n - 1.0);
+    auto &range = ranges[narrow_cast<std::size_t>(f)];
+    range = {{static_cast<Index>(first), static_cast<Index>(last)}};
+
+    for (auto k = range[0]; k <= range[1]; ++k) {
+      ++offsets_[narrow_cast<std::size_t>(k) + 1];
+    }
+  }
+  std::partial_sum(offsets_.cbegin(), offsets_.cend(), offsets_.begin());
+
+  triangles_.resize(narrow_cast<std::size_t>(offsets_.back()));
+  auto next = offsets_;
+  for (Index f = 0; f < nF; ++f) {
+    auto const &range = ranges[narrow_cast<std::size_t>(f)];
+    for (auto k = range[0]; k <= range[1]; ++k) {
+      auto &pos = next[narrow_cast<std::size_t>(k)];
+      triangles_[narrow_cast<std::size_t>(pos++)] = f;
+    }
+  }
+}
+
+template class TriangleSlices<float>;
+template class TriangleSlices<double>;
+
+// MARK: - Contour extraction
+
+namespace {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+template <class T> class ContourTracer {
+public:
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+  using Contour = typename Mesh<T>::Contour;
+
+  /// Mesh edge `(u, v)` with `u < v`
+  using Edge = std::array<Index, 2>;
+
+  /// Intersection of a triangle with the plane, from one edge to another
+  struct Segment {
+    Edge from;
+    Edge to;
+  };
+
+  ContourTracer(T const *vertices, Index const *indices, Label const *labels)
+      : vertices_(vertices), indices_(indices), labels_(labels) {}
+
+  /// Extracts the contours of slice `k`
+  void trace(TriangleSlices<T> const &slices, Index k,
+             std::vector<Contour> &contours) {
+    Z_ = slices.z(k);
+
+    segments_.clear();
+    for (auto t = slices.begin(k); t != slices.end(k); ++t) {
+      addSegment(*t);
+    }
+
+    // Segments sorted by their start edge for the successor lookup and by
+    // their end edge for the predecessor lookup
+    order_.resize(segments_.size());
+    std::iota(order_.begin(), order_.end(), std::size_t{0});
+    std::sort(order_.begin(), order_.end(), [this](auto a, auto b) {
+      return segments_[a].from < segments_[b].from;
+    });
+    ends_.resize(segments_.size());
+    std::transform(segments_.cbegin(), segments_.cend(), ends_.begin(),
+                   [](auto const &s) { return s.to; });
+    std::sort(ends_.begin(), ends_.end());
+    used_.assign(segments_.size(), false);
+
+    // Open polylines start at segments without a predecessor, all remaining
+    // segments form closed loops
+    for (auto s = 0u; s < segments_.size(); ++s) {
+      if (!used_[s] && !std::binary_search(ends_.cbegin(), ends_.cend(),
+                                           segments_[s].from)) {
+        tracePolyline(s, contours);
+      }
+    }
+    for (auto s = 0u; s < segments_.size(); ++s) {
+      if (!used_[s]) { tracePolyline(s, contours); }
+    }
+  }
+
+private:
+  /// Adds the segment of triangle `f` crossing the plane, if any
+  void addSegment(Index f) {
+    std::array<Index, 3> const corner{
+        {indices_[3 * f], indices_[3 * f + 1], indices_[3 * f + 2]}};
+
+    Edge up{{-1, -1}};
+    Edge down{{-1, -1}};
+    for (auto c = 0u; c < 3; ++c) {
+      auto const p = corner[c];
+      auto const q = corner[(c + 1) % 3];
+      auto const pBelow = isBelow(p);
+      auto const qBelow = isBelow(q);
+      if (pBelow && !qBelow) { up = edge(p, q); }
+      if (!pBelow && qBelow) { down = edge(p, q); }
+    }
+
+    // Either both or none of the edges cross the plane
+    if (up[0] < 0) return;
+    segments_.push_back({down, up});
+  }
+
+  /// Chains the unused segments starting at `start` into a polyline
+  void tracePolyline(std::size_t start, std::vector<Contour> &contours) {
+    Contour contour;
+
+    auto const &first = segments_[start].from;
+    appendPoint(first, contour);
+
+    auto current = start;
+    for (;;) {
+      used_[current] = true;
+      auto const &to = segments_[current].to;
+      if (to == first) {
+        contour.isClosed = true;
+        break;
+      }
+      appendPoint(to, contour);
+
+      auto const next = unusedSuccessor(to);
+      if (next == segments_.size()) break;
+      current = next;
+    }
+
+    // Drop the duplicated first point of closed loops through a vertex on
+    // the plane
+    auto const n = contour.pointCount();
+    if (contour.isClosed && n > 1 &&
+        std::equal(contour.points.cend() - 3, contour.points.cend(),
+                   contour.points.cbegin())) {
+      contour.points.resize(3 * (n - 1));
+      contour.labels.pop_back();
+    }
+
+    if (contour.pointCount() > 1) { contours.push_back(std::move(contour)); }
+  }
+
+  /// First unused segment starting at `e` or `segments_.size()` if none
+  std::size_t unusedSuccessor(Edge const &e) const {
+    auto it = std::lower_bound(
+        order_.cbegin(), order_.cend(), e,
+        [this](auto s, auto const &key) { return segments_[s].from < key; });
+    for (; it != order_.cend() && segments_[*it].from == e; ++it) {
+      if (!used_[*it]) return *it;
+    }
+    return segments_.size();
+  }
+
+  /// Appends the intersection of edge `e` with the plane to `contour`
+  void appendPoint(Edge const &e, Contour &contour) const {
+    auto const *a = vertex(e[0]);
+    auto const *b = vertex(e[1]);
+    auto const za = static_cast<double>(a[2]);
+    auto const zb = static_cast<double>(b[2]);
+    auto const t = (Z_ - za) / (zb - za);
+
+    std::array<T, 3> const p{
+        {static_cast<T>(a[0] + t * (b[0] - a[0])),
+         static_cast<T>(a[1] + t * (b[1] - a[1])), static_cast<T>(Z_)}};
+
+    // Vertices on the plane are shared by several edges, skip the duplicates
+    auto const n = contour.pointCount();
+    if (n > 0 && std::equal(p.cbegin(), p.cend(),
+                            contour.points.cbegin() + 3 * (n - 1))) {
+      return;
+    }
+
+    contour.points.insert(contour.points.end(), p.cbegin(), p.cend());
+    contour.labels.push_back(labels_[t < 0.5 ? e[0] : e[1]]);
+  }
+
+  inline bool isBelow(Index v) const noexcept {
+    return static_cast<double>(vertex(v)[2]) < Z_;
+  }
+
+  static inline Edge edge(Index u, Index v) noexcept {
+    return u < v ? Edge{{u, v}} : Edge{{v, u}};
+  }
+
+  inline T const *vertex(Index v) const noexcept { return vertices_ + 3 * v; }
+
+  T const *vertices_;
+  Index const *indices_;
+  Label const *labels_;
+  double Z_ = 0.0;
+
+  std::vector<Segment> segments_;
+  std::vector<std::size_t> order_;
+  std::vector<Edge> ends_;
+  std::vector<bool> used_;
+};
+#pragma clang diagnostic pop
+
+} // anonymous namespace
+
+template <class T>
+std::vector<std::vector<typename Mesh<T>::Contour>>
+sliceMesh(T const *vertices, typename Mesh<T>::Index const *indices,
+          typename Mesh<T>::Label const *labels, std::size_t triangleCount,
+          std::size_t sliceCount, double spacing) {
+  using Index = typename Mesh<T>::Index;
+
+  if (!(spacing > 0.0)) {
+    throw std::invalid_argument("Slice spacing must be positive");
+  }
+
+  std::vector<std::vector<typename Mesh<T>::Contour>> contours(sliceCount);
+  if (sliceCount == 0 || triangleCount == 0) return contours;
+
+  TriangleSlices<T> const slices{vertices, indices, triangleCount, sliceCount,
+                                 spacing};
+  auto const nSlices = slices.sliceCount();
+
+#pragma omp parallel
+  {
+    ContourTracer<T> tracer{vertices, indices, labels};
+
+#pragma omp for schedule(dynamic)
+    for (Index k = 0; k < nSlices; ++k) {
+      tracer.trace(slices, k, contours[gsl::narrow_cast<std::size_t>(k)]);
+    }
+  }
+
+  return contours;
+}
+
+template std::vector<std::vector<Mesh<float>::Contour>>
+sliceMesh(float const *, Mesh<float>::Index const *,
+          Mesh<float>::Label const *, std::size_t, std::size_t, double);
+template std::vector<std::vector<Mesh<double>::Contour>>
+sliceMesh(double const *, Mesh<double>::Index const *,
+          Mesh<double>::Label const *, std::size_t, std::size_t, double);
+
+} // namespace Internal
+} // namespace CortidQCT
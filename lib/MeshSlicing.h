@@ -0,0 +1,117 @@
+/**
+ * @file      MeshSlicing.h
+ *
+ * @brief     This file contains the z-slice bucketing of triangles and the
+ * sweep-based contour extraction.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+/**
+ * @brief Assignment of triangles to the z-planes `z = k * spacing` they
+ * cross
+ *
+ * The triangles of slice `k` are those with `zMin <= k * spacing <= zMax`.
+ * The lists are stored in compressed row format, so the memory is linear in
+ * the total number of (triangle, slice) pairs.
+ *
+ * @tparam T Scalar type of the vertices
+ */
+template <class T> class TriangleSlices {
+public:
+  using Index = typename Mesh<T>::Index;
+
+  /**
+   * @brief Buckets the triangles
+   *
+   * @param vertices vertex positions in `Mesh` storage layout
+   * @param indices triangle indices in `Mesh` storage layout
+   * @param triangleCount number of triangles
+   * @param sliceCount number of z-planes
+   * @param spacing distance of the z-planes, must be positive
+   */
+  TriangleSlices(T const *vertices, Index const *indices,
+                 std::size_t triangleCount, std::size_t sliceCount,
+                 double spacing);
+
+  /// Number of slices
+  inline Index sliceCount() const noexcept {
+    return static_cast<Index>(offsets_.size()) - 1;
+  }
+
+  /// z-coordinate of the plane of slice `k`
+  inline double z(Index k) const noexcept {
+    return static_cast<double>(k) * spacing_;
+  }
+
+  /// Pointer to the first triangle of slice `k`
+  inline Index const *begin(Index k) const noexcept {
+    return triangles_.data() + offsets_[static_cast<std::size_t>(k)];
+  }
+
+  /// Pointer one past the last triangle of slice `k`
+  inline Index const *end(Index k) const noexcept {
+    return triangles_.data() + offsets_[static_cast<std::size_t>(k) + 1];
+  }
+
+private:
+  double spacing_;
+  std::vector<Index> offsets_;
+  std::vector<Index> triangles_;
+};
+
+extern template class TriangleSlices<float>;
+extern template class TriangleSlices<double>;
+
+/**
+ * @brief Intersects a triangle mesh with the planes `z = k * spacing`,
+ * `k = 0, ..., sliceCount - 1`
+ *
+ * The triangles are bucketed by their z-extent once and the slices are
+ * processed in parallel. Within a slice, the crossing segments of the
+ * triangles are chained into polylines via the mesh edges they cross, so
+ * the result does not depend on floating point comparisons of positions.
+ *
+ * Vertices lying exactly on a plane are treated as being above it. On
+ * closed, outward oriented meshes all contours are closed and run
+ * counter-clockwise when viewed from `+z` around the material.
+ *
+ * A contour point gets the label of the nearer endpoint of the crossed edge.
+ *
+ * @param vertices vertex positions in `Mesh` storage layout
+ * @param indices triangle indices in `Mesh` storage layout
+ * @param labels per-vertex labels
+ * @param triangleCount number of triangles
+ * @param sliceCount number of z-planes
+ * @param spacing distance of the z-planes
+ * @return the contours of each slice
+ * @throws std::invalid_argument if the spacing is not positive
+ */
+template <class T>
+std::vector<std::vector<typename Mesh<T>::Contour>>
+sliceMesh(T const *vertices, typename Mesh<T>::Index const *indices,
+          typename Mesh<T>::Label const *labels, std::size_t triangleCount,
+          std::size_t sliceCount, double spacing);
+
+extern template std::vector<std::vector<Mesh<float>::Contour>>
+sliceMesh(float const *, Mesh<float>::Index const *,
+          Mesh<float>::Label const *, std::size_t, std::size_t, double);
+extern template std::vector<std::vector<Mesh<double>::Contour>>
+sliceMesh(double const *, Mesh<double>::Index const *,
+          Mesh<double>::Label const *, std::size_t, std::size_t, double);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,155 @@
+/**
+ * @file      MeshSubdivision.cpp
+ *
+ * @brief     Implementation of the label-aware midpoint subdivision
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshSubdivision.h"
+
+#include <gsl/gsl>
+
+#include <cmath>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+/// Writes the normalized vector `(x, y, z)` to `out`, zero vectors are kept
+template <class T> inline void storeNormalized(T x, T y, T z, T *out) {
+  auto const norm = std::sqrt(x * x + y * y + z * z);
+  auto const scale = norm > T{0} ? T{1} / norm : T{1};
+  out[0] = x * scale;
+  out[1] = y * scale;
+  out[2] = z * scale;
+}
+
+/**
+ * @brief Selects the label of the midpoint of the edge `(a, b)`
+ *
+ * Only the endpoint labels are candidates. If they differ, the corners of the
+ * incident triangles vote.
+ */
+template <class Index, class Label>
+inline Label midpointLabel(MeshTopology<Index> const &topology,
+                           Index const *indices, Label const *labels, Index a,
+                           Index b) {
+  auto const la = labels[a];
+  auto const lb = labels[b];
+  if (la == lb) return la;
+
+  auto votesA = 0;
+  auto votesB = 0;
+  for (auto it = topology.facesBegin(a); it != topology.facesEnd(a); ++it) {
+    auto const *face = indices + 3 * *it;
+    if (face[0] != b && face[1] != b && face[2] != b) continue;
+
+    for (auto k = 0; k < 3; ++k) {
+      auto const label = labels[face[k]];
+      votesA += label == la ? 1 : 0;
+      votesB += label == lb ? 1 : 0;
+    }
+  }
+
+  return votesB > votesA ? lb : la;
+}
+
+} // anonymous namespace
+
+template <class T>
+void midpointSubdivision(typename Mesh<T>::Topology const &topology,
+                         T const *vertices, T const *normals,
+                         typename Mesh<T>::Index const *indices,
+                         typename Mesh<T>::Label const *labels,
+                         SubdividedMesh<T> &result) {
+  using gsl::narrow_cast;
+  using Index = typename Mesh<T>::Index;
+
+  auto const nV = narrow_cast<Index>(topology.vertexCount());
+  auto const nE = narrow_cast<Index>(topology.edgeCount());
+  auto const nF = narrow_cast<Index>(topology.faceIndices().size() / 3);
+  auto const &edges = topology.edges();
+
+  // Output sizes are known exactly: one new vertex per edge, four triangles
+  // per triangle
+  auto const nVOut = narrow_cast<std::size_t>(nV + nE);
+  result.vertices.resize(3 * nVOut);
+  result.normals.resize(3 * nVOut);
+  result.labels.resize(nVOut);
+  result.indices.resize(12 * narrow_cast<std::size_t>(nF));
+
+  auto *outV = result.vertices.data();
+  auto *outN = result.normals.data();
+  auto *outL = result.labels.data();
+  auto *outF = result.indices.data();
+
+  // Original vertices
+#pragma omp parallel for
+  for (Index v = 0; v < nV; ++v) {
+    auto const *p = vertices + 3 * v;
+    auto const *n = normals + 3 * v;
+    outV[3 * v + 0] = p[0];
+    outV[3 * v + 1] = p[1];
+    outV[3 * v + 2] = p[2];
+    storeNormalized(n[0], n[1], n[2], outN + 3 * v);
+    outL[v] = labels[v];
+  }
+
+  // Edge midpoints
+#pragma omp parallel for
+  for (Index e = 0; e < nE; ++e) {
+    auto const &edge = edges[narrow_cast<std::size_t>(e)];
+    auto const *pa = vertices + 3 * edge[0];
+    auto const *pb = vertices + 3 * edge[1];
+    auto const *na = normals + 3 * edge[0];
+    auto const *nb = normals + 3 * edge[1];
+    auto const out = nV + e;
+
+    outV[3 * out + 0] = T{0.5} * (pa[0] + pb[0]);
+    outV[3 * out + 1] = T{0.5} * (pa[1] + pb[1]);
+    outV[3 * out + 2] = T{0.5} * (pa[2] + pb[2]);
+    storeNormalized(na[0] + nb[0], na[1] + nb[1], na[2] + nb[2],
+                    outN + 3 * out);
+    outL[out] = midpointLabel(topology, indices, labels, edge[0], edge[1]);
+  }
+
+  // Split each triangle into four
+#pragma omp parallel for
+  for (Index f = 0; f < nF; ++f) {
+    auto const f0 = indices[3 * f + 0];
+    auto const f1 = indices[3 * f + 1];
+    auto const f2 = indices[3 * f + 2];
+    auto const e0 = nV + topology.edgeIndex(f0, f1);
+    auto const e1 = nV + topology.edgeIndex(f1, f2);
+    auto const e2 = nV + topology.edgeIndex(f2, f0);
+
+    auto const store = [outF](Index face, Index a, Index b, Index c) {
+      outF[3 * face + 0] = a;
+      outF[3 * face + 1] = b;
+      outF[3 * face + 2] = c;
+    };
+    store(f, f0, e0, e2);
+    store(nF + f, f1, e1, e0);
+    store(2 * nF + f, f2, e2, e1);
+    store(3 * nF + f, e0, e1, e2);
+  }
+}
+
+template void midpointSubdivision(Mesh<float>::Topology const &,
+                                  float const *, float const *,
+                                  Mesh<float>::Index const *,
+                                  Mesh<float>::Label const *,
+                                  SubdividedMesh<float> &);
+template void midpointSubdivision(Mesh<double>::Topology const &,
+                                  double const *, double const *,
+                                  Mesh<double>::Index const *,
+                                  Mesh<double>::Label const *,
+                                  SubdividedMesh<double> &);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,79 @@
+/**
+ * @file      MeshSubdivision.h
+ *
+ * @brief     This file contains the definition of the label-aware midpoint
+ * subdivision.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+/// Result of `midpointSubdivision()`, all arrays in `Mesh` storage layout
+template <class T> struct SubdividedMesh {
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  /// Vertex positions
+  std::vector<T> vertices;
+  /// Unit length per-vertex normals
+  std::vector<T> normals;
+  /// Triangle indices
+  std::vector<Index> indices;
+  /// Per-vertex labels
+  std::vector<Label> labels;
+};
+
+/**
+ * @brief Subdivides each triangle into four by inserting edge midpoints
+ *
+ * The original vertices are kept as the first `topology.vertexCount()`
+ * vertices and are not moved. The midpoint of edge `e` of the topology gets
+ * the index `topology.vertexCount() + e`, i.e. the unique edge list serves as
+ * midpoint lookup table and the output sizes are known up front. Triangle
+ * `f` is split into the triangles `f`, `f + M`, `f + 2M` (at its corners)
+ * and `f + 3M` (center), where `M` is the number of triangles.
+ *
+ * Midpoint normals are the normalized mean of the endpoint normals. A
+ * midpoint inherits the label of its endpoints if they agree. Otherwise the
+ * endpoint label that is shared by the majority of the corners of the
+ * triangles incident to the edge is chosen, ties are resolved in favour of
+ * the endpoint with the smaller index.
+ *
+ * All stages run in parallel if OpenMP is available.
+ *
+ * @param topology topology of the input mesh
+ * @param vertices input vertex positions
+ * @param normals input per-vertex normals
+ * @param indices input triangle indices, `3 * M` values
+ * @param labels input per-vertex labels
+ * @param[out] result the subdivided mesh, previous contents are replaced
+ */
+template <class T>
+void midpointSubdivision(typename Mesh<T>::Topology const &topology,
+                         T const *vertices, T const *normals,
+                         typename Mesh<T>::Index const *indices,
+                         typename Mesh<T>::Label const *labels,
+                         SubdividedMesh<T> &result);
+
+extern template void
+midpointSubdivision(Mesh<float>::Topology const &, float const *,
+                    float const *, Mesh<float>::Index const *,
+                    Mesh<float>::Label const *, SubdividedMesh<float> &);
+extern template void
+midpointSubdivision(Mesh<double>::Topology const &, double const *,
+                    double const *, Mesh<double>::Index const *,
+                    Mesh<double>::Label const *, SubdividedMesh<double> &);
+
+} // namespace Internal
+} // namespace CortidQCT
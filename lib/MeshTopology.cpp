@@ -0,0 +1,291 @@
+/**
+ * @file      MeshTopology.cpp
+ *
+ * @brief     Implementation file for the MeshTopology type
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshTopology.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace CortidQCT {
+
+namespace {
+
+/**
+ * @brief Orders the neighbours of a single vertex
+ *
+ * Each incident triangle contributes the pair (next, previous) of the
+ * remaining two corners. Pairs are chained by matching the second element of
+ * one pair with the first element of another. Boundary chains are started at
+ * pairs without a predecessor. Non-manifold configurations result in several
+ * concatenated chains.
+ *
+ * @param pairs pointer to the neighbour pairs of the vertex
+ * @param nPairs number of pairs
+ * @param used scratch buffer with at least `nPairs` elements
+ * @param ringOut output buffer for the ordered ring, must be able to hold `2 *
+ * nPairs` elements
+ * @return number of neighbours written to `ringOut`
+ */
+template <class Index>
+std::size_t orderOneRing(std::array<Index, 2> const *pairs, std::size_t nPairs,
+                         char *used, Index *ringOut) {
+  std::fill(used, used + nPairs, char{0});
+
+  std::size_t ringSize = 0;
+  auto const push = [ringOut, &ringSize](Index i) {
+    if (std::find(ringOut, ringOut + ringSize, i) == ringOut + ringSize) {
+      ringOut[ringSize++] = i;
+    }
+  };
+
+  auto const hasPredecessor = [pairs, nPairs, used](std::size_t k) {
+    for (auto l = 0u; l < nPairs; ++l) {
+      if (!used[l] && l != k && pairs[l][1] == pairs[k][0]) return true;
+    }
+    return false;
+  };
+
+  for (std::size_t remaining = nPairs; remaining > 0;) {
+    // Start a new chain. Prefer pairs without predecessor (boundary) and fall
+    // back to the first unused pair (closed fan).
+    auto start = nPairs;
+    for (auto k = 0u; k < nPairs; ++k) {
+      if (used[k]) continue;
+      if (start == nPairs) start = k;
+      if (!hasPredecessor(k)) {
+        start = k;
+        break;
+      }
+    }
+
+    auto const first = pairs[start][0];
+    auto current = start;
+
+    while (true) {
+      used[current] = 1;
+      --remaining;
+      push(pairs[current][0]);
+
+      auto next = nPairs;
+      for (auto k = 0u; k < nPairs; ++k) {
+        if (!used[k] && pairs[k][0] == pairs[current][1]) {
+          next = k;
+          break;
+        }
+      }
+
+      if (next == nPairs) {
+        // End of an open chain, or the fan has been closed
+        if (pairs[current][1] != first) push(pairs[current][1]);
+        break;
+      }
+      current = next;
+    }
+  }
+
+  return ringSize;
+}
+
+} // anonymous namespace
+
+template <class Index>
+MeshTopology<Index> MeshTopology<Index>::fromTriangles(Index const *indices,
+                                                       Size nTriangles,
+                                                       Size nVertices) {
+  using gsl::narrow_cast;
+  using Pair = std::array<Index, 2>;
+
+  Expects(indices != nullptr || nTriangles == 0);
+
+  auto const nV = narrow_cast<Index>(nVertices);
+  auto const nF = narrow_cast<Index>(nTriangles);
+
+  if (std::any_of(indices, indices + 3 * nTriangles,
+                  [nV](Index i) { return i < 0 || i >= nV; })) {
+    throw std::out_of_range("Triangle vertex index out of range");
+  }
+
+  MeshTopology topology;
+
+  // Vertex-face incidence
+  topology.faceOffsets_.assign(nVertices + 1, Index{0});
+  for (auto k = 0u; k < 3 * nTriangles; ++k) {
+    ++topology.faceOffsets_[narrow_cast<Size>(indices[k]) + 1];
+  }
+  std::partial_sum(topology.faceOffsets_.cbegin(), topology.faceOffsets_.cend(),
+                   topology.faceOffsets_.begin());
+
+  topology.faceIndices_.resize(3 * nTriangles);
+  // (next, previous) corner pair of each incidence entry, used to build the
+  // one-rings
+  std::vector<Pair> pairs(3 * nTriangles);
+  {
+    std::vector<Index> fill(topology.faceOffsets_.cbegin(),
+                            topology.faceOffsets_.cend() - 1);
+    for (Index f = 0; f < nF; ++f) {
+      auto const *tri = indices + 3 * f;
+      for (auto k = 0; k < 3; ++k) {
+        auto const pos = narrow_cast<Size>(fill[narrow_cast<Size>(tri[k])]++);
+        topology.faceIndices_[pos] = f;
+        pairs[pos] = Pair{{tri[(k + 1) % 3], tri[(k + 2) % 3]}};
+      }
+    }
+  }
+
+  // One-rings. Each incident face contributes at most two neighbours, so use
+  // twice the face offsets as scratch offsets and compact afterwards.
+  std::vector<Index> ringScratch(6 * nTriangles);
+  std::vector<Index> ringSizes(nVertices, Index{0});
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wsign-compare"
+#pragma omp parallel
+  {
+    std::vector<char> used;
+#pragma omp for schedule(static)
+    for (Index v = 0; v < nV; ++v) {
+      auto const vs = narrow_cast<Size>(v);
+      auto const begin = narrow_cast<Size>(topology.faceOffsets_[vs]);
+      auto const end = narrow_cast<Size>(topology.faceOffsets_[vs + 1]);
+      used.resize(end - begin);
+      ringSizes[vs] = narrow_cast<Index>(
+          orderOneRing(pairs.data() + begin, end - begin, used.data(),
+                       ringScratch.data() + 2 * begin));
+    }
+  }
+#pragma clang diagnostic pop
+
+  topology.neighbourOffsets_.assign(nVertices + 1, Index{0});
+  std::partial_sum(ringSizes.cbegin(), ringSizes.cend(),
+                   topology.neighbourOffsets_.begin() + 1);
+  topology.neighbourIndices_.resize(
+      narrow_cast<Size>(topology.neighbourOffsets_.back()));
+
+  // Edges grouped by their larger vertex index. Count the smaller neighbours
+  // of each vertex first.
+  topology.edgeOffsets_.assign(nVertices + 1, Index{0});
+  for (Index v = 0; v < nV; ++v) {
+    auto const *ring = ringScratch.data() +
+                       2 * topology.faceOffsets_[narrow_cast<Size>(v)];
+    auto const n = ringSizes[narrow_cast<Size>(v)];
+    topology.edgeOffsets_[narrow_cast<Size>(v) + 1] = narrow_cast<Index>(
+        std::count_if(ring, ring + n, [v](Index u) { return u < v; }));
+  }
+  std::partial_sum(topology.edgeOffsets_.cbegin(), topology.edgeOffsets_.cend(),
+                   topology.edgeOffsets_.begin());
+  topology.edges_.resize(narrow_cast<Size>(topology.edgeOffsets_.back()));
+
+#pragma omp parallel for schedule(static)
+  for (Index v = 0; v < nV; ++v) {
+    auto const vs = narrow_cast<Size>(v);
+    auto const *ring = ringScratch.data() + 2 * topology.faceOffsets_[vs];
+    auto const n = ringSizes[vs];
+
+    std::copy(ring, ring + n,
+              topology.neighbourIndices_.begin() +
+                  topology.neighbourOffsets_[vs]);
+
+    auto edgeIt = topology.edges_.begin() + topology.edgeOffsets_[vs];
+    for (auto k = 0; k < n; ++k) {
+      if (ring[k] < v) { *edgeIt++ = Edge{{ring[k], v}}; }
+    }
+    std::sort(topology.edges_.begin() + topology.edgeOffsets_[vs],
+              topology.edges_.begin() + topology.edgeOffsets_[vs + 1]);
+  }
+
+  return topology;
+}
+
+template <class Index>
+MeshTopology<Index> MeshTopology<Index>::fromAdjacency(
+    std::vector<Edge> edges, std::vector<Index> neighbourOffsets,
+    std::vector<Index> neighbourIndices, std::vector<Index> faceOffsets,
+    std::vector<Index> faceIndices) {
+  using gsl::narrow_cast;
+
+  auto const isValidCSR = [](std::vector<Index> const &offsets,
+                             std::vector<Index> const &indices) {
+    return !offsets.empty() && offsets.front() == 0 &&
+           std::is_sorted(offsets.cbegin(), offsets.cend()) &&
+           narrow_cast<Size>(offsets.back()) == indices.size();
+  };
+
+  if (!isValidCSR(neighbourOffsets, neighbourIndices) ||
+      !isValidCSR(faceOffsets, faceIndices) ||
+      neighbourOffsets.size() != faceOffsets.size()) {
+    throw std::invalid_argument("Inconsistent adjacency offsets");
+  }
+
+  auto const nV = narrow_cast<Index>(neighbourOffsets.size() - 1);
+  if (std::any_of(neighbourIndices.cbegin(), neighbourIndices.cend(),
+                  [nV](Index i) { return i < 0 || i >= nV; })) {
+    throw std::invalid_argument("One-ring vertex index out of range");
+  }
+
+  // Edges must be sorted by their larger, then by their smaller index
+  auto const edgeLess = [](Edge const &lhs, Edge const &rhs) {
+    return std::make_pair(lhs[1], lhs[0]) < std::make_pair(rhs[1], rhs[0]);
+  };
+  if (std::any_of(edges.cbegin(), edges.cend(),
+                  [nV](Edge const &e) {
+                    return e[0] < 0 || e[0] >= e[1] || e[1] >= nV;
+                  }) ||
+      !std::is_sorted(edges.cbegin(), edges.cend(), edgeLess)) {
+    throw std::invalid_argument("Invalid edge list");
+  }
+
+  MeshTopology topology;
+
+  topology.edgeOffsets_.assign(neighbourOffsets.size(), Index{0});
+  for (auto const &edge : edges) {
+    ++topology.edgeOffsets_[narrow_cast<Size>(edge[1]) + 1];
+  }
+  std::partial_sum(topology.edgeOffsets_.cbegin(), topology.edgeOffsets_.cend(),
+                   topology.edgeOffsets_.begin());
+
+  topology.edges_ = std::move(edges);
+  topology.neighbourOffsets_ = std::move(neighbourOffsets);
+  topology.neighbourIndices_ = std::move(neighbourIndices);
+  topology.faceOffsets_ = std::move(faceOffsets);
+  topology.faceIndices_ = std::move(faceIndices);
+
+  return topology;
+}
+
+template <class Index>
+Index MeshTopology<Index>::edgeIndex(Index i, Index j) const noexcept {
+  auto const lo = std::min(i, j);
+  auto const hi = std::max(i, j);
+
+  if (lo < 0 || static_cast<Size>(hi) >= vertexCount()) return Index{-1};
+
+  auto const begin = edges_.cbegin() + edgeOffsets_[static_cast<Size>(hi)];
+  auto const end = edges_.cbegin() + edgeOffsets_[static_cast<Size>(hi) + 1];
+
+  auto const it = std::lower_bound(
+      begin, end, lo, [](Edge const &e, Index value) { return e[0] < value; });
+
+  if (it == end || (*it)[0] != lo) return Index{-1};
+
+  return static_cast<Index>(std::distance(edges_.cbegin(), it));
+}
+
+/*************************************
+ * Explicit template instanciations
+ */
+
+template class MeshTopology<std::ptrdiff_t>;
+
+} // namespace CortidQCT
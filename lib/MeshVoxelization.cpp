@@ -0,0 +1,237 @@
+/**
+ * @file      MeshVoxelization.cpp
+ *
+ * @brief     Implementation of the scanline mesh voxelization
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshVoxelization.h"
+#include "MeshSlicing.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+/// 2D point in the yz-plane
+using Point2 = std::array<double, 2>;
+
+/// Edge function of the directed edge `(p, q)` at `s`
+inline double edgeFunction(Point2 const &p, Point2 const &q, Point2 const &s) {
+  return (q[0] - p[0]) * (s[1] - p[1]) - (q[1] - p[1]) * (s[0] - p[0]);
+}
+
+/**
+ * @brief Inside test with tie-breaking for points on the edge `(p, q)` of a
+ * counter-clockwise triangle
+ *
+ * Of two triangles sharing an edge in opposite directions, exactly one
+ * contains the points on the edge.
+ */
+inline bool isInside(double e, Point2 const &p, Point2 const &q) {
+  if (e != 0.0) return e > 0.0;
+  auto const dy = q[0] - p[0];
+  auto const dz = q[1] - p[1];
+  return dz > 0.0 || (dz == 0.0 && dy < 0.0);
+}
+
+/// Index range `[first, last]` of the grid positions `i * spacing` within
+/// `[lower, upper]`, clamped to `[0, count - 1]`
+template <class Index>
+inline std::array<Index, 2> gridRange(double lower, double upper,
+                                      double spacing, Index count) {
+  auto const n = static_cast<double>(count);
+  auto const first = std::clamp(std::ceil(lower / spacing), 0.0, n);
+  auto const last = std::clamp(std::floor(upper / spacing), -1.0, n - 1.0);
+  return {{static_cast<Index>(first), static_cast<Index>(last)}};
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+template <class T> class ScanlineVoxelizer {
+public:
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  /// Intersection of a ray along the x-axis with the mesh surface
+  struct Crossing {
+    double x;
+    Label label;
+
+    inline bool operator<(Crossing const &rhs) const noexcept {
+      return x < rhs.x;
+    }
+  };
+
+  using Row = std::vector<Crossing>;
+
+  ScanlineVoxelizer(T const *vertices, Index const *indices,
+                    Label const *labels, std::size_t triangleCount,
+                    VolumeSize const &volumeSize, VoxelSize const &voxelSize)
+      : vertices_(vertices), indices_(indices), labels_(labels),
+        W_(gsl::narrow_cast<Index>(volumeSize.width)),
+        H_(gsl::narrow_cast<Index>(volumeSize.height)),
+        spacing_{{static_cast<double>(voxelSize.width),
+                  static_cast<double>(voxelSize.height),
+                  static_cast<double>(voxelSize.depth)}},
+        slices_(vertices, indices, triangleCount, volumeSize.depth,
+                spacing_[2]) {}
+
+  /// Rasterizes slice `k` into `slice`, `rows` is used as scratch space
+  void rasterizeSlice(Index k, std::vector<Row> &rows, Label *slice) const {
+    using gsl::narrow_cast;
+
+    rows.resize(narrow_cast<std::size_t>(H_));
+    for (auto &row : rows) { row.clear(); }
+
+    for (auto t = slices_.begin(k); t != slices_.end(k); ++t) {
+      intersectRows(*t, slices_.z(k), rows);
+    }
+
+    for (Index j = 0; j < H_; ++j) {
+      auto &row = rows[narrow_cast<std::size_t>(j)];
+      std::sort(row.begin(), row.end());
+      fillRow(row, slice + j * W_);
+    }
+  }
+
+private:
+  /// Adds the crossings of the rays `(y = j * h, z = Z)` with triangle `f`
+  void intersectRows(Index f, double Z, std::vector<Row> &rows) const {
+    using gsl::narrow_cast;
+
+    std::array<Index, 3> corner{
+        {indices_[3 * f], indices_[3 * f + 1], indices_[3 * f + 2]}};
+    std::array<Point2, 3> P;
+    for (auto c = 0u; c < 3; ++c) {
+      auto const *v = vertex(corner[c]);
+      P[c] = {{static_cast<double>(v[1]), static_cast<double>(v[2])}};
+    }
+
+    // Make the projected triangle counter-clockwise, skip triangles parallel
+    // to the rays
+    auto area = edgeFunction(P[0], P[1], P[2]);
+    if (area == 0.0) return;
+    if (area < 0.0) {
+      std::swap(P[1], P[2]);
+      std::swap(corner[1], corner[2]);
+      area = -area;
+    }
+
+    auto const yMin = std::min({P[0][0], P[1][0], P[2][0]});
+    auto const yMax = std::max({P[0][0], P[1][0], P[2][0]});
+    auto const range = gridRange(yMin, yMax, spacing_[1], H_);
+
+    for (auto j = range[0]; j <= range[1]; ++j) {
+      Point2 const s{{static_cast<double>(j) * spacing_[1], Z}};
+      std::array<double, 3> const e{{edgeFunction(P[1], P[2], s),
+                                     edgeFunction(P[2], P[0], s),
+                                     edgeFunction(P[0], P[1], s)}};
+      if (!isInside(e[0], P[1], P[2]) || !isInside(e[1], P[2], P[0]) ||
+          !isInside(e[2], P[0], P[1])) {
+        continue;
+      }
+
+      // Barycentric interpolation of x, the label is taken from the nearest
+      // corner
+      auto x = 0.0;
+      for (auto c = 0u; c < 3; ++c) {
+        x += e[c] / area * static_cast<double>(vertex(corner[c])[0]);
+      }
+      auto const nearest = narrow_cast<std::size_t>(
+          std::distance(e.cbegin(), std::max_element(e.cbegin(), e.cend())));
+
+      auto const label = labels_[corner[nearest]];
+      rows[narrow_cast<std::size_t>(j)].push_back({x, label});
+    }
+  }
+
+  /// Fills the voxels between pairs of sorted crossings
+  void fillRow(Row const &row, Label *line) const {
+    for (auto c = 0u; c + 1 < row.size(); c += 2) {
+      auto const &enter = row[c];
+      auto const &exit = row[c + 1];
+
+      // Voxels with center in [enter.x, exit.x)
+      auto const n = static_cast<double>(W_);
+      auto const first = std::clamp(std::ceil(enter.x / spacing_[0]), 0.0, n);
+      auto const last = std::clamp(std::ceil(exit.x / spacing_[0]), 0.0, n);
+
+      for (auto i = static_cast<Index>(first); i < static_cast<Index>(last);
+           ++i) {
+        auto const x = static_cast<double>(i) * spacing_[0];
+        line[i] = x - enter.x <= exit.x - x ? enter.label : exit.label;
+      }
+    }
+  }
+
+  inline T const *vertex(Index v) const noexcept { return vertices_ + 3 * v; }
+
+  T const *vertices_;
+  Index const *indices_;
+  Label const *labels_;
+  Index W_, H_;
+  std::array<double, 3> spacing_;
+  TriangleSlices<T> slices_;
+};
+#pragma clang diagnostic pop
+
+} // anonymous namespace
+
+template <class T>
+std::vector<typename Mesh<T>::Label>
+voxelizeMesh(T const *vertices, typename Mesh<T>::Index const *indices,
+             typename Mesh<T>::Label const *labels, std::size_t triangleCount,
+             VolumeSize const &volumeSize, VoxelSize const &voxelSize,
+             typename Mesh<T>::Label outsideLabel) {
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  if (!(voxelSize.width > 0 && voxelSize.height > 0 && voxelSize.depth > 0)) {
+    throw std::invalid_argument("Voxel size must be positive");
+  }
+
+  std::vector<Label> mask(volumeSize.linear(), outsideLabel);
+  if (mask.empty() || triangleCount == 0) return mask;
+
+  ScanlineVoxelizer<T> const voxelizer{vertices,      indices,    labels,
+                                       triangleCount, volumeSize, voxelSize};
+
+  auto const D = gsl::narrow_cast<Index>(volumeSize.depth);
+  auto const sliceSize = volumeSize.width * volumeSize.height;
+
+#pragma omp parallel
+  {
+    std::vector<typename ScanlineVoxelizer<T>::Row> rows;
+
+#pragma omp for schedule(dynamic)
+    for (Index k = 0; k < D; ++k) {
+      voxelizer.rasterizeSlice(
+          k, rows, mask.data() + gsl::narrow_cast<std::size_t>(k) * sliceSize);
+    }
+  }
+
+  return mask;
+}
+
+template std::vector<Mesh<float>::Label>
+voxelizeMesh(float const *, Mesh<float>::Index const *,
+             Mesh<float>::Label const *, std::size_t, VolumeSize const &,
+             VoxelSize const &, Mesh<float>::Label);
+template std::vector<Mesh<double>::Label>
+voxelizeMesh(double const *, Mesh<double>::Index const *,
+             Mesh<double>::Label const *, std::size_t, VolumeSize const &,
+             VoxelSize const &, Mesh<double>::Label);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,67 @@
+/**
+ * @file      MeshVoxelization.h
+ *
+ * @brief     This file contains the definition of the scanline mesh
+ * voxelization.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+/**
+ * @brief Rasterizes the interior of a closed triangle mesh into a label mask
+ *
+ * Each z-slice is processed independently (and in parallel): the triangles
+ * crossing the slice are intersected with the rays along the x-axis through
+ * the voxel centers of each row, crossings are sorted and the voxels between
+ * pairs of crossings are filled (parity rule). Crossings on shared edges and
+ * vertices are counted exactly once by a consistent tie-breaking rule, so
+ * watertight meshes yield an even number of crossings per ray.
+ *
+ * An interior voxel is assigned the label of the nearer of the two crossings
+ * that enclose it. The label of a crossing is the label of the triangle
+ * corner with the largest barycentric weight.
+ *
+ * The voxel `(i, j, k)` has its center at `(i * w, j * h, k * d)` in mesh
+ * coordinates, where `(w, h, d)` is the voxel size, and the mask is stored
+ * in the same order as the data of a `VoxelVolume`.
+ *
+ * @param vertices vertex positions in `Mesh` storage layout
+ * @param indices triangle indices in `Mesh` storage layout
+ * @param labels per-vertex labels
+ * @param triangleCount number of triangles
+ * @param volumeSize size of the voxel grid
+ * @param voxelSize size of a voxel
+ * @param outsideLabel label of voxels outside of the mesh
+ * @return label mask with `volumeSize.linear()` elements
+ * @throws std::invalid_argument if the voxel size is not positive
+ */
+template <class T>
+std::vector<typename Mesh<T>::Label>
+voxelizeMesh(T const *vertices, typename Mesh<T>::Index const *indices,
+             typename Mesh<T>::Label const *labels, std::size_t triangleCount,
+             VolumeSize const &volumeSize, VoxelSize const &voxelSize,
+             typename Mesh<T>::Label outsideLabel);
+
+extern template std::vector<Mesh<float>::Label>
+voxelizeMesh(float const *, Mesh<float>::Index const *,
+             Mesh<float>::Label const *, std::size_t, VolumeSize const &,
+             VoxelSize const &, Mesh<float>::Label);
+extern template std::vector<Mesh<double>::Label>
+voxelizeMesh(double const *, Mesh<double>::Index const *,
+             Mesh<double>::Label const *, std::size_t, VolumeSize const &,
+             VoxelSize const &, Mesh<double>::Label);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,111 @@
+/**
+ * @file      MultiMeshFitter.cpp
+ *
+ * @brief     Implementation file for MultiMeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MultiMeshFitter.h"
+
+#include "MeshFitterConfigurationIO.h"
+#include "TaskScheduler.h"
+
+#include <yaml-cpp/yaml.h>
+
+#include <stdexcept>
+
+namespace CortidQCT {
+
+using namespace Internal;
+
+MultiMeshFitter::Configuration &
+MultiMeshFitter::Configuration::loadFromFile(std::string const &filename) {
+
+  try {
+    auto const node = YAML::LoadFile(filename);
+    MeasurementModelCache models;
+
+    auto maxConcurrentFits_ = maxConcurrentFits;
+    if (auto const &maxConcurrentNode = node["maxConcurrentFits"]) {
+      maxConcurrentFits_ = maxConcurrentNode.as<std::size_t>();
+    }
+
+    std::vector<Instance> instances_;
+
+    auto const &instancesNode = node["instances"];
+    if (!instancesNode) {
+      Instance instance;
+      loadConfiguration(instance.configuration, node, filename, models);
+      instances_.push_back(std::move(instance));
+    } else {
+      if (!instancesNode.IsSequence() || instancesNode.size() == 0) {
+        throw std::invalid_argument(
+            "instances must be a non-empty sequence in " + filename);
+      }
+
+      // Shared parameters of all instances
+      auto sharedNode = YAML::Clone(node);
+      sharedNode.remove("instances");
+      sharedNode.remove("maxConcurrentFits");
+
+      for (auto const &instanceNode : instancesNode) {
+        if (!instanceNode.IsMap()) {
+          throw std::invalid_argument("instances must be maps in " + filename);
+        }
+
+        Instance instance;
+        auto instanceConfigNode = YAML::Clone(sharedNode);
+        for (auto const &entry : instanceNode) {
+          auto const key = entry.first.as<std::string>();
+          if (key == "name") {
+            instance.name = entry.second.as<std::string>();
+          } else {
+            instanceConfigNode[key] = entry.second;
+          }
+        }
+
+        loadConfiguration(instance.configuration, instanceConfigNode,
+                          filename, models);
+        instances_.push_back(std::move(instance));
+      }
+    }
+
+    instances = std::move(instances_);
+    maxConcurrentFits = maxConcurrentFits_;
+
+  } catch (YAML::Exception const &e) {
+    throw std::invalid_argument("Failed to load configuration file '" +
+                                filename + "': " + e.what());
+  }
+
+  return *this;
+}
+
+std::vector<MeshFitter::Result>
+MultiMeshFitter::fit(VoxelVolume const &volume,
+                     FitOptions const &options) const {
+  if (!options.checkpointFile.empty()) {
+    throw std::invalid_argument(
+        "Checkpoints are not supported by multi mesh fits, they would all "
+        "write the same file");
+  }
+
+  auto const &instances = configuration.instances;
+  std::vector<MeshFitter::Result> results(instances.size());
+
+  // MeshFitter::fit() does not copy the volume, so all instances sample the
+  // same voxel data
+  runTasks(instances.size(), configuration.maxConcurrentFits,
+           [&](std::size_t i) {
+             MeshFitter const fitter{instances[i].configuration};
+             results[i] = fitter.fit(volume, options);
+           });
+
+  return results;
+}
+
+} // namespace CortidQCT
@@ -0,0 +1,294 @@
+/**
+ * @file      ParseHelpers.h
+ *
+ * @brief     This header contains helpers for fast parsing of text files
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if __has_include(<charconv>)
+#  include <charconv>
+#endif
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+namespace CortidQCT {
+namespace Internal {
+
+/**
+ * @brief Parses the value at the start of `[first, last)`
+ *
+ * Uses `std::from_chars` if the standard library supports it for floating
+ * point types (`__cpp_lib_to_chars`), otherwise a stream in the "C" locale.
+ *
+ * @return the end of the parsed value or `nullptr` if there is none
+ */
+template <class V>
+inline char const *parseValue(char const *first, char const *last, V &value) {
+#ifdef __cpp_lib_to_chars
+  auto const result = std::from_chars(first, last, value);
+  return result.ec == std::errc{} ? result.ptr : nullptr;
+#else
+  auto const tokenEnd = std::find_if(first, last, [](char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+  });
+  std::istringstream stream{std::string{first, tokenEnd}};
+  stream.imbue(std::locale::classic());
+  stream >> std::noskipws >> value;
+  if (stream.fail()) return nullptr;
+  if (stream.eof()) return tokenEnd;
+  return first + static_cast<std::ptrdiff_t>(stream.tellg());
+#endif
+}
+
+/// Reads the whole content of the given file into a string
+/// @throws std::invalid_argument if the file could not be read
+inline std::string readFileContents(std::string const &filename) {
+  std::ifstream file{filename, std::ios::binary | std::ios::ate};
+
+  if (!file) {
+    throw std::invalid_argument("Failed to open file '" + filename + "'");
+  }
+
+  auto const size = file.tellg();
+  std::string contents(static_cast<std::size_t>(size), '\0');
+  file.seekg(0);
+
+  if (!file.read(contents.data(), size)) {
+    throw std::invalid_argument("Failed to read file '" + filename + "'");
+  }
+
+  return contents;
+}
+
+/**
+ * @brief Non-owning cursor over a character buffer
+ *
+ * Values are parsed with `parseValue()`, i.e. locale independent and, with
+ * `std::from_chars`, without any intermediate allocations.
+ */
+class TextCursor {
+public:
+  inline TextCursor(char const *begin, char const *end) noexcept
+      : pos_(begin), end_(end) {}
+
+  inline explicit TextCursor(std::string_view text) noexcept
+      : TextCursor(text.data(), text.data() + text.size()) {}
+
+  /// True iff the end of the buffer has been reached
+  inline bool atEnd() const noexcept { return pos_ == end_; }
+
+  /// Current position in the buffer
+  inline char const *position() const noexcept { return pos_; }
+
+  /// Skips blanks (spaces, tabs and carriage returns) but no line breaks
+  inline void skipBlanks() noexcept {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r')) {
+      ++pos_;
+    }
+  }
+
+  /// Skips all whitespace including line breaks
+  inline void skipWhitespace() noexcept {
+    while (pos_ != end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' ||
+                            *pos_ == '\n')) {
+      ++pos_;
+    }
+  }
+
+  /// True iff there is another token in the current line
+  inline bool hasToken() noexcept {
+    skipBlanks();
+    return pos_ != end_ && *pos_ != '\n';
+  }
+
+  /// Returns the next line without the line break and advances past it
+  inline std::string_view nextLine() noexcept {
+    auto const *lineEnd = static_cast<char const *>(
+        std::memchr(pos_, '\n', static_cast<std::size_t>(end_ - pos_)));
+    if (lineEnd == nullptr) lineEnd = end_;
+
+    auto const *contentEnd = lineEnd;
+    if (contentEnd != pos_ && *(contentEnd - 1) == '\r') --contentEnd;
+
+    std::string_view const line{pos_,
+                                static_cast<std::size_t>(contentEnd - pos_)};
+    pos_ = lineEnd == end_ ? end_ : lineEnd + 1;
+    return line;
+  }
+
+  /// Returns the next non-empty line and advances past it
+  inline std::string_view nextNonEmptyLine() noexcept {
+    std::string_view line;
+    while (!atEnd() && (line = nextLine()).empty()) {}
+    return line;
+  }
+
+  /// Advances past the first line that equals `marker`
+  /// @throws std::invalid_argument if there is no such line
+  inline void skipPast(std::string_view marker) {
+    while (!atEnd()) {
+      if (nextLine() == marker) return;
+    }
+    throw std::invalid_argument("Missing '" + std::string{marker} + "' block");
+  }
+
+  /// Parses the next value in the current line
+  /// @throws std::invalid_argument if the value could not be parsed
+  template <class V> inline V parse() {
+    V value;
+    parse(value);
+    return value;
+  }
+
+  /// Parses the next value in the current line into `value`
+  /// @throws std::invalid_argument if the value could not be parsed
+  template <class V> inline void parse(V &value) {
+    skipBlanks();
+    auto const *valueEnd = parseValue(pos_, end_, value);
+    if (valueEnd == nullptr) {
+      throw std::invalid_argument("Failed to parse value near '" +
+                                  std::string{pos_, tokenEnd()} + "'");
+    }
+    pos_ = valueEnd;
+  }
+
+  /// Skips the next token in the current line
+  inline void skipToken() noexcept {
+    skipBlanks();
+    pos_ = tokenEnd();
+  }
+
+private:
+  inline char const *tokenEnd() const noexcept {
+    auto const *p = pos_;
+    while (p != end_ && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+      ++p;
+    }
+    return p;
+  }
+
+  char const *pos_;
+  char const *end_;
+};
+
+/**
+ * @brief Returns the number of chunks to use for parsing `size` bytes in
+ * parallel
+ *
+ * Small inputs are parsed in a single chunk.
+ */
+inline std::size_t parallelChunkCount(std::size_t size) noexcept {
+  constexpr std::size_t minChunkSize = 1 << 20;
+#ifdef _OPENMP
+  auto const nThreads = static_cast<std::size_t>(omp_get_max_threads());
+#else
+  std::size_t const nThreads = 1;
+#endif
+  return std::max(std::size_t{1},
+                  std::min(4 * nThreads, size / minChunkSize));
+}
+
+/**
+ * @brief Splits `text` into at most `nChunks` consecutive chunks
+ *
+ * All chunk boundaries are placed at the beginning of a line, so that no line
+ * is split between two chunks.
+ */
+inline std::vector<std::string_view> splitAtLines(std::string_view text,
+                                                  std::size_t nChunks) {
+  std::vector<std::string_view> chunks;
+  chunks.reserve(nChunks);
+
+  auto const approxSize = text.size() / std::max(nChunks, std::size_t{1});
+  std::size_t begin = 0;
+  while (begin < text.size()) {
+    auto end = chunks.size() + 1 == nChunks
+                   ? text.size()
+                   : std::min(text.size(), begin + approxSize);
+    if (end < text.size()) {
+      end = text.find('\n', end);
+      end = end == std::string_view::npos ? text.size() : end + 1;
+    }
+    chunks.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+
+  return chunks;
+}
+
+/**
+ * @brief Calls `f(i)` for all chunk indices `i` in `[0, nChunks)` in parallel
+ *
+ * Exceptions thrown by `f` are caught inside the parallel region and the
+ * first one (in chunk order) is rethrown afterwards.
+ */
+template <class F> void parallelForEachChunk(std::size_t nChunks, F &&f) {
+  std::vector<std::exception_ptr> errors(nChunks);
+
+#pragma omp parallel for schedule(dynamic)
+  for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(nChunks); ++i) {
+    try {
+      f(static_cast<std::size_t>(i));
+    } catch (...) {
+      errors[static_cast<std::size_t>(i)] = std::current_exception();
+    }
+  }
+
+  for (auto const &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+/**
+ * @brief Calls `f(line)` for each content line of `text`
+ *
+ * Content lines are lines that contain at least one non-blank character and
+ * do not start with `commentChar`. Leading blanks and trailing carriage
+ * returns are stripped.
+ */
+template <class F>
+void forEachContentLine(std::string_view text, F &&f, char commentChar = '#') {
+  TextCursor cursor{text};
+  while (!cursor.atEnd()) {
+    auto line = cursor.nextLine();
+    auto const first = line.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos || line[first] == commentChar) {
+      continue;
+    }
+    line.remove_prefix(first);
+    f(line);
+  }
+}
+
+/// Number of content lines in `text`
+/// @see forEachContentLine
+inline std::size_t countContentLines(std::string_view text,
+                                     char commentChar = '#') {
+  std::size_t count = 0;
+  forEachContentLine(
+      text, [&count](std::string_view) { ++count; }, commentChar);
+  return count;
+}
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,116 @@
+/**
+ * @file      PointToPlaneAlignment.h
+ *
+ * @brief     This header contains the weighted point-to-plane ICP step used
+ * to pre-align the reference mesh
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "MeshHelpers.h"
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <gsl/gsl>
+
+#include <cmath>
+
+namespace CortidQCT {
+
+namespace Internal {
+
+/**
+ * @brief Computes one iteration of weighted point-to-plane ICP
+ *
+ * Vertex `i` should be moved onto the plane through
+ * `V.col(i) - d(i) * N.col(i)` with normal `N.col(i)`, i.e. by `-d(i)` along
+ * its normal, as estimated by the DisplacementOptimizer. The rotation is
+ * linearized about the weighted centroid of the vertices and the linear least
+ * squares problem is solved in double precision. A small ridge term keeps
+ * directions that are not constrained by the planes, e.g. the rotations of
+ * a sphere, at the identity.
+ *
+ * @param V vertices (3xN)
+ * @param N unit vertex normals (3xN)
+ * @param d displacements along the negative normals (Nx1)
+ * @param w non-negative weights (Nx1)
+ * @param estimateScale estimate a similarity instead of a rigid
+ * transformation
+ * @return the transformation that moves the vertices onto the planes
+ */
+template <class T>
+Eigen::Transform<T, 3, Eigen::Affine> pointToPlaneAlignment(
+    Eigen::Ref<PointMatrix<T> const> const &V,
+    Eigen::Ref<PointMatrix<T> const> const &N,
+    Eigen::Ref<Eigen::Matrix<T, Eigen::Dynamic, 1> const> const &d,
+    Eigen::Ref<Eigen::Matrix<T, Eigen::Dynamic, 1> const> const &w,
+    bool estimateScale) {
+  using Eigen::Index;
+  using Matrix7d = Eigen::Matrix<double, 7, 7>;
+  using Vector7d = Eigen::Matrix<double, 7, 1>;
+  using Transform = Eigen::Transform<T, 3, Eigen::Affine>;
+
+  Expects(N.cols() == V.cols() && d.rows() == V.cols() &&
+          w.rows() == V.cols());
+
+  Eigen::VectorXd const weights = w.template cast<double>();
+  auto const weightSum = weights.sum();
+  if (!(weightSum > 0)) { return Transform::Identity(); }
+
+  Eigen::Vector3d const centroid =
+      (V.template cast<double>() * weights) / weightSum;
+  PointMatrix<double> P = V.template cast<double>().colwise() - centroid;
+
+  // Normalize the lever arms so that all parameters have comparable scales
+  auto const radius =
+      std::sqrt(P.colwise().squaredNorm().dot(weights) / weightSum);
+  if (!(radius > 0)) { return Transform::Identity(); }
+  P /= radius;
+
+  // Unknowns: rotation vector, translation and relative scale change
+  Matrix7d AtA = Matrix7d::Zero();
+  Vector7d Atb = Vector7d::Zero();
+  for (Index i = 0; i < V.cols(); ++i) {
+    Eigen::Vector3d const p = P.col(i);
+    Eigen::Vector3d const n = N.col(i).template cast<double>();
+    Vector7d a;
+    a << p.cross(n), n, p.dot(n);
+    AtA.noalias() += weights(i) * a * a.transpose();
+    Atb.noalias() -= weights(i) * static_cast<double>(d(i)) / radius * a;
+  }
+  if (!estimateScale) {
+    AtA.row(6).setZero();
+    AtA.col(6).setZero();
+    AtA(6, 6) = 1;
+    Atb(6) = 0;
+  }
+
+  // The ridge only slows down the convergence, the fixed point is unaffected
+  AtA.diagonal().array() += 1e-3 * AtA.diagonal().maxCoeff();
+  Vector7d const x = AtA.ldlt().solve(Atb);
+
+  Eigen::Vector3d const omega = x.template head<3>();
+  auto const angle = omega.norm();
+  Eigen::Matrix3d const R =
+      angle > 0 ? Eigen::AngleAxisd{angle, omega / angle}.toRotationMatrix()
+                : Eigen::Matrix3d::Identity();
+  Eigen::Vector3d const t = radius * x.template segment<3>(3);
+  auto const scale = 1 + x(6);
+
+  // x -> scale * R * (x - centroid) + centroid + t
+  Eigen::Affine3d transform = Eigen::Affine3d::Identity();
+  transform.linear() = scale * R;
+  transform.translation() = centroid + t - transform.linear() * centroid;
+
+  return transform.template cast<T>();
+}
+
+} // namespace Internal
+
+} // namespace CortidQCT
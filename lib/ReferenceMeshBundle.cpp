@@ -0,0 +1,274 @@
+/**
+ * @file      ReferenceMeshBundle.cpp
+ *
+ * @brief     Implementation of the reference mesh bundle reader and writer
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "ReferenceMeshBundle.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+using Index = typename Mesh<float>::Index;
+using Label = typename Mesh<float>::Label;
+using Topology = typename Mesh<float>::Topology;
+using StorageIndex = typename LaplacianMatrix<float>::StorageIndex;
+
+constexpr std::array<char, 8> bundleMagic = {
+    {'C', 'Q', 'T', 'R', 'M', 'E', 'S', 'H'}};
+constexpr std::uint32_t bundleVersion = 1;
+constexpr std::size_t headerSize = 64;
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct BundleHeader {
+  std::uint64_t vertexCount = 0;
+  std::uint64_t triangleCount = 0;
+  std::uint64_t edgeCount = 0;
+  std::uint64_t neighbourCount = 0;
+  std::uint64_t nonZeroCount = 0;
+  std::uint64_t checksum = 0;
+
+  /// Size of the payload in bytes
+  std::uint64_t payloadSize() const noexcept {
+    auto const nV = vertexCount;
+    auto const nF = triangleCount;
+    return 4 * (3 * nV + 3 * nV + nV + nonZeroCount) +
+           8 * (3 * nF + (nV + 1) + neighbourCount + (nV + 1) + 3 * nF +
+                2 * edgeCount + (nV + 1) + nonZeroCount);
+  }
+};
+#pragma clang diagnostic pop
+
+} // anonymous namespace
+
+std::uint64_t meshChecksum(Mesh<float> const &mesh) {
+  auto const hash = mesh.withUnsafeVertexPointer([&mesh](float const *ptr) {
+    return fnv1a64(ptr, 3 * mesh.vertexCount() * sizeof(float));
+  });
+  return mesh.withUnsafeIndexPointer([&mesh, hash](Index const *ptr) {
+    return fnv1a64(ptr, 3 * mesh.triangleCount() * sizeof(Index), hash);
+  });
+}
+
+bool ReferenceMeshCache::isValidFor(Mesh<float> const &mesh) const {
+  return gsl::narrow_cast<std::size_t>(laplacian.rows()) ==
+             mesh.vertexCount() &&
+         meshChecksum == Internal::meshChecksum(mesh);
+}
+
+ReferenceMeshCache referenceMeshCache(Mesh<float> const &mesh) {
+  ReferenceMeshCache cache;
+  cache.laplacian = laplacianMatrix(mesh);
+  cache.laplacian.makeCompressed();
+  cache.meshChecksum = meshChecksum(mesh);
+  return cache;
+}
+
+void writeReferenceMeshBundle(Mesh<float> const &mesh,
+                              std::string const &filename) {
+  using gsl::narrow;
+
+  auto const &topology = mesh.topology();
+  auto const V = vertexMatrix(mesh);
+  auto const F = facetMatrix(mesh);
+
+  Eigen::Matrix<float, 3, Eigen::Dynamic> const normals =
+      perVertexNormalMatrix(V, F, topology).transpose();
+
+  LaplacianMatrix<float> L = laplacianMatrix(V, F, topology);
+  L.makeCompressed();
+
+  BundleHeader header;
+  header.vertexCount = mesh.vertexCount();
+  header.triangleCount = mesh.triangleCount();
+  header.edgeCount = topology.edgeCount();
+  header.neighbourCount = topology.neighbourIndices().size();
+  header.nonZeroCount = narrow<std::uint64_t>(L.nonZeros());
+
+  auto const nV = mesh.vertexCount();
+  auto const nF = mesh.triangleCount();
+
+  ByteWriter payload{narrow<std::size_t>(header.payloadSize())};
+
+  mesh.withUnsafeVertexPointer(
+      [&](float const *ptr) { payload.append<float>(ptr, 3 * nV); });
+  payload.append<float>(normals.data(), 3 * nV);
+  mesh.withUnsafeLabelPointer(
+      [&](Label const *ptr) { payload.append<std::uint32_t>(ptr, nV); });
+  mesh.withUnsafeIndexPointer(
+      [&](Index const *ptr) { payload.append<std::int64_t>(ptr, 3 * nF); });
+
+  auto const appendVector = [&payload](std::vector<Index> const &values) {
+    payload.append<std::int64_t>(values.data(), values.size());
+  };
+  appendVector(topology.neighbourOffsets());
+  appendVector(topology.neighbourIndices());
+  appendVector(topology.faceOffsets());
+  appendVector(topology.faceIndices());
+  // std::array is contiguous, so the edges form a single index array
+  payload.append<std::int64_t>(
+      reinterpret_cast<Index const *>(topology.edges().data()),
+      2 * topology.edgeCount());
+
+  payload.append<std::int64_t>(L.outerIndexPtr(), nV + 1);
+  payload.append<std::int64_t>(L.innerIndexPtr(), header.nonZeroCount);
+  payload.append<float>(L.valuePtr(), header.nonZeroCount);
+
+  Ensures(payload.bytes().size() == header.payloadSize());
+
+  header.checksum = fnv1a64(payload.bytes().data(), payload.bytes().size());
+
+  std::ofstream out{filename, std::ios::binary};
+  if (!out) {
+    throw std::invalid_argument("Failed to write reference mesh bundle '" +
+                                filename + "'");
+  }
+
+  out.write(bundleMagic.data(), bundleMagic.size());
+  writeLittleEndian<std::uint32_t>(out, bundleVersion);
+  writeLittleEndian<std::uint32_t>(out, std::uint32_t{0});
+  writeLittleEndian<std::uint64_t>(out, header.vertexCount);
+  writeLittleEndian<std::uint64_t>(out, header.triangleCount);
+  writeLittleEndian<std::uint64_t>(out, header.edgeCount);
+  writeLittleEndian<std::uint64_t>(out, header.neighbourCount);
+  writeLittleEndian<std::uint64_t>(out, header.nonZeroCount);
+  writeLittleEndian<std::uint64_t>(out, header.checksum);
+  out.write(reinterpret_cast<char const *>(payload.bytes().data()),
+            static_cast<std::streamsize>(payload.bytes().size()));
+
+  if (!out) {
+    throw std::invalid_argument("Failed to write reference mesh bundle '" +
+                                filename + "'");
+  }
+}
+
+ReferenceMeshBundle readReferenceMeshBundle(std::string const &filename) {
+  using gsl::narrow;
+
+  try {
+    MappedFile const file{filename};
+    ByteReader reader{file.data(), file.data() + file.size()};
+
+    // Header
+    std::array<char, 8> magic;
+    reader.read<char>(magic.data(), magic.size());
+    if (magic != bundleMagic) {
+      throw std::invalid_argument("Not a reference mesh bundle");
+    }
+
+    auto const version = reader.read<std::uint32_t>();
+    if (version != bundleVersion) {
+      throw std::invalid_argument("Unsupported bundle version " +
+                                  std::to_string(version));
+    }
+    reader.read<std::uint32_t>();
+
+    BundleHeader header;
+    header.vertexCount = reader.read<std::uint64_t>();
+    header.triangleCount = reader.read<std::uint64_t>();
+    header.edgeCount = reader.read<std::uint64_t>();
+    header.neighbourCount = reader.read<std::uint64_t>();
+    header.nonZeroCount = reader.read<std::uint64_t>();
+    header.checksum = reader.read<std::uint64_t>();
+
+    // Guard against overflows in payloadSize() caused by corrupted counts
+    constexpr auto maxCount = std::uint64_t{1} << 40;
+    if (header.vertexCount > maxCount || header.triangleCount > maxCount ||
+        header.edgeCount > maxCount || header.neighbourCount > maxCount ||
+        header.nonZeroCount > maxCount ||
+        header.payloadSize() != file.size() - headerSize) {
+      throw std::invalid_argument("File size does not match header");
+    }
+
+    if (fnv1a64(file.data() + headerSize, file.size() - headerSize) !=
+        header.checksum) {
+      throw std::invalid_argument("Checksum mismatch");
+    }
+
+    auto const nV = narrow<std::size_t>(header.vertexCount);
+    auto const nF = narrow<std::size_t>(header.triangleCount);
+    auto const nE = narrow<std::size_t>(header.edgeCount);
+    auto const nR = narrow<std::size_t>(header.neighbourCount);
+    auto const nK = narrow<std::size_t>(header.nonZeroCount);
+
+    // Mesh
+    ReferenceMeshBundle bundle;
+    auto &mesh = bundle.mesh;
+    auto &vertices = PrivateMeshAccessor::vertexData(mesh);
+    auto &normals = PrivateMeshAccessor::normalData(mesh);
+    auto &labels = PrivateMeshAccessor::labelData(mesh);
+    auto &indices = PrivateMeshAccessor::indexData(mesh);
+
+    vertices = reader.readVector<float, float>(3 * nV);
+    normals = reader.readVector<float, float>(3 * nV);
+    labels = reader.readVector<std::uint32_t, Label>(nV);
+    indices = reader.readVector<std::int64_t, Index>(3 * nF);
+
+    auto const nVIndex = narrow<Index>(nV);
+    if (std::any_of(indices.cbegin(), indices.cend(),
+                    [nVIndex](Index i) { return i < 0 || i >= nVIndex; })) {
+      throw std::invalid_argument("Vertex index out of range");
+    }
+
+    // Topology
+    auto neighbourOffsets = reader.readVector<std::int64_t, Index>(nV + 1);
+    auto neighbourIndices = reader.readVector<std::int64_t, Index>(nR);
+    auto faceOffsets = reader.readVector<std::int64_t, Index>(nV + 1);
+    auto faceIndices = reader.readVector<std::int64_t, Index>(3 * nF);
+    std::vector<Topology::Edge> edges(nE);
+    reader.read<std::int64_t>(reinterpret_cast<Index *>(edges.data()), 2 * nE);
+
+    PrivateMeshAccessor::setTopology(
+        mesh, std::make_shared<Topology const>(Topology::fromAdjacency(
+                  std::move(edges), std::move(neighbourOffsets),
+                  std::move(neighbourIndices), std::move(faceOffsets),
+                  std::move(faceIndices))));
+
+    // Laplacian
+    auto &L = bundle.cache.laplacian;
+    L.resize(narrow<Eigen::Index>(nV), narrow<Eigen::Index>(nV));
+    L.resizeNonZeros(narrow<Eigen::Index>(nK));
+    reader.read<std::int64_t>(L.outerIndexPtr(), nV + 1);
+    reader.read<std::int64_t>(L.innerIndexPtr(), nK);
+    reader.read<float>(L.valuePtr(), nK);
+
+    auto const *outer = L.outerIndexPtr();
+    auto const *inner = L.innerIndexPtr();
+    if (outer[0] != 0 || narrow<std::size_t>(outer[nV]) != nK ||
+        !std::is_sorted(outer, outer + nV + 1) ||
+        std::any_of(inner, inner + nK, [nV](StorageIndex i) {
+          return i < 0 || static_cast<std::size_t>(i) >= nV;
+        })) {
+      throw std::invalid_argument("Invalid Laplacian matrix");
+    }
+
+    bundle.cache.meshChecksum = meshChecksum(mesh);
+
+    return bundle;
+  } catch (std::invalid_argument const &e) {
+    throw std::invalid_argument("Failed to read reference mesh bundle '" +
+                                filename + "': " + e.what());
+  }
+}
+
+} // namespace Internal
+} // namespace CortidQCT
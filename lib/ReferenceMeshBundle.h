@@ -0,0 +1,114 @@
+/**
+ * @file      ReferenceMeshBundle.h
+ *
+ * @brief     This file contains the definition of the precompiled reference
+ * mesh bundle format.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "MeshHelpers.h"
+
+#include <cstdint>
+#include <string>
+
+namespace CortidQCT {
+namespace Internal {
+
+/**
+ * @brief Data derived from the reference mesh that is needed to initialize
+ * the mesh fitter
+ */
+struct ReferenceMeshCache {
+  /// Cotangent Laplacian matrix of the reference mesh
+  LaplacianMatrix<float> laplacian;
+  /// Checksum of the vertex and index data the cache was computed for
+  std::uint64_t meshChecksum = 0;
+
+  /// True iff the cache was computed for the given mesh
+  bool isValidFor(Mesh<float> const &mesh) const;
+};
+
+/// Computes the reference mesh cache of the given mesh
+ReferenceMeshCache referenceMeshCache(Mesh<float> const &mesh);
+
+/// Contents of a reference mesh bundle
+struct ReferenceMeshBundle {
+  /// Outwards oriented mesh with labels, normals and topology
+  Mesh<float> mesh;
+  /// Precomputed data for the mesh fitter
+  ReferenceMeshCache cache;
+};
+
+/**
+ * @brief Checksum of the vertex and index data of the given mesh
+ *
+ * Used to detect if a mesh was modified after a cache was computed.
+ */
+std::uint64_t meshChecksum(Mesh<float> const &mesh);
+
+/// True iff the given (lower case) extension is the reference mesh bundle
+/// extension
+inline bool isReferenceMeshBundleExtension(std::string const &extension) {
+  return extension == "refmesh";
+}
+
+/**
+ * @brief Writes a reference mesh bundle
+ *
+ * The bundle contains the mesh as is, i.e. it should be loaded with
+ * `Mesh::loadFromFile()` before, which orients the mesh outwards. The
+ * topology, the normals and the Laplacian matrix are computed and stored in
+ * the bundle as well.
+ *
+ * ### File layout
+ * All values are stored in little endian byte order.
+ *
+ * | Offset | Type     | Content                                        |
+ * |--------|----------|------------------------------------------------|
+ * | 0      | char[8]  | magic "CQTRMESH"                               |
+ * | 8      | uint32   | format version, currently 1                    |
+ * | 12     | uint32   | reserved, 0                                    |
+ * | 16     | uint64   | number of vertices `N`                         |
+ * | 24     | uint64   | number of triangles `M`                        |
+ * | 32     | uint64   | number of edges `E`                            |
+ * | 40     | uint64   | number of one-ring entries `R`                 |
+ * | 48     | uint64   | number of non-zeros of the Laplacian `K`       |
+ * | 56     | uint64   | FNV-1a checksum of the payload                 |
+ * | 64     | payload  |                                                |
+ *
+ * The payload consists of these arrays, stored one after another:
+ * `float32[3N]` vertices, `float32[3N]` normals, `uint32[N]` labels,
+ * `int64[3M]` triangle indices, `int64[N + 1]` one-ring offsets, `int64[R]`
+ * one-ring indices, `int64[N + 1]` vertex-face offsets, `int64[3M]`
+ * vertex-face indices, `int64[2E]` edges, `int64[N + 1]` Laplacian row
+ * offsets, `int64[K]` Laplacian column indices and `float32[K]` Laplacian
+ * values. Since the Laplacian is symmetric, the CSR arrays equal the
+ * compressed column storage used by Eigen.
+ *
+ * @param mesh the oriented reference mesh
+ * @param filename path to the output file
+ * @throws std::invalid_argument if the file could not be written
+ */
+void writeReferenceMeshBundle(Mesh<float> const &mesh,
+                              std::string const &filename);
+
+/**
+ * @brief Reads a reference mesh bundle
+ *
+ * The file is memory mapped and its checksum is verified before any data is
+ * used.
+ *
+ * @param filename path to the bundle
+ * @throws std::invalid_argument if the file could not be read, has an
+ * unsupported version or is corrupted
+ */
+ReferenceMeshBundle readReferenceMeshBundle(std::string const &filename);
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -10,230 +10,462 @@
  */
 
 #include "SIMesh.h"
+#include "BinaryIO.h"
+#include "CheckExtension.h"
 #include "Mesh.h"
 #include "MeshHelpers.h"
-#include "Optional.h"
+#include "ParseHelpers.h"
 
 #include <Eigen/Core>
-#include <igl/adjacency_list.h>
-#include <igl/edges.h>
+#include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <locale>
 #include <sstream>
+#include <vector>
+
+#if __has_include(<charconv>)
+#  include <charconv>
+#endif
 
 namespace CortidQCT {
 namespace Internal {
 
 namespace {
 
+/// Magic bytes at the start of binary SIMesh files
+constexpr std::array<char, 8> binaryMagic = {
+    {'S', 'I', 'M', 'E', 'S', 'H', 'B', '\0'}};
+/// Version of the binary SIMesh format
+constexpr std::uint32_t binaryVersion = 1;
+/// Flag indicating that the binary file contains per-vertex labels
+constexpr std::uint32_t binaryHasLabels = 1;
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
-template <class T> struct Vertex {
-  Eigen::Matrix<T, 3, 1> position;
-  std::vector<typename Mesh<T>::Index> adjacentVertexIndices;
-  std::vector<typename Mesh<T>::Index> incidentEdgeIndices;
-  std::optional<typename Mesh<T>::Label> label;
+/**
+ * @brief Full SIMesh connectivity information of a mesh
+ *
+ * Per-vertex lists are stored in CSR format using `vertexOffsets`, which is
+ * shared by the adjacent vertex and incident edge lists since both have
+ * `degree` elements for each vertex.
+ */
+template <class T> struct SIMeshData {
+  using Index = typename Mesh<T>::Index;
+  using Label = typename Mesh<T>::Label;
+
+  std::size_t nVertices = 0;
+  std::size_t nTriangles = 0;
+  std::size_t nEdges = 0;
+
+  /// Vertex positions [x0, y0, z0, x1, ...]
+  std::vector<T> positions;
+  /// CSR offsets of the per-vertex lists
+  std::vector<Index> vertexOffsets;
+  /// Ordered adjacent vertices of each vertex
+  std::vector<Index> adjacentVertices;
+  /// Incident edges of each vertex in ascending order
+  std::vector<Index> incidentEdges;
+  /// Per-vertex labels, empty if not included
+  std::vector<Label> labels;
+  /// Per edge: [i, j, position of j in adjacency of i, position of i in
+  /// adjacency of j]
+  std::vector<Index> edges;
+  /// Per facet: [v0, v1, v2, e01, e12, e20]
+  std::vector<Index> facets;
 };
 #pragma clang diagnostic pop
 
-template <class T> struct Edge {
-  Eigen::Matrix<T, 2, 1> vertexIndices;
-  Eigen::Matrix<T, 2, 1> vertexNeighboursIndices;
-};
+/// Collects the SIMesh connectivity in time linear in the mesh size
+template <class T>
+SIMeshData<T> connectivity(Mesh<T> const &mesh, bool includeLabels) {
+  using Index = typename Mesh<T>::Index;
+  using gsl::narrow_cast;
+  using std::size_t;
 
-template <class T> struct Facet {
-  Eigen::Matrix<T, 3, 1> vertexIndices;
-  Eigen::Matrix<T, 3, 1> edgeIndices;
-};
+  auto const &topology = mesh.topology();
 
-template <class T>
-std::ostream &operator<<(std::ostream &out, Vertex<T> const &v) {
-  out << v.position.transpose() << " " << v.adjacentVertexIndices.size() << " ";
-  for (auto n : v.adjacentVertexIndices) out << n << " ";
-  for (auto e : v.incidentEdgeIndices) out << e << " ";
-  if (v.label) {
-    out << *v.label;
-  } else {
-    out.seekp(-1, out.cur);
+  SIMeshData<T> data;
+  data.nVertices = mesh.vertexCount();
+  data.nTriangles = mesh.triangleCount();
+  data.nEdges = topology.edgeCount();
+
+  data.positions = mesh.withUnsafeVertexPointer([&mesh](auto const *ptr) {
+    return std::vector<T>(ptr, ptr + 3 * mesh.vertexCount());
+  });
+
+  data.vertexOffsets = topology.neighbourOffsets();
+  data.adjacentVertices = topology.neighbourIndices();
+
+  if (includeLabels) {
+    data.labels = mesh.withUnsafeLabelPointer([&mesh](auto const *ptr) {
+      return std::vector<typename Mesh<T>::Label>(ptr,
+                                                  ptr + mesh.vertexCount());
+    });
+  }
+
+  // Distribute edges to their end points. Since edges are visited in
+  // ascending order, each incident edge list is sorted.
+  data.incidentEdges.resize(data.adjacentVertices.size());
+  std::vector<Index> fill(data.vertexOffsets.cbegin(),
+                          data.vertexOffsets.cend() - 1);
+
+  auto const &edges = topology.edges();
+  data.edges.resize(4 * data.nEdges);
+
+  auto const positionInRing = [&topology](Index i, Index j) {
+    auto const *begin = topology.neighboursBegin(i);
+    return narrow_cast<Index>(
+        std::distance(begin, std::find(begin, topology.neighboursEnd(i), j)));
+  };
+
+  for (size_t e = 0; e < data.nEdges; ++e) {
+    auto const i = edges[e][0];
+    auto const j = edges[e][1];
+
+    data.incidentEdges[narrow_cast<size_t>(fill[narrow_cast<size_t>(i)]++)] =
+        narrow_cast<Index>(e);
+    data.incidentEdges[narrow_cast<size_t>(fill[narrow_cast<size_t>(j)]++)] =
+        narrow_cast<Index>(e);
+
+    data.edges[4 * e + 0] = i;
+    data.edges[4 * e + 1] = j;
+    data.edges[4 * e + 2] = positionInRing(i, j);
+    data.edges[4 * e + 3] = positionInRing(j, i);
   }
-  return out;
+
+  // Facets, edges are looked up in the per-vertex edge buckets of the
+  // topology
+  data.facets.resize(6 * data.nTriangles);
+  mesh.withUnsafeIndexPointer([&data, &topology](auto const *indices) {
+    for (size_t f = 0; f < data.nTriangles; ++f) {
+      auto const *tri = indices + 3 * f;
+      auto *facet = data.facets.data() + 6 * f;
+      for (auto k = 0; k < 3; ++k) {
+        facet[k] = tri[k];
+        facet[3 + k] = topology.edgeIndex(tri[k], tri[(k + 1) % 3]);
+      }
+    }
+  });
+
+  return data;
 }
 
+/**
+ * @brief Buffered writer that formats numbers using `std::to_chars`
+ *
+ * Falls back to a stream in the "C" locale if the standard library does not
+ * support `std::to_chars` for floating point types (`__cpp_lib_to_chars`).
+ */
+class TextWriter {
+public:
+  explicit TextWriter(std::ostream &out) : out_(out) {
+    buffer_.reserve(bufferSize + maxTokenSize);
+#ifndef __cpp_lib_to_chars
+    stream_.imbue(std::locale::classic());
+#endif
+  }
+
+  ~TextWriter() { flush(); }
+
+  TextWriter(TextWriter const &) = delete;
+  TextWriter &operator=(TextWriter const &) = delete;
+
+  template <class V> TextWriter &operator<<(V value) {
+#ifdef __cpp_lib_to_chars
+    auto const size = buffer_.size();
+    buffer_.resize(size + maxTokenSize);
+    auto const result =
+        std::to_chars(buffer_.data() + size, buffer_.data() + buffer_.size(),
+                      value);
+    Ensures(result.ec == std::errc{});
+    buffer_.resize(static_cast<std::size_t>(result.ptr - buffer_.data()));
+#else
+    // Enough digits to read back the exact value
+    stream_.str({});
+    stream_.precision(std::numeric_limits<V>::max_digits10);
+    stream_ << value;
+    auto const str = stream_.str();
+    buffer_.insert(buffer_.end(), str.begin(), str.end());
+#endif
+    flushIfFull();
+    return *this;
+  }
+
+  TextWriter &operator<<(char c) {
+    buffer_.push_back(c);
+    flushIfFull();
+    return *this;
+  }
+
+  TextWriter &operator<<(char const *str) {
+    buffer_.insert(buffer_.end(), str, str + std::strlen(str));
+    flushIfFull();
+    return *this;
+  }
+
+  void flush() {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+
+private:
+  static constexpr std::size_t bufferSize = 1 << 20;
+  static constexpr std::size_t maxTokenSize = 64;
+
+  void flushIfFull() {
+    if (buffer_.size() >= bufferSize) flush();
+  }
+
+  std::ostream &out_;
+  std::vector<char> buffer_;
+#ifndef __cpp_lib_to_chars
+  std::ostringstream stream_;
+#endif
+};
+
 template <class T>
-std::ostream &operator<<(std::ostream &out, Edge<T> const &e) {
-  return out << e.vertexIndices.transpose() << " "
-             << e.vertexNeighboursIndices.transpose();
+void writeText(SIMeshData<T> const &data, std::ostream &stream) {
+  using gsl::narrow_cast;
+  using std::size_t;
+
+  TextWriter out{stream};
+
+  out << data.nVertices << ' ' << data.nTriangles << ' ' << data.nEdges
+      << '\n';
+
+  out << "Vertices\n";
+  for (size_t i = 0; i < data.nVertices; ++i) {
+    auto const begin = narrow_cast<size_t>(data.vertexOffsets[i]);
+    auto const end = narrow_cast<size_t>(data.vertexOffsets[i + 1]);
+
+    out << data.positions[3 * i] << ' ' << data.positions[3 * i + 1] << ' '
+        << data.positions[3 * i + 2] << ' ' << (end - begin);
+    for (auto k = begin; k < end; ++k) out << ' ' << data.adjacentVertices[k];
+    for (auto k = begin; k < end; ++k) out << ' ' << data.incidentEdges[k];
+    if (!data.labels.empty()) out << ' ' << data.labels[i];
+    out << '\n';
+  }
+
+  out << "Edges\n";
+  for (size_t e = 0; e < data.nEdges; ++e) {
+    auto const *edge = data.edges.data() + 4 * e;
+    out << edge[0] << ' ' << edge[1] << ' ' << edge[2] << ' ' << edge[3]
+        << '\n';
+  }
+
+  out << "Facets\n";
+  for (size_t f = 0; f < data.nTriangles; ++f) {
+    auto const *facet = data.facets.data() + 6 * f;
+    out << facet[0] << ' ' << facet[1] << ' ' << facet[2] << ' ' << facet[3]
+        << ' ' << facet[4] << ' ' << facet[5] << '\n';
+  }
 }
 
+// MARK: - Binary format
+
+/**
+ * Layout of the binary format, all values are little endian:
+ *
+ * | Field              | Type       | Count           |
+ * |--------------------|------------|-----------------|
+ * | magic              | char       | 8               |
+ * | version            | uint32     | 1               |
+ * | flags              | uint32     | 1               |
+ * | nVertices          | uint64     | 1               |
+ * | nTriangles         | uint64     | 1               |
+ * | nEdges             | uint64     | 1               |
+ * | positions          | float64    | 3 * nVertices   |
+ * | vertex offsets     | int64      | nVertices + 1   |
+ * | adjacent vertices  | int64      | offsets[nV]     |
+ * | incident edges     | int64      | offsets[nV]     |
+ * | labels (optional)  | uint32     | nVertices       |
+ * | edges              | int64      | 4 * nEdges      |
+ * | facets             | int64      | 6 * nTriangles  |
+ */
 template <class T>
-std::ostream &operator<<(std::ostream &out, Facet<T> const &f) {
-  return out << f.vertexIndices.transpose() << " " << f.edgeIndices.transpose();
+void writeBinary(SIMeshData<T> const &data, std::ostream &out) {
+  out.write(binaryMagic.data(), binaryMagic.size());
+  writeLittleEndian<std::uint32_t>(out, binaryVersion);
+  writeLittleEndian<std::uint32_t>(
+      out, data.labels.empty() ? std::uint32_t{0} : binaryHasLabels);
+  writeLittleEndian<std::uint64_t>(out, data.nVertices);
+  writeLittleEndian<std::uint64_t>(out, data.nTriangles);
+  writeLittleEndian<std::uint64_t>(out, data.nEdges);
+
+  writeLittleEndian<double>(out, data.positions.data(), data.positions.size());
+  writeLittleEndian<std::int64_t>(out, data.vertexOffsets.data(),
+                                  data.vertexOffsets.size());
+  writeLittleEndian<std::int64_t>(out, data.adjacentVertices.data(),
+                                  data.adjacentVertices.size());
+  writeLittleEndian<std::int64_t>(out, data.incidentEdges.data(),
+                                  data.incidentEdges.size());
+  writeLittleEndian<std::uint32_t>(out, data.labels.data(),
+                                   data.labels.size());
+  writeLittleEndian<std::int64_t>(out, data.edges.data(), data.edges.size());
+  writeLittleEndian<std::int64_t>(out, data.facets.data(), data.facets.size());
 }
 
-} // namespace
+template <class T> SIMeshData<T> readBinary(std::istream &in) {
+  using Index = typename Mesh<T>::Index;
+  using gsl::narrow;
 
-template <class T>
-void writeToSIMesh(Mesh<T> const &mesh, std::string const &filename,
-                   bool includeLabels) {
-  using namespace Eigen;
-  using namespace gsl;
-  using std::size_t;
+  std::array<char, 8> magic;
+  if (!in.read(magic.data(), magic.size()) || magic != binaryMagic) {
+    throw std::invalid_argument("Not a binary SIMesh file");
+  }
+
+  if (auto const version = readLittleEndian<std::uint32_t>(in);
+      version != binaryVersion) {
+    throw std::invalid_argument("Unsupported binary SIMesh version " +
+                                std::to_string(version));
+  }
 
-  VertexMatrix<T> const V = vertexMatrix(mesh);
-  FacetMatrix const F = facetMatrix(mesh);
-  LabelVector const L = labelVector(mesh);
+  auto const flags = readLittleEndian<std::uint32_t>(in);
 
-  std::vector<std::vector<typename Mesh<T>::Index>> vertexAdjacencyList;
-  igl::adjacency_list(F, vertexAdjacencyList, true);
+  SIMeshData<T> data;
+  data.nVertices = narrow<std::size_t>(readLittleEndian<std::uint64_t>(in));
+  data.nTriangles = narrow<std::size_t>(readLittleEndian<std::uint64_t>(in));
+  data.nEdges = narrow<std::size_t>(readLittleEndian<std::uint64_t>(in));
 
-  Matrix<Index, Dynamic, 2> E;
-  igl::edges(F, E);
+  data.positions.resize(3 * data.nVertices);
+  readLittleEndian<double>(in, data.positions.data(), data.positions.size());
 
-  using Idx = typename Mesh<T>::Index;
-  std::vector<Vertex<T>> vertices(mesh.vertexCount());
-  std::vector<Edge<Idx>> edges(narrow_cast<size_t>(E.rows()));
-  std::vector<Facet<Idx>> facets(mesh.triangleCount());
+  data.vertexOffsets.resize(data.nVertices + 1);
+  readLittleEndian<std::int64_t>(in, data.vertexOffsets.data(),
+                                 data.vertexOffsets.size());
 
-  typename Mesh<T>::Index vIdx{0};
-  for (auto &&adjacentVertices : vertexAdjacencyList) {
-    auto &vi = vertices[narrow_cast<size_t>(vIdx)];
-    vi.position = V.row(narrow_cast<Index>(vIdx));
-    vi.adjacentVertexIndices = adjacentVertices;
+  auto const nAdjacent = narrow<std::size_t>(data.vertexOffsets.back());
+  if (data.vertexOffsets.front() != Index{0}) {
+    throw std::invalid_argument("Corrupt binary SIMesh file");
+  }
 
-    if (includeLabels) { vi.label = L(vIdx); }
+  data.adjacentVertices.resize(nAdjacent);
+  readLittleEndian<std::int64_t>(in, data.adjacentVertices.data(), nAdjacent);
+  data.incidentEdges.resize(nAdjacent);
+  readLittleEndian<std::int64_t>(in, data.incidentEdges.data(), nAdjacent);
 
-    for (auto j = 0; j < E.rows(); ++j) {
-      if (E(j, 0) == vIdx || E(j, 1) == vIdx) {
-        vi.incidentEdgeIndices.push_back(narrow_cast<Idx>(j));
-      }
-    }
-    ++vIdx;
+  if (flags & binaryHasLabels) {
+    data.labels.resize(data.nVertices);
+    readLittleEndian<std::uint32_t>(in, data.labels.data(), data.nVertices);
   }
 
-  // Populate edge array
-  for (auto i = 0; i < E.rows(); ++i) {
-    auto &ei = edges[narrow_cast<size_t>(i)];
-    ei.vertexIndices[0] = E(i, 0);
-    ei.vertexIndices[1] = E(i, 1);
+  data.edges.resize(4 * data.nEdges);
+  readLittleEndian<std::int64_t>(in, data.edges.data(), data.edges.size());
+  data.facets.resize(6 * data.nTriangles);
+  readLittleEndian<std::int64_t>(in, data.facets.data(), data.facets.size());
 
-    auto j = 0;
-    for (auto u :
-         vertices[narrow_cast<size_t>(E(i, 0))].adjacentVertexIndices) {
-      if (u == E(i, 1)) break;
-      ++j;
-    }
-    ei.vertexNeighboursIndices[0] = j;
+  return data;
+}
 
-    j = 0;
-    for (auto u :
-         vertices[narrow_cast<size_t>(E(i, 1))].adjacentVertexIndices) {
-      if (u == E(i, 0)) break;
-      ++j;
-    }
-    ei.vertexNeighboursIndices[1] = j;
+// MARK: - Text format
+
+/// Parses the vertices, labels and facets of a text SIMesh file
+template <class T> SIMeshData<T> readText(std::string_view text) {
+  using gsl::narrow_cast;
+  using std::size_t;
+
+  TextCursor input{text};
+  SIMeshData<T> data;
+
+  {
+    TextCursor header{input.nextNonEmptyLine()};
+    header.parse(data.nVertices);
+    header.parse(data.nTriangles);
+    header.parse(data.nEdges);
   }
 
-  // Populate facet array
-  for (auto i = 0; i < F.rows(); ++i) {
-    auto &fi = facets[narrow_cast<size_t>(i)];
+  input.skipPast("Vertices");
 
-    fi.vertexIndices = F.row(i).transpose();
+  data.positions.resize(3 * data.nVertices);
+  data.labels.resize(data.nVertices, typename Mesh<T>::Label{0});
+  for (size_t i = 0; i < data.nVertices; ++i) {
+    TextCursor line{input.nextNonEmptyLine()};
+    line.parse(data.positions[3 * i]);
+    line.parse(data.positions[3 * i + 1]);
+    line.parse(data.positions[3 * i + 2]);
 
-    for (auto k = 0; k < 3; ++k) {
-      auto const vi = F(i, k);
-      auto const vj = F(i, (k + 1) % 3);
+    auto const degree = line.parse<std::size_t>();
+    for (size_t k = 0; k < 2 * degree; ++k) line.skipToken();
 
-      for (auto j = 0; j < E.rows(); ++j) {
-        if ((E(j, 0) == vi && E(j, 1) == vj) ||
-            (E(j, 0) == vj && E(j, 1) == vi)) {
-          fi.edgeIndices[k] = j;
-          break;
-        }
-      }
-    }
+    if (line.hasToken()) line.parse(data.labels[i]);
+  }
+
+  input.skipPast("Facets");
+
+  data.facets.resize(6 * data.nTriangles);
+  for (size_t f = 0; f < data.nTriangles; ++f) {
+    TextCursor line{input.nextNonEmptyLine()};
+    line.parse(data.facets[6 * f]);
+    line.parse(data.facets[6 * f + 1]);
+    line.parse(data.facets[6 * f + 2]);
   }
 
-  // Output
-  std::ofstream out(filename);
-  out << mesh.vertexCount() << " " << mesh.triangleCount() << " "
-      << edges.size() << std::endl;
-  out << "Vertices" << std::endl;
-  for (auto const &v : vertices) out << v << std::endl;
-  out << "Edges" << std::endl;
-  for (auto const &e : edges) out << e << std::endl;
-  out << "Facets" << std::endl;
-  for (auto const &f : facets) out << f << std::endl;
+  return data;
 }
 
-template <class T>
-Mesh<T> readFromSIMesh(std::string const &filename, bool withLabels) {
-  using namespace Eigen;
-  using namespace gsl;
+/// True iff the given file name refers to the binary SIMesh format
+inline bool isBinarySIMesh(std::string const &filename) {
+  return IO::extension(filename, true) == "simeshb";
+}
 
-  std::ifstream input{filename};
-  std::string line;
+} // namespace
 
-  // Skip to first line
-  while (std::getline(input, line)) {
-    if (line != "") break;
-  }
+template <class T>
+void writeToSIMesh(Mesh<T> const &mesh, std::string const &filename,
+                   bool includeLabels) {
+  auto const data = connectivity(mesh, includeLabels);
 
-  std::size_t nVertices, nTriangles, nEdges;
-  std::istringstream{line} >> nVertices >> nTriangles >> nEdges;
+  auto const binary = isBinarySIMesh(filename);
+  std::ofstream out(filename, binary ? std::ios::binary : std::ios::out);
 
-  // Skip to "Vertices block
-  while (std::getline(input, line)) {
-    if (line == "Vertices") break;
+  if (!out) {
+    throw std::invalid_argument("Failed to open file '" + filename +
+                                "' for writing");
   }
 
-  VertexMatrix<T> vertices(narrow_cast<Index>(nVertices), 3);
-  FacetMatrix facets(narrow_cast<Index>(nTriangles), 3);
-  LabelVector labels(narrow_cast<Index>(nVertices));
-  // Read vertices
-  for (auto i = 0; i < vertices.rows(); ++i) {
-    // skip empty lines
-    while (std::getline(input, line)) {
-      if (line != "") break;
-    }
-    std::istringstream is{line};
-    is >> vertices(i, 0) >> vertices(i, 1) >> vertices(i, 2);
-    int degree;
-    is >> degree;
-    int dummy;
-    // skip 2 * degree entries
-    for (auto j = 0; j < 2 * degree; ++j) is >> dummy;
-    if (!is.eof()) { is >> labels(i); }
+  if (binary) {
+    writeBinary(data, out);
+  } else {
+    writeText(data, out);
   }
+}
 
-  // Skip to "Facets block
-  while (std::getline(input, line)) {
-    if (line == "Facets") break;
-  }
+template <class T>
+Mesh<T> readFromSIMesh(std::string const &filename, bool withLabels) {
+  using gsl::narrow_cast;
 
-  for (auto i = 0; i < facets.rows(); ++i) {
-    // skip empty lines
-    while (std::getline(input, line)) {
-      if (line != "") break;
+  auto const data = [&filename]() {
+    if (isBinarySIMesh(filename)) {
+      std::ifstream in{filename, std::ios::binary};
+      if (!in) {
+        throw std::invalid_argument("Failed to open file '" + filename + "'");
+      }
+      return readBinary<T>(in);
     }
-    std::istringstream is{line};
-    is >> facets(i, 0) >> facets(i, 1) >> facets(i, 2);
-  }
+    return readText<T>(readFileContents(filename));
+  }();
 
-  auto mesh = Mesh<T>(nVertices, nTriangles);
+  auto mesh = Mesh<T>(data.nVertices, data.nTriangles);
 
-  mesh.withUnsafeVertexPointer([&vertices](auto *ptr) {
-    Map<Matrix<T, 3, Dynamic>>{ptr, 3, vertices.rows()} = vertices.transpose();
+  mesh.withUnsafeVertexPointer([&data](auto *ptr) {
+    std::copy(data.positions.cbegin(), data.positions.cend(), ptr);
   });
 
-  mesh.withUnsafeIndexPointer([&facets](auto *ptr) {
-    Map<Matrix<typename Mesh<T>::Index, 3, Dynamic>>{ptr, 3, facets.rows()} =
-        facets.transpose();
+  mesh.withUnsafeIndexPointer([&data](auto *ptr) {
+    for (std::size_t f = 0; f < data.nTriangles; ++f) {
+      std::copy_n(data.facets.data() + 6 * f, 3, ptr + 3 * f);
+    }
   });
 
-  if (withLabels) {
-    mesh.withUnsafeLabelPointer([&labels](auto *ptr) {
-      Map<Matrix<typename Mesh<T>::Label, Dynamic, 1>>{ptr, labels.rows()} =
-          labels;
+  if (withLabels && !data.labels.empty()) {
+    mesh.withUnsafeLabelPointer([&data](auto *ptr) {
+      std::copy(data.labels.cbegin(), data.labels.cend(), ptr);
     });
   }
 
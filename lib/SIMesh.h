@@ -13,13 +13,37 @@
 
 #include "Mesh.h"
 
+#include <string>
+
 namespace CortidQCT {
 namespace Internal {
 
+/// True iff the given extension (lower case) denotes a SIMesh file, either
+/// the text (`simesh`) or the binary (`simeshb`) variant.
+inline bool isSIMeshExtension(std::string const &extension) {
+  return extension == "simesh" || extension == "simeshb";
+}
+
+/**
+ * @brief Writes the given mesh to a SIMesh file
+ *
+ * Files with the extension `simeshb` are written in the binary variant of
+ * the format, all other files in the text format.
+ *
+ * @throws std::invalid_argument if the file could not be opened
+ */
 template <class T>
 void writeToSIMesh(Mesh<T> const &mesh, std::string const &filename,
                    bool includeLabels = false);
 
+/**
+ * @brief Reads a mesh from a SIMesh file
+ *
+ * Files with the extension `simeshb` are read as binary SIMesh files, all
+ * other files as text SIMesh files.
+ *
+ * @throws std::invalid_argument if the file could not be read or parsed
+ */
 template <class T>
 Mesh<T> readFromSIMesh(std::string const &filename, bool withLabels = true);
 
@@ -11,7 +11,9 @@
 
 #pragma once
 
+#include "DiscreteRangeDecorators.h"
 #include "MeasurementModel.h"
+#include "TraceRecorder.h"
 #include "VoxelVolume.h"
 
 #include <Eigen/Core>
@@ -19,6 +21,42 @@
 
 namespace CortidQCT {
 
+/**
+ * @brief Returns a matrix containing positions to sample a voxel volume at
+ *
+ * Let \f$N := |V|\f$ and let \f$M := |R|\f$, where \f$R\f$ represent
+ * `range`, then the returned 3xNM matrix contains N*M positions, where each M
+ * consecutive postitions represent a line through a vertex in `V` sampled
+ * along the surface normal in `N`.
+ *
+ * @param V 3xN matrix with vertex positions
+ * @param N 3xN matrix of per-vertex surface normals
+ * @param range distances along the normals, e.g. `model.samplingRange`
+ * @return 3xNM matrix containing sampling positions
+ */
+template <class DerivedV, class DerivedN>
+Eigen::Matrix<typename DerivedV::Scalar, 3, Eigen::Dynamic>
+samplingPoints(Eigen::MatrixBase<DerivedV> const &V,
+               Eigen::MatrixBase<DerivedN> const &N,
+               DiscreteRange<typename DerivedV::Scalar> const &range) {
+  using Scalar = typename DerivedV::Scalar;
+  using Eigen::Dynamic;
+  using Eigen::Matrix;
+
+  Expects(V.rows() == 3 && N.rows() == 3 && V.cols() == N.cols());
+
+  auto const t = Internal::discreteRangeElementVector(range);
+  Matrix<Scalar, 3, Dynamic> samples(3, V.cols() * t.rows());
+
+  for (auto i = 0; i < V.cols(); ++i) {
+    auto line = samples.middleCols(i * t.rows(), t.rows());
+    line.noalias() = -N.col(i) * t.transpose();
+    line.colwise() += V.col(i);
+  }
+
+  return samples;
+}
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wpadded"
 class VolumeSampler {
@@ -36,28 +74,84 @@ public:
                          Eigen::MatrixBase<DerivedOut> &values,
                          VoxelVolume::ValueType slope,
                          VoxelVolume::ValueType intercept) const {
+    Expects(values.rows() == positions.cols());
+    Expects(positions.rows() == 3);
+
+    auto const scale = voxelScale();
+
+    volume_.withUnsafeDataPointer([this, &positions, &values, &scale, slope,
+                                   intercept](auto const *ptr) {
+
+#pragma omp parallel
+      {
+        Internal::ScopedTraceEvent const trace{"VolumeSampler chunk"};
+
+#pragma omp for nowait
+        for (Eigen::Index j = 0; j < positions.cols(); ++j) {
+
+          values(j) = this->interpolate(
+                          (positions.col(j).array() * scale.array()).matrix(),
+                          gsl::make_not_null(ptr)) *
+                          slope +
+                      intercept;
+        }
+      }
+    });
+  }
+
+  /**
+   * @brief Samples the volume along the normal lines of the given vertices
+   *
+   * Equivalent, up to rounding, to sampling at the positions returned by
+   * `samplingPoints(V, N, range)`, but the positions are never stored: each
+   * line is walked incrementally in voxel coordinates, so the positions are
+   * accumulated by repeated addition and may differ in the last bits.
+   *
+   * @param V 3xN vertex matrix
+   * @param N 3xN per-vertex normal matrix
+   * @param range distances along the normals
+   * @param values NxM output matrix, the line of vertex `i` is written to row
+   * `i`. Pass a transposed map to store the lines consecutively instead.
+   * @param slope calibration slope
+   * @param intercept calibration intercept
+   */
+  template <class DerivedV, class DerivedN, class DerivedOut>
+  inline void sampleNormalLines(Eigen::MatrixBase<DerivedV> const &V,
+                                Eigen::MatrixBase<DerivedN> const &N,
+                                DiscreteRange<float> const &range,
+                                DerivedOut &&values,
+                                VoxelVolume::ValueType slope,
+                                VoxelVolume::ValueType intercept) const {
     using Eigen::Vector3f;
 
-    Expects(values.rows() == positions.rows());
-    Expects(positions.cols() == 3);
+    auto const M = gsl::narrow<Eigen::Index>(range.numElements());
 
-    Vector3f const scale{1.f / volume_.voxelSize().width,
-                         1.f / volume_.voxelSize().height,
-                         1.f / volume_.voxelSize().depth};
+    Expects(V.rows() == 3 && N.rows() == 3 && V.cols() == N.cols());
+    Expects(values.rows() == V.cols() && values.cols() == M);
 
-    volume_.withUnsafeDataPointer([this, &positions, &values, scale, slope,
-                                   intercept](auto const *ptr) {
+    auto const scale = voxelScale();
 
-#pragma omp parallel for
-      for (Eigen::Index i = 0; i < positions.rows(); ++i) {
+    volume_.withUnsafeDataPointer([this, &V, &N, &range, &values, &scale, M,
+                                   slope, intercept](auto const *ptr) {
 
-        values(i) = this->interpolate(
-                        (positions.row(i).array() * scale.array().transpose())
-                            .matrix()
-                            .transpose(),
-                        gsl::make_not_null(ptr)) *
-                        slope +
-                    intercept;
+#pragma omp parallel
+      {
+        Internal::ScopedTraceEvent const trace{"sampleNormalLines chunk"};
+
+#pragma omp for nowait
+        for (Eigen::Index i = 0; i < V.cols(); ++i) {
+          Vector3f const n =
+              N.col(i).template cast<float>().cwiseProduct(scale);
+          Vector3f const step = -range.stride * n;
+          Vector3f pos = V.col(i).template cast<float>().cwiseProduct(scale) -
+                         range.min * n;
+
+          for (Eigen::Index k = 0; k < M; ++k, pos += step) {
+            values(i, k) =
+                this->interpolate(pos, gsl::make_not_null(ptr)) * slope +
+                intercept;
+          }
+        }
       }
     });
   }
@@ -68,7 +162,7 @@ public:
              VoxelVolume::ValueType slope,
              VoxelVolume::ValueType intercept) const {
     Eigen::Matrix<VoxelVolume::ValueType, Eigen::Dynamic, 1> values(
-        positions.rows());
+        positions.cols());
 
     operator()(positions, values, slope, intercept);
 
@@ -76,6 +170,12 @@ public:
   }
 
 private:
+  /// Scale factors from world to voxel coordinates
+  inline Eigen::Vector3f voxelScale() const {
+    return {1.f / volume_.voxelSize().width, 1.f / volume_.voxelSize().height,
+            1.f / volume_.voxelSize().depth};
+  }
+
   template <class Derived>
   inline VoxelVolume::ValueType
   at(Eigen::MatrixBase<Derived> const &pos,
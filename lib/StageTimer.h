@@ -0,0 +1,65 @@
+/**
+ * @file      StageTimer.h
+ *
+ * @brief     This private header contains a scoped timer for measuring the
+ * stages of the fitting algorithm.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "lib_config.h"
+
+#ifdef CORTIDQCT_WITH_STAGE_TIMERS
+#  include <chrono>
+#endif
+
+namespace CortidQCT {
+namespace Internal {
+
+#ifdef CORTIDQCT_WITH_STAGE_TIMERS
+
+/// Adds the wall clock time of its lifetime, in seconds, to an accumulator
+class ScopedStageTimer {
+public:
+  inline explicit ScopedStageTimer(double &accumulator) noexcept
+      : accumulator_(accumulator), start_(Clock::now()) {}
+
+  inline ~ScopedStageTimer() {
+    accumulator_ +=
+        std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  ScopedStageTimer(ScopedStageTimer const &) = delete;
+  ScopedStageTimer(ScopedStageTimer &&) = delete;
+  ScopedStageTimer &operator=(ScopedStageTimer const &) = delete;
+  ScopedStageTimer &operator=(ScopedStageTimer &&) = delete;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  double &accumulator_;
+  Clock::time_point start_;
+};
+
+#else
+
+/// Timers are disabled, the accumulator is left untouched
+class ScopedStageTimer {
+public:
+  inline explicit ScopedStageTimer(double &) noexcept {}
+
+  ScopedStageTimer(ScopedStageTimer const &) = delete;
+  ScopedStageTimer(ScopedStageTimer &&) = delete;
+  ScopedStageTimer &operator=(ScopedStageTimer const &) = delete;
+  ScopedStageTimer &operator=(ScopedStageTimer &&) = delete;
+};
+
+#endif
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,62 @@
+/**
+ * @file      StopCondition.h
+ *
+ * @brief     This private header contains the condition that stops a fit
+ * early.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "FitOptions.h"
+
+namespace CortidQCT {
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Deadline and cancellation token of a running fit
+ *
+ * A default constructed condition is never met.
+ */
+class StopCondition {
+public:
+  using Clock = FitOptions::Clock;
+
+  StopCondition() = default;
+
+  /// Constructs the condition of a fit that starts now
+  inline explicit StopCondition(FitOptions const &options)
+      : deadline_(options.deadline), token_(options.cancellationToken) {
+    if (options.timeout != Clock::duration::max()) {
+      auto const now = Clock::now();
+      if (options.timeout < deadline_ - now) {
+        deadline_ = now + options.timeout;
+      }
+    }
+  }
+
+  /// Returns true iff the condition may ever be met
+  inline bool isActive() const noexcept {
+    return deadline_ != Clock::time_point::max() || token_.has_value();
+  }
+
+  /// Returns true iff the fit must stop
+  inline bool isMet() const noexcept {
+    return (token_.has_value() && token_->isCancelled()) ||
+           (deadline_ != Clock::time_point::max() && Clock::now() >= deadline_);
+  }
+
+private:
+  Clock::time_point deadline_ = Clock::time_point::max();
+  std::optional<CancellationToken> token_;
+};
+#pragma clang diagnostic pop
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,116 @@
+/**
+ * @file      TaskScheduler.cpp
+ *
+ * @brief     Implementation of the task scheduler
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "TaskScheduler.h"
+#include "TraceRecorder.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#  include <omp.h>
+#endif
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+/// Number of cores available to the process
+std::size_t coreCount() {
+#ifdef _OPENMP
+  // Respects OMP_NUM_THREADS
+  return gsl::narrow_cast<std::size_t>(omp_get_max_threads());
+#else
+  return std::max(std::size_t{1}, static_cast<std::size_t>(
+                                      std::thread::hardware_concurrency()));
+#endif
+}
+
+} // anonymous namespace
+
+ParallelismSplit splitParallelism(std::size_t taskCount,
+                                  std::size_t maxWorkers) {
+  auto const cores = coreCount();
+  auto workers = std::min(cores, std::max(taskCount, std::size_t{1}));
+  if (maxWorkers > 0) { workers = std::min(workers, maxWorkers); }
+
+  return {workers, std::max(std::size_t{1}, cores / workers)};
+}
+
+void runTasks(std::size_t taskCount, std::size_t maxWorkers,
+              std::function<void(std::size_t)> const &task) {
+  if (taskCount == 0) return;
+
+  auto const split = splitParallelism(taskCount, maxWorkers);
+
+  if (split.workers == 1) {
+    for (auto i = 0u; i < taskCount; ++i) { task(i); }
+    return;
+  }
+
+  std::atomic<std::size_t> next{0};
+  std::atomic<bool> failed{false};
+  std::exception_ptr firstError;
+  std::mutex errorMutex;
+
+  auto const work = [&]() {
+#ifdef _OPENMP
+    omp_set_num_threads(gsl::narrow_cast<int>(split.threadsPerWorker));
+#endif
+    while (!failed) {
+      auto const i = next++;
+      if (i >= taskCount) return;
+      try {
+        ScopedTraceEvent const trace{"task"};
+        task(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{errorMutex};
+        if (!firstError) { firstError = std::current_exception(); }
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(split.workers - 1);
+  try {
+    for (auto w = 1u; w < split.workers; ++w) { threads.emplace_back(work); }
+  } catch (...) {
+    // Destroying a joinable thread terminates, so stop the running workers
+    failed = true;
+    for (auto &thread : threads) { thread.join(); }
+    throw;
+  }
+
+  // The calling thread is one of the workers, its OpenMP setting is restored
+  // afterwards
+#ifdef _OPENMP
+  auto const callerThreads = omp_get_max_threads();
+#endif
+  work();
+#ifdef _OPENMP
+  omp_set_num_threads(callerThreads);
+#endif
+
+  for (auto &thread : threads) { thread.join(); }
+
+  if (firstError) { std::rethrow_exception(firstError); }
+}
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,61 @@
+/**
+ * @file      TaskScheduler.h
+ *
+ * @brief     This file contains a minimal scheduler for running independent
+ * tasks concurrently.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace CortidQCT {
+namespace Internal {
+
+/// Number of concurrent workers and OpenMP threads used by each of them
+struct ParallelismSplit {
+  /// Number of tasks running concurrently
+  std::size_t workers = 1;
+  /// Number of OpenMP threads used by the parallel loops of each task
+  std::size_t threadsPerWorker = 1;
+};
+
+/**
+ * @brief Splits the available cores between concurrent tasks and the
+ * parallel loops inside of each task
+ *
+ * If there are at least as many tasks as cores, each core runs its own task
+ * single threaded. Otherwise each task gets an equal share of the cores for
+ * its parallel loops.
+ *
+ * @param taskCount number of tasks
+ * @param maxWorkers upper bound of concurrent tasks, 0 for no bound
+ */
+ParallelismSplit splitParallelism(std::size_t taskCount,
+                                  std::size_t maxWorkers);
+
+/**
+ * @brief Runs `task(i)` for all `i` in `[0, taskCount)` on a pool of worker
+ * threads
+ *
+ * Tasks are started in order of their index. If a task throws, no further
+ * tasks are started and the first exception is rethrown after all running
+ * tasks have finished. If only one worker is used, the tasks run on the
+ * calling thread.
+ *
+ * @param taskCount number of tasks
+ * @param maxWorkers upper bound of concurrent tasks, 0 for no bound
+ * @param task the task
+ * @see splitParallelism()
+ */
+void runTasks(std::size_t taskCount, std::size_t maxWorkers,
+              std::function<void(std::size_t)> const &task);
+
+} // namespace Internal
+} // namespace CortidQCT
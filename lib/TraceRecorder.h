@@ -0,0 +1,67 @@
+/**
+ * @file      TraceRecorder.h
+ *
+ * @brief     This private header contains the recorder for trace events.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+namespace CortidQCT {
+namespace Internal {
+
+using TraceClock = std::chrono::steady_clock;
+
+/// True iff trace events are being recorded
+extern std::atomic<bool> tracingEnabled;
+
+/**
+ * @brief Appends an event to the trace buffer of the calling thread
+ *
+ * Each thread has its own buffer, so no synchronization is required. The
+ * event is dropped if the buffer cannot grow.
+ *
+ * @param name Name of the event, must have static storage duration
+ */
+void recordTraceEvent(char const *name, TraceClock::time_point begin,
+                      TraceClock::time_point end) noexcept;
+
+/**
+ * @brief Records the lifetime of this object as a trace event
+ *
+ * Does nothing but a relaxed atomic load if tracing is disabled.
+ */
+class ScopedTraceEvent {
+public:
+  /// @param name Name of the event, must have static storage duration
+  inline explicit ScopedTraceEvent(char const *name) noexcept
+      : name_(tracingEnabled.load(std::memory_order_relaxed) ? name
+                                                              : nullptr) {
+    if (name_ != nullptr) { begin_ = TraceClock::now(); }
+  }
+
+  inline ~ScopedTraceEvent() {
+    if (name_ != nullptr) {
+      recordTraceEvent(name_, begin_, TraceClock::now());
+    }
+  }
+
+  ScopedTraceEvent(ScopedTraceEvent const &) = delete;
+  ScopedTraceEvent(ScopedTraceEvent &&) = delete;
+  ScopedTraceEvent &operator=(ScopedTraceEvent const &) = delete;
+  ScopedTraceEvent &operator=(ScopedTraceEvent &&) = delete;
+
+private:
+  char const *name_;
+  TraceClock::time_point begin_;
+};
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -0,0 +1,152 @@
+/**
+ * @file      Tracing.cpp
+ *
+ * @brief     Implementation file for the trace event recorder
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "Tracing.h"
+#include "TraceRecorder.h"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+std::atomic<bool> tracingEnabled{false};
+
+namespace {
+
+struct TraceEvent {
+  char const *name;
+  TraceClock::time_point begin;
+  TraceClock::time_point end;
+};
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+struct ThreadTraceBuffer {
+  /// Sequential id of the thread, used as trace thread id
+  std::size_t threadId;
+  std::vector<TraceEvent> events;
+};
+
+/// Owns the buffers of all threads that ever recorded an event
+struct TraceRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;
+  std::size_t nextThreadId = 0;
+  TraceClock::time_point start;
+};
+#pragma clang diagnostic pop
+
+/// Created on first use and never destroyed, so that threads may still
+/// record events while the program exits
+TraceRegistry &traceRegistry() {
+  static auto *const registry = new TraceRegistry;
+  return *registry;
+}
+
+/**
+ * @brief Returns the buffer of the calling thread, registers it on first use
+ *
+ * The registry owns the buffer, so the events outlive the thread. The buffer
+ * of an exited thread is not released but emptied by the next
+ * `startTracing()`.
+ */
+ThreadTraceBuffer &threadTraceBuffer() {
+  thread_local ThreadTraceBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    auto &registry = traceRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.buffers.push_back(std::make_unique<ThreadTraceBuffer>());
+    buffer = registry.buffers.back().get();
+    buffer->threadId = registry.nextThreadId++;
+  }
+  return *buffer;
+}
+
+/// Microseconds between `start` and `time`
+double microseconds(TraceClock::time_point start,
+                    TraceClock::time_point time) {
+  return std::chrono::duration<double, std::micro>(time - start).count();
+}
+
+} // anonymous namespace
+
+void recordTraceEvent(char const *name, TraceClock::time_point begin,
+                      TraceClock::time_point end) noexcept {
+  try {
+    threadTraceBuffer().events.push_back({name, begin, end});
+  } catch (...) {
+    // Dropping an event is better than terminating the fit
+  }
+}
+
+} // namespace Internal
+
+using namespace Internal;
+
+void startTracing() {
+  auto &registry = traceRegistry();
+  std::lock_guard<std::mutex> lock{registry.mutex};
+
+  // Also releases the memory of buffers of threads that exited meanwhile
+  for (auto &buffer : registry.buffers) {
+    std::vector<TraceEvent>{}.swap(buffer->events);
+  }
+
+  registry.start = TraceClock::now();
+  tracingEnabled = true;
+}
+
+void stopTracing(std::string const &filename) {
+  tracingEnabled = false;
+
+  auto &registry = traceRegistry();
+  std::lock_guard<std::mutex> lock{registry.mutex};
+
+  std::ofstream out{filename};
+  if (!out) {
+    throw std::invalid_argument("Failed to open file '" + filename + "'");
+  }
+
+  out.setf(std::ios::fixed);
+  out.precision(3);
+
+  out << "{\"traceEvents\":[";
+  auto first = true;
+  for (auto const &buffer : registry.buffers) {
+    if (buffer->events.empty()) continue;
+
+    out << (first ? "\n" : ",\n") << R"({"name":"thread_name","ph":"M",)"
+        << R"("pid":1,"tid":)" << buffer->threadId
+        << R"(,"args":{"name":"Thread )" << buffer->threadId << "\"}}";
+    first = false;
+
+    for (auto const &event : buffer->events) {
+      out << ",\n"
+          << R"({"name":")" << event.name << R"(","cat":"CortidQCT",)"
+          << R"("ph":"X","pid":1,"tid":)" << buffer->threadId
+          << ",\"ts\":" << microseconds(registry.start, event.begin)
+          << ",\"dur\":" << microseconds(event.begin, event.end) << '}';
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+  if (!out) {
+    throw std::invalid_argument("Failed to write file '" + filename + "'");
+  }
+}
+
+bool isTracing() noexcept { return tracingEnabled; }
+
+} // namespace CortidQCT
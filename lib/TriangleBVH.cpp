@@ -0,0 +1,429 @@
+/**
+ * @file      TriangleBVH.cpp
+ *
+ * @brief     Implementation of the triangle bounding volume hierarchy
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "TriangleBVH.h"
+
+#include <gsl/gsl>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace CortidQCT {
+namespace Internal {
+
+namespace {
+
+template <class T> using Vector3 = Eigen::Matrix<T, 3, 1>;
+
+/// Depth of the self traversal at which parallel tasks are spawned
+constexpr int parallelTaskDepth = 8;
+
+template <class T, class Index>
+inline Vector3<T> vertex(T const *vertices, Index i) {
+  return Eigen::Map<Vector3<T> const>{vertices + 3 * i};
+}
+
+/// Möller-Trumbore test of the segment `(p, q)` against triangle `(a, b, c)`
+template <class T>
+bool segmentIntersectsTriangle(Vector3<T> const &p, Vector3<T> const &q,
+                               Vector3<T> const &a, Vector3<T> const &b,
+                               Vector3<T> const &c) {
+  Vector3<T> const d = q - p;
+  Vector3<T> const e1 = b - a;
+  Vector3<T> const e2 = c - a;
+  Vector3<T> const h = d.cross(e2);
+  auto const det = e1.dot(h);
+
+  // Segment parallel to the triangle plane
+  auto const tolerance =
+      std::numeric_limits<T>::epsilon() * e1.norm() * e2.norm() * d.norm();
+  if (std::abs(det) <= tolerance) return false;
+
+  auto const f = T{1} / det;
+  Vector3<T> const s = p - a;
+  auto const u = f * s.dot(h);
+  if (u < T{0} || u > T{1}) return false;
+
+  Vector3<T> const r = s.cross(e1);
+  auto const v = f * d.dot(r);
+  if (v < T{0} || u + v > T{1}) return false;
+
+  auto const t = f * e2.dot(r);
+  return t >= T{0} && t <= T{1};
+}
+
+/// True iff an edge of one triangle crosses the other triangle
+template <class T>
+bool trianglesIntersect(std::array<Vector3<T>, 3> const &A,
+                        std::array<Vector3<T>, 3> const &B) {
+  for (auto k = 0u; k < 3; ++k) {
+    auto const l = (k + 1) % 3;
+    if (segmentIntersectsTriangle(A[k], A[l], B[0], B[1], B[2]) ||
+        segmentIntersectsTriangle(B[k], B[l], A[0], A[1], A[2])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// True iff the line `origin + t * direction` intersects the box
+template <class T>
+bool lineIntersectsBox(Eigen::AlignedBox<T, 3> const &box,
+                       Vector3<T> const &origin,
+                       Vector3<T> const &direction) {
+  auto tMin = -std::numeric_limits<T>::infinity();
+  auto tMax = std::numeric_limits<T>::infinity();
+
+  for (auto i = 0; i < 3; ++i) {
+    if (direction[i] == T{0}) {
+      if (origin[i] < box.min()[i] || origin[i] > box.max()[i]) return false;
+      continue;
+    }
+    auto t0 = (box.min()[i] - origin[i]) / direction[i];
+    auto t1 = (box.max()[i] - origin[i]) / direction[i];
+    if (t0 > t1) std::swap(t0, t1);
+    tMin = std::max(tMin, t0);
+    tMax = std::min(tMax, t1);
+    if (tMin > tMax) return false;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+template <class T>
+TriangleBVH<T>::TriangleBVH(T const *vertices, Index const *indices,
+                            std::size_t triangleCount)
+    : triangleOrder_(triangleCount),
+      indices_(indices, indices + 3 * triangleCount) {
+  using gsl::narrow_cast;
+
+  if (triangleCount == 0) return;
+
+  std::vector<Vector3<T>> centroids(triangleCount);
+  auto const nF = narrow_cast<Index>(triangleCount);
+#pragma omp parallel for
+  for (Index f = 0; f < nF; ++f) {
+    centroids[narrow_cast<std::size_t>(f)] =
+        (vertex(vertices, indices[3 * f]) +
+         vertex(vertices, indices[3 * f + 1]) +
+         vertex(vertices, indices[3 * f + 2])) /
+        T{3};
+    triangleOrder_[narrow_cast<std::size_t>(f)] = f;
+  }
+
+  nodes_.reserve(4 * (triangleCount / maxLeafSize + 1));
+  build(0, nF, vertices, centroids);
+}
+
+template <class T>
+auto TriangleBVH<T>::triangleBox(Index triangle, T const *vertices) const
+    -> Box {
+  auto const *tri = indices_.data() + 3 * triangle;
+  Box box{vertex(vertices, tri[0])};
+  box.extend(vertex(vertices, tri[1]));
+  box.extend(vertex(vertices, tri[2]));
+  return box;
+}
+
+template <class T>
+bool TriangleBVH<T>::shareVertex(Index a, Index b) const {
+  auto const *ta = indices_.data() + 3 * a;
+  auto const *tb = indices_.data() + 3 * b;
+  return std::any_of(ta, ta + 3, [tb](Index i) {
+    return i == tb[0] || i == tb[1] || i == tb[2];
+  });
+}
+
+template <class T>
+auto TriangleBVH<T>::build(Index first, Index count, T const *vertices,
+                           std::vector<Vector3<T>> const &centroids) -> Index {
+  using gsl::narrow_cast;
+
+  auto const nodeIndex = narrow_cast<Index>(nodes_.size());
+  nodes_.emplace_back();
+
+  auto const begin = triangleOrder_.begin() + first;
+  auto const end = begin + count;
+
+  if (count <= maxLeafSize) {
+    Box box;
+    std::for_each(begin, end, [&](Index f) {
+      box.extend(triangleBox(f, vertices));
+    });
+
+    auto &node = nodes_[narrow_cast<std::size_t>(nodeIndex)];
+    node.box = box;
+    node.first = first;
+    node.count = count;
+    node.end = nodeIndex + 1;
+    leaves_.push_back(nodeIndex);
+    return nodeIndex;
+  }
+
+  // Split at the median centroid along the longest axis
+  Box centroidBox;
+  std::for_each(begin, end, [&](Index f) {
+    centroidBox.extend(centroids[narrow_cast<std::size_t>(f)]);
+  });
+  Eigen::Index axis;
+  centroidBox.sizes().maxCoeff(&axis);
+
+  auto const half = count / 2;
+  std::nth_element(begin, begin + half, end, [&](Index a, Index b) {
+    return centroids[narrow_cast<std::size_t>(a)][axis] <
+           centroids[narrow_cast<std::size_t>(b)][axis];
+  });
+
+  build(first, half, vertices, centroids);
+  auto const right = build(first + half, count - half, vertices, centroids);
+
+  auto &node = nodes_[narrow_cast<std::size_t>(nodeIndex)];
+  auto const &leftNode = nodes_[narrow_cast<std::size_t>(nodeIndex + 1)];
+  auto const &rightNode = nodes_[narrow_cast<std::size_t>(right)];
+  node.box = leftNode.box.merged(rightNode.box);
+  node.right = right;
+  node.end = rightNode.end;
+
+  return nodeIndex;
+}
+
+template <class T> void TriangleBVH<T>::refit(T const *vertices) {
+  using gsl::narrow_cast;
+
+  auto const nLeaves = narrow_cast<Index>(leaves_.size());
+
+#pragma omp parallel for
+  for (Index l = 0; l < nLeaves; ++l) {
+    auto &node = nodes_[narrow_cast<std::size_t>(
+        leaves_[narrow_cast<std::size_t>(l)])];
+    Box box;
+    for (auto i = node.first; i < node.first + node.count; ++i) {
+      box.extend(
+          triangleBox(triangleOrder_[narrow_cast<std::size_t>(i)], vertices));
+    }
+    node.box = box;
+  }
+
+  // Children are stored after their parents
+  for (auto k = narrow_cast<Index>(nodes_.size()) - 1; k >= 0; --k) {
+    auto &node = nodes_[narrow_cast<std::size_t>(k)];
+    if (node.isLeaf()) continue;
+    node.box = nodes_[narrow_cast<std::size_t>(k + 1)].box.merged(
+        nodes_[narrow_cast<std::size_t>(node.right)].box);
+  }
+}
+
+/**
+ * @brief Simultaneous traversal of the hierarchy with itself
+ *
+ * If `tasks` is set, node pairs reached at depth `taskDepth` are appended to
+ * it instead of being traversed, so that they can be processed in parallel.
+ */
+template <class T> struct TriangleBVH<T>::PairTraversal {
+  using NodePair = std::array<Index, 2>;
+
+  TriangleBVH const &bvh;
+  std::vector<Box> const &boxes;
+  T const *vertices;
+  std::vector<TrianglePair> &intersections;
+  std::vector<NodePair> *tasks = nullptr;
+  int taskDepth = 0;
+
+  /// Traverses the subtree of `k` with itself
+  void self(Index k, int depth = 0) {
+    if (defer(k, k, depth)) return;
+
+    auto const &node = bvh.node(k);
+    if (node.isLeaf()) {
+      testLeaves(node, node, true);
+      return;
+    }
+
+    self(k + 1, depth + 1);
+    self(node.right, depth + 1);
+    pair(k + 1, node.right, depth + 1);
+  }
+
+  /// Traverses the subtree of `a` with the subtree of `b`
+  void pair(Index a, Index b, int depth = 0) {
+    auto const &nodeA = bvh.node(a);
+    auto const &nodeB = bvh.node(b);
+    if (!nodeA.box.intersects(nodeB.box)) return;
+    if (defer(a, b, depth)) return;
+
+    if (nodeA.isLeaf() && nodeB.isLeaf()) {
+      testLeaves(nodeA, nodeB, false);
+      return;
+    }
+
+    // Descend into the larger subtree
+    if (nodeB.isLeaf() ||
+        (!nodeA.isLeaf() && nodeA.end - a >= nodeB.end - b)) {
+      pair(a + 1, b, depth + 1);
+      pair(nodeA.right, b, depth + 1);
+    } else {
+      pair(a, b + 1, depth + 1);
+      pair(a, nodeB.right, depth + 1);
+    }
+  }
+
+  bool defer(Index a, Index b, int depth) {
+    if (tasks == nullptr || depth < taskDepth) return false;
+    tasks->push_back({{a, b}});
+    return true;
+  }
+
+  void testLeaves(Node const &leafA, Node const &leafB, bool isSame) {
+    auto const &order = bvh.triangleOrder_;
+
+    for (auto i = leafA.first; i < leafA.first + leafA.count; ++i) {
+      auto const a = order[static_cast<std::size_t>(i)];
+      auto const &boxA = boxes[static_cast<std::size_t>(i)];
+
+      for (auto j = isSame ? i + 1 : leafB.first;
+           j < leafB.first + leafB.count; ++j) {
+        auto const b = order[static_cast<std::size_t>(j)];
+        if (!boxA.intersects(boxes[static_cast<std::size_t>(j)]) ||
+            bvh.shareVertex(a, b)) {
+          continue;
+        }
+        if (trianglesIntersect(triangle(a), triangle(b))) {
+          intersections.push_back({{std::min(a, b), std::max(a, b)}});
+        }
+      }
+    }
+  }
+
+  std::array<Vector3<T>, 3> triangle(Index f) const {
+    auto const *tri = bvh.indices_.data() + 3 * f;
+    return {{vertex(vertices, tri[0]), vertex(vertices, tri[1]),
+             vertex(vertices, tri[2])}};
+  }
+};
+
+template <class T>
+auto TriangleBVH<T>::selfIntersections(T const *vertices) const
+    -> std::vector<TrianglePair> {
+  using gsl::narrow_cast;
+
+  std::vector<TrianglePair> result;
+  if (isEmpty()) return result;
+
+  // Triangle boxes in leaf order
+  auto const nF = narrow_cast<Index>(triangleOrder_.size());
+  std::vector<Box> boxes(triangleOrder_.size());
+#pragma omp parallel for
+  for (Index i = 0; i < nF; ++i) {
+    boxes[narrow_cast<std::size_t>(i)] =
+        triangleBox(triangleOrder_[narrow_cast<std::size_t>(i)], vertices);
+  }
+
+  // Traverse the top levels serially to collect independent tasks
+  std::vector<typename PairTraversal::NodePair> tasks;
+  PairTraversal{*this, boxes, vertices, result, &tasks, parallelTaskDepth}
+      .self(0);
+
+  auto const nTasks = narrow_cast<Index>(tasks.size());
+
+#pragma omp parallel
+  {
+    std::vector<TrianglePair> local;
+    PairTraversal traversal{*this, boxes, vertices, local};
+
+#pragma omp for schedule(dynamic) nowait
+    for (Index t = 0; t < nTasks; ++t) {
+      auto const &task = tasks[narrow_cast<std::size_t>(t)];
+      if (task[0] == task[1]) {
+        traversal.self(task[0]);
+      } else {
+        traversal.pair(task[0], task[1]);
+      }
+    }
+
+#pragma omp critical
+    result.insert(result.end(), local.cbegin(), local.cend());
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+template <class T>
+void TriangleBVH<T>::lineIntersections(T const *vertices,
+                                       Vector3<T> const &origin,
+                                       Vector3<T> const &direction,
+                                       std::vector<LineHit> &hits) const {
+  using gsl::narrow_cast;
+
+  hits.clear();
+  if (isEmpty()) return;
+
+  // Median splits keep the depth below log2 of the triangle count
+  std::array<Index, 64> stack;
+  std::size_t top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    auto const k = stack[--top];
+    auto const &current = node(k);
+    if (!lineIntersectsBox(current.box, origin, direction)) continue;
+
+    if (!current.isLeaf()) {
+      stack[top++] = current.right;
+      stack[top++] = k + 1;
+      continue;
+    }
+
+    for (auto i = current.first; i < current.first + current.count; ++i) {
+      auto const f = triangleOrder_[narrow_cast<std::size_t>(i)];
+      auto const *tri = indices_.data() + 3 * f;
+      Vector3<T> const a = vertex(vertices, tri[0]);
+      Vector3<T> const e1 = vertex(vertices, tri[1]) - a;
+      Vector3<T> const e2 = vertex(vertices, tri[2]) - a;
+
+      // Möller-Trumbore, inclusive on the edges
+      Vector3<T> const h = direction.cross(e2);
+      auto const det = e1.dot(h);
+      if (det == T{0}) continue;
+
+      auto const inv = T{1} / det;
+      Vector3<T> const s = origin - a;
+      auto const u = inv * s.dot(h);
+      if (u < T{0} || u > T{1}) continue;
+
+      Vector3<T> const r = s.cross(e1);
+      auto const v = inv * direction.dot(r);
+      if (v < T{0} || u + v > T{1}) continue;
+
+      hits.push_back({f, inv * e2.dot(r), {{T{1} - u - v, u}}});
+    }
+  }
+
+  std::sort(hits.begin(), hits.end(),
+            [](auto const &a, auto const &b) { return a.t < b.t; });
+
+  // Remove hits of adjacent triangles at the same position
+  auto const tolerance = std::sqrt(std::numeric_limits<T>::epsilon()) *
+                         node(0).box.diagonal().norm() / direction.norm();
+  auto const last = std::unique(
+      hits.begin(), hits.end(), [&](auto const &a, auto const &b) {
+        return b.t - a.t <= tolerance && shareVertex(a.triangle, b.triangle);
+      });
+  hits.erase(last, hits.end());
+}
+
+template class TriangleBVH<float>;
+template class TriangleBVH<double>;
+
+} // namespace Internal
+} // namespace CortidQCT
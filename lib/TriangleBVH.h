@@ -0,0 +1,176 @@
+/**
+ * @file      TriangleBVH.h
+ *
+ * @brief     This file contains the definition of a refittable bounding
+ * volume hierarchy over the triangles of a mesh.
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include <Eigen/Geometry>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace CortidQCT {
+namespace Internal {
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wpadded"
+/**
+ * @brief Binary bounding volume hierarchy of axis aligned boxes over the
+ * triangles of a mesh
+ *
+ * The hierarchy is built once from the triangle indices. When the vertices
+ * move but the connectivity stays the same (e.g. during fitting), `refit()`
+ * updates the boxes in place without changing the tree structure.
+ *
+ * Nodes are stored in depth first order: the left child of an inner node
+ * directly follows its parent and the subtree of node `k` occupies the nodes
+ * `k, ..., nodes()[k].end - 1`.
+ *
+ * @tparam T Scalar type of the vertices
+ */
+template <class T> class TriangleBVH {
+public:
+  using Index = std::ptrdiff_t;
+  using Box = Eigen::AlignedBox<T, 3>;
+  /// Pair of triangle indices
+  using TrianglePair = std::array<Index, 2>;
+
+  /// Node of the hierarchy
+  struct Node {
+    /// Bounding box of all triangles in the subtree
+    Box box;
+    /// Index of the first triangle in `triangleOrder()` (leaves only)
+    Index first = 0;
+    /// Number of triangles, 0 for inner nodes
+    Index count = 0;
+    /// Index of the right child (inner nodes only)
+    Index right = 0;
+    /// Index one past the last node of the subtree
+    Index end = 0;
+
+    /// True iff the node is a leaf
+    inline bool isLeaf() const noexcept { return count > 0; }
+  };
+
+  /// Intersection of a line with a triangle
+  struct LineHit {
+    /// Index of the triangle
+    Index triangle;
+    /// Line parameter of the intersection
+    T t;
+    /// Barycentric weights of the first and second corner of the triangle
+    std::array<T, 2> uv;
+  };
+
+  /// Maximum number of triangles per leaf
+  static constexpr Index maxLeafSize = 4;
+
+  /// Constructs an empty hierarchy
+  TriangleBVH() = default;
+
+  /**
+   * @brief Builds the hierarchy
+   *
+   * @param vertices vertex positions in `Mesh` storage layout
+   * @param indices triangle indices in `Mesh` storage layout
+   * @param triangleCount number of triangles
+   */
+  TriangleBVH(T const *vertices, Index const *indices,
+              std::size_t triangleCount);
+
+  /// True iff the hierarchy contains no triangles
+  inline bool isEmpty() const noexcept { return nodes_.empty(); }
+
+  /// Nodes of the hierarchy, the root is the first node
+  inline std::vector<Node> const &nodes() const noexcept { return nodes_; }
+
+  /// Triangle indices in leaf order
+  inline std::vector<Index> const &triangleOrder() const noexcept {
+    return triangleOrder_;
+  }
+
+  /// Triangle indices the hierarchy was built for
+  inline std::vector<Index> const &indices() const noexcept {
+    return indices_;
+  }
+
+  /**
+   * @brief Updates the bounding boxes for the given vertex positions
+   *
+   * Leaves are updated in parallel. The vertex count and the triangles must
+   * not have changed since construction.
+   *
+   * @param vertices vertex positions in `Mesh` storage layout
+   */
+  void refit(T const *vertices);
+
+  /**
+   * @brief Finds all pairs of intersecting triangles
+   *
+   * Triangles that share a vertex are not tested against each other. Two
+   * triangles are considered intersecting if an edge of one of them crosses
+   * the other one, i.e. coplanar overlaps are not reported. The leaves are
+   * processed in parallel.
+   *
+   * @param vertices vertex positions in `Mesh` storage layout, the hierarchy
+   * must have been built or refitted for these positions
+   * @return pairs `(i, j)` of intersecting triangles with `i < j`, sorted
+   */
+  std::vector<TrianglePair> selfIntersections(T const *vertices) const;
+
+  /**
+   * @brief Finds all intersections of the line `origin + t * direction`,
+   * `t` in R, with the triangles
+   *
+   * Intersections on an edge or vertex shared by several triangles are
+   * reported once.
+   *
+   * @param vertices vertex positions in `Mesh` storage layout, the hierarchy
+   * must have been built or refitted for these positions
+   * @param origin point on the line
+   * @param direction direction of the line, must not be zero
+   * @param hits output, cleared and filled with the intersections sorted by
+   * `t`
+   */
+  void lineIntersections(T const *vertices,
+                         Eigen::Matrix<T, 3, 1> const &origin,
+                         Eigen::Matrix<T, 3, 1> const &direction,
+                         std::vector<LineHit> &hits) const;
+
+private:
+  struct PairTraversal;
+
+  inline Node const &node(Index k) const noexcept {
+    return nodes_[static_cast<std::size_t>(k)];
+  }
+
+  Index build(Index first, Index count, T const *vertices,
+              std::vector<Eigen::Matrix<T, 3, 1>> const &centroids);
+
+  Box triangleBox(Index triangle, T const *vertices) const;
+
+  /// True iff the triangles `a` and `b` have a common vertex
+  bool shareVertex(Index a, Index b) const;
+
+  std::vector<Node> nodes_;
+  std::vector<Index> triangleOrder_;
+  /// Indices of the leaf nodes
+  std::vector<Index> leaves_;
+  std::vector<Index> indices_;
+};
+#pragma clang diagnostic pop
+
+extern template class TriangleBVH<float>;
+extern template class TriangleBVH<double>;
+
+} // namespace Internal
+} // namespace CortidQCT
@@ -14,6 +14,8 @@
 #include "EigenAdaptors.h"
 #include "lib_config.h"
 
+#include <algorithm>
+#include <array>
 #include <exception>
 #include <gsl/gsl>
 
@@ -23,6 +25,66 @@
 
 namespace CortidQCT {
 
+namespace {
+
+/**
+ * @brief Downsamples the given voxel data along a single axis
+ *
+ * @param data voxel data, x varies fastest, then y, then z
+ * @param size number of voxels along each axis, updated on return
+ * @param axis the axis to downsample
+ * @param factor downsampling factor
+ * @return the downsampled voxel data
+ */
+std::vector<float> downsampleAxis(std::vector<float> const &data,
+                                  std::array<std::size_t, 3> &size,
+                                  std::size_t axis, std::size_t factor) {
+  using gsl::narrow_cast;
+
+  auto const n = size[axis];
+  auto const newN = (n - 1) / factor + 1;
+  auto const halfWidth = factor / 2;
+
+  std::array<std::size_t, 3> const stride{{1, size[0], size[0] * size[1]}};
+  auto newSize = size;
+  newSize[axis] = newN;
+  std::array<std::size_t, 3> const newStride{
+      {1, newSize[0], newSize[0] * newSize[1]}};
+
+  // All lines along `axis` are enumerated by the two remaining axes
+  auto const u = (axis + 1) % 3;
+  auto const v = (axis + 2) % 3;
+  auto const lineCount = narrow_cast<std::ptrdiff_t>(size[u] * size[v]);
+
+  std::vector<float> result(newSize[0] * newSize[1] * newSize[2]);
+
+#pragma omp parallel for
+  for (std::ptrdiff_t line = 0; line < lineCount; ++line) {
+    auto const iu = narrow_cast<std::size_t>(line) % size[u];
+    auto const iv = narrow_cast<std::size_t>(line) / size[u];
+    auto const *src = data.data() + iu * stride[u] + iv * stride[v];
+    auto *dst = result.data() + iu * newStride[u] + iv * newStride[v];
+
+    for (auto i = 0u; i < newN; ++i) {
+      auto const center = i * factor;
+      auto const first = center > halfWidth ? center - halfWidth : 0;
+      auto const last = std::min(center + halfWidth, n - 1);
+
+      auto sum = 0.0;
+      for (auto j = first; j <= last; ++j) {
+        sum += static_cast<double>(src[j * stride[axis]]);
+      }
+      dst[i * newStride[axis]] =
+          static_cast<float>(sum / static_cast<double>(last - first + 1));
+    }
+  }
+
+  size = newSize;
+  return result;
+}
+
+} // anonymous namespace
+
 VoxelVolume &VoxelVolume::loadFromFile(std::string const &filename) {
   using namespace std::string_literals;
 
@@ -94,4 +156,40 @@ VoxelVolume &VoxelVolume::calibrate(ValueType slope, ValueType intercept) {
   return *this;
 }
 
+VoxelVolume &VoxelVolume::downsample(std::size_t factor) {
+  if (factor == 0) {
+    throw std::invalid_argument("Downsampling factor must be positive");
+  }
+  if (factor == 1 || isEmpty()) return *this;
+
+  *this = downsampled(factor);
+
+  return *this;
+}
+
+VoxelVolume VoxelVolume::downsampled(std::size_t factor) const {
+  if (factor == 0) {
+    throw std::invalid_argument("Downsampling factor must be positive");
+  }
+  if (factor == 1 || isEmpty()) return *this;
+
+  std::array<std::size_t, 3> size{
+      {volumeSize_.width, volumeSize_.height, volumeSize_.depth}};
+
+  VoxelVolume result;
+  result.voxelSize_ = voxelSize_;
+
+  // The first pass reads this volume and already shrinks the data
+  result.voxelData_ = downsampleAxis(voxelData_, size, 0, factor);
+  result.voxelSize_[0] *= static_cast<float>(factor);
+  for (auto axis = 1u; axis < 3; ++axis) {
+    result.voxelData_ = downsampleAxis(result.voxelData_, size, axis, factor);
+    result.voxelSize_[axis] *= static_cast<float>(factor);
+  }
+
+  result.volumeSize_ = VolumeSize{size[0], size[1], size[2]};
+
+  return result;
+}
+
 } // namespace CortidQCT
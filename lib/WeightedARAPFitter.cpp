@@ -10,6 +10,9 @@
  */
 
 #include "WeightedARAPFitter.h"
+#include "MeshAdaptors.h"
+#include "StageTimer.h"
+#include "TraceRecorder.h"
 
 #include <fstream>
 #include <gsl/gsl>
@@ -29,10 +32,11 @@ constructNNMatrix(Eigen::MatrixBase<DerivedN> const &N,
                   Eigen::MatrixBase<DerivedGamma> const &gamma) {
   using Scalar = typename DerivedN::Scalar;
 
-  Eigen::Matrix<Scalar, 3, Eigen::Dynamic> NN(3, 3 * N.rows());
+  Eigen::Matrix<Scalar, 3, Eigen::Dynamic> NN(3, 3 * N.cols());
 
-  for (auto i = 0; i < N.rows(); ++i) {
-    NN.template block<3, 3>(0, 3 * i) = gamma(i) * N.row(i).transpose() * N.row(i);
+  for (auto i = 0; i < N.cols(); ++i) {
+    NN.template block<3, 3>(0, 3 * i) =
+        gamma(i) * N.col(i) * N.col(i).transpose();
   }
 
   return NN;
@@ -68,9 +72,8 @@ constructDVector(Eigen::MatrixBase<DerivedNN> const &NN,
 
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> d(NN.cols());
 
-  for (auto i = 0; i < Y.rows(); ++i) {
-    d.template segment<3>(3 * i) =
-        NN.template block<3, 3>(0, 3 * i) * Y.row(i).transpose();
+  for (auto i = 0; i < Y.cols(); ++i) {
+    d.template segment<3>(3 * i) = NN.template block<3, 3>(0, 3 * i) * Y.col(i);
   }
 
   return d;
@@ -80,19 +83,19 @@ constructDVector(Eigen::MatrixBase<DerivedNN> const &NN,
 
 template <class T>
 WeightedARAPFitter<T>::WeightedARAPFitter(Mesh<T> const &mesh, T sigma) {
-  V0_ = vertexMatrix(mesh);
+  V0_ = Adaptor::vertexMap(mesh);
   F_ = facetMatrix(mesh);
   sigmaSqInv_ = static_cast<Scalar>(1) / (sigma * sigma);
-  computeLaplacian();
+  L_ = laplacianMatrix(V0_.transpose(), F_, mesh.topology());
 }
 
 template <class T> void WeightedARAPFitter<T>::computeLaplacian() {
-  L_ = laplacianMatrix(V0_, F_);
+  L_ = laplacianMatrix(V0_.transpose(), F_);
 }
 
 template <class T> void WeightedARAPFitter<T>::initRotationMatrix() {
   using Mat = Eigen::Matrix<Scalar, 3, 3>;
-  R_ = Mat::Identity().replicate(1, V0_.rows());
+  R_ = Mat::Identity().replicate(1, V0_.cols());
 }
 
 template <class T>
@@ -101,7 +104,7 @@ void WeightedARAPFitter<T>::optimizePositions(
     Eigen::ConjugateGradient<Eigen::SparseMatrix<Scalar>,
                              Eigen::Lower | Eigen::Upper> &solver,
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &cOut,
-    VertexMatrix<Scalar> &Vout) const {
+    PointMatrix<Scalar> &Vout) const {
 
   using InnerIterator = typename LaplacianMatrix<Scalar>::InnerIterator;
   using Eigen::Dynamic;
@@ -110,7 +113,7 @@ void WeightedARAPFitter<T>::optimizePositions(
   using Vector = Eigen::Matrix<Scalar, Dynamic, 1>;
 
   // copmute c vector
-  for (auto i = 0; i < V0_.rows(); ++i) {
+  for (auto i = 0; i < V0_.cols(); ++i) {
 
     Matrix<Scalar, 3, 3> const Ri = R_.template block<3, 3>(0, 3 * i);
     cOut.template segment<3>(3 * i).array() = 0;
@@ -121,27 +124,26 @@ void WeightedARAPFitter<T>::optimizePositions(
 
       cOut.template segment<3>(3 * i) +=
           it.value() * (Ri + R_.template block<3, 3>(0, 3 * j)) *
-          (V0_.row(i) - V0_.row(j)).transpose() / static_cast<Scalar>(2);
+          (V0_.col(i) - V0_.col(j)) / static_cast<Scalar>(2);
     }
   }
 
   Vector const rhs = 2 * sigmaSqInv_ * cOut + d;
-  Matrix<Scalar, 3, Dynamic> const Vtransposed = Vout.transpose();
 
+  // The 3xN vertex matrix is the interleaved unknown vector of the system
   Vector const x = solver.solveWithGuess(
-      rhs, Map<Vector const>{Vtransposed.data(), 3 * Vout.rows(), 1});
+      rhs, Map<Vector const>{Vout.data(), Vout.size(), 1});
 
-  Vout = Map<Matrix<Scalar, 3, Dynamic> const>{x.data(), 3, Vout.rows()}
-             .transpose();
+  Map<Vector>{Vout.data(), Vout.size(), 1} = x;
 }
 
 template <class T>
-void WeightedARAPFitter<T>::optimizeRotations(VertexMatrix<T> const &V) {
+void WeightedARAPFitter<T>::optimizeRotations(PointMatrix<T> const &V) {
   using Matrix3 = Eigen::Matrix<Scalar, 3, 3>;
   using Vector3 = Eigen::Matrix<Scalar, 3, 1>;
   using InnerIterator = typename LaplacianMatrix<Scalar>::InnerIterator;
 
-  auto const n = V0_.rows();
+  auto const n = V0_.cols();
   // Find rotations that minimize ARAP energy
   for (auto i = 0; i < n; ++i) {
 
@@ -150,8 +152,8 @@ void WeightedARAPFitter<T>::optimizeRotations(VertexMatrix<T> const &V) {
       auto const j = it.row();
       if (i == j) continue;
 
-      Vector3 const eij = (V0_.row(i) - V0_.row(j)).transpose();
-      Vector3 const eijHat = (V.row(i) - V.row(j)).transpose();
+      Vector3 const eij = V0_.col(i) - V0_.col(j);
+      Vector3 const eijHat = V.col(i) - V.col(j);
 
       Si += it.value() * eijHat * eij.transpose();
     }
@@ -173,20 +175,20 @@ void WeightedARAPFitter<T>::optimizeRotations(VertexMatrix<T> const &V) {
 }
 
 template <class T>
-T WeightedARAPFitter<T>::rigidityEnergy(VertexMatrix<Scalar> const &V) const {
+T WeightedARAPFitter<T>::rigidityEnergy(PointMatrix<Scalar> const &V) const {
   using InnerIterator = typename LaplacianMatrix<Scalar>::InnerIterator;
 
   auto energy = Scalar{0};
 
-  for (auto i = 0; i < V.rows(); ++i) {
+  for (auto i = 0; i < V.cols(); ++i) {
 
     for (InnerIterator it{L_, i}; it; ++it) {
       auto const j = it.row();
       if (i == j) continue;
 
-      energy += it.value() * ((V.row(i) - V.row(j)).transpose() -
+      energy += it.value() * ((V.col(i) - V.col(j)) -
                               R_.template block<3, 3>(0, 3 * i) *
-                                  (V0_.row(i) - V0_.row(j)).transpose())
+                                  (V0_.col(i) - V0_.col(j)))
                                  .squaredNorm();
     }
   }
@@ -195,54 +197,78 @@ T WeightedARAPFitter<T>::rigidityEnergy(VertexMatrix<Scalar> const &V) const {
 }
 
 template <class T>
-VertexMatrix<T>
-WeightedARAPFitter<T>::fit(VertexMatrix<T> const &Y, VertexMatrix<T> const &N,
-                           Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const &gamma) {
+void WeightedARAPFitter<T>::fit(Eigen::Ref<PointMatrix<T> const> const &Y,
+                                Eigen::Ref<PointMatrix<T> const> const &N,
+                                Eigen::Ref<Vector const> const &gamma,
+                                Eigen::Ref<PointMatrix<T>> Vout,
+                                StopCondition const &stopCondition) {
   using Eigen::Dynamic;
   using Eigen::Matrix;
   using Matrix3 = Eigen::Matrix<Scalar, 3, 3>;
   using SparseMatrix = Eigen::SparseMatrix<Scalar>;
 
-  auto const n = V0_.rows();
-  Expects(Y.rows() == n && N.rows() == n && Y.cols() == 3 && N.cols() == 3);
+  auto const n = V0_.cols();
+  Expects(Y.cols() == n && N.cols() == n && Vout.cols() == n);
+  Expects(gamma.rows() == n);
 
-  initRotationMatrix();
+  timings_ = {};
 
-  VertexMatrix<Scalar> V = V0_;
-  VertexMatrix<Scalar> Vbest = V;
+  Matrix<Scalar, Dynamic, 1> d;
+  // The solver references A, so it must outlive the solver
+  SparseMatrix A;
+  Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper> cg;
+  {
+    ScopedTraceEvent const trace{"ARAP setup"};
+    ScopedStageTimer const timer{timings_.setup};
 
-  auto const NN = constructNNMatrix(N, gamma);
-  auto const B = constructBMatrix(NN);
-  auto const d = constructDVector(NN, Y);
-  SparseMatrix const A =
-      2 * sigmaSqInv_ * Eigen::kroneckerProduct(-L_, Matrix3::Identity()) + B;
+    initRotationMatrix();
 
-  Matrix<Scalar, Dynamic, 1> c(3 * n);
+    auto const NN = constructNNMatrix(N, gamma);
+    auto const B = constructBMatrix(NN);
+    d = constructDVector(NN, Y);
+    A = 2 * sigmaSqInv_ * Eigen::kroneckerProduct(-L_, Matrix3::Identity()) +
+        B;
 
-  Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper> cg;
-  cg.compute(A);
+    cg.compute(A);
+  }
+
+  PointMatrix<Scalar> V = V0_;
+  Vout = V;
+
+  Matrix<Scalar, Dynamic, 1> c(3 * n);
 
   auto converged = false;
   auto eMin = std::numeric_limits<Scalar>::max();
   int nonDecrease{0};
 
   while (!converged) {
-    optimizePositions(d, cg, c, V);
-    optimizeRotations(V);
+    {
+      ScopedTraceEvent const trace{"ARAP solve"};
+      ScopedStageTimer const timer{timings_.solve};
+      optimizePositions(d, cg, c, V);
+    }
+    {
+      ScopedTraceEvent const trace{"ARAP rotations"};
+      ScopedStageTimer const timer{timings_.rotations};
+      optimizeRotations(V);
+    }
 
-    auto const energy = rigidityEnergy(V);
+    auto energy = Scalar{0};
+    {
+      ScopedTraceEvent const trace{"ARAP energy"};
+      ScopedStageTimer const timer{timings_.energy};
+      energy = rigidityEnergy(V);
+    }
 
     if (energy < eMin) {
       nonDecrease = 0;
       eMin = energy;
-      Vbest = V;
+      Vout = V;
     } else {
       ++nonDecrease;
     }
-    converged = nonDecrease > 5;
+    converged = nonDecrease > 5 || stopCondition.isMet();
   }
-
-  return Vbest;
 }
 
 template class WeightedARAPFitter<float>;
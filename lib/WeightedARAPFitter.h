@@ -13,10 +13,13 @@
 #pragma once
 
 #include "MeshHelpers.h"
+#include "StopCondition.h"
 
 #include <Eigen/Core>
 #include <Eigen/Sparse>
 
+#include <utility>
+
 namespace CortidQCT {
 namespace Internal {
 
@@ -26,12 +29,29 @@ namespace Internal {
  * @brief This class implements a weighted as-rigid-as-possible mesh fitting
  * algorithm that uses a point-to-plane metric.
  *
+ * All point sets are 3xN matrices with one point per column, i.e. they share
+ * the memory layout of the mesh storage and the unknown vector of the linear
+ * system, so no conversions are required while fitting.
+ *
  * @tparam T Scalar type of the vertices
  */
 template <class T> class WeightedARAPFitter {
 
 public:
   using Scalar = T;
+  using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  /// Wall clock time in seconds spent in the parts of the last `fit()` call
+  struct Timings {
+    /// Setting up the linear system
+    double setup = 0.0;
+    /// Solving for the vertex positions
+    double solve = 0.0;
+    /// Finding the per-vertex rotations
+    double rotations = 0.0;
+    /// Computing the rigidity energy
+    double energy = 0.0;
+  };
 
   /**
    * @brief Constructs an object that can be used to fit the given reference
@@ -43,7 +63,7 @@ public:
   /**
    * @brief Constructs an object that can be used to fit the given reference
    * mesh
-   * @param V The vertex matrix of the reference mesh (Nx3)
+   * @param V The vertex matrix of the reference mesh (3xN)
    * @param F The facet matrix of the reference mesh (Mx3)
    */
   template <class DerivedV, class DerivedF>
@@ -53,19 +73,71 @@ public:
     computeLaplacian();
   }
 
+  /**
+   * @brief Constructs an object that can be used to fit the given reference
+   * mesh, re-using an already computed topology
+   * @param V The vertex matrix of the reference mesh (3xN)
+   * @param F The facet matrix of the reference mesh (Mx3)
+   * @param topology The topology of the reference mesh
+   */
+  template <class DerivedV, class DerivedF>
+  inline WeightedARAPFitter(Eigen::MatrixBase<DerivedV> const &V,
+                            Eigen::MatrixBase<DerivedF> const &F,
+                            typename Mesh<T>::Topology const &topology,
+                            T sigma)
+      : V0_(V), F_(F), sigmaSqInv_(static_cast<T>(1) / (sigma * sigma)),
+        L_(laplacianMatrix(V0_.transpose(), F_, topology)) {}
+
+  /**
+   * @brief Constructs an object that can be used to fit the given reference
+   * mesh, re-using an already computed Laplacian matrix
+   * @param V The vertex matrix of the reference mesh (3xN)
+   * @param F The facet matrix of the reference mesh (Mx3)
+   * @param L The cotangent Laplacian matrix of the reference mesh (NxN)
+   */
+  template <class DerivedV, class DerivedF>
+  inline WeightedARAPFitter(Eigen::MatrixBase<DerivedV> const &V,
+                            Eigen::MatrixBase<DerivedF> const &F,
+                            LaplacianMatrix<T> L, T sigma)
+      : V0_(V), F_(F), sigmaSqInv_(static_cast<T>(1) / (sigma * sigma)),
+        L_(std::move(L)) {
+    Expects(L_.rows() == V0_.cols() && L_.cols() == V0_.cols());
+  }
+
   /**
    * @brief Fits the reference mesh to the given target vertices by minimizing
    * the wiehgted point-to-plane distances under ARAP constraints.
    *
-   * @param Y Target vertex matrix (Nx3)
-   * @param N Target per-vertex normal matrix (Nx3)
+   * @param Y Target vertex matrix (3xN)
+   * @param N Target per-vertex normal matrix (3xN)
    * @param gamma Weight vector (Nx1)
-   * @return VertexMatrix (Nx3) representing the linear embedding of the
-   * deformed mesh
+   * @param Vout Vertex matrix (3xN) the linear embedding of the deformed mesh
+   * is written to, e.g. a map of the vertices of the mesh to deform
+   * @param stopCondition checked after each local-global iteration. If met,
+   * the positions with the lowest energy found so far are written to `Vout`.
+   */
+  void fit(Eigen::Ref<PointMatrix<Scalar> const> const &Y,
+           Eigen::Ref<PointMatrix<Scalar> const> const &N,
+           Eigen::Ref<Vector const> const &gamma,
+           Eigen::Ref<PointMatrix<Scalar>> Vout,
+           StopCondition const &stopCondition = StopCondition{});
+
+  /**
+   * @brief Applies a similarity transformation to the reference mesh
+   *
+   * The cotangent Laplacian is invariant under similarity transformations,
+   * so it is kept.
+   *
+   * @param transform rigid transformation, optionally with uniform scaling
    */
-  VertexMatrix<Scalar> fit(VertexMatrix<Scalar> const &Y,
-                           VertexMatrix<Scalar> const &N,
-                           Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const &gamma);
+  template <int Mode>
+  inline void
+  transformReference(Eigen::Transform<Scalar, 3, Mode> const &transform) {
+    V0_ = transform * V0_;
+  }
+
+  /// Returns the time spent in the parts of the last `fit()` call
+  inline Timings const &timings() const noexcept { return timings_; }
 
 private:
   using RotationMatrix = Eigen::Matrix<Scalar, 3, Eigen::Dynamic>;
@@ -84,16 +156,16 @@ private:
       Eigen::ConjugateGradient<Eigen::SparseMatrix<Scalar>,
                                Eigen::Lower | Eigen::Upper> &solver,
       Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &cOut,
-      VertexMatrix<Scalar> &Vout) const;
+      PointMatrix<Scalar> &Vout) const;
 
   /// Find the optimal per-vertex rotations that minimize the ARAP energy
-  void optimizeRotations(VertexMatrix<Scalar> const &V);
+  void optimizeRotations(PointMatrix<Scalar> const &V);
 
   /// Compute the rigidity energy of the deformed mesh
-  Scalar rigidityEnergy(VertexMatrix<Scalar> const &V) const;
+  Scalar rigidityEnergy(PointMatrix<Scalar> const &V) const;
 
-  /// Vertex matrix of the undeformed mesh
-  VertexMatrix<Scalar> V0_;
+  /// Vertex matrix of the undeformed mesh (3xN)
+  PointMatrix<Scalar> V0_;
   /// Facet matrix of the undeformed mesh
   FacetMatrix F_;
   /// Scale parameter
@@ -102,6 +174,8 @@ private:
   LaplacianMatrix<Scalar> L_;
   /// Matrix containing all per-vertex rotations
   RotationMatrix R_;
+  /// Timings of the last fit
+  Timings timings_;
 };
 #pragma clang diagnostic pop
 
@@ -0,0 +1,125 @@
+/**
+ * @file      DensityProfiles.cpp
+ *
+ * @brief     Test cases for the density profile extraction
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "tests_config.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#ifndef CortidQCT_DATADIR
+#  error "No data dir given"
+#endif
+
+using namespace CortidQCT;
+
+static std::string const volumeFile =
+    std::string(CortidQCT_DATADIR) + "/ascendingSlices.bst";
+
+/// Value of the test volume at the given position in mesh coordinates
+static float volumeValue(float x, float y, float z) {
+  // Voxel (i, j, k) has the value -2000 + 0.5 j + 20 i + 400 k, the voxel
+  // size is (0.25, 0.5, 1)
+  return -2000.f + y + 80.f * x + 400.f * z;
+}
+
+static Mesh<float> makeTriangle() {
+  Mesh<float> mesh{3, 1};
+  mesh.withUnsafeVertexPointer([](float *vertices) {
+    std::array<float, 9> const V = {{2, 5, 4, 3, 10, 5, 1, 8, 3}};
+    std::copy(V.cbegin(), V.cend(), vertices);
+  });
+  mesh.withUnsafeVertexNormalPointer([](float *normals) {
+    std::array<float, 9> const N = {{0, 0, 1, 1, 0, 0, 0, 1, 0}};
+    std::copy(N.cbegin(), N.cend(), normals);
+  });
+  mesh.withUnsafeIndexPointer([](auto *indices) {
+    indices[0] = 0;
+    indices[1] = 1;
+    indices[2] = 2;
+  });
+  mesh.withUnsafeLabelPointer([](auto *labels) {
+    labels[0] = 0;
+    labels[1] = 1;
+    labels[2] = 1;
+  });
+  return mesh;
+}
+
+TEST(DensityProfiles, SamplesAlongInwardNormals) {
+  VoxelVolume const volume{volumeFile};
+  auto const mesh = makeTriangle();
+  auto const range = DiscreteRangef{-1.f, 1.f, 0.5f};
+  auto const calibration = DensityCalibration{2.f, 1.f};
+
+  auto const profiles = sampleDensityProfiles(mesh, volume, range, calibration);
+
+  ASSERT_EQ(3 * range.numElements(), profiles.size());
+
+  mesh.withUnsafeVertexPointer([&](float const *V) {
+    mesh.withUnsafeVertexNormalPointer([&](float const *N) {
+      for (auto i = 0u; i < 3; ++i) {
+        for (auto k = 0u; k < range.numElements(); ++k) {
+          auto const t = range.nThElement(k + 1);
+          auto const expected =
+              2.f * volumeValue(V[3 * i] - t * N[3 * i],
+                                V[3 * i + 1] - t * N[3 * i + 1],
+                                V[3 * i + 2] - t * N[3 * i + 2]) +
+              1.f;
+          EXPECT_NEAR(expected, profiles[i * range.numElements() + k], 1e-2f);
+        }
+      }
+    });
+  });
+}
+
+TEST(DensityProfiles, ExteriorSamplesAreNaN) {
+  VoxelVolume const volume{volumeFile};
+  auto mesh = makeTriangle();
+  mesh.withUnsafeVertexPointer([](float *vertices) { vertices[0] = 10.f; });
+
+  std::vector<float> profiles(3);
+  sampleDensityProfiles(mesh, volume, DiscreteRangef{0.f, 0.f, 1.f},
+                        DensityCalibration{}, profiles.data());
+
+  EXPECT_TRUE(std::isnan(profiles[0]));
+  EXPECT_FALSE(std::isnan(profiles[1]));
+  EXPECT_FALSE(std::isnan(profiles[2]));
+}
+
+TEST(DensityProfiles, AggregatesPerLabel) {
+  auto const mesh = makeTriangle();
+  auto const nan = std::numeric_limits<float>::quiet_NaN();
+  std::array<float, 6> const profiles = {{1.f, 2.f, 3.f, nan, 5.f, 8.f}};
+
+  auto const aggregated = aggregateDensityProfiles(mesh, profiles.data(), 2);
+
+  ASSERT_EQ(2, aggregated.size());
+
+  EXPECT_EQ(0, aggregated[0].label);
+  EXPECT_EQ(1, aggregated[0].vertexCount);
+  EXPECT_FLOAT_EQ(1.f, aggregated[0].mean[0]);
+  EXPECT_FLOAT_EQ(2.f, aggregated[0].mean[1]);
+  EXPECT_FLOAT_EQ(0.f, aggregated[0].standardDeviation[0]);
+
+  EXPECT_EQ(1, aggregated[1].label);
+  EXPECT_EQ(2, aggregated[1].vertexCount);
+  EXPECT_EQ(2, aggregated[1].sampleCount[0]);
+  EXPECT_EQ(1, aggregated[1].sampleCount[1]);
+  EXPECT_FLOAT_EQ(4.f, aggregated[1].mean[0]);
+  EXPECT_FLOAT_EQ(8.f, aggregated[1].mean[1]);
+  EXPECT_FLOAT_EQ(1.f, aggregated[1].standardDeviation[0]);
+  EXPECT_FLOAT_EQ(0.f, aggregated[1].standardDeviation[1]);
+}
@@ -0,0 +1,101 @@
+/**
+ * @file      InternalPointToPlaneAlignment.cpp
+ *
+ * @brief     Test cases for the point-to-plane ICP step of the pre-alignment
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "PointToPlaneAlignment.h"
+
+#include <gtest/gtest.h>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Internal;
+
+using Transform = Eigen::Affine3f;
+
+/// Random points with random unit normals
+static std::pair<PointMatrix<float>, PointMatrix<float>> planes() {
+  std::srand(42);
+  PointMatrix<float> const V = 10 * PointMatrix<float>::Random(3, 200);
+  PointMatrix<float> N = PointMatrix<float>::Random(3, 200);
+  N.colwise().normalize();
+  return {V, N};
+}
+
+/// Runs ICP until the vertices lie on the planes through `target`
+static Transform align(PointMatrix<float> const &V,
+                       PointMatrix<float> const &N,
+                       PointMatrix<float> const &target, bool estimateScale) {
+  Eigen::VectorXf const w = Eigen::VectorXf::Ones(V.cols());
+  Transform transform = Transform::Identity();
+  for (auto i = 0; i < 10; ++i) {
+    PointMatrix<float> const current = transform * V;
+    Eigen::VectorXf const d =
+        ((current - target).array() * N.array()).colwise().sum().transpose();
+    transform =
+        pointToPlaneAlignment<float>(current, N, d, w, estimateScale) *
+        transform;
+  }
+  return transform;
+}
+
+TEST(PointToPlaneAlignment, RecoversRigidTransformation) {
+  auto const [V, N] = planes();
+  Transform const expected =
+      Eigen::Translation3f{1.f, -2.f, .5f} *
+      Eigen::AngleAxisf{0.1f, Eigen::Vector3f{1, 2, 3}.normalized()};
+
+  auto const transform = align(V, N, expected * V, false);
+
+  EXPECT_TRUE(transform.matrix().isApprox(expected.matrix(), 1e-4f))
+      << transform.matrix();
+}
+
+TEST(PointToPlaneAlignment, RecoversSimilarityTransformation) {
+  auto const [V, N] = planes();
+  Transform const expected =
+      Eigen::Translation3f{-1.f, .5f, 2.f} * Eigen::Scaling(1.1f) *
+      Eigen::AngleAxisf{0.05f, Eigen::Vector3f{0, 1, 1}.normalized()};
+
+  auto const rigid = align(V, N, expected * V, false);
+  EXPECT_NEAR(1.f, rigid.linear().determinant(), 1e-4f);
+
+  auto const similarity = align(V, N, expected * V, true);
+  EXPECT_TRUE(similarity.matrix().isApprox(expected.matrix(), 1e-4f))
+      << similarity.matrix();
+}
+
+TEST(PointToPlaneAlignment, UnconstrainedDirectionsAreKept) {
+  // Points on a sphere do not constrain rotations about its center. Antipodal
+  // pairs keep the centroid at the center.
+  PointMatrix<float> N{3, 100};
+  N.leftCols(50) = PointMatrix<float>::Random(3, 50);
+  N.leftCols(50).colwise().normalize();
+  N.rightCols(50) = -N.leftCols(50);
+  PointMatrix<float> const V = 5 * N;
+  Eigen::VectorXf const d = Eigen::VectorXf::Constant(100, -1.f);
+  Eigen::VectorXf const w = Eigen::VectorXf::Ones(100);
+
+  auto const rigid = pointToPlaneAlignment<float>(V, N, d, w, false);
+  EXPECT_TRUE(rigid.matrix().isIdentity(1e-4f)) << rigid.matrix();
+
+  // Moving each vertex outwards by 1 scales the sphere
+  auto const similarity = pointToPlaneAlignment<float>(V, N, d, w, true);
+  Eigen::Matrix3f const expected = Eigen::Matrix3f::Identity() * 1.2f;
+  EXPECT_TRUE(similarity.linear().isApprox(expected, 1e-3f))
+      << similarity.matrix();
+}
+
+TEST(PointToPlaneAlignment, ZeroWeightsGiveIdentity) {
+  auto const [V, N] = planes();
+  Eigen::VectorXf const d = Eigen::VectorXf::Ones(V.cols());
+  Eigen::VectorXf const w = Eigen::VectorXf::Zero(V.cols());
+
+  auto const transform = pointToPlaneAlignment<float>(V, N, d, w, true);
+  EXPECT_TRUE(transform.matrix().isIdentity());
+}
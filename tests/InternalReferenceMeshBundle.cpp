@@ -0,0 +1,93 @@
+/**
+ * @file      InternalReferenceMeshBundle.cpp
+ *
+ * @brief     Test cases for the reference mesh bundle format
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "tests_config.h"
+
+#include "ReferenceMeshBundle.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Internal;
+
+#ifndef CortidQCT_DATADIR
+#  error "No data dir given"
+#endif
+
+static std::string const meshFile =
+    std::string(CortidQCT_DATADIR) + "/SimpleVertebra.off";
+static std::string const labelFile =
+    std::string(CortidQCT_DATADIR) + "/SimpleVertebra-labels.txt";
+
+TEST(ReferenceMeshBundle, RoundTrip) {
+  using namespace std::string_literals;
+
+  auto const mesh = Mesh<float>{}.loadFromFile(meshFile, labelFile);
+  std::string const bundleFile = std::tmpnam(nullptr) + ".refmesh"s;
+
+  ASSERT_NO_THROW(writeReferenceMeshBundle(mesh, bundleFile));
+
+  ReferenceMeshBundle bundle;
+  ASSERT_NO_THROW(bundle = readReferenceMeshBundle(bundleFile));
+
+  auto const &loaded = bundle.mesh;
+  ASSERT_EQ(mesh.vertexCount(), loaded.vertexCount());
+  ASSERT_EQ(mesh.triangleCount(), loaded.triangleCount());
+
+  EXPECT_TRUE(vertexMatrix(mesh) == vertexMatrix(loaded));
+  EXPECT_TRUE(facetMatrix(mesh) == facetMatrix(loaded));
+  EXPECT_TRUE(labelVector(mesh) == labelVector(loaded));
+
+  auto const &expectedTopology = mesh.topology();
+  auto const &topology = loaded.topology();
+  EXPECT_EQ(expectedTopology.edges(), topology.edges());
+  EXPECT_EQ(expectedTopology.neighbourIndices(), topology.neighbourIndices());
+  EXPECT_EQ(expectedTopology.faceIndices(), topology.faceIndices());
+  for (auto const &edge : expectedTopology.edges()) {
+    EXPECT_EQ(expectedTopology.edgeIndex(edge[0], edge[1]),
+              topology.edgeIndex(edge[0], edge[1]));
+  }
+
+  LaplacianMatrix<float> const L = laplacianMatrix(mesh);
+  EXPECT_NEAR(0.0f, (L - bundle.cache.laplacian).norm(), 1e-5f);
+
+  EXPECT_TRUE(bundle.cache.isValidFor(mesh));
+  auto modified = mesh;
+  modified.withUnsafeVertexPointer([](float *vertices) { vertices[0] += 1; });
+  EXPECT_FALSE(bundle.cache.isValidFor(modified));
+
+  std::remove(bundleFile.c_str());
+}
+
+TEST(ReferenceMeshBundle, DetectsCorruption) {
+  using namespace std::string_literals;
+
+  auto const mesh = Mesh<float>{}.loadFromFile(meshFile, labelFile);
+  std::string const bundleFile = std::tmpnam(nullptr) + ".refmesh"s;
+
+  ASSERT_NO_THROW(writeReferenceMeshBundle(mesh, bundleFile));
+
+  {
+    std::fstream file{bundleFile,
+                      std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(100);
+    file.put('\x7f');
+  }
+
+  EXPECT_THROW(readReferenceMeshBundle(bundleFile), std::invalid_argument);
+
+  std::remove(bundleFile.c_str());
+}
@@ -29,6 +29,8 @@ using namespace CortidQCT;
 
 static std::string const file1 =
     std::string(CortidQCT_DATADIR) + "/testModel.yml";
+static std::string const volumeFile =
+    std::string(CortidQCT_DATADIR) + "/ascendingSlices.bst";
 
 TEST(InternalSampler, ModelSampler) {
   using Eigen::MatrixXf;
@@ -49,3 +51,34 @@ TEST(InternalSampler, ModelSampler) {
   ASSERT_FLOAT_EQ(0.81167072, values(0));
   ASSERT_FLOAT_EQ(1.17916775, values(1));
 }
+
+TEST(InternalSampler, NormalLinesMatchSamplingPoints) {
+  using Eigen::Matrix3Xf;
+  using Eigen::MatrixXf;
+  using Eigen::VectorXf;
+
+  auto const volume = VoxelVolume{}.loadFromFile(volumeFile);
+  auto const sampler = VolumeSampler{volume};
+  DiscreteRangef const range{-2.f, 2.f, 0.5f};
+  auto const M = static_cast<Eigen::Index>(range.numElements());
+
+  Matrix3Xf V(3, 3);
+  V << 1.f, 2.5f, 4.f, // x
+      3.f, 7.25f, 12.f, // y
+      2.f, 4.5f, 6.f;   // z
+  Matrix3Xf N(3, 3);
+  N << 0.f, 0.6f, 0.f, // x
+      0.f, 0.f, 0.8f,  // y
+      1.f, 0.8f, 0.6f; // z
+
+  VectorXf const expected = sampler(samplingPoints(V, N, range), 1.f, 0.f);
+
+  MatrixXf values(V.cols(), M);
+  sampler.sampleNormalLines(V, N, range, values, 1.f, 0.f);
+
+  for (Eigen::Index i = 0; i < V.cols(); ++i) {
+    for (Eigen::Index k = 0; k < M; ++k) {
+      EXPECT_NEAR(expected(i * M + k), values(i, k), 1e-2f);
+    }
+  }
+}
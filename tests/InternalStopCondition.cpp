@@ -0,0 +1,58 @@
+/**
+ * @file      InternalStopCondition.cpp
+ *
+ * @brief     Test cases for the stop condition of a fit
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "StopCondition.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Internal;
+using namespace std::chrono_literals;
+
+TEST(StopCondition, DefaultIsNeverMet) {
+  StopCondition const condition;
+  ASSERT_FALSE(condition.isActive());
+  ASSERT_FALSE(condition.isMet());
+
+  StopCondition const fromDefaultOptions{FitOptions{}};
+  ASSERT_FALSE(fromDefaultOptions.isActive());
+  ASSERT_FALSE(fromDefaultOptions.isMet());
+}
+
+TEST(StopCondition, CancellationIsSharedBetweenCopies) {
+  CancellationToken token;
+  FitOptions options;
+  options.cancellationToken = token;
+
+  StopCondition const condition{options};
+  ASSERT_TRUE(condition.isActive());
+  ASSERT_FALSE(condition.isMet());
+
+  std::thread{[token]() mutable { token.cancel(); }}.join();
+  ASSERT_TRUE(condition.isMet());
+}
+
+TEST(StopCondition, EarlierOfDeadlineAndTimeoutApplies) {
+  FitOptions options;
+  options.deadline = FitOptions::Clock::now() + 1h;
+  options.timeout = 0s;
+  ASSERT_TRUE(StopCondition{options}.isMet());
+
+  options.deadline = FitOptions::Clock::now() - 1s;
+  options.timeout = 1h;
+  ASSERT_TRUE(StopCondition{options}.isMet());
+
+  options.deadline = FitOptions::Clock::now() + 1h;
+  ASSERT_FALSE(StopCondition{options}.isMet());
+}
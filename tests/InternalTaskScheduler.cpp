@@ -0,0 +1,55 @@
+/**
+ * @file      InternalTaskScheduler.cpp
+ *
+ * @brief     Test cases for the task scheduler
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "TaskScheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace CortidQCT::Internal;
+
+TEST(TaskScheduler, SplitNeverExceedsTasksOrBound) {
+  auto const single = splitParallelism(1, 0);
+  ASSERT_EQ(1u, single.workers);
+  ASSERT_GE(single.threadsPerWorker, 1u);
+
+  auto const many = splitParallelism(1000, 0);
+  ASSERT_GE(many.workers, 1u);
+  ASSERT_EQ(1u, many.threadsPerWorker);
+
+  auto const bounded = splitParallelism(1000, 1);
+  ASSERT_EQ(1u, bounded.workers);
+  ASSERT_EQ(single.threadsPerWorker, bounded.threadsPerWorker);
+}
+
+TEST(TaskScheduler, RunsEachTaskOnce) {
+  constexpr std::size_t n = 100;
+  std::vector<std::atomic<int>> counts(n);
+
+  runTasks(n, 4, [&counts](std::size_t i) { ++counts[i]; });
+
+  for (auto const &count : counts) { ASSERT_EQ(1, count); }
+}
+
+TEST(TaskScheduler, RethrowsFirstException) {
+  std::atomic<std::size_t> started{0};
+
+  ASSERT_THROW(runTasks(100, 4,
+                        [&started](std::size_t i) {
+                          ++started;
+                          if (i == 3) throw std::runtime_error("failed");
+                        }),
+               std::runtime_error);
+  ASSERT_GE(started, 4u);
+}
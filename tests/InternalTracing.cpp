@@ -0,0 +1,87 @@
+/**
+ * @file      InternalTracing.cpp
+ *
+ * @brief     Test cases for the trace event recorder
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "TraceRecorder.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Internal;
+
+namespace {
+
+std::string readFile(std::string const &filename) {
+  std::ifstream in{filename};
+  return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+std::size_t countOccurrences(std::string const &text,
+                             std::string const &pattern) {
+  std::size_t count = 0;
+  for (auto pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+} // anonymous namespace
+
+TEST(Tracing, RecordsEventsOfAllThreads) {
+  using namespace std::string_literals;
+  std::string const traceFile = std::tmpnam(nullptr) + ".json"s;
+
+  startTracing();
+  ASSERT_TRUE(isTracing());
+
+  { ScopedTraceEvent const event{"main event"}; }
+  std::thread thread{[] { ScopedTraceEvent const event{"thread event"}; }};
+  thread.join();
+
+  ASSERT_NO_THROW(stopTracing(traceFile));
+  ASSERT_FALSE(isTracing());
+
+  // Not recorded
+  { ScopedTraceEvent const event{"main event"}; }
+
+  auto const trace = readFile(traceFile);
+  std::remove(traceFile.c_str());
+
+  ASSERT_EQ(0u, trace.find("{\"traceEvents\":["));
+  ASSERT_EQ(1u, countOccurrences(trace, "\"name\":\"main event\""));
+  ASSERT_EQ(1u, countOccurrences(trace, "\"name\":\"thread event\""));
+  ASSERT_EQ(2u, countOccurrences(trace, "\"name\":\"thread_name\""));
+}
+
+TEST(Tracing, StartDiscardsPreviousEvents) {
+  using namespace std::string_literals;
+  std::string const traceFile = std::tmpnam(nullptr) + ".json"s;
+
+  startTracing();
+  { ScopedTraceEvent const event{"discarded"}; }
+  startTracing();
+  { ScopedTraceEvent const event{"kept"}; }
+  stopTracing(traceFile);
+
+  auto const trace = readFile(traceFile);
+  std::remove(traceFile.c_str());
+
+  ASSERT_EQ(0u, countOccurrences(trace, "discarded"));
+  ASSERT_EQ(1u, countOccurrences(trace, "kept"));
+}
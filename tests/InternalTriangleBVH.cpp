@@ -0,0 +1,92 @@
+/**
+ * @file      InternalTriangleBVH.cpp
+ *
+ * @brief     Test cases for the triangle bounding volume hierarchy
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "tests_config.h"
+
+#include "TriangleBVH.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Internal;
+
+#ifndef CortidQCT_DATADIR
+#  error "No data dir given"
+#endif
+
+static std::string const meshFile =
+    std::string(CortidQCT_DATADIR) + "/SimpleVertebra.off";
+static std::string const labelFile =
+    std::string(CortidQCT_DATADIR) + "/SimpleVertebra-labels.txt";
+
+TEST(TriangleBVH, DetectsCrossingTriangles) {
+  // Two triangles piercing each other and a distant third one
+  std::vector<float> const vertices = {
+      0.f, 0.f, 0.f,  2.f, 0.f,  0.f, 0.f, 2.f, 0.f, // triangle 0
+      .5f, .5f, -1.f, .5f, .5f,  1.f, 3.f, .5f, 0.f, // triangle 1
+      5.f, 5.f, 5.f,  6.f, 5.f,  5.f, 5.f, 6.f, 5.f  // triangle 2
+  };
+  std::vector<std::ptrdiff_t> const indices = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+
+  TriangleBVH<float> const bvh{vertices.data(), indices.data(), 3};
+
+  auto const intersections = bvh.selfIntersections(vertices.data());
+  ASSERT_EQ(1, intersections.size());
+  EXPECT_EQ(0, intersections.front()[0]);
+  EXPECT_EQ(1, intersections.front()[1]);
+}
+
+TEST(TriangleBVH, RefitMatchesRebuild) {
+  auto mesh = Mesh<float>{}.loadFromFile(meshFile, labelFile);
+
+  std::vector<float> vertices(3 * mesh.vertexCount());
+  std::vector<std::ptrdiff_t> indices(3 * mesh.triangleCount());
+  mesh.withUnsafeVertexPointer([&](auto const *ptr) {
+    std::copy(ptr, ptr + vertices.size(), vertices.begin());
+  });
+  mesh.withUnsafeIndexPointer([&](auto const *ptr) {
+    std::copy(ptr, ptr + indices.size(), indices.begin());
+  });
+
+  TriangleBVH<float> bvh{vertices.data(), indices.data(),
+                         mesh.triangleCount()};
+  EXPECT_TRUE(bvh.selfIntersections(vertices.data()).empty());
+
+  // Push a vertex through the opposite side of the mesh
+  Eigen::Vector3f centroid = Eigen::Vector3f::Zero();
+  for (auto i = 0u; i < mesh.vertexCount(); ++i) {
+    centroid += Eigen::Map<Eigen::Vector3f const>{vertices.data() + 3 * i};
+  }
+  centroid /= static_cast<float>(mesh.vertexCount());
+  Eigen::Map<Eigen::Vector3f> v0{vertices.data()};
+  v0 = centroid + 3.f * (centroid - v0);
+
+  bvh.refit(vertices.data());
+  auto const refitted = bvh.selfIntersections(vertices.data());
+
+  TriangleBVH<float> const rebuilt{vertices.data(), indices.data(),
+                                   mesh.triangleCount()};
+  auto const expected = rebuilt.selfIntersections(vertices.data());
+
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(expected, refitted);
+
+  // The root box contains all vertices
+  auto const &root = bvh.nodes().front();
+  for (auto i = 0u; i < mesh.vertexCount(); ++i) {
+    EXPECT_TRUE(root.box.contains(
+        Eigen::Map<Eigen::Vector3f const>{vertices.data() + 3 * i}));
+  }
+}
@@ -7,8 +7,13 @@
 #include <gtest/gtest.h>
 #include <igl/per_vertex_normals.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdio>
+#include <fstream>
 #include <iterator>
+#include <limits>
 
 using namespace CortidQCT;
 
@@ -182,6 +187,299 @@ TEST(Mesh, NormalsOrientedOutwards) {
   ASSERT_TRUE((dotProducts.array() > -0.25f).all());
 }
 
+TEST(Mesh, DecimatePreservesTopologyAndLabels) {
+  Mesh<float> fine;
+  ASSERT_NO_THROW(fine.loadFromFile(mesh1, labels1));
+
+  auto coarse = fine;
+  Mesh<float>::VertexCorrespondence correspondence;
+  ASSERT_NO_THROW(coarse.decimate(fine.vertexCount() / 4, &correspondence));
+
+  ASSERT_EQ(fine.vertexCount() / 4, coarse.vertexCount());
+  ASSERT_EQ(coarse.vertexCount(), correspondence.coarseToFine.size());
+  ASSERT_EQ(fine.vertexCount(), correspondence.fineToCoarse.size());
+
+  // Euler characteristic is preserved
+  auto const eulerCharacteristic = [](Mesh<float> const &mesh) {
+    return static_cast<long>(mesh.vertexCount()) -
+           static_cast<long>(mesh.topology().edgeCount()) +
+           static_cast<long>(mesh.triangleCount());
+  };
+  EXPECT_EQ(eulerCharacteristic(fine), eulerCharacteristic(coarse));
+
+  fine.withUnsafeLabelPointer([&](auto const *fineLabels) {
+    coarse.withUnsafeLabelPointer([&](auto const *coarseLabels) {
+      for (auto i = 0u; i < coarse.vertexCount(); ++i) {
+        auto const j = correspondence.coarseToFine[i];
+        ASSERT_EQ(fineLabels[j], coarseLabels[i]);
+      }
+      for (auto j = 0u; j < fine.vertexCount(); ++j) {
+        auto const i = correspondence.fineToCoarse[j];
+        ASSERT_GE(i, 0);
+        ASSERT_EQ(fineLabels[j], coarseLabels[i]);
+      }
+    });
+  });
+}
+
+TEST(Mesh, ReorderVerticesIsInvertible) {
+  using Index = Mesh<float>::Index;
+
+  Mesh<float> original;
+  ASSERT_NO_THROW(original.loadFromFile(mesh1, labels1));
+
+  auto const bandwidth = [](Mesh<float> const &mesh) {
+    Index maxDistance = 0;
+    for (auto const &edge : mesh.topology().edges()) {
+      maxDistance = std::max(maxDistance, edge[1] - edge[0]);
+    }
+    return maxDistance;
+  };
+
+  for (auto const ordering : {VertexOrdering::reverseCuthillMcKee,
+                              VertexOrdering::hilbertCurve}) {
+    auto reordered = original;
+    std::vector<Index> newToOld;
+    reordered.reorderVertices(ordering, &newToOld);
+
+    ASSERT_EQ(original.vertexCount(), newToOld.size());
+    if (ordering == VertexOrdering::reverseCuthillMcKee) {
+      EXPECT_LT(bandwidth(reordered), bandwidth(original));
+    }
+
+    std::vector<Index> oldToNew(newToOld.size());
+    for (auto i = 0u; i < newToOld.size(); ++i) {
+      oldToNew[static_cast<std::size_t>(newToOld[i])] = static_cast<Index>(i);
+    }
+    reordered.permuteVertices(oldToNew);
+
+    original.withUnsafeVertexPointer([&](auto const *expected) {
+      reordered.withUnsafeVertexPointer([&](auto const *actual) {
+        ASSERT_TRUE(std::equal(expected, expected + 3 * original.vertexCount(),
+                               actual));
+      });
+    });
+    original.withUnsafeIndexPointer([&](auto const *expected) {
+      reordered.withUnsafeIndexPointer([&](auto const *actual) {
+        ASSERT_TRUE(std::equal(
+            expected, expected + 3 * original.triangleCount(), actual));
+      });
+    });
+    original.withUnsafeLabelPointer([&](auto const *expected) {
+      reordered.withUnsafeLabelPointer([&](auto const *actual) {
+        ASSERT_TRUE(
+            std::equal(expected, expected + original.vertexCount(), actual));
+      });
+    });
+  }
+
+  auto invalid = std::vector<Index>(original.vertexCount(), 0);
+  EXPECT_THROW(original.permuteVertices(invalid), std::invalid_argument);
+}
+
+/// Closed, outward oriented cube [0.5, 4.5]^3 with all labels set to 7
+static Mesh<float> makeCube() {
+  Mesh<float> cube{8, 12};
+  cube.withUnsafeVertexPointer([](auto *vertices) {
+    for (auto v = 0; v < 8; ++v) {
+      vertices[3 * v + 0] = (v & 1) != 0 ? 4.5f : 0.5f;
+      vertices[3 * v + 1] = (v & 2) != 0 ? 4.5f : 0.5f;
+      vertices[3 * v + 2] = (v & 4) != 0 ? 4.5f : 0.5f;
+    }
+  });
+  cube.withUnsafeIndexPointer([](auto *indices) {
+    std::array<std::ptrdiff_t, 36> const faces = {
+        0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+    std::copy(faces.cbegin(), faces.cend(), indices);
+  });
+  cube.withUnsafeLabelPointer(
+      [](auto *labels) { std::fill(labels, labels + 8, 7u); });
+
+  return cube;
+}
+
+TEST(Mesh, VoxelizeCube) {
+  auto const cube = makeCube();
+
+  auto const mask = cube.voxelize(VolumeSize{6, 6, 6}, VoxelSize{1, 1, 1}, 0);
+
+  ASSERT_EQ(216, mask.size());
+  for (auto k = 0u; k < 6; ++k) {
+    for (auto j = 0u; j < 6; ++j) {
+      for (auto i = 0u; i < 6; ++i) {
+        auto const isInside = [](auto x) { return x >= 1 && x <= 4; };
+        auto const expected =
+            isInside(i) && isInside(j) && isInside(k) ? 7u : 0u;
+        ASSERT_EQ(expected, mask[(k * 6 + j) * 6 + i]);
+      }
+    }
+  }
+}
+
+TEST(Mesh, SliceContoursOfCube) {
+  auto const cube = makeCube();
+
+  auto const slices = cube.sliceContours(6, 1.f);
+
+  ASSERT_EQ(6, slices.size());
+  EXPECT_TRUE(slices[0].empty());
+  EXPECT_TRUE(slices[5].empty());
+  for (auto k = 1u; k < 5; ++k) {
+    ASSERT_EQ(1, slices[k].size());
+    auto const &contour = slices[k].front();
+    EXPECT_TRUE(contour.isClosed);
+    ASSERT_EQ(8, contour.pointCount());
+    EXPECT_TRUE(std::all_of(contour.labels.cbegin(), contour.labels.cend(),
+                            [](auto label) { return label == 7; }));
+
+    // Counter-clockwise square of side length 4
+    auto area = 0.f;
+    auto const &p = contour.points;
+    for (auto i = 0u; i < 8; ++i) {
+      auto const j = (i + 1) % 8;
+      EXPECT_FLOAT_EQ(static_cast<float>(k), p[3 * i + 2]);
+      area += p[3 * i] * p[3 * j + 1] - p[3 * j] * p[3 * i + 1];
+    }
+    EXPECT_FLOAT_EQ(16.f, area / 2.f);
+  }
+}
+
+TEST(Mesh, SliceContoursOfClosedMeshAreClosed) {
+  Mesh<float> mesh;
+  ASSERT_NO_THROW(mesh.loadFromFile(mesh1, labels1));
+
+  mesh.withUnsafeVertexPointer([&mesh](auto *vertices) {
+    std::transform(vertices, vertices + 3 * mesh.vertexCount(), vertices,
+                   [](auto x) { return x + 40.f; });
+  });
+
+  auto const slices = mesh.sliceContours(160, 0.5f);
+
+  auto contourCount = 0u;
+  for (auto const &slice : slices) {
+    for (auto const &contour : slice) {
+      EXPECT_TRUE(contour.isClosed);
+      EXPECT_EQ(3 * contour.pointCount(), contour.points.size());
+      ++contourCount;
+    }
+  }
+  EXPECT_GT(contourCount, 0);
+
+  EXPECT_THROW(mesh.sliceContours(10, 0.f), std::invalid_argument);
+}
+
+TEST(Mesh, AllRayIntersectionsOfCube) {
+  auto const cube = makeCube();
+
+  // The first ray crosses the diagonal edges of the bottom and top faces,
+  // the second one starts inside the cube, the third one misses it
+  std::array<Ray<float>, 3> const rays = {{{{2.5f, 2.5f, -10.f}, {0, 0, 1}},
+                                           {{1.f, 2.f, 3.f}, {1, 0, 0}},
+                                           {{6.f, 2.f, 3.f}, {0, 1, 0}}}};
+
+  std::vector<std::size_t> offsets;
+  std::vector<RayMeshIntersection<float>> intersections;
+  cube.allRayIntersections(rays.data(), rays.data() + rays.size(), offsets,
+                           intersections);
+
+  ASSERT_EQ((std::vector<std::size_t>{0, 2, 4, 4}), offsets);
+  EXPECT_FLOAT_EQ(10.5f, intersections[0].signedDistance);
+  EXPECT_FLOAT_EQ(14.5f, intersections[1].signedDistance);
+  EXPECT_FLOAT_EQ(-0.5f, intersections[2].signedDistance);
+  EXPECT_FLOAT_EQ(3.5f, intersections[3].signedDistance);
+
+  for (auto r = 0u; r < 2; ++r) {
+    for (auto i = offsets[r]; i < offsets[r + 1]; ++i) {
+      auto const &intersection = intersections[i];
+      auto const p = cube.cartesianRepresentation(intersection.position);
+      for (auto c = 0u; c < 3; ++c) {
+        EXPECT_NEAR(rays[r].origin[c] +
+                        intersection.signedDistance * rays[r].direction[c],
+                    p[c], 1e-5f);
+      }
+    }
+  }
+}
+
+TEST(Mesh, AllRayIntersectionsOfClosedMeshHaveEvenCount) {
+  Mesh<float> mesh;
+  ASSERT_NO_THROW(mesh.loadFromFile(mesh1, labels1));
+
+  std::vector<Ray<float>> rays;
+  for (auto i = 0; i < 64; ++i) {
+    for (auto j = 0; j < 64; ++j) {
+      rays.push_back({{-30.f + static_cast<float>(i), -30.f, -30.f +
+                       static_cast<float>(j) + 0.37f},
+                      {0, 1, 0}});
+    }
+  }
+
+  std::vector<std::size_t> offsets;
+  std::vector<RayMeshIntersection<float>> intersections;
+  mesh.allRayIntersections(rays.data(), rays.data() + rays.size(), offsets,
+                           intersections);
+
+  ASSERT_EQ(rays.size() + 1, offsets.size());
+  ASSERT_EQ(offsets.back(), intersections.size());
+  EXPECT_GT(intersections.size(), 0);
+  for (auto r = 0u; r < rays.size(); ++r) {
+    EXPECT_EQ(0, (offsets[r + 1] - offsets[r]) % 2);
+    EXPECT_TRUE(std::is_sorted(
+        intersections.cbegin() + static_cast<std::ptrdiff_t>(offsets[r]),
+        intersections.cbegin() + static_cast<std::ptrdiff_t>(offsets[r + 1]),
+        [](auto const &a, auto const &b) {
+          return a.signedDistance < b.signedDistance;
+        }));
+  }
+}
+
+TEST(Mesh, VoxelizeMatchesMeshVolume) {
+  Mesh<float> mesh;
+  ASSERT_NO_THROW(mesh.loadFromFile(mesh1, labels1));
+
+  // Move the mesh into the positive octant
+  mesh.withUnsafeVertexPointer([&mesh](auto *vertices) {
+    std::transform(vertices, vertices + 3 * mesh.vertexCount(), vertices,
+                   [](auto x) { return x + 40.f; });
+  });
+
+  // Volume by the divergence theorem
+  auto volume = 0.0;
+  mesh.withUnsafeVertexPointer([&](auto const *V) {
+    mesh.withUnsafeIndexPointer([&](auto const *F) {
+      for (auto f = 0u; f < mesh.triangleCount(); ++f) {
+        Eigen::Vector3d const a =
+            Eigen::Map<Eigen::Vector3f const>{V + 3 * F[3 * f]}.cast<double>();
+        Eigen::Vector3d const b =
+            Eigen::Map<Eigen::Vector3f const>{V + 3 * F[3 * f + 1]}
+                .cast<double>();
+        Eigen::Vector3d const c =
+            Eigen::Map<Eigen::Vector3f const>{V + 3 * F[3 * f + 2]}
+                .cast<double>();
+        volume += a.dot(b.cross(c)) / 6.0;
+      }
+    });
+  });
+
+  auto constexpr outside = std::numeric_limits<Mesh<float>::Label>::max();
+  auto const voxelSize = 0.5f;
+  auto const mask =
+      mesh.voxelize(VolumeSize{160, 160, 160},
+                    VoxelSize{voxelSize, voxelSize, voxelSize}, outside);
+
+  auto const insideCount =
+      std::count_if(mask.cbegin(), mask.cend(),
+                    [outside](auto label) { return label != outside; });
+  auto const voxelVolume =
+      static_cast<double>(insideCount) * voxelSize * voxelSize * voxelSize;
+
+  EXPECT_NEAR(std::abs(volume), voxelVolume, 0.02 * std::abs(volume));
+  EXPECT_TRUE(std::all_of(mask.cbegin(), mask.cend(), [outside](auto label) {
+    return label == outside || label <= 3;
+  }));
+}
+
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
 
@@ -285,6 +583,54 @@ TYPED_TEST(MeshQueriesTest, BarycentricToCartesianSequenceCall) {
   }
 }
 
+TYPED_TEST(MeshQueriesTest, BarycentricInterpolationOfVectorAttributes) {
+  using T = TypeParam;
+  using BC = BarycentricPoint<T, typename Mesh<T>::Index>;
+
+  // Two-dimensional attribute (v, -2v) for vertex v
+  std::vector<T> const attributes = {0, 0, 1, -2, 2, -4, 3, -6};
+
+  // Enough points to be processed in parallel
+  std::vector<BC> query;
+  for (auto i = 0; i < 4096; ++i) {
+    auto const u = T(i % 7) / T{10};
+    auto const v = T(i % 3) / T{10};
+    query.push_back(BC{{u, v}, i % 4});
+  }
+
+  auto const *begin = query.data();
+  auto const *end = begin + query.size();
+
+  std::vector<T> values(2 * query.size());
+  this->mesh.barycentricInterpolation(begin, end, attributes.data(),
+                                      values.data(), 2);
+
+  this->mesh.withUnsafeIndexPointer([&](auto const *indices) {
+    for (auto i = 0u; i < query.size(); ++i) {
+      auto const &pt = query[i];
+      auto const *tri = indices + 3 * pt.triangleIndex;
+      auto const expected = pt.uv[0] * T(tri[0]) + pt.uv[1] * T(tri[1]) +
+                            (1 - pt.uv[0] - pt.uv[1]) * T(tri[2]);
+      ASSERT_NEAR(expected, values[2 * i], 1e-6);
+      ASSERT_NEAR(-2 * expected, values[2 * i + 1], 1e-6);
+    }
+  });
+
+  // Sequential path
+  std::vector<T> sequential;
+  this->mesh.barycentricInterpolation(begin, end, attributes.data(),
+                                      std::back_inserter(sequential), 2);
+  ASSERT_EQ(values.size(), sequential.size());
+  for (auto i = 0u; i < values.size(); ++i) {
+    ASSERT_NEAR(values[i], sequential[i], 1e-6);
+  }
+
+  query.back().triangleIndex = 4;
+  EXPECT_THROW(this->mesh.barycentricInterpolation(
+                   begin, end, attributes.data(), values.data(), 2),
+               std::out_of_range);
+}
+
 TYPED_TEST(MeshQueriesTest, RayMeshIntersectionSingleCall) {
   using T = TypeParam;
   using R = Ray<T>;
@@ -321,5 +667,227 @@ TYPED_TEST(MeshQueriesTest, RayMeshIntersectionSequence) {
   ASSERT_NEAR(0.33333333333, intersections[0].position.uv[1], 1e-6);
 }
 
+TYPED_TEST(MeshQueriesTest, TopologyOfTetrahedron) {
+  using Index = typename Mesh<TypeParam>::Index;
+
+  auto const &topology = this->mesh.topology();
+
+  ASSERT_EQ(4, topology.vertexCount());
+  ASSERT_EQ(6, topology.edgeCount());
+
+  for (Index i = 0; i < 4; ++i) {
+    ASSERT_EQ(3, topology.degree(i));
+    ASSERT_EQ(3, std::distance(topology.facesBegin(i), topology.facesEnd(i)));
+
+    for (Index j = 0; j < 4; ++j) {
+      if (i == j) continue;
+      auto const e = topology.edgeIndex(i, j);
+      ASSERT_LE(0, e);
+      ASSERT_EQ(e, topology.edgeIndex(j, i));
+    }
+  }
+
+  ASSERT_EQ(-1, topology.edgeIndex(0, 0));
+  ASSERT_EQ(-1, topology.edgeIndex(0, 4));
+}
+
+TYPED_TEST(MeshQueriesTest, TopologyIsCachedUntilIndicesChange) {
+  auto const *first = &this->mesh.topology();
+
+  ASSERT_EQ(first, &this->mesh.topology());
+
+  // Copies share the cached topology
+  auto const copy = this->mesh;
+  ASSERT_EQ(first, &copy.topology());
+
+  // Replace vertex 0 by vertex 3 in the last triangle
+  this->mesh.withUnsafeIndexPointer([](auto *indices) { indices[9] = 3; });
+
+  auto const &topology = this->mesh.topology();
+  ASSERT_EQ(2, std::distance(topology.facesBegin(0), topology.facesEnd(0)));
+  ASSERT_EQ(4, std::distance(topology.facesBegin(3), topology.facesEnd(3)));
+
+  // The copy still refers to the original topology
+  ASSERT_EQ(first, &copy.topology());
+  ASSERT_EQ(3, std::distance(copy.topology().facesBegin(0),
+                             copy.topology().facesEnd(0)));
+}
+
+TYPED_TEST(MeshQueriesTest, SIMeshTextAndBinaryRoundTrip) {
+  using namespace std::string_literals;
+  using T = TypeParam;
+
+  this->mesh.withUnsafeLabelPointer([](auto *labels) {
+    labels[0] = 1;
+    labels[1] = 2;
+    labels[2] = 3;
+    labels[3] = 4;
+  });
+
+  std::string const textFile = std::tmpnam(nullptr) + ".simesh"s;
+  std::string const binaryFile = std::tmpnam(nullptr) + ".simeshb"s;
+
+  ASSERT_NO_THROW(this->mesh.writeToFile(textFile));
+  ASSERT_NO_THROW(this->mesh.writeToFile(binaryFile));
+
+  Mesh<T> textMesh, binaryMesh;
+  ASSERT_NO_THROW(textMesh.loadFromFile(textFile));
+  ASSERT_NO_THROW(binaryMesh.loadFromFile(binaryFile));
+
+  for (auto const *loaded : {&textMesh, &binaryMesh}) {
+    ASSERT_EQ(this->mesh.vertexCount(), loaded->vertexCount());
+    ASSERT_EQ(this->mesh.triangleCount(), loaded->triangleCount());
+
+    ASSERT_TRUE(loaded->withUnsafeVertexPointer([this](auto const pV) {
+      return this->mesh.withUnsafeVertexPointer(
+          [pV, size = 3 * this->mesh.vertexCount()](auto const pU) {
+            return std::equal(pU, pU + size, pV);
+          });
+    }));
+
+    ASSERT_TRUE(loaded->withUnsafeLabelPointer([this](auto const pL) {
+      return this->mesh.withUnsafeLabelPointer(
+          [pL, size = this->mesh.vertexCount()](auto const pK) {
+            return std::equal(pK, pK + size, pL);
+          });
+    }));
+  }
+
+  ASSERT_TRUE(textMesh.withUnsafeIndexPointer([&binaryMesh](auto const pI) {
+    return binaryMesh.withUnsafeIndexPointer(
+        [pI, size = 3 * binaryMesh.triangleCount()](auto const pJ) {
+          return std::equal(pI, pI + size, pJ);
+        });
+  }));
+
+  std::remove(textFile.c_str());
+  std::remove(binaryFile.c_str());
+}
+
+TYPED_TEST(MeshQueriesTest, PLYRoundTripPreservesLabels) {
+  using namespace std::string_literals;
+  using T = TypeParam;
+
+  this->mesh.withUnsafeLabelPointer([](auto *labels) {
+    labels[0] = 1;
+    labels[1] = 2;
+    labels[2] = 3;
+    labels[3] = 4;
+  });
+
+  std::string const coloredFile = std::tmpnam(nullptr) + ".ply"s;
+  std::string const plainFile = std::tmpnam(nullptr) + ".ply"s;
+  std::string const labelFile = std::tmpnam(nullptr) + ".txt"s;
+
+  ASSERT_NO_THROW(this->mesh.writeToFile(coloredFile));
+  ASSERT_NO_THROW(this->mesh.writeToFile(plainFile, labelFile));
+
+  Mesh<T> coloredMesh, plainMesh;
+  ASSERT_NO_THROW(coloredMesh.loadFromFile(coloredFile));
+  ASSERT_NO_THROW(plainMesh.loadFromFile(plainFile, labelFile));
+
+  for (auto const *loaded : {&coloredMesh, &plainMesh}) {
+    ASSERT_EQ(this->mesh.vertexCount(), loaded->vertexCount());
+    ASSERT_EQ(this->mesh.triangleCount(), loaded->triangleCount());
+
+    ASSERT_TRUE(loaded->withUnsafeVertexPointer([this](auto const pV) {
+      return this->mesh.withUnsafeVertexPointer(
+          [pV, size = 3 * this->mesh.vertexCount()](auto const pU) {
+            return std::equal(pU, pU + size, pV);
+          });
+    }));
+
+    ASSERT_TRUE(loaded->withUnsafeLabelPointer([this](auto const pL) {
+      return this->mesh.withUnsafeLabelPointer(
+          [pL, size = this->mesh.vertexCount()](auto const pK) {
+            return std::equal(pK, pK + size, pL);
+          });
+    }));
+  }
+
+  std::remove(coloredFile.c_str());
+  std::remove(plainFile.c_str());
+  std::remove(labelFile.c_str());
+}
+
+TYPED_TEST(MeshQueriesTest, OBJReaderTriangulatesPolygons) {
+  using namespace std::string_literals;
+  using T = TypeParam;
+
+  std::string const meshFile = std::tmpnam(nullptr) + ".obj"s;
+  std::string const labelFile = std::tmpnam(nullptr) + ".txt"s;
+
+  {
+    std::ofstream mesh{meshFile};
+    mesh << "# unit square\n"
+         << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0.5 0.5 1\n"
+         << "vn 0 0 -1\n"
+         << "f 1//1 4//1 3//1 2//1\n"
+         << "f -5 -4 -1\nf 2 3 5\nf 3 4 5\nf 4 1 5\n";
+    std::ofstream labels{labelFile};
+    labels << "1 2 3\n4 5\n";
+  }
+
+  Mesh<T> loaded;
+  ASSERT_NO_THROW(loaded.loadFromFile(meshFile, labelFile));
+
+  ASSERT_EQ(5, loaded.vertexCount());
+  ASSERT_EQ(6, loaded.triangleCount());
+
+  loaded.withUnsafeLabelPointer([](auto const *labels) {
+    for (auto i = 0; i < 5; ++i) { EXPECT_EQ(i + 1, labels[i]); }
+  });
+  loaded.withUnsafeVertexPointer(
+      [](auto const *vertices) { EXPECT_EQ(T{0.5}, vertices[12]); });
+
+  std::remove(meshFile.c_str());
+  std::remove(labelFile.c_str());
+}
+
+TYPED_TEST(MeshQueriesTest, UpsampleSplitsEdgesAndKeepsLabels) {
+  using T = TypeParam;
+
+  this->mesh.withUnsafeLabelPointer([](auto *labels) {
+    labels[0] = 1;
+    labels[1] = 1;
+    labels[2] = 1;
+    labels[3] = 2;
+  });
+  this->mesh.updatePerVertexNormals();
+
+  auto const original = this->mesh;
+  auto const edge = original.topology().edgeIndex(0, 3);
+
+  this->mesh.upsample();
+
+  ASSERT_EQ(10, this->mesh.vertexCount());
+  ASSERT_EQ(16, this->mesh.triangleCount());
+  ASSERT_EQ(24, this->mesh.topology().edgeCount());
+
+  this->mesh.withUnsafeVertexPointer([&](auto const *vertices) {
+    original.withUnsafeVertexPointer([&](auto const *originalVertices) {
+      // Original vertices are not moved
+      for (auto i = 0; i < 12; ++i) {
+        EXPECT_EQ(originalVertices[i], vertices[i]);
+      }
+      auto const *midpoint = vertices + 3 * (4 + edge);
+      for (auto k = 0; k < 3; ++k) {
+        EXPECT_NEAR(T{0.5} * (originalVertices[k] + originalVertices[9 + k]),
+                    midpoint[k], T{1e-6});
+      }
+    });
+  });
+
+  this->mesh.withUnsafeLabelPointer([](auto const *labels) {
+    EXPECT_EQ(2, labels[3]);
+    // Both triangles incident to the edge (0, 3) vote for label 1
+    for (auto i = 4; i < 10; ++i) { EXPECT_EQ(1, labels[i]); }
+  });
+
+  this->mesh.upsample(2);
+  ASSERT_EQ(130, this->mesh.vertexCount());
+  ASSERT_EQ(256, this->mesh.triangleCount());
+}
+
 #pragma clang diagnostic pop
 
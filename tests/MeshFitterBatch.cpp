@@ -0,0 +1,87 @@
+/**
+ * @file      MeshFitterBatch.cpp
+ *
+ * @brief     Test cases for the batch fits of MeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+/// The batch fits use a Laplacian computed before the initial placement, so
+/// the vertices may differ by rounding
+static void expectSameResult(MeshFitter::Result const &expected,
+                             MeshFitter::Result const &result) {
+  auto const expectedVertices = vertices(expected.deformedMesh);
+  auto const resultVertices = vertices(result.deformedMesh);
+  ASSERT_EQ(expectedVertices.size(), resultVertices.size());
+  for (auto i = 0u; i < expectedVertices.size(); ++i) {
+    for (auto k = 0u; k < 3; ++k) {
+      EXPECT_NEAR(expectedVertices[i][k], resultVertices[i][k], 1e-3f);
+    }
+  }
+  EXPECT_EQ(expected.iteration, result.iteration);
+  EXPECT_EQ(expected.converged, result.converged);
+  EXPECT_EQ(expected.success, result.success);
+}
+
+TEST(MeshFitterBatch, MatchesSequentialFits) {
+  MeshFitter const fitter{testConfiguration()};
+
+  auto const volume = VoxelVolume{volumeFile};
+  auto calibrated = volume;
+  calibrated.calibrate(1.1f, 50.f);
+  std::vector<VoxelVolume> const volumes = {volume, calibrated, volume};
+
+  std::vector<MeshFitter::Result> results(volumes.size());
+  std::vector<std::size_t> callCounts(volumes.size(), 0);
+  fitter.fitBatch(volumes, [&](std::size_t i, MeshFitter::Result &&result) {
+    ++callCounts[i];
+    results[i] = std::move(result);
+  });
+
+  for (auto i = 0u; i < volumes.size(); ++i) {
+    EXPECT_EQ(1u, callCounts[i]);
+    expectSameResult(fitter.fit(volumes[i]), results[i]);
+  }
+}
+
+TEST(MeshFitterBatch, LoadsVolumesOnDemand) {
+  MeshFitter const fitter{testConfiguration()};
+
+  std::vector<MeshFitter::VolumeLoader> const loaders(
+      2, [] { return VoxelVolume{volumeFile}; });
+
+  auto const expected = fitter.fit(VoxelVolume{volumeFile});
+  std::size_t callCount = 0;
+  fitter.fitBatch(loaders, [&](std::size_t, MeshFitter::Result &&result) {
+    ++callCount;
+    expectSameResult(expected, result);
+  });
+
+  EXPECT_EQ(loaders.size(), callCount);
+}
+
+TEST(MeshFitterBatch, RethrowsCallbackException) {
+  MeshFitter const fitter{testConfiguration()};
+  std::vector<VoxelVolume> const volumes(2, VoxelVolume{volumeFile});
+
+  EXPECT_THROW(fitter.fitBatch(volumes,
+                               [](std::size_t, MeshFitter::Result &&) {
+                                 throw std::runtime_error("callback");
+                               }),
+               std::runtime_error);
+}
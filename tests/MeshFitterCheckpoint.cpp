@@ -0,0 +1,110 @@
+/**
+ * @file      MeshFitterCheckpoint.cpp
+ *
+ * @brief     Test cases for the checkpoints of MeshFitter::State
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+static MeshFitter::Configuration configuration() {
+  auto config = testConfiguration();
+  config.minNonDecreasing = 1;
+  config.referenceMeshVertexOrdering = VertexOrdering::hilbertCurve;
+  return config;
+}
+
+static void expectSameState(MeshFitter::State const &expected,
+                            MeshFitter::State const &state) {
+  EXPECT_EQ(vertices(expected.deformedMesh), vertices(state.deformedMesh));
+  EXPECT_EQ(expected.volumeSamples, state.volumeSamples);
+  EXPECT_EQ(expected.displacementVector, state.displacementVector);
+  EXPECT_EQ(expected.weights, state.weights);
+  EXPECT_EQ(expected.iteration, state.iteration);
+  EXPECT_EQ(expected.nonDecreasing, state.nonDecreasing);
+  EXPECT_EQ(expected.effectiveSigmaS, state.effectiveSigmaS);
+  EXPECT_EQ(expected.minDisNorm, state.minDisNorm);
+  EXPECT_EQ(expected.converged, state.converged);
+}
+
+TEST(MeshFitterCheckpoint, ResumedStateContinuesIdentically) {
+  using namespace std::string_literals;
+
+  MeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+  std::string const checkpointFile = std::tmpnam(nullptr) + ".checkpoint"s;
+
+  auto state = fitter.init(volume);
+  for (auto i = 0; i < 3; ++i) { fitter.fitOneIteration(state); }
+
+  ASSERT_NO_THROW(fitter.saveCheckpoint(state, checkpointFile));
+
+  auto loaded = fitter.loadCheckpoint(checkpointFile, volume);
+  expectSameState(state, loaded);
+  EXPECT_EQ(state.iterationTimings.size(), loaded.iterationTimings.size());
+
+  // The decayed sigmaS is part of the hidden state
+  for (auto i = 0; i < 3; ++i) {
+    fitter.fitOneIteration(state);
+    fitter.fitOneIteration(loaded);
+    expectSameState(state, loaded);
+  }
+
+  std::remove(checkpointFile.c_str());
+}
+
+TEST(MeshFitterCheckpoint, RejectsOtherVolume) {
+  using namespace std::string_literals;
+
+  MeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+  std::string const checkpointFile = std::tmpnam(nullptr) + ".checkpoint"s;
+
+  auto const state = fitter.init(volume);
+  ASSERT_NO_THROW(fitter.saveCheckpoint(state, checkpointFile));
+
+  auto otherVolume = volume;
+  otherVolume.calibrate(1.f, 1.f);
+
+  EXPECT_THROW(fitter.loadCheckpoint(checkpointFile, otherVolume),
+               std::invalid_argument);
+
+  std::remove(checkpointFile.c_str());
+}
+
+TEST(MeshFitterCheckpoint, RejectsCorruptedFile) {
+  using namespace std::string_literals;
+
+  MeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+  std::string const checkpointFile = std::tmpnam(nullptr) + ".checkpoint"s;
+
+  auto const state = fitter.init(volume);
+  ASSERT_NO_THROW(fitter.saveCheckpoint(state, checkpointFile));
+
+  {
+    std::fstream file{checkpointFile,
+                      std::ios::in | std::ios::out | std::ios::binary};
+    file.seekp(100);
+    file.put('x');
+  }
+
+  EXPECT_THROW(fitter.loadCheckpoint(checkpointFile, volume),
+               std::invalid_argument);
+
+  std::remove(checkpointFile.c_str());
+}
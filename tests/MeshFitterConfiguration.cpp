@@ -26,6 +26,8 @@ static std::string const file1 =
     std::string(CortidQCT_DATADIR) + "/testConfig.yml";
 static std::string const file2 =
     std::string(CortidQCT_DATADIR) + "/testConfig2.yml";
+static std::string const multiFile =
+    std::string(CortidQCT_DATADIR) + "/testMultiConfig.yml";
 
 TEST(MeshFitterConfiguration, DefaultParameters) {
   auto const config = MeshFitter::Configuration{};
@@ -99,3 +101,46 @@ TEST(MeshFitterConfiguration, LoadFromFileWithColorMap) {
 
   ASSERT_EQ(MeshFitter::Configuration::OriginType::centered, origin);
 }
+
+TEST(MeshFitterConfiguration, LoadMultiInstanceFile) {
+  auto config = MultiMeshFitter::Configuration{};
+
+  ASSERT_NO_THROW(config.loadFromFile(multiFile));
+
+  ASSERT_EQ(2u, config.maxConcurrentFits);
+  ASSERT_EQ(2u, config.instances.size());
+  ASSERT_EQ("L1", config.instances[0].name);
+  ASSERT_EQ("L2", config.instances[1].name);
+
+  auto const &conf1 = config.instances[0].configuration;
+  auto const &conf2 = config.instances[1].configuration;
+
+  // Shared parameters and per-instance overrides
+  ASSERT_DOUBLE_EQ(3.1415, conf1.sigmaE);
+  ASSERT_DOUBLE_EQ(3.1415, conf2.sigmaE);
+  ASSERT_DOUBLE_EQ(1.5, conf1.sigmaS);
+  ASSERT_DOUBLE_EQ(2.5, conf2.sigmaS);
+
+  ASSERT_TRUE(std::holds_alternative<Coordinate3D>(conf1.referenceMeshOrigin));
+  ASSERT_TRUE(std::holds_alternative<Coordinate3D>(conf2.referenceMeshOrigin));
+  ASSERT_FLOAT_EQ(0.25f,
+                  std::get<Coordinate3D>(conf1.referenceMeshOrigin).xyz[2]);
+  ASSERT_FLOAT_EQ(0.75f,
+                  std::get<Coordinate3D>(conf2.referenceMeshOrigin).xyz[2]);
+
+  // The model is only loaded once
+  auto const label = *conf1.model.labels().begin();
+  auto const pointer = [](float const *ptr) { return ptr; };
+  ASSERT_EQ(conf1.model.withUnsafeDataPointer(label, pointer),
+            conf2.model.withUnsafeDataPointer(label, pointer));
+}
+
+TEST(MeshFitterConfiguration, LoadSingleInstanceFile) {
+  auto config = MultiMeshFitter::Configuration{};
+
+  ASSERT_NO_THROW(config.loadFromFile(file1));
+
+  ASSERT_EQ(1u, config.instances.size());
+  ASSERT_TRUE(config.instances.front().name.empty());
+  ASSERT_DOUBLE_EQ(3.1415, config.instances.front().configuration.sigmaE);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file      MeshFitterLevels.cpp
+ *
+ * @brief     Test cases for the multi-resolution fitting of MeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+static MeshFitter::Configuration configuration() {
+  auto config = testConfiguration();
+
+  MeshFitter::Configuration::Level coarse;
+  coarse.vertexFraction = 0.25f;
+  coarse.volumeDownsampling = 2;
+  MeshFitter::Configuration::Level intermediate;
+  intermediate.vertexFraction = 0.5f;
+  config.levels = {coarse, intermediate};
+
+  return config;
+}
+
+TEST(MeshFitterLevels, MultiLevelFitConverges) {
+  auto const config = configuration();
+  MeshFitter const fitter{config};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const result = fitter.fit(volume);
+
+  EXPECT_TRUE(result.success);
+  EXPECT_TRUE(result.converged);
+  EXPECT_EQ(config.referenceMesh.vertexCount(),
+            result.deformedMesh.vertexCount());
+}
+
+TEST(MeshFitterLevels, RepeatedFitsAreIdentical) {
+  MeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+
+  // The second fit re-uses the coarse levels of the first one
+  auto const first = fitter.fit(volume);
+  auto const second = fitter.fit(volume);
+
+  ASSERT_TRUE(first.success);
+  ASSERT_TRUE(second.success);
+  EXPECT_EQ(vertices(first.deformedMesh), vertices(second.deformedMesh));
+}
+
+TEST(MeshFitterLevels, ReorderedMultiLevelFitConverges) {
+  auto config = configuration();
+  config.referenceMeshVertexOrdering = VertexOrdering::reverseCuthillMcKee;
+  MeshFitter const fitter{config};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const result = fitter.fit(volume);
+
+  EXPECT_TRUE(result.success);
+  EXPECT_TRUE(result.converged);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file      MeshFitterObserver.cpp
+ *
+ * @brief     Test cases for the iteration observer of MeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+static MeshFitter::Configuration configuration() {
+  auto config = testConfiguration();
+  // Needs several iterations to converge
+  config.sigmaS = 4;
+  return config;
+}
+
+TEST(MeshFitterObserver, CalledOncePerIteration) {
+  auto config = configuration();
+  std::vector<MeshFitter::IterationRecord> records;
+  config.iterationObserver = [&records](auto const &record) {
+    records.push_back(record);
+  };
+  MeshFitter const fitter{config};
+
+  auto const result = fitter.fit(VoxelVolume{volumeFile});
+
+  // `iteration` is one ahead of the completed iterations
+  ASSERT_EQ(result.iteration - 1, records.size());
+  ASSERT_GT(records.size(), 1u);
+  for (auto i = 0u; i < records.size(); ++i) {
+    EXPECT_EQ(i + 2, records[i].iteration);
+    EXPECT_EQ(i + 1 == records.size(), records[i].converged);
+  }
+  EXPECT_EQ(result.logLikelihood, records.back().logLikelihood);
+  EXPECT_EQ(result.effectiveSigmaS, records.back().effectiveSigmaS);
+}
+
+TEST(MeshFitterObserver, CanStopTheFit) {
+  CancellationToken token;
+  FitOptions options;
+  options.cancellationToken = token;
+
+  auto config = configuration();
+  std::size_t callCount = 0;
+  config.iterationObserver = [&callCount, token](auto const &) mutable {
+    if (++callCount == 2) token.cancel();
+  };
+  MeshFitter const fitter{config};
+
+  auto const result = fitter.fit(VoxelVolume{volumeFile}, options);
+
+  EXPECT_EQ(2u, callCount);
+  EXPECT_TRUE(result.interrupted);
+  EXPECT_FALSE(result.converged);
+}
+
+TEST(MeshFitterObserver, StoppedFitReturnsBestIteration) {
+  CancellationToken token;
+  FitOptions options;
+  options.cancellationToken = token;
+
+  auto config = configuration();
+  std::vector<MeshFitter::IterationRecord> records;
+  config.iterationObserver = [&records, token](auto const &record) mutable {
+    records.push_back(record);
+    if (records.size() == 4) token.cancel();
+  };
+  MeshFitter const fitter{config};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const result = fitter.fit(volume, options);
+  ASSERT_TRUE(result.interrupted);
+
+  auto const best = std::max_element(
+      records.begin(), records.end(), [](auto const &lhs, auto const &rhs) {
+        return lhs.logLikelihood < rhs.logLikelihood;
+      });
+  ASSERT_GE(result.logLikelihood, best->logLikelihood);
+  if (result.logLikelihood == best->logLikelihood) {
+    EXPECT_EQ(best->iteration, result.iteration);
+    EXPECT_EQ(best->effectiveSigmaS, result.effectiveSigmaS);
+  }
+
+  // The returned meshes and per-vertex data belong to the same iteration
+  auto state = fitter.init(volume);
+  while (state.iteration < result.iteration) { fitter.fitOneIteration(state); }
+  EXPECT_EQ(result.logLikelihood, state.logLikelihood);
+  EXPECT_EQ(vertices(state.deformedMesh), vertices(result.deformedMesh));
+  EXPECT_EQ(state.vertexNormals, result.vertexNormals);
+  EXPECT_EQ(state.volumeSamples, result.volumeSamples);
+  EXPECT_EQ(state.displacementVector, result.displacementVector);
+  EXPECT_EQ(state.weights, result.weights);
+}
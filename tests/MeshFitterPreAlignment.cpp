@@ -0,0 +1,140 @@
+/**
+ * @file      MeshFitterPreAlignment.cpp
+ *
+ * @brief     Test cases for the pre-alignment of MeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+/// Number of voxels per dimension of the test volume
+static constexpr std::uint32_t volumeDim = 64;
+/// Isotropic voxel size in mm
+static constexpr double voxelSize = 0.5;
+/// Radius of the sphere in mm
+static constexpr float sphereRadius = 8.f;
+/// Center of the sphere in mm
+static constexpr float sphereCenter = 0.5f * volumeDim * voxelSize;
+
+template <class T> static void writeBigEndian(std::ofstream &file, T value) {
+  std::array<char, sizeof(T)> bytes;
+  std::memcpy(bytes.data(), &value, sizeof(T));
+  std::reverse(bytes.begin(), bytes.end());
+  file.write(bytes.data(), sizeof(T));
+}
+
+/// Writes a cube shaped BST volume containing a dark sphere in a bright
+/// surrounding, the sphere is symmetric in all axes
+static void writeSphereVolume(std::string const &filename) {
+  std::ofstream file{filename, std::ios::binary};
+  for (std::uint32_t k = 0; k < 3; ++k) {
+    writeBigEndian(file, std::uint32_t{1});
+    writeBigEndian(file, volumeDim);
+  }
+  for (std::uint32_t k = 0; k < 3; ++k) { writeBigEndian(file, volumeDim); }
+  writeBigEndian(file, std::uint32_t{1});
+  for (std::uint32_t k = 0; k < 3; ++k) { writeBigEndian(file, voxelSize); }
+
+  for (std::uint32_t z = 0; z < volumeDim; ++z) {
+    for (std::uint32_t y = 0; y < volumeDim; ++y) {
+      for (std::uint32_t x = 0; x < volumeDim; ++x) {
+        auto const coord = [](std::uint32_t i) {
+          return static_cast<float>(i * voxelSize) - sphereCenter;
+        };
+        auto const radius = std::sqrt(
+            coord(x) * coord(x) + coord(y) * coord(y) + coord(z) * coord(z));
+        writeBigEndian(file, radius < sphereRadius ? 0.f : 1200.f);
+      }
+    }
+  }
+}
+
+/// Returns a sphere mesh centered at the origin with all labels set to 0
+static Mesh<float> sphereMesh() {
+  // Octahedron
+  Mesh<float> mesh{6, 8};
+  mesh.withUnsafeVertexPointer([](float *ptr) {
+    std::array<float, 18> const vertices = {
+        {1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1, 0, 0, 0, 1, 0, 0, -1}};
+    std::copy(vertices.begin(), vertices.end(), ptr);
+  });
+  mesh.withUnsafeIndexPointer([](auto *ptr) {
+    std::array<Mesh<float>::Index, 24> const indices = {
+        {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+         2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5}};
+    std::copy(indices.begin(), indices.end(), ptr);
+  });
+
+  mesh.upsample(3);
+
+  mesh.withUnsafeVertexPointer([&mesh](float *ptr) {
+    for (auto i = 0u; i < mesh.vertexCount(); ++i) {
+      auto *v = ptr + 3 * i;
+      auto const norm = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+      for (auto k = 0; k < 3; ++k) { v[k] *= sphereRadius / norm; }
+    }
+  });
+
+  return mesh;
+}
+
+static std::array<float, 3> centroid(Mesh<float> const &mesh) {
+  std::array<float, 3> sum{{0, 0, 0}};
+  for (auto const &v : vertices(mesh)) {
+    for (auto k = 0; k < 3; ++k) { sum[k] += v[k]; }
+  }
+  for (auto &s : sum) { s /= static_cast<float>(mesh.vertexCount()); }
+  return sum;
+}
+
+TEST(MeshFitterPreAlignment, RecoversRigidOffset) {
+  using namespace std::string_literals;
+  using Configuration = MeshFitter::Configuration;
+
+  std::string const volumeFilename = std::tmpnam(nullptr) + ".bst"s;
+  writeSphereVolume(volumeFilename);
+  auto const volume = VoxelVolume{volumeFilename};
+  std::remove(volumeFilename.c_str());
+
+  // Place the mesh off center
+  std::array<float, 3> const offset{{4.f, -4.f, 4.f}};
+  auto config = testConfiguration();
+  config.referenceMesh = sphereMesh();
+  config.referenceMeshOrigin = Coordinate3D{
+      {{sphereCenter + offset[0], sphereCenter + offset[1],
+        sphereCenter + offset[2]}},
+      Coordinate3D::Type::absolute};
+  // The displacements of the test model are quantized to 4 mm, so each ICP
+  // iteration only moves the mesh by a fraction of a millimeter
+  config.sigmaS = 4;
+  config.preAlignment.type = Configuration::AlignmentType::rigid;
+  config.preAlignment.iterations = 200;
+  config.maxIterations = 1;
+
+  MeshFitter const fitter{config};
+  auto const result = fitter.fit(volume);
+
+  // The aligned reference mesh is centered in the sphere
+  auto const center = centroid(result.referenceMesh);
+  for (auto k = 0; k < 3; ++k) { EXPECT_NEAR(sphereCenter, center[k], 0.1f); }
+}
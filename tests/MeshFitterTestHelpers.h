@@ -0,0 +1,64 @@
+/**
+ * @file      MeshFitterTestHelpers.h
+ *
+ * @brief     This header contains fixtures shared by the MeshFitter tests
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#pragma once
+
+#include "tests_config.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+#ifndef CortidQCT_DATADIR
+#  error "No data dir given"
+#endif
+
+namespace CortidQCT {
+namespace Test {
+
+static std::string const configFile =
+    std::string(CortidQCT_DATADIR) + "/testConfig.yml";
+static std::string const volumeFile =
+    std::string(CortidQCT_DATADIR) + "/ascendingSlices.bst";
+
+/// Replaces the labels of `mesh` that are not covered by the test model
+inline void restrictToModelLabels(Mesh<float> &mesh) {
+  // The test model only covers the labels 0 and 1
+  mesh.withUnsafeLabelPointer([&mesh](auto *labels) {
+    std::replace_if(
+        labels, labels + mesh.vertexCount(),
+        [](auto label) { return label > 1; }, 0);
+  });
+}
+
+/// Returns the test configuration, restricted to the labels of the model
+inline MeshFitter::Configuration testConfiguration() {
+  auto config = MeshFitter::Configuration::fromFile(configFile);
+  restrictToModelLabels(config.referenceMesh);
+  return config;
+}
+
+/// Returns a copy of the vertices of the given mesh
+inline std::vector<std::array<float, 3>> vertices(Mesh<float> const &mesh) {
+  return mesh.withUnsafeVertexPointer([&mesh](float const *ptr) {
+    std::vector<std::array<float, 3>> result(mesh.vertexCount());
+    for (auto i = 0u; i < result.size(); ++i) {
+      std::copy_n(ptr + 3 * i, 3, result[i].data());
+    }
+    return result;
+  });
+}
+
+} // namespace Test
+} // namespace CortidQCT
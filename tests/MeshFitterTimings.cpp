@@ -0,0 +1,81 @@
+/**
+ * @file      MeshFitterTimings.cpp
+ *
+ * @brief     Test cases for the stage timings of MeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+using StageTimings = MeshFitter::StageTimings;
+
+static std::vector<double StageTimings::*> const stages = {
+    &StageTimings::volumeSampling,       &StageTimings::displacements,
+    &StageTimings::deformation,          &StageTimings::deformationSetup,
+    &StageTimings::deformationSolve,     &StageTimings::deformationRotations,
+    &StageTimings::deformationEnergy,    &StageTimings::selfIntersections,
+    &StageTimings::logLikelihood};
+
+/// Adds the timings in order, i.e. rounded like the total of the fit
+static StageTimings sum(std::vector<StageTimings> const &timings,
+                        StageTimings result = {}) {
+  for (auto const &t : timings) { result += t; }
+  return result;
+}
+
+TEST(MeshFitterTimings, TotalIsSumOfIterations) {
+  auto config = testConfiguration();
+  // Needs several iterations to converge
+  config.sigmaS = 4;
+  config.detectSelfIntersections = true;
+  MeshFitter const fitter{config};
+
+  auto state = fitter.init(VoxelVolume{volumeFile});
+  // The initial volume sampling is not part of an iteration
+  auto const initial = state.totalTimings;
+  for (auto const stage : stages) {
+    if (stage != &StageTimings::volumeSampling) {
+      EXPECT_EQ(0.0, initial.*stage);
+    }
+  }
+
+  auto const result = fitter.resume(state);
+
+  ASSERT_EQ(result.iteration - 1, result.iterationTimings.size());
+  ASSERT_GT(result.iterationTimings.size(), 1u);
+
+  auto const expected = sum(result.iterationTimings, initial);
+  for (auto const stage : stages) {
+    EXPECT_DOUBLE_EQ(expected.*stage, result.totalTimings.*stage);
+  }
+}
+
+TEST(MeshFitterTimings, FitIncludesInitialSampling) {
+  auto config = testConfiguration();
+  config.sigmaS = 4;
+  MeshFitter const fitter{config};
+
+  auto const result = fitter.fit(VoxelVolume{volumeFile});
+  auto const iterations = sum(result.iterationTimings);
+
+  for (auto const stage : stages) {
+    if (stage == &StageTimings::volumeSampling) {
+      EXPECT_GE(result.totalTimings.*stage, iterations.*stage);
+    } else {
+      EXPECT_DOUBLE_EQ(iterations.*stage, result.totalTimings.*stage);
+    }
+  }
+}
@@ -0,0 +1,83 @@
+/**
+ * @file      MeshFitterWarmStart.cpp
+ *
+ * @brief     Test cases for warm starting MeshFitter from a previous result
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+TEST(MeshFitterWarmStart, StartsAtTransformedPrior) {
+  MeshFitter const fitter{testConfiguration()};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const prior = fitter.fit(volume);
+  ASSERT_TRUE(prior.success);
+
+  // Rotation by 90 degrees about the z axis
+  RigidTransform transform;
+  transform.rotation = {{0, -1, 0, 1, 0, 0, 0, 0, 1}};
+  transform.translation = {{1, 2, 3}};
+
+  auto const state = fitter.init(volume, prior, transform);
+
+  auto const priorVertices = vertices(prior.deformedMesh);
+  auto const stateVertices = vertices(state.deformedMesh);
+  ASSERT_EQ(priorVertices.size(), stateVertices.size());
+  for (auto i = 0u; i < priorVertices.size(); ++i) {
+    auto const &p = priorVertices[i];
+    EXPECT_FLOAT_EQ(-p[1] + 1, stateVertices[i][0]);
+    EXPECT_FLOAT_EQ(p[0] + 2, stateVertices[i][1]);
+    EXPECT_FLOAT_EQ(p[2] + 3, stateVertices[i][2]);
+  }
+
+  // The reference mesh is not affected by the prior
+  auto const coldState = fitter.init(volume);
+  EXPECT_EQ(vertices(coldState.referenceMesh), vertices(state.referenceMesh));
+
+  EXPECT_EQ(prior.effectiveSigmaS, state.effectiveSigmaS);
+  EXPECT_EQ(1u, state.iteration);
+  EXPECT_FALSE(state.converged);
+}
+
+TEST(MeshFitterWarmStart, MapsPriorToReorderedVertices) {
+  auto config = testConfiguration();
+  config.referenceMeshVertexOrdering = VertexOrdering::hilbertCurve;
+  MeshFitter const fitter{config};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const prior = fitter.fit(volume);
+  auto const state = fitter.init(volume, prior);
+
+  // The state is reordered, the warm started result is not
+  auto const result = fitter.resume(state);
+  EXPECT_TRUE(result.success);
+  EXPECT_EQ(vertices(prior.referenceMesh), vertices(result.referenceMesh));
+
+  auto priorVertices = vertices(prior.deformedMesh);
+  auto stateVertices = vertices(state.deformedMesh);
+  std::sort(priorVertices.begin(), priorVertices.end());
+  std::sort(stateVertices.begin(), stateVertices.end());
+  EXPECT_EQ(priorVertices, stateVertices);
+}
+
+TEST(MeshFitterWarmStart, RejectsMismatchingPrior) {
+  MeshFitter const fitter{testConfiguration()};
+  auto const volume = VoxelVolume{volumeFile};
+
+  EXPECT_THROW(fitter.init(volume, MeshFitter::Result{}),
+               std::invalid_argument);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file      MultiMeshFitter.cpp
+ *
+ * @brief     Test cases for MultiMeshFitter
+ *
+ * @author    Stefan Reinhold
+ * @copyright Copyright (C) 2019 Stefan Reinhold  -- All Rights Reserved.
+ *            You may use, distribute and modify this code under the terms of
+ *            the AFL 3.0 license; see LICENSE for full license details.
+ */
+
+#include "MeshFitterTestHelpers.h"
+
+#include <CortidQCT/CortidQCT.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+using namespace CortidQCT;
+using namespace CortidQCT::Test;
+
+static std::string const multiConfigFile =
+    std::string(CortidQCT_DATADIR) + "/testMultiConfig.yml";
+
+static MultiMeshFitter::Configuration configuration() {
+  auto config = MultiMeshFitter::Configuration::fromFile(multiConfigFile);
+  for (auto &instance : config.instances) {
+    restrictToModelLabels(instance.configuration.referenceMesh);
+  }
+  return config;
+}
+
+TEST(MultiMeshFitter, FitsEveryInstance) {
+  MultiMeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+
+  auto const results = fitter.fit(volume);
+
+  auto const &instances = fitter.configuration.instances;
+  ASSERT_EQ(instances.size(), results.size());
+  for (auto i = 0u; i < instances.size(); ++i) {
+    auto const expected = MeshFitter{instances[i].configuration}.fit(volume);
+    EXPECT_TRUE(results[i].success);
+    EXPECT_EQ(expected.iteration, results[i].iteration);
+
+    // The results are in the order of the instances
+    auto const expectedVertices = vertices(expected.deformedMesh);
+    auto const resultVertices = vertices(results[i].deformedMesh);
+    ASSERT_EQ(expectedVertices.size(), resultVertices.size());
+    for (auto j = 0u; j < expectedVertices.size(); ++j) {
+      for (auto k = 0u; k < 3; ++k) {
+        EXPECT_NEAR(expectedVertices[j][k], resultVertices[j][k], 1e-3f);
+      }
+    }
+  }
+
+  // The instances are placed at different origins
+  EXPECT_NE(vertices(results[0].deformedMesh),
+            vertices(results[1].deformedMesh));
+}
+
+TEST(MultiMeshFitter, RejectsCheckpoints) {
+  MultiMeshFitter const fitter{configuration()};
+  auto const volume = VoxelVolume{volumeFile};
+
+  FitOptions options;
+  options.checkpointFile = "checkpoint";
+
+  EXPECT_THROW(fitter.fit(volume, options), std::invalid_argument);
+}
@@ -81,3 +81,35 @@ TEST(VoxelVolume, LoadFromFileThrowsOnNonExistentFile) {
 
   ASSERT_THROW(VoxelVolume{"non-existant-file.bst"}, std::invalid_argument);
 }
+
+TEST(VoxelVolume, DownsamplePreservesLinearRamp) {
+  auto volume = VoxelVolume{file1};
+
+  ASSERT_THROW(volume.downsample(0), std::invalid_argument);
+
+  volume.downsample(2);
+
+  ASSERT_EQ((VolumeSize{10, 20, 5}), volume.size());
+  ASSERT_FLOAT_EQ(2.f * voxelSize1.width, volume.voxelSize().width);
+  ASSERT_FLOAT_EQ(2.f * voxelSize1.height, volume.voxelSize().height);
+  ASSERT_FLOAT_EQ(2.f * voxelSize1.depth, volume.voxelSize().depth);
+
+  // The mean over a centered box equals the ramp at its center, except at
+  // the lower border where the box is clamped
+  volume.withUnsafeDataPointer([&](float const *data) {
+    auto const size = volume.size();
+    for (auto z = 1u; z < size.depth; ++z) {
+      for (auto y = 1u; y < size.height; ++y) {
+        for (auto x = 1u; x < size.width; ++x) {
+          auto const ref = -2000.f + static_cast<float>(2 * y) * 0.5f +
+                           static_cast<float>(2 * x) * 20.f +
+                           static_cast<float>(2 * z) * 400.f;
+          ASSERT_FLOAT_EQ(ref, data[(z * size.height + y) * size.width + x]);
+        }
+      }
+    }
+    // Voxel (0, 1, 1), box [0, 1] along x
+    ASSERT_FLOAT_EQ(-2000.f + 10.f + 1.f + 800.f,
+                    data[(size.height + 1) * size.width]);
+  });
+}
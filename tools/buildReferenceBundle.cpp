@@ -0,0 +1,39 @@
+#include <CortidQCT/CortidQCT.h>
+
+#include "CheckExtension.h"
+#include "ReferenceMeshBundle.h"
+
+#include <iostream>
+
+int main(int argc, char **argv) {
+  using namespace CortidQCT;
+
+  if (argc != 3 && argc != 4) {
+    std::cerr << "Usage: BuildReferenceBundle <InputMesh> [InputLabels] "
+                 "<OutputBundle.refmesh>"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try {
+    // Loading orients the mesh outwards
+    auto mesh = Mesh<float>{};
+    if (argc == 3) {
+      mesh.loadFromFile(argv[1]);
+    } else if (IO::extension(argv[2], true) == "yml" ||
+               IO::extension(argv[2], true) == "yaml") {
+      auto const map = ColorToLabelMaps::CustomMap::fromFile(argv[2]);
+      mesh.loadFromFile(argv[1], map);
+    } else {
+      mesh.loadFromFile(argv[1], argv[2]);
+    }
+
+    Internal::writeReferenceMeshBundle(mesh, argv[argc - 1]);
+
+  } catch (std::exception const &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}